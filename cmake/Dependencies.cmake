@@ -33,7 +33,7 @@ find_package(Boost CONFIG REQUIRED # Rational numbers, improved containers, stri
 	COMPONENTS container)
 find_package(Freetype REQUIRED) # Font file processing
 find_package(harfbuzz CONFIG REQUIRED) # Text shaping
-find_package(FFMPEG REQUIRED) # Sample rate conversion, audio file decoding
+find_package(FFMPEG REQUIRED) # Sample rate conversion, audio and video file decoding
 find_package(magic_enum CONFIG REQUIRED) # Enum reflection
 find_package(libassert CONFIG REQUIRED) # Smarter assert macros
 find_package(mio CONFIG REQUIRED) # Memory-mapped disk IO
@@ -92,9 +92,13 @@ FetchContent_MakeAvailable(signalsmith-basics)
 set(LIBCORO_FEATURE_NETWORKING OFF CACHE BOOL "" FORCE)
 set(LIBCORO_BUILD_EXAMPLES OFF CACHE BOOL "" FORCE)
 set(LIBCORO_BUILD_TESTS OFF CACHE BOOL "" FORCE)
+# PatchLibcoro.cmake edits coro/task.hpp as laid out at this commit. When bumping it, check that
+# the patched promise still gets its allocation functions, e.g. via the "pooled" count of
+# get_coro_frame_stats() after running a task.
 FetchContent_Declare(libcoro # Coroutine primitives
 	GIT_REPOSITORY https://github.com/jbaldwin/libcoro
 	GIT_TAG 7e0ce982405fb26b6ca8af97f40a8eaa2b78c4fa
+	PATCH_COMMAND ${CMAKE_COMMAND} -DLIBCORO_DIR=<SOURCE_DIR> -P ${CMAKE_CURRENT_LIST_DIR}/PatchLibcoro.cmake
 	EXCLUDE_FROM_ALL
 )
 FetchContent_MakeAvailable(libcoro)
@@ -103,11 +107,15 @@ set(MSDF_ATLAS_BUILD_STANDALONE OFF CACHE BOOL "" FORCE)
 set(MSDF_ATLAS_DYNAMIC_RUNTIME ON CACHE BOOL "" FORCE)
 set(MSDF_ATLAS_NO_ARTERY_FONT ON CACHE BOOL "" FORCE)
 set(MSDF_ATLAS_USE_SKIA OFF CACHE BOOL "" FORCE)
+set(MSDF_ATLAS_GEN_VERSION v1.3) # Also pins the bundled msdfgen
 FetchContent_Declare(msdf-atlas-gen # Font atlas generation
 	GIT_REPOSITORY https://github.com/Chlumsky/msdf-atlas-gen
-	GIT_TAG v1.3
+	GIT_TAG ${MSDF_ATLAS_GEN_VERSION}
 )
 FetchContent_MakeAvailable(msdf-atlas-gen)
+# Glyph caches rasterized by a different version are discarded
+set_property(SOURCE ${PROJECT_SOURCE_DIR}/src/lib/msdf.cpp APPEND PROPERTY
+	COMPILE_DEFINITIONS "MSDF_ATLAS_GEN_VERSION=\"${MSDF_ATLAS_GEN_VERSION}\"")
 
 # Remote assets
 
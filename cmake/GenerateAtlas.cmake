@@ -7,36 +7,21 @@
 
 include_guard()
 
-include(cmake/Dependencies.cmake)
+include(cmake/PlaynoteCore.cmake)
 
 add_executable(GenerateAtlas
 	src/lib/harfbuzz.cpp
 	src/lib/msdf.cpp
-	src/lib/icu.cpp
-	src/io/file.cpp
 	src/gfx/text.cpp
-	src/utils/logger.cpp
 	tools/generate_atlas.cpp
 )
 target_link_libraries(GenerateAtlas
-	PRIVATE readerwriterqueue::readerwriterqueue
-	PRIVATE concurrentqueue::concurrentqueue
+	PRIVATE PlaynoteCore
 	PRIVATE msdf-atlas-gen::msdf-atlas-gen
-	PRIVATE magic_enum::magic_enum
-	PRIVATE libassert::assert
 	PRIVATE Freetype::Freetype
 	PRIVATE harfbuzz::harfbuzz
-	PRIVATE libcoro
-	PRIVATE Boost::container
-	PRIVATE Boost::boost
-	PRIVATE quill::quill
-	PRIVATE ICU::i18n
-	PRIVATE ICU::uc
 )
-target_include_directories(Playnote
-	PRIVATE ${ZPP_BITS_INCLUDE_DIRS}
-)
-target_include_directories(GenerateAtlas PRIVATE src)
+target_include_directories(GenerateAtlas PRIVATE tools)
 
 function(generate_atlas)
 	cmake_parse_arguments(ARG "" "OUTPUT" "FONTS" ${ARGN})
@@ -53,10 +38,14 @@ function(generate_atlas)
 		list(APPEND ABS_INPUTS "${ABS_INPUT}")
 	endforeach()
 
+	# Glyphs from previous runs are reused, so only new or changed glyphs are rasterized
+	set(GLYPH_CACHE ${ARG_OUTPUT}.glyphs)
+
 	add_custom_command(
 		OUTPUT ${ARG_OUTPUT}
+		BYPRODUCTS ${GLYPH_CACHE}
 		COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
-		COMMAND GenerateAtlas ${ARG_OUTPUT} ${ABS_INPUTS}
+		COMMAND GenerateAtlas --cache ${GLYPH_CACHE} ${ARG_OUTPUT} ${ABS_INPUTS}
 		DEPENDS ${ARG_FONTS} $<TARGET_FILE:GenerateAtlas>
 		COMMENT "Generating font atlas cache at ${ARG_OUTPUT}"
 		VERBATIM
@@ -0,0 +1,18 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Reproducible synthetic BMS songs, for benchmarks and stress tests
+add_executable(GenerateCorpus
+	tools/corpus.cpp
+	tools/generate_corpus.cpp
+)
+set_target_properties(GenerateCorpus PROPERTIES OUTPUT_NAME playnote-corpus)
+target_link_libraries(GenerateCorpus PRIVATE PlaynoteCore)
@@ -7,31 +7,17 @@
 
 include_guard()
 
-include(cmake/Dependencies.cmake)
+include(cmake/PlaynoteCore.cmake)
 
 add_executable(PackAssets
-	src/lib/sqlite.cpp
-	src/lib/zstd.cpp
-	src/io/file.cpp
 	tools/pack_assets.cpp
 )
-target_link_libraries(PackAssets
-	PRIVATE readerwriterqueue::readerwriterqueue
-	PRIVATE concurrentqueue::concurrentqueue
-	PRIVATE unofficial::sqlite3::sqlite3
-	PRIVATE magic_enum::magic_enum
-	PRIVATE libassert::assert
-	PRIVATE libcoro
-	PRIVATE Boost::container
-	PRIVATE Boost::boost
-	PRIVATE zstd::libzstd
-)
-target_include_directories(PackAssets PRIVATE src)
+target_link_libraries(PackAssets PRIVATE PlaynoteCore)
 
 function(pack_assets)
-	cmake_parse_arguments(ARG "" "OUTPUT" "RAW;COMPRESS" ${ARGN})
-	if(NOT ARG_OUTPUT OR (NOT ARG_RAW AND NOT ARG_COMPRESS))
-		message(FATAL_ERROR "Usage: pack_assets(OUTPUT <db_file> [RAW <assets...>] [COMPRESS <assets...>])")
+	cmake_parse_arguments(ARG "" "OUTPUT" "RAW;COMPRESS;COMPRESS_SHARED" ${ARGN})
+	if(NOT ARG_OUTPUT OR (NOT ARG_RAW AND NOT ARG_COMPRESS AND NOT ARG_COMPRESS_SHARED))
+		message(FATAL_ERROR "Usage: pack_assets(OUTPUT <pack_file> [RAW <assets...>] [COMPRESS <assets...>] [COMPRESS_SHARED <assets...>])")
 	endif()
 
 	get_filename_component(OUTPUT_DIR ${ARG_OUTPUT} DIRECTORY)
@@ -47,6 +33,12 @@ function(pack_assets)
 		list(APPEND ALL_INPUTS "${ABS_INPUT}:z")
 		list(APPEND DEPENDS_LIST "${ABS_INPUT}")
 	endforeach()
+	# Compressed with a dictionary trained on all of them; best for many small, similar assets
+	foreach(INPUT IN LISTS ARG_COMPRESS_SHARED)
+		get_filename_component(ABS_INPUT "${INPUT}" ABSOLUTE)
+		list(APPEND ALL_INPUTS "${ABS_INPUT}:d")
+		list(APPEND DEPENDS_LIST "${ABS_INPUT}")
+	endforeach()
 
 	add_custom_command(
 		OUTPUT ${ARG_OUTPUT}
@@ -0,0 +1,42 @@
+# Patch step of the libcoro dependency, run in script mode with LIBCORO_DIR set to its source
+# directory. Gives the promise of coro::task an allocation function that serves coroutine frames
+# from Playnote's frame pool (src/utils/frame_pool.cpp). Every target that links libcoro
+# must compile the frame pool. Running it again on an already patched tree does nothing.
+# Written against the libcoro commit pinned in Dependencies.cmake; revisit it whenever that changes.
+
+set(TASK_HEADER "${LIBCORO_DIR}/include/coro/task.hpp")
+file(READ "${TASK_HEADER}" TASK_SOURCE)
+if(TASK_SOURCE MATCHES "allocate_coro_frame")
+	return()
+endif()
+
+string(FIND "${TASK_SOURCE}" "namespace coro" NAMESPACE_POS)
+string(FIND "${TASK_SOURCE}" "struct promise_base" PROMISE_POS)
+if(NAMESPACE_POS EQUAL -1 OR PROMISE_POS EQUAL -1)
+	message(FATAL_ERROR "Unexpected layout of ${TASK_HEADER}; cmake/PatchLibcoro.cmake needs updating")
+endif()
+string(SUBSTRING "${TASK_SOURCE}" ${PROMISE_POS} -1 PROMISE_SOURCE)
+string(FIND "${PROMISE_SOURCE}" "{" BRACE_OFFSET)
+math(EXPR BODY_POS "${PROMISE_POS} + ${BRACE_OFFSET} + 1")
+
+string(SUBSTRING "${TASK_SOURCE}" 0 ${NAMESPACE_POS} HEAD)
+math(EXPR MIDDLE_LENGTH "${BODY_POS} - ${NAMESPACE_POS}")
+string(SUBSTRING "${TASK_SOURCE}" ${NAMESPACE_POS} ${MIDDLE_LENGTH} MIDDLE)
+string(SUBSTRING "${TASK_SOURCE}" ${BODY_POS} -1 TAIL)
+
+set(DECLARATIONS [=[
+#include <cstddef>
+
+namespace playnote
+{
+[[nodiscard]] auto allocate_coro_frame(std::size_t) -> void*;
+void free_coro_frame(void*, std::size_t) noexcept;
+} // namespace playnote
+
+]=])
+set(ALLOCATION_FUNCTIONS [=[
+
+    static auto operator new(std::size_t size) -> void* { return ::playnote::allocate_coro_frame(size); }
+    static auto operator delete(void* ptr, std::size_t size) noexcept -> void { ::playnote::free_coro_frame(ptr, size); }
+]=])
+file(WRITE "${TASK_HEADER}" "${HEAD}${DECLARATIONS}${MIDDLE}${ALLOCATION_FUNCTIONS}${TAIL}")
@@ -0,0 +1,19 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Headless chart analysis, without a library, window, GPU or audio device
+add_executable(PlaynoteAnalyze
+	tools/analyze.cpp
+)
+set_target_properties(PlaynoteAnalyze PROPERTIES OUTPUT_NAME playnote-analyze)
+target_precompile_headers(PlaynoteAnalyze PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteAnalyze PRIVATE tools)
+target_link_libraries(PlaynoteAnalyze PRIVATE PlaynoteCore)
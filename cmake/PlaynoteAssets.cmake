@@ -47,9 +47,9 @@ set(PLAYNOTE_FONT_ATLAS_CACHE ${PROJECT_BINARY_DIR}/$<CONFIG>/generated/font_atl
 generate_atlas(OUTPUT ${PLAYNOTE_FONT_ATLAS_CACHE} FONTS
 	${PLAYNOTE_FONT_OUTPUTS})
 
-# Pack into an asset database
-set(PLAYNOTE_ASSET_DB ${PROJECT_BINARY_DIR}/$<CONFIG>/assets.db)
-pack_assets(OUTPUT ${PLAYNOTE_ASSET_DB}
+# Pack into an asset pack
+set(PLAYNOTE_ASSET_PACK ${PROJECT_BINARY_DIR}/$<CONFIG>/assets.pak)
+pack_assets(OUTPUT ${PLAYNOTE_ASSET_PACK}
 	RAW
 		${PLAYNOTE_FONT_OUTPUTS}
 		${unifont_SOURCE_DIR}/unifont-16.0.04.ttf
@@ -57,4 +57,4 @@ pack_assets(OUTPUT ${PLAYNOTE_ASSET_DB}
 		${PLAYNOTE_FONT_ATLAS_CACHE}
 )
 
-add_custom_target(PlaynoteAssets DEPENDS ${PLAYNOTE_SHADER_OUTPUTS} ${PLAYNOTE_ASSET_DB})
+add_custom_target(PlaynoteAssets DEPENDS ${PLAYNOTE_SHADER_OUTPUTS} ${PLAYNOTE_ASSET_PACK})
@@ -0,0 +1,20 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Polyphony stress test of the audio engine, rendering into an offline sink
+add_executable(PlaynoteAudioStress
+	tools/corpus.cpp
+	tools/audio_stress.cpp
+)
+set_target_properties(PlaynoteAudioStress PROPERTIES OUTPUT_NAME playnote-audio-stress)
+target_precompile_headers(PlaynoteAudioStress PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteAudioStress PRIVATE tools)
+target_link_libraries(PlaynoteAudioStress PRIVATE PlaynoteCore)
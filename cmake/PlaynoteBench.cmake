@@ -0,0 +1,51 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+find_package(benchmark CONFIG REQUIRED) # Microbenchmark harness
+find_package(nlohmann_json CONFIG REQUIRED) # Baseline parsing
+
+# Microbenchmarks of the chart and playback core, on generated inputs
+add_executable(PlaynoteBench
+	tools/corpus.cpp
+	tools/bench/fixtures.cpp
+	tools/bench/baseline.cpp
+	tools/bench/chart.cpp
+	tools/bench/audio.cpp
+	tools/bench/bga.cpp
+	tools/bench/similarity.cpp
+	tools/bench/config.cpp
+	tools/bench/broadcaster.cpp
+	tools/bench/coro.cpp
+	tools/bench/scheduler.cpp
+	tools/bench/memory.cpp
+	tools/bench/alloc_audit.cpp
+	tools/bench/tracing.cpp
+	tools/bench/player.cpp
+	tools/bench/main.cpp
+)
+set_target_properties(PlaynoteBench PROPERTIES OUTPUT_NAME playnote-bench)
+target_precompile_headers(PlaynoteBench PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteBench PRIVATE tools)
+target_link_libraries(PlaynoteBench
+	PRIVATE PlaynoteCore
+	PRIVATE benchmark::benchmark
+	PRIVATE nlohmann_json::nlohmann_json
+)
+
+# Benchmarks that double as checks, runnable with ctest. A single iteration each is enough,
+# since any failed check fails the whole binary.
+enable_testing()
+add_test(NAME memory_attribution
+	COMMAND PlaynoteBench "--benchmark_filter=^(tracked_vector_|chart_media_attribution)" --benchmark_min_time=1x)
+if(PLAYNOTE_ALLOC_AUDIT)
+	add_test(NAME steady_state_allocations
+		COMMAND PlaynoteBench "--benchmark_filter=_without_allocating" --benchmark_min_time=1x)
+endif()
@@ -0,0 +1,124 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/Dependencies.cmake)
+
+# Chart, audio and library code shared by the game and all tools, compiled once. Build type,
+# tracing and allocation audit defines are public, so that every user sees the same headers.
+add_library(PlaynoteCore STATIC
+	src/lib/signalsmith.cpp
+	src/lib/archive.cpp
+	src/lib/ebur128.cpp
+	src/lib/openssl.cpp
+	src/lib/sqlite.cpp
+	src/lib/ffmpeg.cpp
+	src/lib/vulkan.cpp
+	src/lib/glfw.cpp
+	src/lib/zstd.cpp
+	src/lib/icu.cpp
+	src/lib/os.cpp
+	src/dev/audio.cpp
+	src/io/source.cpp
+	src/io/file.cpp
+	src/io/song.cpp
+	src/io/audio_store.cpp
+	src/audio/renderer.cpp
+	src/audio/player.cpp
+	src/audio/mixer.cpp
+	src/bms/builder.cpp
+	src/bms/bga.cpp
+	src/bms/ghost.cpp
+	src/bms/density.cpp
+	src/bms/similarity.cpp
+	src/bms/import_job.cpp
+	src/bms/import_workers.cpp
+	src/bms/library.cpp
+	src/bms/cursor.cpp
+	src/bms/mapper.cpp
+	src/bms/score.cpp
+	src/utils/frame_pool.cpp
+	src/utils/scheduler.cpp
+	src/utils/tracing.cpp
+	src/utils/memory.cpp
+	src/utils/alloc_audit.cpp
+	src/utils/config.cpp
+	src/utils/logger.cpp
+)
+if(NOT WIN32)
+	target_sources(PlaynoteCore PRIVATE
+		src/lib/pipewire.cpp)
+else()
+	target_sources(PlaynoteCore PRIVATE
+		src/lib/wasapi.cpp)
+endif()
+set_target_properties(PlaynoteCore PROPERTIES OUTPUT_NAME playnote-core)
+target_precompile_headers(PlaynoteCore PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteCore PUBLIC src) # All includes start from src as root
+target_compile_definitions(PlaynoteCore PUBLIC "$<$<CONFIG:Debug>:BUILD_DEBUG>$<$<CONFIG:RelWithDebInfo>:BUILD_RELDEB>$<$<CONFIG:Release>:BUILD_RELEASE>")
+if(PLAYNOTE_TRACING)
+	target_compile_definitions(PlaynoteCore PUBLIC ENABLE_TRACING)
+endif()
+if(PLAYNOTE_ALLOC_AUDIT)
+	target_compile_definitions(PlaynoteCore PUBLIC ENABLE_ALLOC_AUDIT)
+endif()
+target_link_libraries(PlaynoteCore
+	PUBLIC signalsmith-basics
+	PUBLIC readerwriterqueue::readerwriterqueue
+	PUBLIC concurrentqueue::concurrentqueue
+	PUBLIC tomlplusplus::tomlplusplus
+	PUBLIC vk-bootstrap
+	PUBLIC LibArchive::LibArchive
+	PUBLIC magic_enum::magic_enum
+	PUBLIC libassert::assert
+	PUBLIC OpenSSL::Crypto
+	PUBLIC PkgConfig::ebur128
+	PUBLIC libcoro
+	PUBLIC unofficial::sqlite3::sqlite3
+	PUBLIC Vulkan::Headers
+	PUBLIC Boost::container
+	PUBLIC Boost::boost
+	PUBLIC quill::quill
+	PUBLIC zstd::libzstd
+	PUBLIC volk::volk_headers
+	PUBLIC volk::volk
+	PUBLIC glfw
+	PUBLIC ICU::i18n
+	PUBLIC ICU::uc
+	PUBLIC mio::mio-headers
+	PUBLIC mio::mio
+	PUBLIC ${FFMPEG_LIBRARIES}
+)
+if(NOT WIN32)
+	target_link_libraries(PlaynoteCore
+		PUBLIC Fontconfig::Fontconfig
+		PUBLIC PkgConfig::PipeWire
+	)
+else()
+	target_link_libraries(PlaynoteCore
+		PUBLIC dwrite
+		PUBLIC ksuser
+		PUBLIC winmm
+		PUBLIC avrt
+	)
+endif()
+# The allocation auditor replaces operator new, which conflicts with mimalloc's override.
+# Linked publicly, so that the override ends up in every executable.
+if(NOT PLAYNOTE_ALLOC_AUDIT)
+	if(NOT WIN32)
+		target_link_libraries(PlaynoteCore PUBLIC mimalloc-static)
+	else()
+		target_link_libraries(PlaynoteCore PUBLIC mimalloc)
+	endif()
+endif()
+target_include_directories(PlaynoteCore
+	PUBLIC ${FFMPEG_INCLUDE_DIRS}
+	PUBLIC ${ZPP_BITS_INCLUDE_DIRS}
+	PUBLIC ${PLF_COLONY_INCLUDE_DIRS}
+)
+target_link_directories(PlaynoteCore PUBLIC ${FFMPEG_LIBRARY_DIRS})
@@ -0,0 +1,19 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Headless library import, without a window, GPU or audio device
+add_executable(PlaynoteImport
+	tools/import.cpp
+)
+set_target_properties(PlaynoteImport PROPERTIES OUTPUT_NAME playnote-import)
+target_precompile_headers(PlaynoteImport PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteImport PRIVATE tools)
+target_link_libraries(PlaynoteImport PRIVATE PlaynoteCore)
@@ -0,0 +1,20 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# End-to-end import throughput benchmark over a generated corpus
+add_executable(PlaynoteImportBench
+	tools/corpus.cpp
+	tools/import_bench.cpp
+)
+set_target_properties(PlaynoteImportBench PROPERTIES OUTPUT_NAME playnote-import-bench)
+target_precompile_headers(PlaynoteImportBench PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteImportBench PRIVATE tools)
+target_link_libraries(PlaynoteImportBench PRIVATE PlaynoteCore)
@@ -0,0 +1,18 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Import worker process, running import jobs on behalf of the game or playnote-import
+add_executable(PlaynoteImportWorker
+	tools/import_worker.cpp
+)
+set_target_properties(PlaynoteImportWorker PROPERTIES OUTPUT_NAME playnote-import-worker)
+target_precompile_headers(PlaynoteImportWorker PRIVATE src/preamble.hpp)
+target_link_libraries(PlaynoteImportWorker PRIVATE PlaynoteCore)
@@ -0,0 +1,19 @@
+# Copyright (c) 2026 Tearnote (Hubert Maraszek)
+#
+# Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+# or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+# or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+# or distributed except according to those terms.
+
+include_guard()
+
+include(cmake/PlaynoteCore.cmake)
+
+# Chart hot-reload for chart authors, playing back on autoplay
+add_executable(PlaynoteWatch
+	tools/watch.cpp
+)
+set_target_properties(PlaynoteWatch PROPERTIES OUTPUT_NAME playnote-watch)
+target_precompile_headers(PlaynoteWatch PRIVATE src/preamble.hpp)
+target_include_directories(PlaynoteWatch PRIVATE tools)
+target_link_libraries(PlaynoteWatch PRIVATE PlaynoteCore)
@@ -10,6 +10,8 @@ or distributed except according to those terms.
 #include "audio/mixer.hpp"
 
 #include "preamble.hpp"
+#include "utils/alloc_audit.hpp"
+#include "utils/tracing.hpp"
 
 namespace playnote::audio {
 
@@ -21,11 +23,21 @@ Mixer::Mixer(Logger::Category cat):
 	limiter{audio.get_sampling_rate(), 1ms, 10ms, 100ms}
 {}
 
+Mixer::Mixer(Logger::Category cat, dev::Audio::OfflineSink sink):
+	cat{cat},
+	audio{cat, [this](span<dev::Sample> buffer) { this->mix(buffer); }, sink},
+	limiter{audio.get_sampling_rate(), 1ms, 10ms, 100ms}
+{}
+
 void Mixer::mix(span<dev::Sample> buffer)
 {
+	TRACE_THREAD_NAME("audio"); // The audio thread is owned by the audio API
+	TRACE_ZONE("Mix");
+	ALLOC_AUDIT_FRAME("Audio"); // Covers the previous buffer and the audio API's work since then
 	// This should only block during startup/shutdown and loadings
 	auto lock = lock_guard{generator_lock};
 	if (generators.empty()) return;
+	TRACE_COUNTER("Audio generators", generators.size());
 
 	for (auto const& generator: generators)
 		generator.second.begin_buffer();
@@ -30,6 +30,9 @@ public:
 	// Initialize, attaching to the global audio device.
 	explicit Mixer(Logger::Category);
 
+	// Initialize with an offline sink. Buffers are only mixed on get_audio().render().
+	Mixer(Logger::Category, dev::Audio::OfflineSink);
+
 	// Register an audio generator. A generator is any object that implements the member function
 	// auto next_sample() -> dev::Sample.
 	template<implements<Generator> T>
@@ -19,7 +19,7 @@ namespace playnote::audio {
 Player::Player()
 {
 	globals::mixer->add_generator(*this);
-	timer_slop = globals::glfw->get_time();
+	timer_slop = current_time();
 	inbound_inputs = make_shared<spsc_queue<UserInput>>();
 }
 
@@ -56,7 +56,7 @@ auto Player::get_audio_cursor(shared_ptr<bms::Cursor> const& cursor) const -> bm
 			globals::mixer->get_audio().samples_to_ns(samples_processed) - globals::mixer->get_latency() :
 			0ns;
 		auto const last_buffer_start = timer_slop + buffer_start_progress;
-		auto const elapsed = globals::glfw->get_time() - last_buffer_start;
+		auto const elapsed = current_time() - last_buffer_start;
 		auto const elapsed_samples = globals::mixer->get_audio().ns_to_samples(elapsed);
 		auto result = bms::Cursor{*it->cursor};
 		result.seek_relative(clamp(elapsed_samples, 0z, globals::mixer->get_audio().ns_to_samples(globals::mixer->get_latency())));
@@ -65,6 +65,12 @@ auto Player::get_audio_cursor(shared_ptr<bms::Cursor> const& cursor) const -> bm
 	PANIC();
 }
 
+auto Player::current_time() -> nanoseconds
+{
+	auto& audio = globals::mixer->get_audio();
+	return audio.is_offline()? audio.get_offline_time() : globals::glfw->get_time();
+}
+
 void Player::begin_buffer()
 {
 	// Retrieve new inputs
@@ -79,7 +85,7 @@ void Player::begin_buffer()
 
 	// Adjust timer slop
 	auto const estimated = timer_slop + globals::mixer->get_audio().samples_to_ns(samples_processed);
-	auto const now = globals::glfw->get_time();
+	auto const now = current_time();
 	auto const difference = now - estimated;
 	timer_slop += difference;
 	if (difference > 5ms) WARN("Audio timer was late by {}ms", difference / 1ms);
@@ -38,6 +38,10 @@ public:
 	// This is a best guess estimate based on time elapsed since the last audio buffer.
 	[[nodiscard]] auto get_audio_cursor(shared_ptr<bms::Cursor> const&) const -> bms::Cursor;
 
+	// Return the number of samples currently playing. Only safe to call between buffers, which
+	// in practice means with an offline sink.
+	[[nodiscard]] auto get_active_sound_count() const -> ssize_t { return active_sounds.size(); }
+
 	void pause() { paused = true; }
 	void resume() { paused = false; }
 
@@ -72,6 +76,9 @@ private:
 	small_vector<UserInput, 16> pending_inputs;
 	bool paused = false;
 	small_vector<ActiveSound, 128> active_sounds;
+
+	// Current time; the wall clock, or the rendered duration if the mixer uses an offline sink.
+	[[nodiscard]] static auto current_time() -> nanoseconds;
 };
 
 }
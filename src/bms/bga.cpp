@@ -0,0 +1,326 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/bga.hpp"
+
+#include "preamble.hpp"
+#include "utils/tracing.hpp"
+#include "utils/logger.hpp"
+#include "utils/memory.hpp"
+#include "lib/ffmpeg.hpp"
+
+namespace playnote::bms {
+
+using lib::ffmpeg::Picture;
+
+BGAPlayer::VideoStream::VideoStream()
+{
+	for (auto& frame: queue) frame.pixels = make_tracked_vector<byte>(MemoryTag::VideoFrames);
+	current.pixels = make_tracked_vector<byte>(MemoryTag::VideoFrames);
+	decoder = jthread{[this](std::stop_token stop) { decode_loop(stop); }};
+}
+
+void BGAPlayer::VideoStream::start(span<byte const> new_video, Counters& new_counters)
+{
+	ASSUME(idle);
+	idle = false;
+	{
+		auto lock = lock_guard{queue_lock};
+		video = new_video;
+		counters = &new_counters;
+		generation += 1;
+	}
+	wake.notify_one();
+}
+
+void BGAPlayer::VideoStream::release()
+{
+	idle = true;
+	has_current = false;
+	last_late_frame = -1;
+	{
+		auto lock = lock_guard{queue_lock};
+		video = {};
+		generation += 1;
+		queue_head = 0;
+		queue_size = 0;
+		finished = false;
+	}
+	wake.notify_one();
+}
+
+auto BGAPlayer::VideoStream::frame_at(nanoseconds time) -> Picture const*
+{
+	auto lock = lock_guard{queue_lock};
+	auto popped = 0z;
+	while (queue_size > 0 && queue[queue_head].timestamp <= time) {
+		std::swap(current, queue[queue_head]);
+		queue_head = (queue_head + 1) % QueueDepth;
+		queue_size -= 1;
+		popped += 1;
+	}
+	if (popped) {
+		has_current = true;
+		wake.notify_one();
+	}
+	// More than one frame becoming due at once means the earlier ones were never shown
+	if (popped > 1) counters->frames_late.fetch_add(popped - 1, memory_order_relaxed);
+
+	// The decoder is behind if the shown frame has expired, and the next one isn't ready.
+	// Count each frame interval that passes this way once
+	if (!finished && queue_size == 0 && (!has_current || time >= current.timestamp + current.duration)) {
+		auto const frame_duration = has_current && current.duration > 0ns? current.duration : duration_cast<nanoseconds>(1s) / 30;
+		auto const frame_idx = time / frame_duration;
+		if (frame_idx != last_late_frame) {
+			last_late_frame = frame_idx;
+			counters->frames_late.fetch_add(1, memory_order_relaxed);
+		}
+	}
+	return has_current? &current : nullptr;
+}
+
+void BGAPlayer::VideoStream::decode_loop(std::stop_token stop)
+{
+	auto decoder = lib::ffmpeg::VideoDecoder{};
+	auto decoder_generation = int64_t{0}; // Generation the decoder was opened for
+	while (true) {
+		auto slot = 0z;
+		auto slot_generation = int64_t{0};
+		auto slot_video = span<byte const>{};
+		{
+			auto lock = std::unique_lock{queue_lock};
+			if (!wake.wait(lock, stop, [&] {
+				return generation != decoder_generation || (!video.empty() && !finished && queue_size < QueueDepth);
+			})) return;
+			slot = (queue_head + queue_size) % QueueDepth;
+			slot_generation = generation;
+			slot_video = video;
+		}
+
+		// The slot isn't visible to the consumer until the frame is queued, so it's written unlocked
+		try {
+			if (slot_generation != decoder_generation) {
+				decoder_generation = slot_generation;
+				decoder.reset();
+				if (slot_video.empty()) continue;
+				TRACE_ZONE("Open video BGA");
+				decoder = lib::ffmpeg::open_video(slot_video);
+			}
+			TRACE_ZONE("Decode video BGA frame");
+			auto const start = steady_clock::now();
+			auto const decoded = lib::ffmpeg::decode_frame(decoder, queue[slot], int2{CanvasSize, CanvasSize});
+			auto const elapsed = steady_clock::now() - start;
+
+			auto lock = lock_guard{queue_lock};
+			if (generation != slot_generation) continue; // Released while decoding; the frame is stale
+			counters->decode_ns.fetch_add(elapsed / 1ns, memory_order_relaxed);
+			if (!decoded) {
+				finished = true;
+				continue;
+			}
+			queue_size += 1;
+			counters->frames_decoded.fetch_add(1, memory_order_relaxed);
+		} catch (exception const& e) {
+			WARN("Failed to decode video BGA: {}", e.what());
+			auto lock = lock_guard{queue_lock};
+			if (generation == slot_generation) finished = true;
+		}
+	}
+}
+
+BGAPlayer::BGAPlayer(shared_ptr<Chart const> chart):
+	chart{move(chart)}
+{
+	for (auto& canvas: canvases) {
+		canvas.pixels = make_tracked_vector<byte>(MemoryTag::VideoFrames);
+		canvas.pixels.resize(CanvasSize * CanvasSize * 4);
+	}
+	compositor = jthread{[this](std::stop_token stop) { composite_loop(stop); }};
+}
+
+auto BGAPlayer::update(nanoseconds new_progress) -> bool
+{
+	auto lock = lock_guard{request_lock};
+	requested_progress = new_progress;
+	request_idx += 1;
+	requested.notify_one();
+	if (!ready_fresh) return false;
+	std::swap(front, ready);
+	ready_fresh = false;
+	return true;
+}
+
+void BGAPlayer::show_poor(nanoseconds progress)
+{
+	auto lock = lock_guard{request_lock};
+	poor_until = progress + PoorDuration;
+}
+
+auto BGAPlayer::get_stats() const -> Stats
+{
+	return Stats{
+		.frames_decoded = counters.frames_decoded.load(memory_order_relaxed),
+		.frames_late = counters.frames_late.load(memory_order_relaxed),
+		.composites = counters.composites.load(memory_order_relaxed),
+		.decode_time = nanoseconds{counters.decode_ns.load(memory_order_relaxed)},
+	};
+}
+
+void BGAPlayer::composite_loop(std::stop_token stop)
+{
+	auto handled_idx = 0z;
+	while (true) {
+		auto target = 0ns;
+		auto target_poor_until = 0ns;
+		{
+			auto lock = std::unique_lock{request_lock};
+			if (!requested.wait(lock, stop, [&] { return request_idx != handled_idx; })) return;
+			handled_idx = request_idx;
+			target = requested_progress;
+			if (target < progress) poor_until = nanoseconds::min(); // Rewound
+			target_poor_until = poor_until;
+		}
+
+		if (!advance(target, target_poor_until)) continue;
+		auto lock = lock_guard{request_lock};
+		std::swap(back, ready);
+		ready_fresh = true;
+	}
+}
+
+auto BGAPlayer::advance(nanoseconds new_progress, nanoseconds poor_until) -> bool
+{
+	TRACE_ZONE("BGA update");
+	if (new_progress < progress) reset();
+	progress = new_progress;
+
+	auto changed = false;
+	auto pictures = array<Picture const*, enum_count<Layer>()>{};
+	for (auto [idx, layer]: layers | views::enumerate) {
+		auto const& events = chart->timeline.bga[idx];
+
+		// Advance to the latest event that already happened. If it's a video that was prefetched,
+		// its stream carries over
+		auto const first_due = layer.next_event;
+		while (layer.next_event < ssize(events) && events[layer.next_event].timestamp <= progress)
+			layer.next_event += 1;
+		if (layer.next_event != first_due) {
+			auto const& event = events[layer.next_event - 1];
+			auto const was_prefetched = layer.next_event - first_due == 1 && layer.upcoming;
+			layer.current = event;
+			release_video(layer.stream);
+			if (was_prefetched) std::swap(layer.stream, layer.upcoming);
+			else layer.stream = start_video(event.bmp_slot);
+			release_video(layer.upcoming);
+		}
+
+		// Start decoding the next video in time for it to be ready
+		if (!layer.upcoming && layer.next_event < ssize(events)) {
+			auto const& next = events[layer.next_event];
+			if (next.timestamp <= progress + PrefetchWindow && is_video(next.bmp_slot))
+				layer.upcoming = start_video(next.bmp_slot);
+		}
+
+		auto const* picture = layer_picture(layer);
+		auto const timestamp = picture? picture->timestamp : 0ns;
+		if (picture != layer.shown || timestamp != layer.shown_timestamp) changed = true;
+		layer.shown = picture;
+		layer.shown_timestamp = timestamp;
+		pictures[idx] = picture;
+	}
+
+	auto const poor = progress < poor_until && pictures[+Layer::Poor];
+	if (poor != poor_shown) changed = true;
+	poor_shown = poor;
+	if (!changed) return false;
+
+	if (poor) composite(span{&pictures[+Layer::Poor], 1});
+	else composite(span{pictures}.first(+Layer::Poor));
+	return true;
+}
+
+auto BGAPlayer::is_video(ssize_t bmp_slot) const -> bool
+{
+	auto const& slot = chart->media.bmp_slots[bmp_slot];
+	return slot && holds_alternative<tracked_vector<byte>>(*slot);
+}
+
+auto BGAPlayer::start_video(ssize_t bmp_slot) -> VideoStream*
+{
+	if (!is_video(bmp_slot)) return nullptr;
+	auto stream = find_if(streams, [](auto const& s) { return s.is_idle(); });
+	ASSUME(stream != streams.end()); // Every layer holds at most two streams
+	stream->start(get<tracked_vector<byte>>(*chart->media.bmp_slots[bmp_slot]), counters);
+	return &*stream;
+}
+
+void BGAPlayer::release_video(VideoStream*& stream)
+{
+	if (!stream) return;
+	stream->release();
+	stream = nullptr;
+}
+
+void BGAPlayer::reset()
+{
+	for (auto& layer: layers) {
+		release_video(layer.stream);
+		release_video(layer.upcoming);
+		layer = LayerState{};
+	}
+}
+
+auto BGAPlayer::layer_picture(LayerState& layer) -> Picture const*
+{
+	if (!layer.current) return nullptr;
+	if (layer.stream) return layer.stream->frame_at(progress - layer.current->timestamp);
+	if (auto const& slot = chart->media.bmp_slots[layer.current->bmp_slot])
+		if (auto const* image = std::get_if<Picture>(slot.get())) return image;
+	return nullptr; // Missing file, or a video that failed to load
+}
+
+void BGAPlayer::composite(span<Picture const* const> pictures)
+{
+	TRACE_ZONE("BGA composite");
+	counters.composites.fetch_add(1, memory_order_relaxed);
+	auto& canvas = canvases[back].pixels;
+	canvases[back].visible = any_of(pictures, [](auto const* picture) { return picture != nullptr; });
+
+	// Opaque black background
+	for (auto pixel: canvas | views::chunk(4)) {
+		pixel[0] = pixel[1] = pixel[2] = byte{0};
+		pixel[3] = byte{255};
+	}
+
+	// Pictures are stretched over the whole canvas with nearest-neighbor sampling. Black pixels
+	// of every layer above the bottom one are transparent
+	for (auto [layer_idx, picture]: pictures | views::enumerate) {
+		if (!picture) continue;
+		auto const keyed = layer_idx > 0;
+		if (!keyed && picture->width == CanvasSize && picture->height == CanvasSize) {
+			copy(picture->pixels, canvas.begin()); // Videos are decoded at canvas size
+			continue;
+		}
+		for (auto y: views::iota(0, CanvasSize)) {
+			auto const src_y = y * picture->height / CanvasSize;
+			for (auto x: views::iota(0, CanvasSize)) {
+				auto const src_x = x * picture->width / CanvasSize;
+				auto const* src = &picture->pixels[(src_y * picture->width + src_x) * 4];
+				if (keyed && src[0] == byte{0} && src[1] == byte{0} && src[2] == byte{0}) continue;
+				auto* dst = &canvas[(y * CanvasSize + x) * 4];
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = byte{255};
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,171 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include <condition_variable>
+#include "preamble.hpp"
+#include "utils/memory.hpp"
+#include "lib/ffmpeg.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bms {
+
+// Compositor of a chart's BGA layers into a single picture. Still images are decoded when the chart
+// is built; videos are decoded on background threads, starting a little before they're shown,
+// so that a frame is always ready by the time it's due. The layers are composited on another
+// background thread, so the caller only ever picks up finished pictures.
+class BGAPlayer {
+public:
+	static constexpr auto CanvasSize = 512; // Width and height of the composited picture
+	static constexpr auto PrefetchWindow = 2s; // How far ahead of the cursor videos start decoding
+	static constexpr auto QueueDepth = 8z; // Video frames decoded ahead, per video
+	static constexpr auto PoorDuration = 1s; // How long the poor layer is shown after a miss
+
+	// Playback statistics, accumulated since the player was created.
+	struct Stats {
+		ssize_t frames_decoded; // Video frames produced by the decoder threads
+		ssize_t frames_late; // Video frames that weren't decoded by the time they were due
+		ssize_t composites; // Number of times the picture changed
+		nanoseconds decode_time; // Total time the decoder threads spent decoding
+	};
+
+	// Create a player for the chart's BGA, and start its compositor and decoder threads.
+	// Nothing is shown until the first update.
+	explicit BGAPlayer(shared_ptr<Chart const>);
+
+	// Move the BGA to the given chart position. Returns true if a newer picture was composited
+	// since the previous call; the picture can lag behind the position by one call.
+	// Moving backwards restarts the BGA from the beginning.
+	auto update(nanoseconds progress) -> bool;
+
+	// Show the poor layer for a while, starting at the given chart position.
+	void show_poor(nanoseconds progress);
+
+	// Return the composited picture, CanvasSize x CanvasSize 8-bit RGBA in sRGB. It stays valid
+	// and unchanged until the next update.
+	[[nodiscard]] auto get_image() const -> span<byte const> { return canvases[front].pixels; }
+
+	// Return true if any layer is showing a picture.
+	[[nodiscard]] auto is_visible() const -> bool { return canvases[front].visible; }
+
+	[[nodiscard]] auto get_stats() const -> Stats;
+
+	BGAPlayer(BGAPlayer const&) = delete;
+	auto operator=(BGAPlayer const&) -> BGAPlayer& = delete;
+	BGAPlayer(BGAPlayer&&) = delete;
+	auto operator=(BGAPlayer&&) -> BGAPlayer& = delete;
+
+private:
+	using Layer = BGAEvent::Layer;
+
+	// Every layer decodes at most its current video and the upcoming one
+	static constexpr auto StreamCount = enum_count<Layer>() * 2;
+
+	struct Counters {
+		atomic<ssize_t> frames_decoded = 0;
+		atomic<ssize_t> frames_late = 0;
+		atomic<ssize_t> composites = 0;
+		atomic<int64_t> decode_ns = 0;
+	};
+
+	// A video decoding slot, with its own thread that lives as long as the player. Videos are
+	// assigned to and released from the slot without starting or stopping any threads.
+	class VideoStream {
+	public:
+		VideoStream();
+
+		// Start decoding a video. The stream must be idle.
+		void start(span<byte const> video, Counters&);
+
+		// Drop the video and its decoded frames, making the stream idle. Doesn't wait for the
+		// decoder thread, which abandons its current frame on its own.
+		void release();
+
+		[[nodiscard]] auto is_idle() const -> bool { return idle; }
+
+		// Return the frame that's due at the given time since the video started, or nullptr
+		// if the first frame isn't ready yet. Frames are consumed in order; the returned frame
+		// is valid until the next call.
+		auto frame_at(nanoseconds) -> lib::ffmpeg::Picture const*;
+
+	private:
+		bool idle = true; // Only accessed by the owner
+
+		mutex queue_lock;
+		std::condition_variable_any wake;
+		span<byte const> video; // Empty while idle
+		Counters* counters = nullptr;
+		int64_t generation = 0; // Bumped whenever a video is started or released
+		array<lib::ffmpeg::Picture, QueueDepth> queue; // Ring buffer
+		ssize_t queue_head = 0; // Earliest decoded frame
+		ssize_t queue_size = 0; // Decoded frames waiting to be shown
+		bool finished = false; // Decoder reached the end of the video, or failed
+		lib::ffmpeg::Picture current; // Frame being shown; swapped with queue slots to recycle buffers
+		bool has_current = false;
+		int64_t last_late_frame = -1;
+
+		jthread decoder; // Last, so that it stops before the members above are destroyed
+
+		void decode_loop(std::stop_token);
+	};
+
+	// Playback state of one layer. Only accessed by the compositor thread.
+	struct LayerState {
+		ssize_t next_event = 0; // Index of the first event that didn't happen yet
+		optional<BGAEvent> current;
+		VideoStream* stream = nullptr; // Decoding the current event's video, if any
+		VideoStream* upcoming = nullptr; // Decoding the next event's video ahead of time, if any
+		lib::ffmpeg::Picture const* shown = nullptr; // To detect changes
+		nanoseconds shown_timestamp = 0ns; // ^
+	};
+
+	struct Canvas {
+		tracked_vector<byte> pixels;
+		bool visible = false;
+	};
+
+	shared_ptr<Chart const> chart;
+	Counters counters;
+	array<VideoStream, StreamCount> streams;
+
+	// Compositor thread state
+	array<LayerState, enum_count<Layer>()> layers;
+	nanoseconds progress = -1ns;
+	bool poor_shown = false;
+
+	// Triple buffer: the compositor draws into back, hands it over as ready, and the caller
+	// picks up ready as front. Front is only accessed by the caller
+	array<Canvas, 3> canvases;
+	ssize_t front = 0;
+	ssize_t back = 2;
+
+	mutex request_lock;
+	std::condition_variable_any requested;
+	ssize_t ready = 1; // Accessed under request_lock
+	bool ready_fresh = false; // ^ True if ready holds a picture the caller didn't pick up yet
+	nanoseconds requested_progress = -1ns; // ^
+	int64_t request_idx = 0; // ^ Bumped with every update
+	nanoseconds poor_until = nanoseconds::min(); // ^
+
+	jthread compositor; // Last, so that it stops before the members above are destroyed
+
+	void composite_loop(std::stop_token);
+	// Advance the layers to the position and composite them into the back canvas if anything
+	// changed. Returns true if it did.
+	auto advance(nanoseconds progress, nanoseconds poor_until) -> bool;
+	[[nodiscard]] auto is_video(ssize_t bmp_slot) const -> bool;
+	[[nodiscard]] auto start_video(ssize_t bmp_slot) -> VideoStream*;
+	void release_video(VideoStream*&);
+	void reset();
+	// Return the layer's picture at the current position, or nullptr if it shows nothing.
+	auto layer_picture(LayerState&) -> lib::ffmpeg::Picture const*;
+	void composite(span<lib::ffmpeg::Picture const* const> pictures);
+};
+
+}
@@ -12,13 +12,14 @@ or distributed except according to those terms.
 #include "preamble.hpp"
 #include "utils/task_pool.hpp"
 #include "utils/assert.hpp"
+#include "utils/tracing.hpp"
 #include "lib/ebur128.hpp"
 #include "lib/openssl.hpp"
 #include "lib/icu.hpp"
+#include "lib/ffmpeg.hpp"
 #include "dev/audio.hpp"
 #include "io/file.hpp"
 #include "audio/renderer.hpp"
-#include "audio/mixer.hpp"
 
 namespace playnote::bms {
 
@@ -26,8 +27,10 @@ namespace playnote::bms {
 static constexpr auto CommandsWithSlots = {"WAV"sv, "BMP"sv, "BGA"sv, "BPM"sv, "TEXT"sv, "SONG"sv, "@BGA"sv,
 	"STOP"sv, "ARGB"sv, "SEEK"sv, "EXBPM"sv, "EXWAV"sv, "SWBGA"sv, "EXRANK"sv, "CHANGEOPTION"sv};
 
-Builder::Builder(Logger::Category cat):
-	cat{cat}
+Builder::Builder(Logger::Category cat, bool load_audio, bool load_bga):
+	cat{cat},
+	load_audio{load_audio},
+	load_bga{load_bga}
 {
 	// Implemented headers
 	header_handlers.emplace("TITLE",        &Builder::handle_header_title);
@@ -40,6 +43,7 @@ Builder::Builder(Logger::Category cat):
 	header_handlers.emplace("BPM",          &Builder::handle_header_bpm);
 	header_handlers.emplace("DIFFICULTY",   &Builder::handle_header_difficulty);
 	header_handlers.emplace("WAV",          &Builder::handle_header_wav);
+	header_handlers.emplace("BMP",          &Builder::handle_header_bmp);
 
 	// Critical unimplemented headers
 	// (if a file uses one of these, there is no chance for the BMS to be played correctly)
@@ -78,7 +82,6 @@ Builder::Builder(Logger::Category cat):
 	header_handlers.emplace("OCT/FP",       &Builder::handle_header_unimplemented);
 	header_handlers.emplace("CDDA",         &Builder::handle_header_unimplemented);
 	header_handlers.emplace("MIDIFILE",     &Builder::handle_header_unimplemented);
-	header_handlers.emplace("BMP",          &Builder::handle_header_unimplemented);
 	header_handlers.emplace("BGA",          &Builder::handle_header_unimplemented);
 	header_handlers.emplace("@BGA",         &Builder::handle_header_unimplemented);
 	header_handlers.emplace("POORBGA",      &Builder::handle_header_unimplemented);
@@ -114,6 +117,9 @@ Builder::Builder(Logger::Category cat):
 	channel_handlers.emplace("01" /* BGM                 */, &Builder::handle_channel_bgm);
 	channel_handlers.emplace("02" /* Measure length      */, &Builder::handle_channel_measure_length);
 	channel_handlers.emplace("03" /* BPM                 */, &Builder::handle_channel_bpm);
+	channel_handlers.emplace("04" /* BGA base            */, &Builder::handle_channel_bga);
+	channel_handlers.emplace("06" /* BGA poor            */, &Builder::handle_channel_bga);
+	channel_handlers.emplace("07" /* BGA layer           */, &Builder::handle_channel_bga);
 	channel_handlers.emplace("08" /* BPMxx               */, &Builder::handle_channel_bpmxx);
 	for (auto const i: views::iota(1z, 10z)) // P1 notes
 		channel_handlers.emplace(string{"1"} + static_cast<char>('0' + i), &Builder::handle_channel_note);
@@ -133,9 +139,6 @@ Builder::Builder(Logger::Category cat):
 		channel_handlers.emplace(string{"6"} + static_cast<char>('A' + i), &Builder::handle_channel_ln);
 
 	// Unimplemented channels
-	channel_handlers.emplace("04" /* BGA base            */, &Builder::handle_channel_unimplemented);
-	channel_handlers.emplace("06" /* BGA poor            */, &Builder::handle_channel_unimplemented);
-	channel_handlers.emplace("07" /* BGA layer           */, &Builder::handle_channel_unimplemented);
 	channel_handlers.emplace("0A" /* BGA layer 2         */, &Builder::handle_channel_unimplemented);
 	channel_handlers.emplace("0B" /* BGA base alpha      */, &Builder::handle_channel_unimplemented);
 	channel_handlers.emplace("0C" /* BGA layer alpha     */, &Builder::handle_channel_unimplemented);
@@ -173,40 +176,190 @@ Builder::Builder(Logger::Category cat):
 	channel_handlers.emplace("A6" /* Play option         */, &Builder::handle_channel_ignored_log);
 }
 
-auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io::Song& song, int sampling_rate,
-	optional<reference_wrapper<Metadata>> cache) -> task<shared_ptr<Chart const>>
+auto Builder::build(Scheduler& scheduler, span<byte const> bms_raw, io::Song& song, int sampling_rate,
+	optional<reference_wrapper<Metadata>> cache, CancelToken cancel) -> task<shared_ptr<Chart const>>
 {
+	TRACE_ASYNC_SPAN("Build chart");
 	auto chart = make_shared<Chart>();
 	chart->md5 = lib::openssl::md5(bms_raw);
 	if (cache) chart->metadata = *cache;
 	auto parse_state = State{};
 	parse_state.measure_lengths.reserve(256); // Arbitrary
+	auto const bms = decode_bms(bms_raw);
+	parse(bms, *chart, parse_state);
+	co_return co_await generate(scheduler, move(chart), move(parse_state), song, sampling_rate, cache, nullopt, cancel);
+}
 
-	// Convert chart to UTF-8
-	auto encoding = lib::icu::detect_encoding(bms_raw, io::KnownEncodings);
-	if (!encoding) {
-		WARN_AS(cat, "Unexpected BMS file encoding; assuming Shift_JIS");
-		encoding = "Shift_JIS";
+auto Builder::rebuild(Scheduler& scheduler, span<byte const> bms_raw, io::Song& song, int sampling_rate,
+	CancelToken cancel) -> task<shared_ptr<Chart const>>
+{
+	TRACE_ASYNC_SPAN("Rebuild chart");
+	auto chart = make_shared<Chart>();
+	chart->md5 = lib::openssl::md5(bms_raw);
+	auto const bms = decode_bms(bms_raw);
+
+	// Split the file into header lines and measures
+	struct Line {
+		ssize_t line_num;
+		string_view text;
+	};
+	auto header_lines = vector<Line>{};
+	auto measure_lines = State::Mapping<vector<Line>>{};
+	auto measure_order = vector<string_view>{}; // Order of first appearance
+	auto headers = string{};
+	auto in_order = true; // false if any header comes after a channel
+	for (auto [line_num, line]: views::zip(views::iota(1z), bms | views::split('\n') | views::to_sv)) {
+		line = trim_copy(line);
+		if (line.empty() || line[0] != '#') continue;
+		line = line.substr(1);
+		if (line.empty()) continue;
+		if (line[1] >= '0' && line[1] <= '9') {
+			auto const number = line.substr(0, min(line.size(), 3uz));
+			auto [it, inserted] = measure_lines.try_emplace(string{number});
+			if (inserted) measure_order.emplace_back(number);
+			it->second.emplace_back(Line{line_num, line});
+		} else {
+			if (!measure_lines.empty()) in_order = false;
+			header_lines.emplace_back(Line{line_num, line});
+			headers.append(line);
+			headers.push_back('\n');
+		}
 	}
-	auto bms = lib::icu::to_utf8(bms_raw, *encoding);
 
-	// Normalize line endings
-	replace_all(bms, "\r\n", "\n");
-	replace_all(bms, "\r", "\n");
+	// Slots are matched up with the previous chart's by filename, since a header change can renumber them
+	auto const reuse_previous = [&](State const& state) -> optional<Reuse> {
+		if (!parse_cache) return nullopt;
+		auto const match = [](auto const& slots, auto const& previous_slots) {
+			auto result = vector<ssize_t>(slots.size(), -1);
+			auto by_filename = unordered_map<string_view, ssize_t>{};
+			for (auto const& slot: previous_slots | views::values)
+				by_filename.emplace(slot.filename, slot.idx);
+			for (auto const& slot: slots | views::values)
+				if (auto it = by_filename.find(slot.filename); it != by_filename.end()) result[slot.idx] = it->second;
+			return result;
+		};
+		return Reuse{
+			.chart = parse_cache->chart.get(),
+			.wav_slots = match(state.wav, parse_cache->state.wav),
+			.bmp_slots = match(state.bmp, parse_cache->state.bmp),
+		};
+	};
 
-	// Parse line-by-line
-	for (auto [line_num, line]: views::zip(views::iota(1u), bms | views::split('\n') | views::to_sv)) {
-		line = trim_copy(line); // BMS occasionally uses leading whitespace
-		if (line.empty()) continue; // Skip empty lines
-		if (line[0] != '#') continue; // Anything that doesn't start with "#" is a comment
-		line = line.substr(1); // Remove the "#"
-		if (line.empty()) continue;
-		if (line[1] >= '0' && line[1] <= '9')
-			parse_channel(line, line_num, *chart, parse_state);
-		else
-			parse_header(line, line_num, *chart, parse_state);
+	// Channel handlers resolve slots as they go, so a channel that precedes a header can only be
+	// parsed in file order. Such files are always fully rebuilt
+	if (!in_order) {
+		auto parse_state = State{};
+		parse(bms, *chart, parse_state);
+		auto reuse = reuse_previous(parse_state);
+		auto result = co_await generate(scheduler, move(chart), move(parse_state), song, sampling_rate,
+			nullopt, move(reuse), cancel);
+		parse_cache.reset();
+		rebuild_stats = RebuildStats{
+			.full = true,
+			.measures_parsed = ssize(measure_order),
+			.measures_total = ssize(measure_order),
+		};
+		co_return result;
 	}
 
+	// Headers only set slot mappings and metadata; if they're unchanged, so are those
+	auto next = ParseCache{};
+	auto const full = !parse_cache || parse_cache->headers != headers;
+	next.headers = move(headers);
+	if (full) {
+		for (auto const& line: header_lines)
+			parse_header(line.text, line.line_num, *chart, next.state);
+		next.metadata = chart->metadata;
+	} else {
+		next.state.wav = parse_cache->state.wav;
+		next.state.bpm = parse_cache->state.bpm;
+		next.state.bmp = parse_cache->state.bmp;
+		next.metadata = parse_cache->metadata;
+		chart->metadata = next.metadata;
+	}
+	auto reuse = reuse_previous(next.state);
+
+	// Parse the measures that changed. Each one is parsed into an emptied scratch state, so that
+	// its events can be kept apart. Handlers mark slots as used in the scratch mappings; the real
+	// flags are derived from the events of all measures afterwards
+	auto scratch = State{};
+	scratch.wav = next.state.wav;
+	scratch.bpm = next.state.bpm;
+	scratch.bmp = next.state.bmp;
+	auto parsed = 0z;
+	for (auto number: measure_order) {
+		auto const& lines = measure_lines.find(number)->second;
+		auto text = string{};
+		for (auto const& line: lines) {
+			text.append(line.text);
+			text.push_back('\n');
+		}
+		if (!full) {
+			if (auto it = parse_cache->measures.find(number); it != parse_cache->measures.end() && it->second.text == text) {
+				next.measures.emplace(string{number}, move(it->second));
+				continue;
+			}
+		}
+
+		scratch.measure_lengths.clear();
+		scratch.measure_rel_bpms.clear();
+		scratch.measure_rel_notes.clear();
+		scratch.measure_rel_bgas.clear();
+		for (auto const& line: lines)
+			parse_channel(line.text, line.line_num, *chart, scratch);
+		auto measure = Measure{
+			.text = move(text),
+			.extends = !scratch.measure_lengths.empty(),
+			.length = scratch.measure_lengths.empty()? 1.0 : scratch.measure_lengths.back(),
+			.bpms = move(scratch.measure_rel_bpms),
+			.notes = move(scratch.measure_rel_notes),
+			.bgas = move(scratch.measure_rel_bgas),
+		};
+		next.measures.emplace(string{number}, move(measure));
+		parsed += 1;
+	}
+
+	// Assemble the full parse state. Events of different measures never share a position,
+	// so their order between measures doesn't matter
+	auto parse_state = State{};
+	parse_state.wav = next.state.wav;
+	parse_state.bpm = next.state.bpm;
+	parse_state.bmp = next.state.bmp;
+	auto wav_used = vector<bool>(parse_state.wav.size());
+	auto bmp_used = vector<bool>(parse_state.bmp.size());
+	for (auto number: measure_order) {
+		auto const& measure = next.measures.find(number)->second;
+		if (measure.extends) {
+			auto const idx = lexical_cast<ssize_t>(number); // The measure was parsed, so this won't throw
+			extend_measure_lengths(parse_state.measure_lengths, idx);
+			parse_state.measure_lengths[idx] = measure.length;
+		}
+		copy(measure.bpms, back_inserter(parse_state.measure_rel_bpms));
+		copy(measure.notes, back_inserter(parse_state.measure_rel_notes));
+		copy(measure.bgas, back_inserter(parse_state.measure_rel_bgas));
+		for (auto const& note: measure.notes)
+			if (note.wav_slot_idx != -1) wav_used[note.wav_slot_idx] = true;
+		for (auto const& bga: measure.bgas)
+			bmp_used[bga.bmp_slot_idx] = true;
+	}
+	for (auto& slot: parse_state.wav | views::values) slot.used = wav_used[slot.idx];
+	for (auto& slot: parse_state.bmp | views::values) slot.used = bmp_used[slot.idx];
+
+	auto result = co_await generate(scheduler, move(chart), move(parse_state), song, sampling_rate, nullopt, move(reuse), cancel);
+	next.chart = result;
+	parse_cache = move(next);
+	rebuild_stats = RebuildStats{
+		.full = full,
+		.measures_parsed = parsed,
+		.measures_total = ssize(measure_order),
+	};
+	co_return result;
+}
+
+auto Builder::generate(Scheduler& scheduler, shared_ptr<Chart> chart, State parse_state, io::Song& song,
+	int sampling_rate, optional<reference_wrapper<Metadata>> cache, optional<Reuse> reuse,
+	CancelToken cancel) -> task<shared_ptr<Chart const>>
+{
 	// At this point, we have:
 	// - chart.metadata fields that correspond directly to header commands
 	//     (this purposefully overwrites any previously applied cache)
@@ -214,6 +367,7 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 	// - state.measure_lengths
 	// - state.measure_rel_bpms, missing initial bpm and unsorted
 	// - state.measure_rel_notes, unsorted and LNs unpaired
+	// - state.measure_rel_bgas, unsorted
 
 	// The chart generation process uses several ways of anchoring event positions.
 	// Measure-relative:
@@ -230,21 +384,70 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 	//   Imagining a chart as a tall ribbon, y-position is a physical distance from the bottom
 	//   of the chart, relative to 1.0 being the on-screen height of one initial-BPM beat.
 
+	// By convention, #BMP00 is the picture shown on a miss if the chart doesn't specify any
+	if (auto const poor_slot = parse_state.bmp.find("00"); poor_slot != parse_state.bmp.end() &&
+		std::ranges::none_of(parse_state.measure_rel_bgas, [](auto const& bga) { return bga.layer == BGAEvent::Layer::Poor; })) {
+		poor_slot->second.used = true;
+		parse_state.measure_rel_bgas.emplace_back(MeasureRelBGA{
+			.position = NotePosition{0},
+			.layer = BGAEvent::Layer::Poor,
+			.bmp_slot_idx = poor_slot->second.idx,
+		});
+		extend_measure_lengths(parse_state.measure_lengths, 0);
+	}
+
 	// Load used audio samples
 	chart->media.sampling_rate = sampling_rate;
 	chart->media.wav_slots.resize(parse_state.wav.size());
 	auto tasks = vector<task<>>{};
 	for (auto const& parsed_slot: parse_state.wav | views::values) {
-		if (!parsed_slot.used) continue;
+		if (!load_audio || !parsed_slot.used) continue;
 		auto& slot = chart->media.wav_slots[parsed_slot.idx];
-		tasks.emplace_back(schedule_task_on(pool, [](io::Song& song, vector<dev::Sample>& slot, string filename, int sampling_rate) -> task<> {
+		if (reuse && reuse->wav_slots[parsed_slot.idx] != -1) {
+			if (auto const& previous = reuse->chart->media.wav_slots[reuse->wav_slots[parsed_slot.idx]]) {
+				slot = previous;
+				continue;
+			}
+		}
+		tasks.emplace_back(schedule_task_on(scheduler, [](io::Song& song, Media::WavSlot& slot, string filename, int sampling_rate, CancelToken cancel) -> task<> {
+			TRACE_ZONE("Load keysound");
 			try {
-				slot = song.load_audio_file(filename, sampling_rate);
+				slot = song.load_audio_file(filename, sampling_rate, MemoryTag::ChartMedia, cancel);
 			} catch (...) {} // If audio failed to load, slot will just stay empty
 			co_return;
-		}(song, slot, parsed_slot.filename, sampling_rate)));
+		}(song, slot, parsed_slot.filename, sampling_rate, cancel)));
+	}
+
+	// Load used BGA files alongside the keysounds
+	chart->media.bmp_slots.resize(parse_state.bmp.size());
+	for (auto const& parsed_slot: parse_state.bmp | views::values) {
+		if (!load_bga || !parsed_slot.used) continue;
+		auto& slot = chart->media.bmp_slots[parsed_slot.idx];
+		if (reuse && reuse->bmp_slots[parsed_slot.idx] != -1) {
+			if (auto const& previous = reuse->chart->media.bmp_slots[reuse->bmp_slots[parsed_slot.idx]]) {
+				slot = previous;
+				continue;
+			}
+		}
+		tasks.emplace_back(schedule_task_on(scheduler, [](io::Song& song, Media::BMPSlot& slot, string filename) -> task<> {
+			TRACE_ZONE("Load BGA file");
+			try {
+				auto const [type, file] = song.load_bga_file(filename);
+				if (type == io::Song::BGAType::Image) {
+					slot = make_shared<Media::BMPData const>(lib::ffmpeg::decode_image(file, MemoryTag::ChartMedia));
+				} else {
+					// Videos are decoded during playback, from a copy that outlives the song
+					auto video = make_tracked_vector<byte>(MemoryTag::ChartMedia);
+					video.assign(file.begin(), file.end());
+					slot = make_shared<Media::BMPData const>(move(video));
+				}
+			} catch (...) {} // If the file failed to load, slot will just stay empty
+			co_return;
+		}(song, slot, parsed_slot.filename)));
 	}
 	co_await when_all(move(tasks));
+	cancel.check(); // Keysounds that were cut short are indistinguishable from missing ones
+	TRACE_ZONE("Generate chart"); // No more suspension points past this line
 
 	// chart.media is now complete
 
@@ -252,6 +455,7 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 	auto& measure_lengths = parse_state.measure_lengths;
 	auto& measure_rel_bpms = parse_state.measure_rel_bpms;
 	auto& measure_rel_notes = parse_state.measure_rel_notes;
+	auto& measure_rel_bgas = parse_state.measure_rel_bgas;
 
 	// Prepare measure_rel_bpms for use
 	if (chart->metadata.bpm_range.initial == 0.0f) chart->metadata.bpm_range.initial = 130.0f; // BMS spec default
@@ -370,34 +574,37 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 		return result;
 	}();
 
-	// Convert notes from beat-relative to absolute
+	// Convert a beat-relative position to absolute
 	struct AbsPosition {
 		nanoseconds timestamp;
 		double y_pos;
 	};
+	auto const to_absolute = [&](double position) {
+		// Find the BPM section that the position is part of
+		auto bpm_section = find_last_if(views::zip(beat_rel_bpms, chart->timeline.bpm_sections), [&](auto const& view) {
+			return position >= get<0>(view).position;
+		});
+		ASSERT(!bpm_section.empty());
+		auto [beat_rel_bpm, bpm] = *bpm_section.begin();
+
+		auto const beats_since_bpm = position - beat_rel_bpm.position;
+		auto const time_since_bpm = beats_since_bpm * duration<double>{60.0 / bpm.bpm};
+		return AbsPosition{
+			.timestamp = bpm.position + duration_cast<nanoseconds>(time_since_bpm),
+			.y_pos = bpm.y_pos + beats_since_bpm * bpm.scroll_speed,
+		};
+	};
+
+	// Convert notes from beat-relative to absolute
 	using AbsNote = RelativeNote<AbsPosition>;
 	auto const abs_notes = [&] {
 		auto result = vector<AbsNote>{};
 		result.reserve(beat_rel_notes.size());
 		transform(beat_rel_notes, back_inserter(result), [&](auto const& note) {
-			// Find the BPM section that the note is part of
-			auto bpm_section = find_last_if(views::zip(beat_rel_bpms, chart->timeline.bpm_sections), [&](auto const& view) {
-				return note.position >= get<0>(view).position;
-			});
-			ASSERT(!bpm_section.empty());
-			auto [beat_rel_bpm, bpm] = *bpm_section.begin();
-
-			auto const beats_since_bpm = note.position - beat_rel_bpm.position;
-			auto const time_since_bpm = beats_since_bpm * duration<double>{60.0 / bpm.bpm};
-			auto const timestamp = bpm.position + duration_cast<nanoseconds>(time_since_bpm);
-			auto const y_pos = bpm.y_pos + beats_since_bpm * bpm.scroll_speed;
 			return AbsNote{
 				.type = note.type,
 				.lane = note.lane,
-				.position = AbsPosition{
-					.timestamp = timestamp,
-					.y_pos = y_pos,
-				},
+				.position = to_absolute(note.position),
 				.wav_slot_idx = note.wav_slot_idx,
 			};
 		});
@@ -473,6 +680,20 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 		}
 	}
 
+	// Convert BGA events straight to absolute, and split them up into sorted layers.
+	// Like with BPM changes, the bottom-most of simultaneous events wins, which stable_sort preserves
+	// by keeping it last.
+	for (auto const& bga: measure_rel_bgas) {
+		auto const& measure = beat_rel_measures[trunc(bga.position)];
+		auto const position = measure.start + measure.length * rational_cast<double>(fract(bga.position));
+		chart->timeline.bga[+bga.layer].emplace_back(BGAEvent{
+			.timestamp = to_absolute(position).timestamp,
+			.bmp_slot = bga.bmp_slot_idx,
+		});
+	}
+	for (auto& layer: chart->timeline.bga)
+		stable_sort(layer, [](auto const& a, auto const& b) { return a.timestamp < b.timestamp; });
+
 	// Fill in lane meta-information
 	for (auto [idx, lane]: chart->timeline.lanes | views::enumerate) {
 		auto const type = static_cast<Lane::Type>(idx);
@@ -534,6 +755,18 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 
 	// Offline audio render pass, handling all related statistics in one sweep
 	auto [loudness, audio_duration, preview] = [&] {
+		if (!load_audio)
+			return make_tuple(0.0, chart->metadata.chart_duration, make_tracked_vector<dev::Sample>(MemoryTag::ChartMedia));
+		if (reuse) {
+			// An edit rarely moves the loudness by much, and rendering would take most of the rebuild.
+			// The audio keeps ringing past the last note for as long as it did before
+			auto const& previous = *reuse->chart;
+			auto preview = make_tracked_vector<dev::Sample>(MemoryTag::ChartMedia);
+			preview.assign(previous.media.preview.begin(), previous.media.preview.end());
+			auto const tail = previous.metadata.audio_duration - previous.metadata.chart_duration;
+			return make_tuple(previous.metadata.loudness, chart->metadata.chart_duration + max(tail, 0ns), move(preview));
+		}
+		TRACE_ZONE("Offline render");
 		static constexpr auto BufferSize = 4096z / static_cast<ssize_t>(sizeof(dev::Sample)); // One memory page
 		auto renderer = audio::Renderer{chart};
 		auto ctx = lib::ebur128::init(sampling_rate);
@@ -542,11 +775,12 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 
 		auto const preview_start = min<nanoseconds>(20s, chart->metadata.chart_duration / 4);
 		auto const preview_end = min<nanoseconds>(preview_start + 15s, chart->metadata.chart_duration);
-		auto preview = vector<dev::Sample>{};
-		preview.reserve(globals::mixer->get_audio().ns_to_samples(preview_end - preview_start, sampling_rate) + 1);
+		auto preview = make_tracked_vector<dev::Sample>(MemoryTag::ChartMedia);
+		preview.reserve(lib::ns_to_samples(preview_end - preview_start, sampling_rate) + 1);
 
 		auto processing = true;
 		while (processing) {
+			cancel.check();
 			for (auto _: views::iota(0z, BufferSize)) {
 				auto const sample = renderer.advance_one_sample();
 				if (sample && renderer.get_cursor().get_progress_ns() <= 300s) { // 5 minute cutoff
@@ -564,8 +798,8 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 		}
 		// Skip ahead if the chart end is far away
 		auto const longest_wav = fold_left(chart->media.wav_slots, 0zu,
-			[](auto accum, auto const& el) { return max(accum, el.size()); });
-		auto const longest_wav_ns = globals::mixer->get_audio().samples_to_ns(longest_wav, chart->media.sampling_rate);
+			[](auto accum, auto const& el) { return el? max(accum, el->size()) : accum; });
+		auto const longest_wav_ns = lib::samples_to_ns(longest_wav, chart->media.sampling_rate);
 		// Jumping forward to this point will definitely not skip triggering the sound that ends up
 		// being the last sound of the song
 		auto const jump_dst = chart->metadata.chart_duration - longest_wav_ns - 1ms;
@@ -573,14 +807,15 @@ auto Builder::build(unique_ptr<thread_pool>& pool, span<byte const> bms_raw, io:
 			renderer.seek(jump_dst);
 		while (renderer.advance_one_sample()) {} // Advance to the end
 
-		return make_tuple(lib::ebur128::get_loudness(ctx), renderer.get_cursor().get_progress_ns(), move(preview));
+		// Apply loudness to preview
+		auto const loudness = lib::ebur128::get_loudness(ctx);
+		auto const gain = dev::lufs_to_gain(loudness);
+		for (auto& sample: preview) {
+			sample.left *= gain;
+			sample.right *= gain;
+		}
+		return make_tuple(loudness, renderer.get_cursor().get_progress_ns(), move(preview));
 	}();
-	// Apply loudness to preview
-	auto gain = dev::lufs_to_gain(loudness);
-	for (auto& sample: preview) {
-		sample.left *= gain;
-		sample.right *= gain;
-	}
 	chart->metadata.loudness = loudness;
 	chart->metadata.audio_duration = audio_duration;
 	chart->media.preview = move(preview);
@@ -742,6 +977,38 @@ void Builder::extend_measure_lengths(vector<double>& lengths, ssize_t max_measur
 	lengths.resize(min_length, 1.0);
 }
 
+auto Builder::decode_bms(span<byte const> bms_raw) -> string
+{
+	// Convert chart to UTF-8
+	auto encoding = lib::icu::detect_encoding(bms_raw, io::KnownEncodings);
+	if (!encoding) {
+		WARN_AS(cat, "Unexpected BMS file encoding; assuming Shift_JIS");
+		encoding = "Shift_JIS";
+	}
+	auto bms = lib::icu::to_utf8(bms_raw, *encoding);
+
+	// Normalize line endings
+	replace_all(bms, "\r\n", "\n");
+	replace_all(bms, "\r", "\n");
+	return bms;
+}
+
+void Builder::parse(string_view bms, Chart& chart, State& state)
+{
+	// Parse line-by-line
+	for (auto [line_num, line]: views::zip(views::iota(1u), bms | views::split('\n') | views::to_sv)) {
+		line = trim_copy(line); // BMS occasionally uses leading whitespace
+		if (line.empty()) continue; // Skip empty lines
+		if (line[0] != '#') continue; // Anything that doesn't start with "#" is a comment
+		line = line.substr(1); // Remove the "#"
+		if (line.empty()) continue;
+		if (line[1] >= '0' && line[1] <= '9')
+			parse_channel(line, line_num, chart, state);
+		else
+			parse_header(line, line_num, chart, state);
+	}
+}
+
 void Builder::parse_header(string_view line, ssize_t line_num, Chart& chart, State& state)
 {
 	// Extract components
@@ -959,6 +1226,30 @@ void Builder::handle_header_wav(HeaderCommand cmd, Chart&, State& state)
 	wav_slot.filename = cmd.value;
 }
 
+void Builder::handle_header_bmp(HeaderCommand cmd, Chart&, State& state)
+{
+	if (cmd.slot.empty()) {
+		WARN_AS(cat, "L{}: BMP header has no slot", cmd.line_num);
+		return;
+	}
+	if (cmd.value.empty()) {
+		WARN_AS(cat, "L{}: BMP header has no value", cmd.line_num);
+		return;
+	}
+
+	// Remove extension and trailing dots
+	auto const separator_pos = cmd.value.find_last_of('.');
+	if (separator_pos != string::npos) {
+		cmd.value = cmd.value.substr(0, separator_pos);
+		while (cmd.value.ends_with('.'))
+			cmd.value = cmd.value.substr(0, cmd.value.size() - 1);
+	}
+
+	auto& bmp_slot = state.bmp[cmd.slot];
+	if (bmp_slot.idx == -1) bmp_slot.idx = state.bmp.size() - 1;
+	bmp_slot.filename = cmd.value;
+}
+
 void Builder::handle_header_bpmxx(HeaderCommand cmd, Chart&, State& state)
 {
 	if (cmd.slot.empty()) {
@@ -1068,6 +1359,28 @@ void Builder::handle_channel_ln(ChannelCommand cmd, Chart&, State& state)
 	extend_measure_lengths(state.measure_lengths, trunc(cmd.position));
 }
 
+void Builder::handle_channel_bga(ChannelCommand cmd, Chart&, State& state)
+{
+	if (cmd.value == "00") return; // Rhythm padding
+	auto const layer = [&] {
+		if (cmd.channel == "04") return BGAEvent::Layer::Base;
+		if (cmd.channel == "06") return BGAEvent::Layer::Poor;
+		if (cmd.channel == "07") return BGAEvent::Layer::Layer;
+		throw runtime_error_fmt("L{}: Unknown BGA channel: {}", cmd.line_num, cmd.channel);
+	}();
+	auto const slot_iter = state.bmp.find(cmd.value);
+	if (slot_iter == state.bmp.end()) return; // A BGA event that uses a nonexistent slot does nothing
+	auto& slot = slot_iter->second;
+	slot.used = true;
+
+	state.measure_rel_bgas.emplace_back(MeasureRelBGA{
+		.position = cmd.position,
+		.layer = layer,
+		.bmp_slot_idx = slot.idx,
+	});
+	extend_measure_lengths(state.measure_lengths, trunc(cmd.position));
+}
+
 void Builder::handle_channel_measure_length(ChannelCommand cmd, Chart&, State& state)
 {
 	extend_measure_lengths(state.measure_lengths, trunc(cmd.position));
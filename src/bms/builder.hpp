@@ -10,6 +10,8 @@ or distributed except according to those terms.
 #pragma once
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/cancel.hpp"
 #include "io/song.hpp"
 #include "bms/chart.hpp"
 
@@ -19,12 +21,35 @@ namespace playnote::bms {
 class Builder {
 public:
 	// Create the builder. Chart generation from this builder will use the provided logger.
-	explicit Builder(Logger::Category);
+	// Without audio, keysounds aren't loaded and the offline render is skipped; the chart is silent,
+	// its loudness is zero, and its audio duration is the same as the chart duration.
+	// BGA files are only loaded if requested, since only playback needs them; the BGA timeline
+	// is generated either way.
+	explicit Builder(Logger::Category, bool load_audio = true, bool load_bga = false);
 
 	// Build a chart from BMS data. The song must contain audio/video resources referenced by the chart.
 	// Optionally, the metadata cache speeds up loading by skipping expensive steps.
-	auto build(unique_ptr<thread_pool>&, span<byte const> bms, io::Song&, int sampling_rate,
-		optional<reference_wrapper<Metadata>> cache = nullopt) -> task<shared_ptr<Chart const>>;
+	// Throws cancelled_error if the token is cancelled before the chart is complete.
+	auto build(Scheduler&, span<byte const> bms, io::Song&, int sampling_rate,
+		optional<reference_wrapper<Metadata>> cache = nullopt, CancelToken = {}) -> task<shared_ptr<Chart const>>;
+
+	// Statistics of the most recent rebuild.
+	struct RebuildStats {
+		bool full; // All measures were parsed, because it was the first rebuild or the headers changed
+		ssize_t measures_parsed;
+		ssize_t measures_total;
+	};
+
+	// Build a chart from an edited version of the BMS data passed to the previous rebuild.
+	// Only measures whose lines changed are parsed again; a change to any header line, or the first
+	// rebuild, parses the whole file. Keysounds and BGA files already loaded by the previous chart
+	// are reused, and the offline render is skipped, carrying over the previous chart's loudness
+	// and preview. Rebuilds of the same builder must not overlap.
+	// Throws cancelled_error if the token is cancelled before the chart is complete.
+	auto rebuild(Scheduler&, span<byte const> bms, io::Song&, int sampling_rate,
+		CancelToken = {}) -> task<shared_ptr<Chart const>>;
+
+	[[nodiscard]] auto get_rebuild_stats() const -> RebuildStats { return rebuild_stats; }
 
 private:
 	// Whole part - measure, fractional part - position within measure.
@@ -80,6 +105,13 @@ private:
 		float scroll_speed;
 	};
 
+	// A BGA change event, measure-relative.
+	struct MeasureRelBGA {
+		NotePosition position;
+		BGAEvent::Layer layer;
+		ssize_t bmp_slot_idx;
+	};
+
 	// Temporary structures for building the chart.
 	struct State {
 		// Maps for flattening the slot values into increasing indices.
@@ -95,16 +127,53 @@ private:
 			ssize_t idx = -1;
 			float bpm;
 		};
+		struct BMPSlot {
+			ssize_t idx = -1;
+			string filename; // without extension
+			bool used = false; // true if any BGA event uses the slot
+		};
 
 		Mapping<WavSlot> wav;
 		Mapping<BPMSlot> bpm;
+		Mapping<BMPSlot> bmp;
 
 		vector<double> measure_lengths;
 		vector<MeasureRelBPM> measure_rel_bpms;
 		vector<MeasureRelNote> measure_rel_notes;
+		vector<MeasureRelBGA> measure_rel_bgas;
+	};
+
+	// Parse results of one measure, kept between rebuilds.
+	struct Measure {
+		string text; // All lines of the measure, in order
+		bool extends = false; // true if any event of the measure extends the measure list
+		double length = 1.0;
+		vector<MeasureRelBPM> bpms;
+		vector<MeasureRelNote> notes;
+		vector<MeasureRelBGA> bgas;
+	};
+
+	// State of the previous rebuild.
+	struct ParseCache {
+		string headers; // All header lines, in order
+		State state; // Slot mappings only
+		Metadata metadata; // As set by the headers
+		State::Mapping<Measure> measures; // By measure number, as written in the file
+		shared_ptr<Chart const> chart;
+	};
+
+	// Media of a previous chart that a new build can reuse.
+	struct Reuse {
+		Chart const* chart;
+		vector<ssize_t> wav_slots; // For every slot, index of the previous chart's slot with the same file, or -1
+		vector<ssize_t> bmp_slots; // ^
 	};
 
 	Logger::Category cat;
+	bool load_audio;
+	bool load_bga;
+	optional<ParseCache> parse_cache;
+	RebuildStats rebuild_stats = {};
 
 	using HeaderHandlerFunc = void(Builder::*)(HeaderCommand, Chart&, State&);
 	unordered_map<string, HeaderHandlerFunc, string_hash> header_handlers;
@@ -114,6 +183,14 @@ private:
 	[[nodiscard]] static auto slot_hex_to_int(string_view hex) -> ssize_t;
 	static void extend_measure_lengths(vector<double>&, ssize_t max_measure);
 
+	// Convert BMS data to UTF-8 with LF line endings.
+	[[nodiscard]] auto decode_bms(span<byte const>) -> string;
+	void parse(string_view bms, Chart&, State&);
+	// Turn parse results into a complete chart. With reuse, media of the previous chart is copied
+	// instead of loaded, and the offline render is skipped.
+	auto generate(Scheduler&, shared_ptr<Chart>, State, io::Song&, int sampling_rate,
+		optional<reference_wrapper<Metadata>> cache, optional<Reuse>, CancelToken) -> task<shared_ptr<Chart const>>;
+
 	void parse_header(string_view line, ssize_t line_num, Chart&, State&);
 	void parse_channel(string_view line, ssize_t line_num, Chart&, State&);
 
@@ -141,12 +218,16 @@ private:
 	// Slot reference handlers
 	void handle_header_wav(HeaderCommand, Chart&, State&);
 	void handle_header_bpmxx(HeaderCommand, Chart&, State&);
+	void handle_header_bmp(HeaderCommand, Chart&, State&);
 
 	// Audio channels
 	void handle_channel_bgm(ChannelCommand, Chart&, State&);
 	void handle_channel_note(ChannelCommand, Chart&, State&);
 	void handle_channel_ln(ChannelCommand, Chart&, State&);
 
+	// BGA channels
+	void handle_channel_bga(ChannelCommand, Chart&, State&);
+
 	// Timeline control channels
 	void handle_channel_measure_length(ChannelCommand, Chart&, State&);
 	void handle_channel_bpm(ChannelCommand, Chart&, State&);
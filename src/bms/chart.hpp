@@ -9,7 +9,9 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/memory.hpp"
 #include "lib/openssl.hpp"
+#include "lib/ffmpeg.hpp"
 #include "dev/audio.hpp"
 
 namespace playnote::bms {
@@ -130,22 +132,46 @@ struct Metadata {
 	BPMRange bpm_range;
 };
 
+// A change of the picture shown on one of the BGA layers.
+struct BGAEvent {
+	// The layers are drawn bottom to top. Black pixels of the Layer layer are transparent.
+	// The Poor layer replaces the others for a moment after the player misses a note.
+	enum class Layer: ssize_t {
+		Base,
+		Layer,
+		Poor,
+	};
+
+	nanoseconds timestamp;
+	ssize_t bmp_slot;
+};
+
 using Playstyle = Metadata::Playstyle;
 using Difficulty = Metadata::Difficulty;
 
 // All the data that's required to reproduce a chart's timeline (timing and objects.)
 struct Timeline {
 	using Lanes = array<Lane, enum_count<Lane::Type>()>;
+	using BGALayers = array<vector<BGAEvent>, enum_count<BGAEvent::Layer>()>;
 
 	Lanes lanes;
 	vector<BPMChange> bpm_sections; // Sorted from earliest
+	BGALayers bga; // Sorted from earliest
 };
 
-// Media contents referenced by the chart.
+// Media contents referenced by the chart. Slot contents are immutable, so they're shared with
+// the song's audio cache and with charts rebuilt from this one instead of being copied.
 struct Media {
-	using WavSlot = vector<dev::Sample>;
+	// Null if the file was missing or failed to load.
+	using WavSlot = shared_ptr<tracked_vector<dev::Sample> const>;
+	// Still images are decoded when the chart is built. Videos are kept compressed, and decoded
+	// during playback.
+	using BMPData = variant<lib::ffmpeg::Picture, tracked_vector<byte>>;
+	// Null if the file was missing or failed to load.
+	using BMPSlot = shared_ptr<BMPData const>;
 	vector<WavSlot> wav_slots;
-	vector<dev::Sample> preview;
+	vector<BMPSlot> bmp_slots;
+	tracked_vector<dev::Sample> preview;
 	int sampling_rate;
 };
 
@@ -25,10 +25,61 @@ Cursor::Cursor(shared_ptr<Chart const> chart, bool autoplay):
 	}
 }
 
-auto Cursor::pending_judgment_events() -> generator<JudgmentEvent>
+auto Cursor::skip_to(ssize_t sample_position, span<RecordedInput const> inputs) -> ssize_t
 {
-	auto event = JudgmentEvent{};
-	while (judgment_events.try_dequeue(event)) co_yield move(event);
+	auto const sampling_rate = chart->media.sampling_rate;
+	auto const silent = [](SoundEvent) {};
+	auto applied = 0z;
+	while (sample_progress < sample_position) {
+		// Find the next sample where anything can happen. Deadlines are rounded down a sample,
+		// so that they're never overshot; waking up early just costs an extra pass
+		auto next = sample_position;
+		if (applied < ssize(inputs)) next = min(next, inputs[applied].sample);
+		for (auto [lane, progress]: views::zip(chart->timeline.lanes, lane_progress)) {
+			if (!lane.playable || progress.next_note >= ssize(lane.notes)) continue;
+			Note const& note = lane.notes[progress.next_note];
+			if (!progress.ln_timing)
+				next = min(next, lib::ns_to_samples(note.timestamp + HitWindow, sampling_rate) - 1);
+			if (note.type_is<Note::LN>())
+				next = min(next, lib::ns_to_samples(note.timestamp + note.params<Note::LN>().length, sampling_rate) - 1);
+		}
+		sample_progress = max(sample_progress, next);
+		if (sample_progress >= sample_position) break;
+
+		// Same as advance_one_sample(), minus the sounds and unplayable lanes
+		while (applied < ssize(inputs) && inputs[applied].sample <= sample_progress) {
+			trigger_input(inputs[applied].input, silent);
+			applied += 1;
+		}
+		for (auto [type, lane, progress]: views::zip(
+			views::iota(0u) | views::transform([](auto i) { return static_cast<Lane::Type>(i); }),
+			chart->timeline.lanes, lane_progress))
+		{
+			if (!lane.playable) continue;
+			{
+				if (progress.next_note >= ssize(lane.notes)) continue;
+				Note const& note = lane.notes[progress.next_note];
+				if (get_progress_ns() - note.timestamp > HitWindow && !progress.ln_timing)
+					trigger_miss(type);
+			}
+			{
+				if (progress.next_note >= ssize(lane.notes)) continue;
+				Note const& note = lane.notes[progress.next_note];
+				if (note.type_is<Note::LN>() && note.timestamp + note.params<Note::LN>().length <= get_progress_ns())
+					trigger_ln_release(type);
+			}
+		}
+		sample_progress += 1;
+	}
+	sample_progress = max(sample_progress, sample_position);
+	return applied;
+}
+
+void Cursor::start_recording()
+{
+	recording = make_shared<Recording>();
+	// Inputs are recorded on the audio thread, so the buffer never grows past this
+	recording->reserve(chart->metadata.note_count * RecordedInputsPerNote + RecordedInputsSlack);
 }
 
 void Cursor::seek(ssize_t sample_position)
@@ -67,33 +118,6 @@ void Cursor::seek_relative(ssize_t sample_offset)
 	for (auto _: views::iota(0z, sample_offset)) advance_one_sample([](auto){});
 }
 
-auto Cursor::upcoming_notes(float max_units, nanoseconds offset, bool adjust_for_latency) const -> generator<UpcomingNote>
-{
-	auto const latency_adjustment = adjust_for_latency? -globals::mixer->get_latency() : 0ns;
-	auto const progress_timestamp = globals::mixer->get_audio().samples_to_ns(sample_progress, chart->media.sampling_rate) + latency_adjustment - offset;
-	auto const& bpm_section = get_bpm_section(progress_timestamp);
-	auto const section_progress = progress_timestamp - bpm_section.position;
-	auto const beat_duration = duration<double>{60.0 / chart->metadata.bpm_range.main};
-	auto const bpm_ratio = bpm_section.bpm / chart->timeline.bpm_sections[0].bpm;
-	auto const current_y = bpm_section.y_pos + section_progress / beat_duration * bpm_ratio * bpm_section.scroll_speed;
-	for (auto [idx, lane, progress]: views::zip(views::iota(0z), chart->timeline.lanes, lane_progress)) {
-		if (!lane.visible) continue;
-		for (auto [note_idx, note]: views::zip(
-			views::iota(progress.next_note),
-			span{lane.notes.begin() + progress.next_note, lane.notes.size() - progress.next_note}
-		)) {
-			auto const distance = note.y_pos - current_y;
-			if (distance > max_units) break;
-			co_yield UpcomingNote{
-				.note = note,
-				.lane = static_cast<Lane::Type>(idx),
-				.lane_idx = note_idx,
-				.distance = static_cast<float>(distance),
-			};
-		}
-	}
-}
-
 auto Cursor::operator=(Cursor const& other) -> Cursor&
 {
 	chart = other.chart;
@@ -139,6 +163,12 @@ void Cursor::trigger_ln_release(Lane::Type type)
 	progress.next_note += 1;
 }
 
+auto Cursor::wav_slot(ssize_t idx) const -> span<dev::Sample const>
+{
+	if (idx == -1 || !chart->media.wav_slots[idx]) return {};
+	return *chart->media.wav_slots[idx];
+}
+
 auto Cursor::get_bpm_section(nanoseconds timestamp) const -> BPMChange const&
 {
 	auto const& bpm_sections = chart->timeline.bpm_sections;
@@ -150,4 +180,15 @@ auto Cursor::get_bpm_section(nanoseconds timestamp) const -> BPMChange const&
 	return *bpm_section.begin();
 }
 
+auto Cursor::get_y_pos(nanoseconds offset, bool adjust_for_latency) const -> double
+{
+	auto const latency_adjustment = adjust_for_latency? -globals::mixer->get_latency() : 0ns;
+	auto const progress_timestamp = lib::samples_to_ns(sample_progress, chart->media.sampling_rate) + latency_adjustment - offset;
+	auto const& bpm_section = get_bpm_section(progress_timestamp);
+	auto const section_progress = progress_timestamp - bpm_section.position;
+	auto const beat_duration = duration<double>{60.0 / chart->metadata.bpm_range.main};
+	auto const bpm_ratio = bpm_section.bpm / chart->timeline.bpm_sections[0].bpm;
+	return bpm_section.y_pos + section_progress / beat_duration * bpm_ratio * bpm_section.scroll_speed;
+}
+
 }
@@ -48,6 +48,13 @@ public:
 		span<dev::Sample const> audio;
 	};
 
+	// A manual input, along with the cursor position it was applied at.
+	struct RecordedInput {
+		ssize_t sample;
+		LaneInput input;
+	};
+	using Recording = vector<RecordedInput>;
+
 	// Create a cursor for the given chart.
 	explicit Cursor(shared_ptr<Chart const> chart, bool autoplay = false);
 
@@ -58,13 +65,14 @@ public:
 	[[nodiscard]] auto get_progress() const -> ssize_t { return sample_progress; }
 
 	// Return the current position of the cursor in nanoseconds.
-	[[nodiscard]] auto get_progress_ns() const -> nanoseconds { return globals::mixer->get_audio().samples_to_ns(get_progress(), chart->media.sampling_rate); }
+	[[nodiscard]] auto get_progress_ns() const -> nanoseconds { return lib::samples_to_ns(get_progress(), chart->media.sampling_rate); }
 
 	// true if a lane is currently being held, false otherwise.
 	[[nodiscard]] auto is_pressed(Lane::Type lane) const -> bool { return lane_progress[+lane].pressed; }
 
-	// Return every judgment event since the last time this was called.
-	auto pending_judgment_events() -> generator<JudgmentEvent>;
+	// Call the provided function once for every judgment event since the last time this was called.
+	template<callable<void(JudgmentEvent)> Func>
+	void pending_judgment_events(Func&&);
 
 	// Progress by one audio sample, calling the provided function once for every newly started sound.
 	// Can be optionally provided with inputs that will affect chart playback (ignored if autoplay).
@@ -73,6 +81,13 @@ public:
 	template<callable<void(SoundEvent)> Func>
 	auto advance_one_sample(Func&& func, span<LaneInput const> inputs = {}) -> bool;
 
+	// Advance to the given position without triggering any audio, applying recorded inputs at their
+	// positions. Instead of visiting every sample, the cursor skips straight to the next moment
+	// that can change a judgment: an input, a note leaving the hit window, or an LN ending.
+	// Unplayable lanes are not advanced. Inputs must be sorted by position; returns the number
+	// of inputs that were applied. Judgment events are the same as from advance_one_sample().
+	auto skip_to(ssize_t sample_position, span<RecordedInput const> inputs) -> ssize_t;
+
 	// Directly modify current position, without triggering any audio or judgment events in between
 	// current position and the destination. Note progress will update for the new position, as if
 	// the chart has been autoplayed up to this point. Input queue is unaffected; you might want to
@@ -80,29 +95,44 @@ public:
 	void seek(ssize_t sample_position);
 
 	// Seek to a specified timestamp. The same precautions apply as for seek().
-	void seek_ns(nanoseconds timestamp) { seek(globals::mixer->get_audio().ns_to_samples(timestamp, chart->media.sampling_rate)); }
+	void seek_ns(nanoseconds timestamp) { seek(lib::ns_to_samples(timestamp, chart->media.sampling_rate)); }
 
 	// Seek relative to current position. If seek is backward, or autoplay is on, lane progress is
 	// driven automatically. Otherwise, functions as a fast-forward.
 	void seek_relative(ssize_t sample_offset);
 
-	// Return every note less than max_units away from current position.
+	// Call the provided function once for every note less than max_units away from current position.
 	struct UpcomingNote {
 		Note const& note;
 		Lane::Type lane;
 		ssize_t lane_idx;
 		float distance; // From current chart position, in units
 	};
-	auto upcoming_notes(float max_units, nanoseconds offset = 0ns, bool adjust_for_latency = false) const -> generator<UpcomingNote>;
+	template<callable<void(UpcomingNote const&)> Func>
+	void upcoming_notes(Func&&, float max_units, nanoseconds offset = 0ns, bool adjust_for_latency = false) const;
 
 	// For a given lane, return the index of the next note to be judged. Every note with a smaller
 	// index has already been judged and should not be visible to the player.
 	auto next_note_idx(Lane::Type lane) const -> ssize_t { return lane_progress[+lane].next_note; }
 
+	// Start recording manual inputs, for the play to be replayed with skip_to() later. The recording
+	// has a fixed capacity, enough for a press and a release of every note several times over;
+	// inputs past it are not recorded.
+	void start_recording();
+
+	// Return the inputs recorded so far, or nullptr if recording wasn't started. Only safe to read
+	// while the cursor isn't advancing.
+	[[nodiscard]] auto get_recording() const -> shared_ptr<Recording const> { return recording; }
+
+	// Copies don't record.
 	Cursor(Cursor const& other) { *this = other; }
 	auto operator=(Cursor const&) -> Cursor&;
 
 private:
+	// Capacity of a recording, per note of the chart and in total on top of that.
+	static constexpr auto RecordedInputsPerNote = 8z;
+	static constexpr auto RecordedInputsSlack = 4096z;
+
 	struct LaneProgress {
 		ssize_t next_note; // Index of the earliest note that hasn't been judged yet
 		ssize_t active_slot; // Index of the WAV slot that will be triggered on player input
@@ -115,21 +145,35 @@ private:
 	ssize_t sample_progress = 0;
 	array<LaneProgress, enum_count<Lane::Type>()> lane_progress = {};
 	spsc_queue<JudgmentEvent> judgment_events;
+	shared_ptr<Recording> recording;
 
 	template<callable<void(SoundEvent)> Func>
 	void trigger_input(LaneInput, Func&&);
 	void trigger_miss(Lane::Type);
 	void trigger_ln_release(Lane::Type);
+	// Return the audio of a WAV slot, or an empty span if it has none.
+	auto wav_slot(ssize_t idx) const -> span<dev::Sample const>;
 	auto get_bpm_section(nanoseconds timestamp) const -> BPMChange const&;
+	auto get_y_pos(nanoseconds offset, bool adjust_for_latency) const -> double;
 };
 
+template<callable<void(Cursor::JudgmentEvent)> Func>
+void Cursor::pending_judgment_events(Func&& func)
+{
+	auto event = JudgmentEvent{};
+	while (judgment_events.try_dequeue(event)) func(move(event));
+}
+
 template<callable<void(Cursor::SoundEvent)> Func>
 auto Cursor::advance_one_sample(Func&& func, span<LaneInput const> inputs) -> bool
 {
 	// Manual inputs
 	if (!autoplay) {
-		for (auto const& input: inputs)
+		for (auto const& input: inputs) {
+			if (recording && recording->size() < recording->capacity())
+				recording->push_back(RecordedInput{sample_progress, input});
 			trigger_input(input, func);
+		}
 	}
 
 	for (auto [type, lane, progress]: views::zip(
@@ -173,6 +217,28 @@ auto Cursor::advance_one_sample(Func&& func, span<LaneInput const> inputs) -> bo
 	return get_progress_ns() < chart->metadata.chart_duration;
 }
 
+template<callable<void(Cursor::UpcomingNote const&)> Func>
+void Cursor::upcoming_notes(Func&& func, float max_units, nanoseconds offset, bool adjust_for_latency) const
+{
+	auto const current_y = get_y_pos(offset, adjust_for_latency);
+	for (auto [idx, lane, progress]: views::zip(views::iota(0z), chart->timeline.lanes, lane_progress)) {
+		if (!lane.visible) continue;
+		for (auto [note_idx, note]: views::zip(
+			views::iota(progress.next_note),
+			span{lane.notes.begin() + progress.next_note, lane.notes.size() - progress.next_note}
+		)) {
+			auto const distance = note.y_pos - current_y;
+			if (distance > max_units) break;
+			func(UpcomingNote{
+				.note = note,
+				.lane = static_cast<Lane::Type>(idx),
+				.lane_idx = note_idx,
+				.distance = static_cast<float>(distance),
+			});
+		}
+	}
+}
+
 template<callable<void(Cursor::SoundEvent)> Func>
 void Cursor::trigger_input(LaneInput input, Func&& func)
 {
@@ -196,10 +262,10 @@ void Cursor::trigger_input(LaneInput input, Func&& func)
 						.timing = get_progress_ns() - note.timestamp,
 					});
 				}
-				if (lane.audible && note.wav_slot != -1 && !chart->media.wav_slots[note.wav_slot].empty()) {
+				if (lane.audible && note.wav_slot != -1 && !wav_slot(note.wav_slot).empty()) {
 					func(SoundEvent{
 						.channel = note.wav_slot,
-						.audio = chart->media.wav_slots[note.wav_slot],
+						.audio = wav_slot(note.wav_slot),
 					});
 				}
 
@@ -210,10 +276,10 @@ void Cursor::trigger_input(LaneInput input, Func&& func)
 					progress.ln_timing = get_progress_ns() - note.timestamp;
 			} else {
 				// Press is too early to affect the note
-				if (lane.audible && note.wav_slot != -1 && !chart->media.wav_slots[note.wav_slot].empty()) {
+				if (lane.audible && note.wav_slot != -1 && !wav_slot(note.wav_slot).empty()) {
 					func(SoundEvent{
 						.channel = progress.active_slot,
-						.audio = chart->media.wav_slots[progress.active_slot],
+						.audio = wav_slot(progress.active_slot),
 					});
 				}
 			}
@@ -225,10 +291,10 @@ void Cursor::trigger_input(LaneInput input, Func&& func)
 	} else {
 		if (input.state) {
 			// Chart over, player is just pressing things for fun
-			if (lane.audible && progress.active_slot != -1 && !chart->media.wav_slots[progress.active_slot].empty()) {
+			if (lane.audible && progress.active_slot != -1 && !wav_slot(progress.active_slot).empty()) {
 				func(SoundEvent{
 					.channel = progress.active_slot,
-					.audio = chart->media.wav_slots[progress.active_slot],
+					.audio = wav_slot(progress.active_slot),
 				});
 			}
 		}
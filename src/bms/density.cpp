@@ -0,0 +1,158 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/density.hpp"
+
+#include <cstring>
+#include "preamble.hpp"
+#include "lib/bits.hpp"
+
+namespace playnote::bms {
+
+// Layout: encoding, scale, value count, then the values. The first byte is never zero, which
+// tells it apart from the zpp_bits format of earlier versions; that one starts with the 32-bit
+// size of a 2048-point series.
+struct DensityHeader {
+	DensityEncoding encoding;
+	float scale; // Value of the largest quantized step
+	uint32_t count;
+};
+static constexpr auto DensityHeaderSize = 1z + 4z + 4z;
+
+template<typename T>
+static void append_bytes(vector<byte>& out, T value)
+{
+	auto const bytes = std::as_bytes(span{&value, 1});
+	out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+template<typename T>
+static auto read_bytes(span<byte const> in, ssize_t offset) -> T
+{
+	if (offset + static_cast<ssize_t>(sizeof(T)) > ssize(in)) throw runtime_error{"Truncated density data"};
+	auto value = T{};
+	std::memcpy(&value, in.data() + offset, sizeof(T));
+	return value;
+}
+
+auto encode_density(span<float const> values, DensityEncoding encoding) -> vector<byte>
+{
+	auto const steps = encoding == DensityEncoding::Q8? 255.0f : 65535.0f;
+	auto const peak = fold_left(values, 0.0f, [](auto acc, auto v) { return max(acc, v); });
+	auto const scale = peak > 0.0f? peak / steps : 0.0f;
+	auto const quantize = [&](float value) -> uint32_t {
+		if (scale == 0.0f) return 0;
+		return static_cast<uint32_t>(clamp(std::lround(value / scale), 0l, static_cast<long>(steps)));
+	};
+
+	auto out = vector<byte>{};
+	out.reserve(DensityHeaderSize + values.size() * (encoding == DensityEncoding::Q8? 1 : 2));
+	append_bytes(out, encoding);
+	append_bytes(out, scale);
+	append_bytes(out, static_cast<uint32_t>(values.size()));
+	auto previous = 0;
+	for (auto value: values) {
+		auto const quantized = quantize(value);
+		switch (encoding) {
+		case DensityEncoding::Q8:
+			append_bytes(out, static_cast<uint8_t>(quantized));
+			break;
+		case DensityEncoding::Q16:
+			append_bytes(out, static_cast<uint16_t>(quantized));
+			break;
+		case DensityEncoding::Q16Delta: {
+			// Densities are smooth, so most differences fit in a single varint byte
+			auto const delta = static_cast<int>(quantized) - previous;
+			auto zigzag = static_cast<uint32_t>((delta << 1) ^ (delta >> 31));
+			while (zigzag >= 0x80) {
+				out.emplace_back(static_cast<byte>((zigzag & 0x7F) | 0x80));
+				zigzag >>= 7;
+			}
+			out.emplace_back(static_cast<byte>(zigzag));
+			previous = static_cast<int>(quantized);
+			break;
+		}
+		}
+	}
+	return out;
+}
+
+auto decode_density(span<byte const> in) -> vector<float>
+{
+	if (in.empty()) throw runtime_error{"Empty density data"};
+	if (in[0] == byte{0}) {
+		auto result = vector<float>{};
+		lib::bits::in{in}(result).or_throw();
+		return result;
+	}
+
+	auto const header = DensityHeader{
+		.encoding = read_bytes<DensityEncoding>(in, 0),
+		.scale = read_bytes<float>(in, 1),
+		.count = read_bytes<uint32_t>(in, 5),
+	};
+	auto result = vector<float>{};
+	result.reserve(header.count);
+	auto offset = DensityHeaderSize;
+	auto previous = 0;
+	for (auto _: views::iota(0u, header.count)) {
+		auto quantized = 0;
+		switch (header.encoding) {
+		case DensityEncoding::Q8:
+			quantized = read_bytes<uint8_t>(in, offset);
+			offset += 1;
+			break;
+		case DensityEncoding::Q16:
+			quantized = read_bytes<uint16_t>(in, offset);
+			offset += 2;
+			break;
+		case DensityEncoding::Q16Delta: {
+			auto zigzag = 0u;
+			for (auto shift = 0; ; shift += 7) {
+				if (shift > 28) throw runtime_error{"Malformed density data"};
+				auto const next = read_bytes<uint8_t>(in, offset);
+				offset += 1;
+				zigzag |= (next & 0x7Fu) << shift;
+				if (!(next & 0x80)) break;
+			}
+			auto const delta = static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+			quantized = previous + delta;
+			previous = quantized;
+			break;
+		}
+		default:
+			throw runtime_error_fmt("Unknown density encoding {}", +header.encoding);
+		}
+		result.emplace_back(quantized * header.scale);
+	}
+	return result;
+}
+
+auto downsample_density(Metadata::Density const& density, ssize_t points) -> Metadata::Density
+{
+	auto const length = ssize(density.key);
+	if (length <= points) return density;
+	auto const downsample = [&](vector<float> const& series) {
+		auto result = vector<float>(points);
+		for (auto [idx, value]: result | views::enumerate) {
+			auto const from = idx * length / points;
+			auto const to = (idx + 1) * length / points;
+			value = *max_element(span{series}.subspan(from, to - from));
+		}
+		return result;
+	};
+	return Metadata::Density{
+		.resolution = density.resolution * length / points,
+		.key = downsample(density.key),
+		.scratch = downsample(density.scratch),
+		.ln = downsample(density.ln),
+	};
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bms {
+
+// Storage formats of a density series. Values are quantized against the series' maximum,
+// which is stored alongside as the scale.
+enum class DensityEncoding: uint8_t {
+	Q8 = 1, // 8 bits per value
+	Q16 = 2, // 16 bits per value
+	Q16Delta = 3, // 16-bit values stored as varint differences from the previous one
+};
+
+// Number of points in a density thumbnail; enough for a graph in a chart list.
+constexpr auto DensityThumbnailPoints = 128z;
+
+// Serialize a density series. The encoding is stored with the data.
+[[nodiscard]] auto encode_density(span<float const>, DensityEncoding) -> vector<byte>;
+
+// Deserialize a density series written by encode_density(). Series stored by earlier versions,
+// as zpp_bits-serialized floats, are also accepted.
+// Throws runtime_error if the data is malformed.
+[[nodiscard]] auto decode_density(span<byte const>) -> vector<float>;
+
+// Reduce density series to the given number of points. Each point is the maximum of the points
+// it covers, so that peaks stay visible. Series that are already short enough are returned as-is.
+[[nodiscard]] auto downsample_density(Metadata::Density const&, ssize_t points) -> Metadata::Density;
+
+}
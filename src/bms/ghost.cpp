@@ -0,0 +1,37 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/ghost.hpp"
+
+#include "preamble.hpp"
+#include "utils/tracing.hpp"
+
+namespace playnote::bms {
+
+Ghost::Ghost(shared_ptr<Chart const> chart, shared_ptr<Cursor::Recording const> recording):
+	chart{move(chart)},
+	recording{move(recording)},
+	cursor{this->chart},
+	score{*this->chart}
+{}
+
+void Ghost::update(nanoseconds progress)
+{
+	TRACE_ZONE("Ghost update");
+	auto const target = lib::ns_to_samples(progress, chart->media.sampling_rate);
+	if (target < cursor.get_progress()) {
+		cursor = Cursor{chart};
+		score = Score{*chart};
+		next_input = 0;
+	}
+	next_input += cursor.skip_to(target, span{*recording}.subspan(next_input));
+	cursor.pending_judgment_events([&](auto&& ev) { score.submit_judgment_event(ev); });
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "bms/cursor.hpp"
+#include "bms/score.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bms {
+
+// A muted replay of a recorded play, for comparison against the live one. Only the judgment state
+// is tracked; no sound is played, and the ghost jumps between recorded inputs and note deadlines
+// rather than advancing one sample at a time. Cheap enough to run dozens alongside the player.
+class Ghost {
+public:
+	// Create a ghost that replays the recording on the given chart. The recording must have been
+	// made on the same chart.
+	Ghost(shared_ptr<Chart const>, shared_ptr<Cursor::Recording const>);
+
+	// Advance the replay to the given chart position. Moving backwards restarts it from the beginning.
+	void update(nanoseconds progress);
+
+	// Return the replay's score so far.
+	[[nodiscard]] auto get_score() const -> Score const& { return score; }
+
+	// Return the position the replay was advanced to.
+	[[nodiscard]] auto get_progress_ns() const -> nanoseconds { return cursor.get_progress_ns(); }
+
+private:
+	shared_ptr<Chart const> chart;
+	shared_ptr<Cursor::Recording const> recording;
+	Cursor cursor;
+	Score score;
+	ssize_t next_input = 0;
+};
+
+}
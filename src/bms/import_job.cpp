@@ -0,0 +1,247 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/import_job.hpp"
+
+#include "preamble.hpp"
+#include "utils/tracing.hpp"
+#include "lib/openssl.hpp"
+#include "lib/ffmpeg.hpp"
+#include "lib/bits.hpp"
+#include "io/source.hpp"
+#include "io/song.hpp"
+#include "bms/builder.hpp"
+
+namespace playnote::bms {
+
+// Sampling rate of chart previews, and of the audio the charts are analyzed with
+static constexpr auto ImportSamplingRate = 48000;
+
+// Build a single chart of a song, and encode its preview.
+static auto build_chart(Scheduler& scheduler, io::Song& song, string chart_path, span<byte const> chart_raw,
+	CancelToken cancel_token) -> task<ImportedChart>
+{
+	TRACE_ASYNC_SPAN("Import chart");
+	cancel_token.check();
+
+	auto builder_cat = globals::logger->create_string_logger(lib::openssl::md5_to_hex(lib::openssl::md5(chart_raw)));
+	INFO_AS(builder_cat, "Importing chart \"{}\"", chart_path);
+	auto builder = Builder{builder_cat};
+	auto const build_start = steady_clock::now();
+	auto chart = co_await builder.build(scheduler, chart_raw, song, ImportSamplingRate, nullopt, cancel_token);
+	auto const encode_start = steady_clock::now();
+	auto const preview = lib::ffmpeg::encode_as_opus(chart->media.preview, ImportSamplingRate,
+		MemoryTag::ImportStaging, cancel_token);
+	auto const encode_end = steady_clock::now();
+
+	co_return ImportedChart{
+		.path = move(chart_path),
+		.md5 = chart->md5,
+		.metadata = chart->metadata,
+		.preview = vector<byte>{preview.begin(), preview.end()},
+		.log = builder_cat.get_buffer(),
+		.build_time = duration_cast<nanoseconds>(encode_start - build_start),
+		.encode_time = duration_cast<nanoseconds>(encode_end - encode_start),
+	};
+}
+
+auto run_import_job(Logger::Category cat, Scheduler& scheduler, ImportJob const& job, io::AudioStore& audio_store,
+	CancelToken cancel_token) -> task<ImportResult>
+{
+	TRACE_ASYNC_SPAN("Import job");
+	auto result = ImportResult{};
+
+	// Create/modify the songzip
+	auto stage_start = steady_clock::now();
+	auto source = io::Source{job.source, cancel_token};
+	auto song = optional<io::Song>{nullopt};
+	if (job.base) {
+		song = co_await io::Song::from_source_append(cat, scheduler, io::read_file(*job.base), source,
+			job.destination, cancel_token, &audio_store);
+	} else {
+		song = co_await io::Song::from_source(cat, scheduler, source, job.destination, cancel_token, &audio_store);
+	}
+	auto const references = song->get_store_references();
+	result.store_references.assign(references.begin(), references.end());
+	auto now = steady_clock::now();
+	result.transcode_time = duration_cast<nanoseconds>(now - stage_start);
+	stage_start = now;
+
+	// Prepare song for chart builds
+	co_await song->preload_audio_files(scheduler, ImportSamplingRate, cancel_token);
+	INFO_AS(cat, "Song \"{}\" files processed successfully", job.source);
+	result.preload_time = duration_cast<nanoseconds>(steady_clock::now() - stage_start);
+
+	// Build all charts that aren't in the library yet
+	auto chart_tasks = vector<task<ImportedChart>>{};
+	auto chart_paths = vector<string>{};
+	for (auto [path, chart]: song->for_each_chart()) {
+		if (contains(job.skip, lib::openssl::md5(chart))) {
+			INFO_AS(cat, "Chart import \"{}\" skipped (duplicate)", path);
+			result.charts_skipped += 1;
+			continue;
+		}
+		chart_tasks.emplace_back(schedule_task_on(scheduler, build_chart(scheduler, *song, string{path}, chart, cancel_token)));
+		chart_paths.emplace_back(path);
+	}
+	auto built = co_await when_all(move(chart_tasks));
+	cancel_token.check();
+	for (auto [chart, path]: views::zip(built, chart_paths)) {
+		try {
+			result.charts.emplace_back(move(chart.return_value()));
+		} catch (exception const& e) {
+			result.failures.emplace_back(FailedChart{.path = path, .message = e.what()});
+		}
+	}
+	co_return result;
+}
+
+auto format_import_job(ImportJob const& job) -> string
+{
+	// Fields are separated by tabs, so paths can't contain any
+	auto const field = [](fs::path const& path) {
+		auto str = path.string();
+		if (str.find_first_of("\t\r\n") != string::npos)
+			throw runtime_error_fmt("Path \"{}\" can't be sent to an import worker", path);
+		return str;
+	};
+	auto skip = string{};
+	for (auto const& md5: job.skip) {
+		if (!skip.empty()) skip.push_back(',');
+		skip.append(lib::openssl::md5_to_hex(md5));
+	}
+	return format("{}\t{}\t{}\t{}", field(job.source), job.base? field(*job.base) : string{},
+		field(job.destination), skip);
+}
+
+auto parse_import_job(string_view line) -> ImportJob
+{
+	auto fields = vector<string_view>{};
+	copy(line | views::split('\t') | views::to_sv, back_inserter(fields));
+	if (fields.size() != 4) throw runtime_error_fmt("Malformed import job: \"{}\"", line);
+
+	auto job = ImportJob{
+		.source = fields[0],
+		.base = fields[1].empty()? nullopt : optional{fs::path{fields[1]}},
+		.destination = fields[2],
+	};
+	if (fields[3].empty()) return job;
+	for (auto hex: fields[3] | views::split(',') | views::to_sv) {
+		auto const md5 = lib::openssl::md5_from_hex(hex);
+		if (!md5) throw runtime_error_fmt("Malformed import job: invalid MD5 \"{}\"", hex);
+		job.skip.emplace_back(*md5);
+	}
+	return job;
+}
+
+// Layout: magic, version, then the result. The importing process and its workers can come from
+// different builds, so the version needs bumping whenever the layout below changes.
+static constexpr auto ImportResultMagic = uint32_t{0x52494E50}; // "PNIR"
+static constexpr auto ImportResultVersion = uint32_t{1};
+
+// Durations and enums are stored as their underlying values. Const values are written, and the rest
+// are read.
+template<typename Archive, typename Rep, typename Period>
+static void archive_value(Archive& archive, duration<Rep, Period> const& value) { archive(value.count()).or_throw(); }
+template<typename Archive, typename Rep, typename Period>
+static void archive_value(Archive& archive, duration<Rep, Period>& value)
+{
+	auto ticks = Rep{};
+	archive(ticks).or_throw();
+	value = duration<Rep, Period>{ticks};
+}
+template<typename Archive, scoped_enum T>
+static void archive_value(Archive& archive, T const& value) { archive(+value).or_throw(); }
+template<typename Archive, scoped_enum T>
+static void archive_value(Archive& archive, T& value)
+{
+	auto underlying = +T{};
+	archive(underlying).or_throw();
+	value = T{underlying};
+}
+
+// The field lists below are shared by both directions. Every member is bound, so adding one
+// to the structs fails to compile until it's added here as well.
+template<typename Archive, typename Meta>
+static void archive_metadata(Archive& archive, Meta& meta)
+{
+	auto& [title, subtitle, artist, subartist, genre, url, email, difficulty, playstyle, features, note_count,
+		chart_duration, audio_duration, loudness, density, nps, bpm_range] = meta;
+	auto& [has_ln, has_soflan] = features;
+	auto& [density_resolution, density_key, density_scratch, density_ln] = density;
+	auto& [nps_average, nps_peak] = nps;
+	auto& [bpm_initial, bpm_min, bpm_max, bpm_main] = bpm_range;
+
+	archive(title, subtitle, artist, subartist, genre, url, email).or_throw();
+	archive_value(archive, difficulty);
+	archive_value(archive, playstyle);
+	archive(has_ln, has_soflan, note_count).or_throw();
+	archive_value(archive, chart_duration);
+	archive_value(archive, audio_duration);
+	archive(loudness).or_throw();
+	archive_value(archive, density_resolution);
+	archive(density_key, density_scratch, density_ln, nps_average, nps_peak,
+		bpm_initial, bpm_min, bpm_max, bpm_main).or_throw();
+}
+
+template<typename Archive, typename Result>
+static void archive_import_result(Archive& archive, Result& result)
+{
+	constexpr auto reading = !std::is_const_v<Result>;
+	auto& [charts, failures, charts_skipped, store_references, audio_reused, audio_transcoded,
+		transcode_time, preload_time] = result;
+
+	auto chart_count = static_cast<uint32_t>(charts.size());
+	archive(chart_count).or_throw();
+	if constexpr (reading) charts.resize(chart_count);
+	for (auto& chart: charts) {
+		auto& [path, md5, metadata, preview, log, build_time, encode_time] = chart;
+		archive(path, md5, preview, log).or_throw();
+		archive_value(archive, build_time);
+		archive_value(archive, encode_time);
+		archive_metadata(archive, metadata);
+	}
+
+	auto failure_count = static_cast<uint32_t>(failures.size());
+	archive(failure_count).or_throw();
+	if constexpr (reading) failures.resize(failure_count);
+	for (auto& failure: failures) {
+		auto& [path, message] = failure;
+		archive(path, message).or_throw();
+	}
+
+	archive(charts_skipped, store_references, audio_reused, audio_transcoded).or_throw();
+	archive_value(archive, transcode_time);
+	archive_value(archive, preload_time);
+}
+
+auto serialize_import_result(ImportResult const& result) -> vector<byte>
+{
+	auto data = vector<byte>{};
+	auto out = lib::bits::out{data};
+	out(ImportResultMagic, ImportResultVersion).or_throw();
+	archive_import_result(out, result);
+	return data;
+}
+
+auto deserialize_import_result(span<byte const> data) -> ImportResult
+{
+	auto in = lib::bits::in{data};
+	auto magic = uint32_t{};
+	auto version = uint32_t{};
+	in(magic, version).or_throw();
+	if (magic != ImportResultMagic) throw runtime_error{"Not an import result"};
+	if (version != ImportResultVersion)
+		throw runtime_error_fmt("Import result has version {}, expected {}", version, ImportResultVersion);
+	auto result = ImportResult{};
+	archive_import_result(in, result);
+	return result;
+}
+
+}
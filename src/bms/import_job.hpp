@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/cancel.hpp"
+#include "io/audio_store.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bms {
+
+// The part of a song import that doesn't touch the library database: writing the songzip, and
+// building all new charts of the song. Runs in the importing process, or in an import worker
+// process so that a crash in a decoder can't take the importing process down with it.
+struct ImportJob {
+	fs::path source; // Song folder or archive
+	optional<fs::path> base; // Existing songzip to extend, if any
+	fs::path destination; // Where to write the songzip
+	vector<MD5> skip; // Charts already in the library, which aren't built again
+};
+
+// A chart built by an import job, ready to be committed to the library.
+struct ImportedChart {
+	string path; // Within the song
+	MD5 md5;
+	Metadata metadata;
+	vector<byte> preview; // Opus-encoded
+	string log; // Everything logged while building the chart
+	nanoseconds build_time;
+	nanoseconds encode_time;
+};
+
+// A chart that failed to build.
+struct FailedChart {
+	string path;
+	string message;
+};
+
+// Everything an import job produced.
+struct ImportResult {
+	vector<ImportedChart> charts;
+	vector<FailedChart> failures;
+	ssize_t charts_skipped = 0;
+	vector<io::AudioStore::Hash> store_references; // Audio store files the songzip refers to
+	ssize_t audio_reused = 0; // Audio store hits, only counted here by worker processes
+	ssize_t audio_transcoded = 0; // Audio store misses, only counted here by worker processes
+	nanoseconds transcode_time = 0ns;
+	nanoseconds preload_time = 0ns;
+};
+
+// Run an import job. Charts that fail to build are recorded in the result; any other failure throws,
+// and leaves a partial songzip at the destination for the caller to clean up.
+auto run_import_job(Logger::Category, Scheduler&, ImportJob const&, io::AudioStore&,
+	CancelToken = {}) -> task<ImportResult>;
+
+// Convert an import job to a single line of text, and back. Used to send jobs to worker processes.
+// Parsing throws runtime_error on malformed input.
+[[nodiscard]] auto format_import_job(ImportJob const&) -> string;
+[[nodiscard]] auto parse_import_job(string_view) -> ImportJob;
+
+// Convert an import result to a binary blob, and back. Used to receive results from worker processes.
+// Deserializing throws runtime_error on malformed input.
+[[nodiscard]] auto serialize_import_result(ImportResult const&) -> vector<byte>;
+[[nodiscard]] auto deserialize_import_result(span<byte const>) -> ImportResult;
+
+}
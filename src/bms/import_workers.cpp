@@ -0,0 +1,202 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/import_workers.hpp"
+
+#include <iostream>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "io/file.hpp"
+
+namespace playnote::bms {
+
+// Replies of a worker, each followed by a tab and the payload
+static constexpr auto ReplyOk = "ok\t"sv; // Peak RSS of the worker, in bytes
+static constexpr auto ReplyError = "error\t"sv; // Error message
+
+// How often a worker busy with a job checks for cancellation
+static constexpr auto CancelPollInterval = 50ms;
+
+// A job running for longer than this is assumed to be stuck, and its worker is treated as crashed.
+// Every job gets the base time, and more for every MiB of its source.
+static constexpr auto JobTimeLimitBase = 120s;
+static constexpr auto JobTimeLimitPerMiB = 2s;
+
+// Total size of a song folder or archive, in bytes. Unreadable files are skipped.
+static auto source_size_of(fs::path const& source) -> ssize_t
+{
+	auto ec = std::error_code{};
+	if (!fs::is_directory(source, ec)) {
+		auto const size = fs::file_size(source, ec);
+		return ec? 0 : static_cast<ssize_t>(size);
+	}
+	auto total = 0z;
+	for (auto it = fs::recursive_directory_iterator{source, ec}; !ec && it != fs::recursive_directory_iterator{}; it.increment(ec)) {
+		auto file_ec = std::error_code{};
+		if (!it->is_regular_file(file_ec)) continue;
+		auto const size = it->file_size(file_ec);
+		if (!file_ec) total += static_cast<ssize_t>(size);
+	}
+	return total;
+}
+
+// Where a worker writes the result of a job
+static auto result_path_of(ImportJob const& job) -> fs::path
+{
+	auto path = job.destination;
+	path.concat(".result");
+	return path;
+}
+
+ImportWorkerPool::ImportWorkerPool(Logger::Category cat, fs::path executable, fs::path const& store_path,
+	ssize_t count, CancelToken cancel_token):
+	cat{cat},
+	executable{move(executable)},
+	cancel_token{move(cancel_token)}
+{
+	// The machine's threads are shared between the workers
+	auto const threads_per_worker = max(1z, static_cast<ssize_t>(jthread::hardware_concurrency()) / count);
+	args = {"--store", store_path.string(), "--threads", format("{}", threads_per_worker)};
+	threads.reserve(count);
+	for (auto idx: views::iota(0z, count))
+		threads.emplace_back([this, idx](std::stop_token stop) { serve(stop, idx); });
+	INFO_AS(cat, "Importing with {} worker processes", count);
+}
+
+auto ImportWorkerPool::run(Scheduler& scheduler, ImportJob job, bool fresh_worker) -> task<ImportResult>
+{
+	auto request = Request{.job = &job, .fresh_worker = fresh_worker};
+	{
+		auto lock = lock_guard{queue_lock};
+		queue.emplace_back(&request);
+	}
+	queue_signal.notify_one();
+	co_await request.done;
+	// Resumed on a pool thread; move back onto the scheduler
+	co_await scheduler.schedule(Priority::Import);
+
+	auto const results_path = result_path_of(job);
+	auto deleter = io::FileDeleter{results_path};
+	if (request.cancelled) throw cancelled_error{"Operation cancelled"};
+	if (request.crashed) throw worker_crashed_error{"Import worker crashed"};
+	if (request.error) throw runtime_error{*request.error};
+	auto const results = io::read_file(results_path);
+	co_return deserialize_import_result(results.contents);
+}
+
+void ImportWorkerPool::serve(std::stop_token stop, ssize_t index)
+{
+	lib::os::name_current_thread(format("import_worker{}", index));
+	auto worker = optional<lib::os::ChildProcess>{nullopt};
+	while (true) {
+		auto* request = static_cast<Request*>(nullptr);
+		{
+			auto lock = std::unique_lock{queue_lock};
+			if (!queue_signal.wait(lock, stop, [&] { return !queue.empty(); })) return;
+			request = queue.front();
+			queue.pop_front();
+		}
+		if (cancel_token.is_cancelled())
+			request->cancelled = true;
+		else
+			dispatch(*request, worker, index);
+		request->done.set();
+	}
+}
+
+void ImportWorkerPool::dispatch(Request& request, optional<lib::os::ChildProcess>& worker, ssize_t index)
+try {
+	if (worker && request.fresh_worker) {
+		worker.reset();
+		INFO_AS(cat, "Restarting import worker {} for a retried job", index);
+	}
+	if (!worker) {
+		auto worker_args = vector<string>{format("{}", index)};
+		worker_args.insert(worker_args.end(), args.begin(), args.end());
+		worker.emplace(lib::os::spawn_process(executable, worker_args));
+		INFO_AS(cat, "Started import worker {}", index);
+	}
+
+	auto const time_limit = JobTimeLimitBase + JobTimeLimitPerMiB * (source_size_of(request.job->source) / (1z << 20));
+	auto const deadline = steady_clock::now() + time_limit;
+	auto const job_line = format_import_job(*request.job) + '\n';
+	if (lib::os::write_to_process(*worker, job_line)) {
+		while (true) {
+			if (!lib::os::wait_for_process_output(*worker, CancelPollInterval)) {
+				if (steady_clock::now() >= deadline) {
+					// A hung worker is as much the song's fault as a crashed one
+					ERROR_AS(cat, "Import worker {} took longer than {}s importing \"{}\"; stopping it",
+						index, time_limit / 1s, request.job->source);
+					lib::os::kill_process(*worker);
+					worker.reset();
+					crashes.fetch_add(1);
+					request.crashed = true;
+					return;
+				}
+				if (!cancel_token.is_cancelled()) continue;
+				// The job is abandoned mid-way; the next one gets a fresh worker
+				INFO_AS(cat, "Stopping import worker {} for cancellation", index);
+				lib::os::kill_process(*worker);
+				worker.reset();
+				request.cancelled = true;
+				return;
+			}
+			auto line = lib::os::read_line_from_process(*worker);
+			if (!line) break;
+			if (line->starts_with(ReplyOk)) {
+				auto const rss = lexical_cast<ssize_t>(string_view{*line}.substr(ReplyOk.size()));
+				auto previous = peak_rss.load();
+				while (rss > previous && !peak_rss.compare_exchange_weak(previous, rss)) {}
+				return;
+			}
+			if (line->starts_with(ReplyError)) {
+				request.error = line->substr(ReplyError.size());
+				return;
+			}
+			WARN_AS(cat, "Import worker {} wrote unexpected output: \"{}\"", index, *line);
+		}
+	}
+
+	// The worker is gone; reap it, and start a new one for the next job
+	ERROR_AS(cat, "Import worker {} exited while importing \"{}\"", index, request.job->source);
+	worker.reset();
+	crashes.fetch_add(1);
+	request.crashed = true;
+}
+catch (exception const& e) {
+	request.error = e.what();
+}
+
+void serve_import_jobs(Logger::Category cat, Scheduler& scheduler, io::AudioStore& audio_store)
+{
+	auto line = string{};
+	while (std::getline(std::cin, line)) {
+		if (line.ends_with('\r')) line.pop_back();
+		if (line.empty()) continue;
+		try {
+			auto const job = parse_import_job(line);
+			audio_store.reset_stats();
+			auto result = sync_wait(run_import_job(cat, scheduler, job, audio_store));
+			result.audio_reused = audio_store.get_hits();
+			result.audio_transcoded = audio_store.get_misses();
+			io::write_file(result_path_of(job), serialize_import_result(result));
+			print("{}{}\n", ReplyOk, lib::os::get_process_usage().peak_rss);
+		} catch (exception const& e) {
+			// Replies are single lines
+			auto message = string{e.what()};
+			replace_all(message, "\r", " ");
+			replace_all(message, "\n", " ");
+			ERROR_AS(cat, "Import job failed: {}", message);
+			print("{}{}\n", ReplyError, message);
+		}
+		std::fflush(stdout);
+	}
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include <condition_variable>
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/cancel.hpp"
+#include "lib/os.hpp"
+#include "io/audio_store.hpp"
+#include "bms/import_job.hpp"
+
+namespace playnote::bms {
+
+// Thrown when an import worker process exits in the middle of a job, most likely by crashing,
+// or is stopped for exceeding the job's time limit. The job's song is the likely culprit.
+class worker_crashed_error: public runtime_error {
+public:
+	using runtime_error::runtime_error;
+};
+
+// A pool of import worker processes, which run import jobs one at a time each. A worker that crashes
+// is replaced by a new one before its next job. Jobs and replies travel over the workers' standard
+// input and output as lines of text; results are written by the worker to a file next to the
+// job's destination.
+class ImportWorkerPool {
+public:
+	// Prepare count workers running the provided executable, which is expected to call
+	// serve_import_jobs(). Workers are started on first use. Once the token is cancelled, queued jobs
+	// fail with cancelled_error, and so do running ones after their worker is killed.
+	ImportWorkerPool(Logger::Category, fs::path executable, fs::path const& store_path, ssize_t count,
+		CancelToken = {});
+
+	// Run an import job on the next available worker. Throws worker_crashed_error if the worker
+	// exits before replying or doesn't reply within a time limit scaled by the size of the job's
+	// source, and runtime_error if the job failed inside the worker. If fresh_worker is set,
+	// the job runs in a newly started worker rather than one that already ran other jobs.
+	auto run(Scheduler&, ImportJob, bool fresh_worker = false) -> task<ImportResult>;
+
+	// Return the largest peak resident set size any worker reported, in bytes.
+	[[nodiscard]] auto get_peak_rss() const -> ssize_t { return peak_rss.load(); }
+
+	// Return the number of workers that had to be replaced after crashing or hanging.
+	[[nodiscard]] auto get_crashes() const -> ssize_t { return crashes.load(); }
+
+	ImportWorkerPool(ImportWorkerPool const&) = delete;
+	auto operator=(ImportWorkerPool const&) -> ImportWorkerPool& = delete;
+	ImportWorkerPool(ImportWorkerPool&&) = delete;
+	auto operator=(ImportWorkerPool&&) -> ImportWorkerPool& = delete;
+
+private:
+	// A job waiting for a worker. Owned by the awaiting coroutine.
+	struct Request {
+		ImportJob const* job;
+		bool fresh_worker;
+		coro::event done{false};
+		optional<string> error;
+		bool crashed = false;
+		bool cancelled = false;
+	};
+
+	Logger::Category cat;
+	fs::path executable;
+	vector<string> args; // Without the worker index
+	CancelToken cancel_token;
+	mutex queue_lock;
+	std::condition_variable_any queue_signal;
+	deque<Request*> queue;
+	atomic<ssize_t> peak_rss = 0;
+	atomic<ssize_t> crashes = 0;
+	vector<jthread> threads;
+
+	void serve(std::stop_token, ssize_t index);
+	void dispatch(Request&, optional<lib::os::ChildProcess>& worker, ssize_t index);
+};
+
+// Run import jobs received on standard input until it's closed, replying on standard output.
+// This is the main loop of an import worker process. Nothing else may write to standard output.
+void serve_import_jobs(Logger::Category, Scheduler&, io::AudioStore&);
+
+}
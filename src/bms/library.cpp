@@ -9,43 +9,90 @@ or distributed except according to those terms.
 
 #include "bms/library.hpp"
 
+#include <cstring>
 #include "preamble.hpp"
 #include "utils/task_pool.hpp"
 #include "utils/config.hpp"
+#include "utils/tracing.hpp"
 #include "lib/openssl.hpp"
 #include "lib/ffmpeg.hpp"
-#include "lib/bits.hpp"
 #include "lib/zstd.hpp"
 #include "io/source.hpp"
 #include "io/file.hpp"
-#include "audio/mixer.hpp"
 #include "bms/builder.hpp"
+#include "bms/density.hpp"
 
 namespace playnote::bms {
 
-Library::Library(Logger::Category cat, unique_ptr<thread_pool>& pool, fs::path const& path):
+// Total size of a song folder or archive, and the latest modification time of anything inside.
+// Together they tell if a song changed since it was last seen.
+struct LocationStamp {
+	ssize_t size;
+	int64_t mtime; // In file clock ticks
+};
+static auto location_stamp(fs::path const& path) -> LocationStamp
+{
+	auto stamp = LocationStamp{
+		.size = 0,
+		.mtime = fs::last_write_time(path).time_since_epoch().count(),
+	};
+	if (!fs::is_directory(path)) {
+		stamp.size = static_cast<ssize_t>(fs::file_size(path));
+		return stamp;
+	}
+	for (auto const& entry: fs::recursive_directory_iterator{path}) {
+		stamp.mtime = max<int64_t>(stamp.mtime, entry.last_write_time().time_since_epoch().count());
+		if (entry.is_regular_file()) stamp.size += static_cast<ssize_t>(entry.file_size());
+	}
+	return stamp;
+}
+
+Library::Library(Logger::Category cat, Scheduler& scheduler, fs::path const& db_path, fs::path songs_path):
 	cat{cat},
-	pool{pool},
-	db{lib::sqlite::open(path)},
-	import_tasks{pool}
+	scheduler{scheduler},
+	db{lib::sqlite::open(db_path)},
+	songs_path{move(songs_path)},
+	audio_store{this->songs_path / "audio"},
+	import_tasks{scheduler, Priority::Import},
+	maintenance_tasks{scheduler, Priority::Maintenance}
 {
 	lib::sqlite::execute(db, SongsSchema);
+	lib::sqlite::execute(db, SongAudioSchema);
+	lib::sqlite::execute(db, ImportQuarantineSchema);
 	lib::sqlite::execute(db, ChartsSchema);
 	lib::sqlite::execute(db, ChartDensitiesSchema);
+	lib::sqlite::execute(db, ChartDensityThumbnailsSchema);
+	lib::sqlite::execute(db, ChartEmbeddingsSchema);
 	lib::sqlite::execute(db, ChartImportLogsSchema);
 	lib::sqlite::execute(db, ChartPreviewsSchema);
-	fs::create_directory(LibraryPath);
-	INFO_AS(cat, "Opened song library at \"{}\"", path);
+	fs::create_directories(this->songs_path);
+	load_similarity_index();
+	maintenance_tasks.start(backfill_embeddings());
+	maintenance_tasks.start(collect_audio_garbage());
+	INFO_AS(cat, "Opened song library at \"{}\"", db_path);
 }
 
 Library::~Library() noexcept
-{ stopping.store(true); }
+{
+	// Running imports use most of the other members, so they have to finish before any of them
+	// are destroyed
+	cancel_token.cancel();
+	import_tasks.wait();
+	maintenance_tasks.wait();
+}
+
+void Library::use_import_workers(fs::path executable, ssize_t count)
+{
+	ASSERT(count >= 1);
+	import_workers = make_unique<ImportWorkerPool>(cat, move(executable), audio_store.get_path(), count, cancel_token);
+}
 
 void Library::import(fs::path const& path)
 { import_tasks.start(import_many(path)); }
 
 auto Library::list_charts() -> task<vector<ChartEntry>>
 {
+	TRACE_ZONE("List charts");
 	auto chart_listing = lib::sqlite::prepare<ChartListing>(db);
 	auto result = vector<ChartEntry>{};
 	for (auto [md5, title, playstyle, difficulty]: lib::sqlite::query(chart_listing)) {
@@ -65,13 +112,18 @@ void Library::reset_import_stats()
 	import_stats.songs_processed.store(0);
 	import_stats.songs_total.store(0);
 	import_stats.songs_failed.store(0);
+	import_stats.songs_quarantined.store(0);
 	import_stats.charts_added.store(0);
 	import_stats.charts_skipped.store(0);
 	import_stats.charts_failed.store(0);
+	import_stats.bytes_processed.store(0);
+	for (auto& time: import_stats.stage_times) time.store(0);
+	audio_store.reset_stats();
 }
 
-auto Library::load_chart(unique_ptr<thread_pool>& pool, MD5 md5) -> task<shared_ptr<Chart const>>
+auto Library::load_chart(Scheduler& scheduler, MD5 md5, int sampling_rate) -> task<shared_ptr<Chart const>>
 {
+	TRACE_ASYNC_SPAN("Load chart");
 	auto cache = optional<Metadata>{nullopt};
 	auto song_path = fs::path{};
 	auto chart_path = string{};
@@ -83,13 +135,7 @@ auto Library::load_chart(unique_ptr<thread_pool>& pool, MD5 md5) -> task<shared_
 			density_resolution, density_key, density_scratch, density_ln
 		]: lib::sqlite::query(select_song_chart, md5)
 	) {
-		auto deserialize_density = [](span<byte const> v) {
-			auto in = lib::bits::in(v);
-			auto vec = vector<float>{};
-			in(vec).or_throw();
-			return vec;
-		};
-		song_path = fs::path{LibraryPath} / song_path_sv;
+		song_path = songs_path / song_path_sv;
 		chart_path = chart_path_sv;
 		cache = Metadata{
 			.title = string{title},
@@ -111,9 +157,9 @@ auto Library::load_chart(unique_ptr<thread_pool>& pool, MD5 md5) -> task<shared_
 			.loudness = loudness,
 			.density = Metadata::Density{
 				.resolution = nanoseconds{density_resolution},
-				.key = deserialize_density(density_key),
-				.scratch = deserialize_density(density_scratch),
-				.ln = deserialize_density(density_ln),
+				.key = decode_density(density_key),
+				.scratch = decode_density(density_scratch),
+				.ln = decode_density(density_ln),
 			},
 			.nps = Metadata::NPS{
 				.average = static_cast<float>(average_nps),
@@ -129,10 +175,132 @@ auto Library::load_chart(unique_ptr<thread_pool>& pool, MD5 md5) -> task<shared_
 	}
 	if (!cache) throw runtime_error{"Chart not found"};
 
-	auto song = io::Song(cat, io::read_file(song_path));
+	auto song = io::Song(cat, io::read_file(song_path), &audio_store);
 	auto chart_raw = song.load_file(chart_path);
-	auto builder = Builder{cat};
-	co_return co_await builder.build(pool, chart_raw, song, globals::mixer->get_audio().get_sampling_rate(), *cache);
+	auto builder = Builder{cat, true, true}; // Loaded for playback, so BGA is needed
+	co_return co_await builder.build(scheduler, chart_raw, song, sampling_rate, *cache);
+}
+
+auto Library::load_density_thumbnails(span<MD5 const> md5s) -> task<vector<DensityThumbnail>>
+{
+	TRACE_ZONE("Load density thumbnails");
+	auto md5_list = string{"["};
+	for (auto const& md5: md5s) {
+		if (md5_list.size() > 1) md5_list.push_back(',');
+		format_to(back_inserter(md5_list), "\"{}\"", lib::openssl::md5_to_hex(md5));
+	}
+	md5_list.push_back(']');
+
+	auto select_density_thumbnails = lib::sqlite::prepare<SelectDensityThumbnails>(db);
+	auto result = vector<DensityThumbnail>{};
+	result.reserve(md5s.size());
+	for (auto [md5, resolution, key, scratch, ln]: lib::sqlite::query(select_density_thumbnails, md5_list)) {
+		auto thumbnail = DensityThumbnail{};
+		copy(md5, thumbnail.md5.begin());
+		thumbnail.density = downsample_density(Metadata::Density{
+			.resolution = nanoseconds{resolution},
+			.key = decode_density(key),
+			.scratch = decode_density(scratch),
+			.ln = decode_density(ln),
+		}, DensityThumbnailPoints);
+		result.emplace_back(move(thumbnail));
+	}
+	co_return result;
+}
+
+auto Library::find_similar_charts(MD5 md5, ssize_t count) -> task<vector<SimilarChart>>
+{
+	TRACE_ZONE("Find similar charts");
+	auto const embedding = similarity_index.get(md5);
+	if (!embedding) co_return {};
+	auto result = vector<SimilarChart>{};
+	for (auto const& match: similarity_index.find(*embedding, count, md5))
+		result.emplace_back(SimilarChart{.md5 = match.md5, .distance = match.distance});
+	co_return result;
+}
+
+void Library::load_similarity_index()
+{
+	TRACE_ZONE("Load similarity index");
+	auto select_chart_embeddings = lib::sqlite::prepare<SelectChartEmbeddings>(db);
+	for (auto [md5_bytes, embedding_bytes]: lib::sqlite::query(select_chart_embeddings, ChartEmbeddingVersion)) {
+		auto md5 = MD5{};
+		auto embedding = ChartEmbedding{};
+		if (embedding_bytes.size() != sizeof(ChartEmbedding)) continue;
+		copy(md5_bytes, md5.begin());
+		std::memcpy(embedding.data(), embedding_bytes.data(), sizeof(ChartEmbedding));
+		similarity_index.add(md5, embedding);
+	}
+}
+
+auto Library::backfill_embeddings() -> task<>
+{
+	// Small enough that imports waiting on the database aren't held up for long
+	static constexpr auto BatchSize = 256z;
+	TRACE_ASYNC_SPAN("Backfill similarity embeddings");
+	auto select_charts_missing_embeddings = lib::sqlite::prepare<SelectChartsMissingEmbeddings>(db);
+	auto insert_chart_embedding = lib::sqlite::prepare<InsertChartEmbedding>(db);
+	auto calculated = 0z;
+	try {
+		while (true) {
+			cancel_token.check();
+			auto batch = 0z;
+			lib::sqlite::transaction(db, [&] {
+				for (auto [
+						md5_bytes, note_count, chart_duration, average_nps, peak_nps, min_bpm, max_bpm, main_bpm,
+						density_resolution, density_key, density_scratch, density_ln
+					]: lib::sqlite::query(select_charts_missing_embeddings, ChartEmbeddingVersion, BatchSize)
+				) {
+					auto metadata = Metadata{};
+					metadata.note_count = note_count;
+					metadata.chart_duration = nanoseconds{chart_duration};
+					metadata.density = Metadata::Density{
+						.resolution = nanoseconds{density_resolution},
+						.key = decode_density(density_key),
+						.scratch = decode_density(density_scratch),
+						.ln = decode_density(density_ln),
+					};
+					metadata.nps = Metadata::NPS{
+						.average = static_cast<float>(average_nps),
+						.peak = static_cast<float>(peak_nps),
+					};
+					metadata.bpm_range = Metadata::BPMRange{
+						.min = static_cast<float>(min_bpm),
+						.max = static_cast<float>(max_bpm),
+						.main = static_cast<float>(main_bpm),
+					};
+					auto const embedding = make_embedding(metadata);
+					lib::sqlite::execute(insert_chart_embedding, md5_bytes, ChartEmbeddingVersion, std::as_bytes(span{embedding}));
+					auto md5 = MD5{};
+					copy(md5_bytes, md5.begin());
+					similarity_index.add(md5, embedding);
+					batch += 1;
+				}
+			});
+			calculated += batch;
+			if (batch < BatchSize) break;
+			co_await scheduler.yield();
+		}
+	} catch (cancelled_error const&) {
+	} catch (exception const& e) {
+		WARN_AS(cat, "Failed to calculate similarity embeddings: {}", e.what());
+	}
+	if (calculated > 0) INFO_AS(cat, "Calculated similarity embeddings of {} charts", calculated);
+}
+
+auto Library::collect_audio_garbage() -> task<>
+{
+	auto referenced = unordered_set<io::AudioStore::Hash>{};
+	auto select_song_audio = lib::sqlite::prepare<SelectSongAudio>(db);
+	for (auto [hash_bytes]: lib::sqlite::query(select_song_audio)) {
+		auto hash = io::AudioStore::Hash{};
+		if (hash_bytes.size() != hash.size()) continue;
+		copy(hash_bytes, hash.begin());
+		referenced.emplace(hash);
+	}
+	auto const deleted = audio_store.collect_garbage(referenced);
+	if (deleted > 0) INFO_AS(cat, "Deleted {} unused files from the audio store", deleted);
+	co_return;
 }
 
 auto Library::find_available_song_filename(string_view name) -> string
@@ -149,17 +317,27 @@ auto Library::find_available_song_filename(string_view name) -> string
 	unreachable();
 }
 
+void Library::add_stage_time(ImportStage stage, nanoseconds time)
+{ import_stats.stage_times[+stage].fetch_add(time.count()); }
+
+auto Library::finish_stage(ImportStage stage, steady_clock::time_point start) -> steady_clock::time_point
+{
+	auto const now = steady_clock::now();
+	add_stage_time(stage, duration_cast<nanoseconds>(now - start));
+	return now;
+}
+
 auto Library::import_many(fs::path path) -> task<>
 {
 	if (fs::is_regular_file(path)) {
 		import_stats.songs_total.fetch_add(1);
-		co_await schedule_task_on(pool, import_one(path));
+		co_await schedule_task_on(scheduler, import_one(path));
 	} else if (fs::is_directory(path)) {
 		auto contents = vector<fs::directory_entry>{};
 		copy(fs::directory_iterator{path}, back_inserter(contents));
 		if (any_of(contents, [&](auto const& entry) { return fs::is_regular_file(entry) && io::has_extension(entry, io::BMSExtensions); })) {
 			import_stats.songs_total.fetch_add(1);
-			co_await schedule_task_on(pool, import_one(path));
+			co_await schedule_task_on(scheduler, import_one(path));
 		} else {
 			for (auto const& entry: contents) import_tasks.start(import_many(entry));
 		}
@@ -172,13 +350,32 @@ auto Library::import_many(fs::path path) -> task<>
 
 auto Library::import_one(fs::path path) -> task<>
 {
-	auto charts = vector<MD5>{}; // Need access to this in the catch clause
+	TRACE_ASYNC_SPAN("Import song");
+	// Need access to these in the catch clauses
+	auto charts = vector<MD5>{};
+	auto song_id = -1z;
+	auto song_filename = string{};
+	auto duplicate = false;
+	auto source_bytes = 0z;
+	auto stamp = LocationStamp{};
 	try {
-		if (stopping.load()) throw runtime_error_fmt("Song import \"{}\" cancelled", path);
+		cancel_token.check();
+		auto stage_start = steady_clock::now();
+		stamp = location_stamp(path);
+		auto quarantined = false;
+		auto quarantine_exists = lib::sqlite::prepare<QuarantineExists>(db);
+		for (auto _: lib::sqlite::query(quarantine_exists, path.string(), static_cast<int64_t>(stamp.size), stamp.mtime)) quarantined = true;
+		if (quarantined) {
+			WARN_AS(cat, "Song \"{}\" skipped: quarantined after crashing import workers; it will be retried once it changes", path);
+			import_stats.songs_processed.fetch_add(1);
+			import_stats.songs_failed.fetch_add(1);
+			co_return;
+		}
 		INFO_AS(cat, "Importing song \"{}\"", path);
+		source_bytes = stamp.size;
 
 		// Collect MD5s of charts to add
-		auto source = io::Source{path};
+		auto source = io::Source{path, cancel_token};
 		for (auto&& ref: source.for_each_file()) {
 			if (!io::has_extension(ref.get_path(), io::BMSExtensions)) continue;
 			charts.emplace_back(lib::openssl::md5(ref.read()));
@@ -186,9 +383,6 @@ auto Library::import_one(fs::path path) -> task<>
 
 		// Check if any running task is a duplicate of this one
 		auto lock = co_await staging_lock.scoped_lock();
-		auto song_id = -1z;
-		auto song_filename = string{};
-		auto duplicate = false;
 		for (auto const& chart: charts) {
 			auto it = staging.find(chart);
 			if (it != staging.end()) {
@@ -228,145 +422,201 @@ auto Library::import_one(fs::path path) -> task<>
 		for (auto const& chart: charts) staging.emplace(chart, song_id);
 		lock.unlock();
 
-		// Create/modify the songzip
-		auto song = optional<io::Song>{nullopt};
+		// Charts already in the library aren't built again
+		auto job = ImportJob{.source = path};
+		auto chart_exists = lib::sqlite::prepare<ChartExists>(db);
+		for (auto const& chart: charts) {
+			for (auto _: lib::sqlite::query(chart_exists, chart)) job.skip.emplace_back(chart);
+		}
 		if (duplicate) {
 			// Extending
 			INFO_AS(cat, "Song \"{}\" already exists in library; extending", path);
-			auto existing_song_path = fs::path{};
 			auto select_song_by_id = lib::sqlite::prepare<SelectSongByID>(db);
 			for (auto [pathname]: lib::sqlite::query(select_song_by_id, song_id))
-				existing_song_path = fs::path{LibraryPath} / pathname;
-
-			auto tmp_path = existing_song_path;
-			tmp_path.concat(".tmp");
-			auto deleter = io::FileDeleter{tmp_path};
-			song = co_await io::Song::from_source_append(cat, pool, io::read_file(existing_song_path), source, tmp_path);
-
-			fs::rename(tmp_path, existing_song_path);
-			deleter.disarm();
+				job.base = songs_path / pathname;
+			if (!job.base) throw runtime_error_fmt("Failed to import \"{}\": song {} vanished", path, song_id);
+			job.destination = *job.base;
+			job.destination.concat(".tmp");
 		} else {
 			// New song
-			auto const out_path = fs::path{LibraryPath} / song_filename;
-			auto deleter = io::FileDeleter{out_path};
-			song = co_await io::Song::from_source(cat, pool, source, out_path);
-			deleter.disarm();
+			job.destination = songs_path / song_filename;
 		}
-
-		// Prepare song for chart imports
-		co_await song->preload_audio_files(pool, 48000);
-		INFO_AS(cat, "Song \"{}\" files processed successfully", path);
-
-		// Start chart imports
-		auto chart_import_tasks = vector<task<MD5>>{};
-		auto chart_paths = vector<string>{};
-		for (auto [path, chart]: song->for_each_chart()) {
-			chart_import_tasks.emplace_back(schedule_task_on(pool, import_chart(*song, song_id, string{path}, chart)));
-			chart_paths.emplace_back(path);
+		finish_stage(ImportStage::Scan, stage_start);
+
+		// Create/modify the songzip and build the charts
+		auto deleter = io::FileDeleter{job.destination};
+		auto result = ImportResult{};
+		if (import_workers) {
+			// A single crash could be the OOM killer or bad luck rather than the song, so it gets
+			// a second chance in a fresh worker before it's quarantined
+			auto crashed = false;
+			try {
+				result = co_await import_workers->run(scheduler, job);
+			} catch (worker_crashed_error const& e) {
+				WARN_AS(cat, "Import of song \"{}\" failed: {}; retrying in a new worker", path, e.what());
+				crashed = true;
+			}
+			if (crashed) {
+				fs::remove(job.destination);
+				result = co_await import_workers->run(scheduler, job, true);
+			}
+		} else {
+			result = co_await run_import_job(cat, scheduler, job, audio_store, cancel_token);
+		}
+		cancel_token.check();
+		if (job.base) fs::rename(job.destination, *job.base);
+		deleter.disarm();
+		add_stage_time(ImportStage::Transcode, result.transcode_time);
+		add_stage_time(ImportStage::Preload, result.preload_time);
+		audio_store.add_stats(result.audio_reused, result.audio_transcoded);
+		import_stats.charts_skipped.fetch_add(result.charts_skipped);
+
+		// Keep the audio store files the song refers to from being collected
+		auto insert_song_audio = lib::sqlite::prepare<InsertSongAudio>(db);
+		lib::sqlite::transaction(db, [&] {
+			for (auto const& hash: result.store_references)
+				lib::sqlite::execute(insert_song_audio, song_id, hash);
+		});
+
+		// Store the charts
+		for (auto const& failure: result.failures) {
+			ERROR_AS(cat, "Failed to import chart \"{}\": {}", failure.path, failure.message);
+			import_stats.charts_failed.fetch_add(1);
 		}
-		auto results = co_await when_all(move(chart_import_tasks));
-
-		// Report chart import results
 		auto imported = vector<MD5>{};
-		for (auto [result, path]: views::zip(results, chart_paths)) {
+		for (auto const& chart: result.charts) {
+			add_stage_time(ImportStage::Build, chart.build_time);
+			add_stage_time(ImportStage::Encode, chart.encode_time);
 			try {
-				auto md5 = result.return_value();
-				if (md5 == MD5{}) continue; // Skipped
-				INFO_AS(cat, "Chart \"{}\" imported successfully", path);
-				imported.emplace_back(md5);
+				if (!commit_chart(song_id, chart)) continue; // Skipped
+				INFO_AS(cat, "Chart \"{}\" imported successfully", chart.path);
+				imported.emplace_back(chart.md5);
 			} catch (exception const& e) {
-				ERROR_AS(cat, "Failed to import chart \"{}\": {}", path, e.what());
+				ERROR_AS(cat, "Failed to import chart \"{}\": {}", chart.path, e.what());
 				import_stats.charts_failed.fetch_add(1);
 			}
 		}
+		stage_start = steady_clock::now(); // Commits timed their own stage
 
 		// Clean up
 		if (imported.empty()) {
 			WARN_AS(cat, "No new charts found in song \"{}\"", path);
-			if (!duplicate) {
-				auto delete_song = lib::sqlite::prepare<DeleteSong>(db);
-				lib::sqlite::execute(delete_song, song_id);
-				move(*song).remove();
-			}
+			if (!duplicate) remove_song_if_empty(song_id, song_filename);
 		} else {
 			auto deduplicated = co_await deduplicate_previews(song_id, imported);
 			if (deduplicated)
 				INFO_AS(cat, "Removed {} duplicate previews from song \"{}\"", deduplicated, path);
+			finish_stage(ImportStage::Previews, stage_start);
 			INFO_AS(cat, "Song \"{}\" imported successfully", path);
 		}
+		if (import_workers) {
+			// Any quarantine of an earlier version of the song no longer applies
+			auto delete_quarantine = lib::sqlite::prepare<DeleteQuarantine>(db);
+			lib::sqlite::execute(delete_quarantine, path.string());
+		}
+		import_stats.songs_processed.fetch_add(1);
+		import_stats.bytes_processed.fetch_add(source_bytes);
+	}
+	catch (cancelled_error const&) {
+		INFO_AS(cat, "Song import \"{}\" cancelled", path);
+		// A new song that didn't get to keep any charts would be left as an orphaned row
+		if (song_id != -1z && !duplicate) remove_song_if_empty(song_id, song_filename);
+		import_stats.songs_processed.fetch_add(1);
+		import_stats.bytes_processed.fetch_add(source_bytes);
+	}
+	catch (worker_crashed_error const& e) {
+		ERROR_AS(cat, "Failed to import song \"{}\": {}; quarantining the song", path, e.what());
+		auto insert_quarantine = lib::sqlite::prepare<InsertQuarantine>(db);
+		lib::sqlite::execute(insert_quarantine, path.string(), static_cast<int64_t>(stamp.size), stamp.mtime, e.what());
+		if (song_id != -1z && !duplicate) remove_song_if_empty(song_id, song_filename);
 		import_stats.songs_processed.fetch_add(1);
+		import_stats.songs_failed.fetch_add(1);
+		import_stats.songs_quarantined.fetch_add(1);
+		import_stats.bytes_processed.fetch_add(source_bytes);
 	}
 	catch (exception const& e) {
 		ERROR_AS(cat, "Failed to import song \"{}\": {}", path, e.what());
 		import_stats.songs_processed.fetch_add(1);
 		import_stats.songs_failed.fetch_add(1);
+		import_stats.bytes_processed.fetch_add(source_bytes);
 	}
 }
 
-auto Library::import_chart(io::Song& song, ssize_t song_id, string chart_path, span<byte const> chart_raw) -> task<MD5>
+auto Library::commit_chart(ssize_t song_id, ImportedChart const& chart) -> bool
 {
-	if (stopping.load()) throw runtime_error_fmt("Chart import \"{}\" cancelled", chart_path);
-
+	TRACE_ZONE("Commit chart");
+	auto const stage_start = steady_clock::now();
 	auto chart_exists = lib::sqlite::prepare<ChartExists>(db);
-	auto const md5 = lib::openssl::md5(chart_raw);
 	auto exists = false;
-	for (auto _: lib::sqlite::query(chart_exists, md5)) exists = true;
+	for (auto _: lib::sqlite::query(chart_exists, chart.md5)) exists = true;
 	if (exists) {
-		INFO_AS(cat, "Chart import \"{}\" skipped (duplicate)", chart_path);
+		INFO_AS(cat, "Chart import \"{}\" skipped (duplicate)", chart.path);
 		import_stats.charts_skipped.fetch_add(1);
-		co_return {};
+		return false;
 	}
 
 	auto insert_chart = lib::sqlite::prepare<InsertChart>(db);
 	auto insert_chart_density = lib::sqlite::prepare<InsertChartDensity>(db);
+	auto insert_chart_density_thumbnail = lib::sqlite::prepare<InsertChartDensityThumbnail>(db);
+	auto insert_chart_embedding = lib::sqlite::prepare<InsertChartEmbedding>(db);
 	auto insert_chart_import_log = lib::sqlite::prepare<InsertChartImportLog>(db);
 	auto insert_chart_preview = lib::sqlite::prepare<InsertChartPreview>(db);
-	auto builder_cat = globals::logger->create_string_logger(lib::openssl::md5_to_hex(md5));
-	INFO_AS(builder_cat, "Importing chart \"{}\"", chart_path);
-	auto builder = Builder{builder_cat};
-	auto chart = co_await builder.build(pool, chart_raw, song, 48000);
-	auto encoded_preview = lib::ffmpeg::encode_as_opus(chart->media.preview, 48000);
-
+	auto const& metadata = chart.metadata;
+	auto const embedding = make_embedding(metadata);
 	lib::sqlite::transaction(db, [&] {
-		auto preview_id = lib::sqlite::insert(insert_chart_preview, encoded_preview);
-		lib::sqlite::execute(insert_chart, chart->md5, song_id, chart_path, chart->metadata.title,
-			chart->metadata.subtitle, chart->metadata.artist, chart->metadata.subartist,
-			chart->metadata.genre, chart->metadata.url, chart->metadata.email,
-			+chart->metadata.difficulty, +chart->metadata.playstyle, chart->metadata.features.has_ln,
-			chart->metadata.features.has_soflan, chart->metadata.note_count,
-			chart->metadata.chart_duration.count(), chart->metadata.audio_duration.count(),
-			chart->metadata.loudness, chart->metadata.nps.average, chart->metadata.nps.peak,
-			chart->metadata.bpm_range.min, chart->metadata.bpm_range.max,
-			chart->metadata.bpm_range.main, preview_id);
-
-		auto serialize_density = [](vector<float> const& v) {
-			auto [data, out] = lib::bits::data_out();
-			out(v).or_throw();
-			return data;
-		};
-		lib::sqlite::execute(insert_chart_density, chart->md5,
-			chart->metadata.density.resolution.count(),
-			serialize_density(chart->metadata.density.key),
-			serialize_density(chart->metadata.density.scratch),
-			serialize_density(chart->metadata.density.ln));
-		auto buffer = builder_cat.get_buffer();
-		auto buffer_bytes = span{reinterpret_cast<byte const*>(buffer.data()), buffer.size() + 1};
-		lib::sqlite::execute(insert_chart_import_log, chart->md5, lib::zstd::compress(buffer_bytes));
+		auto preview_id = lib::sqlite::insert(insert_chart_preview, chart.preview);
+		lib::sqlite::execute(insert_chart, chart.md5, song_id, chart.path, metadata.title,
+			metadata.subtitle, metadata.artist, metadata.subartist,
+			metadata.genre, metadata.url, metadata.email,
+			+metadata.difficulty, +metadata.playstyle, metadata.features.has_ln,
+			metadata.features.has_soflan, metadata.note_count,
+			metadata.chart_duration.count(), metadata.audio_duration.count(),
+			metadata.loudness, metadata.nps.average, metadata.nps.peak,
+			metadata.bpm_range.min, metadata.bpm_range.max,
+			metadata.bpm_range.main, preview_id);
+
+		auto const& density = metadata.density;
+		lib::sqlite::execute(insert_chart_density, chart.md5, density.resolution.count(),
+			encode_density(density.key, DensityEncoding::Q16Delta),
+			encode_density(density.scratch, DensityEncoding::Q16Delta),
+			encode_density(density.ln, DensityEncoding::Q16Delta));
+		auto const thumbnail = downsample_density(density, DensityThumbnailPoints);
+		lib::sqlite::execute(insert_chart_density_thumbnail, chart.md5, thumbnail.resolution.count(),
+			encode_density(thumbnail.key, DensityEncoding::Q8),
+			encode_density(thumbnail.scratch, DensityEncoding::Q8),
+			encode_density(thumbnail.ln, DensityEncoding::Q8));
+		lib::sqlite::execute(insert_chart_embedding, chart.md5, ChartEmbeddingVersion, std::as_bytes(span{embedding}));
+		auto log_bytes = span{reinterpret_cast<byte const*>(chart.log.c_str()), chart.log.size() + 1};
+		lib::sqlite::execute(insert_chart_import_log, chart.md5, lib::zstd::compress(log_bytes));
 	});
+	finish_stage(ImportStage::Commit, stage_start);
+	similarity_index.add(chart.md5, embedding);
 	dirty.store(true);
 	import_stats.charts_added.fetch_add(1);
-	co_return chart->md5;
+	return true;
+}
+
+void Library::remove_song_if_empty(ssize_t song_id, string_view song_filename)
+{
+	auto has_charts = false;
+	auto song_has_charts = lib::sqlite::prepare<SongHasCharts>(db);
+	for (auto _: lib::sqlite::query(song_has_charts, song_id)) has_charts = true;
+	if (has_charts) return;
+	auto delete_song = lib::sqlite::prepare<DeleteSong>(db);
+	lib::sqlite::execute(delete_song, song_id);
+	fs::remove(songs_path / song_filename);
 }
 
 auto Library::deduplicate_previews(ssize_t song_id, span<MD5 const> new_charts) -> task<ssize_t> {
+	TRACE_ZONE("Deduplicate previews");
 	// Some or all of the charts of this song were just added, all with their own previews.
 	// Any of these previews can be a duplicate of a new preview or an old preview.
 
 	// Fetch all previews (decoded) of all charts of the song, with their IDs.
 	auto select_song_previews = lib::sqlite::prepare<SelectSongPreviews>(db);
-	auto previews = unordered_map<ssize_t, vector<dev::Sample>>{};
+	auto previews = unordered_map<ssize_t, tracked_vector<dev::Sample>>{};
 	for (auto [id, preview]: lib::sqlite::query(select_song_previews, song_id))
-		previews.emplace(id, lib::ffmpeg::decode_and_resample_file_buffer(preview, 48000));
+		previews.emplace(id, lib::ffmpeg::decode_and_resample_file_buffer(preview, 48000, MemoryTag::ImportStaging));
 
 	// Fetch all preview IDs of new charts
 	auto select_chart_preview_ids = lib::sqlite::prepare<SelectChartPreviewIDs>(db);
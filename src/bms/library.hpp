@@ -10,9 +10,15 @@ or distributed except according to those terms.
 #pragma once
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/cancel.hpp"
+#include "utils/config.hpp"
 #include "lib/sqlite.hpp"
 #include "io/song.hpp"
+#include "io/audio_store.hpp"
 #include "bms/chart.hpp"
+#include "bms/similarity.hpp"
+#include "bms/import_workers.hpp"
 
 namespace playnote::bms {
 
@@ -25,15 +31,46 @@ public:
 		string title;
 	};
 
-	// Open an existing library, or create an empty one at the provided path.
-	// The thread pool passed in will be used for import jobs.
-	Library(Logger::Category, unique_ptr<thread_pool>&, fs::path const&);
+	// A chart found by a similarity search.
+	struct SimilarChart {
+		MD5 md5;
+		float distance; // 0.0 for charts that play identically
+	};
+
+	// Low-resolution density graph of a chart, for previews in chart lists.
+	struct DensityThumbnail {
+		MD5 md5;
+		Metadata::Density density;
+	};
+
+	// Stages of a song import, for profiling. The chart stages are timed per chart, so charts
+	// imported in parallel all count towards them.
+	enum class ImportStage {
+		Scan, // Hashing charts and checking for duplicates
+		Transcode, // Building the songzip
+		Preload, // Decoding audio files
+		Build, // Building charts
+		Encode, // Encoding chart previews
+		Commit, // Storing charts in the database
+		Previews, // Deduplicating previews
+	};
+
+	// Open an existing library, or create an empty one at the provided path. Songzips are stored
+	// in the provided directory, and the audio files they share in its "audio" subdirectory.
+	// The scheduler passed in will be used for import jobs.
+	Library(Logger::Category, Scheduler&, fs::path const& db_path, fs::path songs_path = LibraryPath);
 	~Library() noexcept;
 
 	// Import a song and all its charts into the library. Returns instantly; the import happens in the background.
 	// All other methods are safe to call while an import is in progress.
 	void import(fs::path const&);
 
+	// Build songzips and charts in the provided number of worker processes running the executable,
+	// rather than in this process. A song that crashes a worker is retried once in a fresh worker;
+	// if it crashes that one too, it's quarantined, and skipped by later imports until it changes.
+	// Must be called before the first import.
+	void use_import_workers(fs::path executable, ssize_t count);
+
 	// Return true if an import is ongoing.
 	[[nodiscard]] auto is_importing() const -> bool { return !import_tasks.empty(); }
 
@@ -61,11 +98,43 @@ public:
 	// Return the number of charts that failed to import.
 	[[nodiscard]] auto get_import_charts_failed() const -> ssize_t { return import_stats.charts_failed.load(); }
 
+	// Return the size of all song sources that were imported so far, in bytes.
+	[[nodiscard]] auto get_import_bytes_processed() const -> ssize_t { return import_stats.bytes_processed.load(); }
+
+	// Return the number of audio files that didn't need transcoding, because an identical file
+	// was imported before.
+	[[nodiscard]] auto get_import_audio_reused() const -> ssize_t { return audio_store.get_hits(); }
+
+	// Return the number of audio files that were transcoded.
+	[[nodiscard]] auto get_import_audio_transcoded() const -> ssize_t { return audio_store.get_misses(); }
+
+	// Return the number of songs that crashed an import worker and were quarantined.
+	[[nodiscard]] auto get_import_songs_quarantined() const -> ssize_t { return import_stats.songs_quarantined.load(); }
+
+	// Return the largest peak resident set size of any import worker process, in bytes.
+	// Zero if import workers aren't used.
+	[[nodiscard]] auto get_import_worker_peak_rss() const -> ssize_t
+	{ return import_workers? import_workers->get_peak_rss() : 0; }
+
+	// Return the time spent in an import stage, summed over all songs and charts.
+	[[nodiscard]] auto get_import_stage_time(ImportStage stage) const -> nanoseconds
+	{ return nanoseconds{import_stats.stage_times[+stage].load()}; }
+
 	// Set all import statistics to zero. Can be used during an import, but the values might be inconsistent afterwards.
 	void reset_import_stats();
 
-	// Load a chart from the library.
-	auto load_chart(unique_ptr<thread_pool>&, MD5) -> task<shared_ptr<Chart const>>;
+	// Load a chart from the library, with audio resampled to the provided sampling rate.
+	auto load_chart(Scheduler&, MD5, int sampling_rate) -> task<shared_ptr<Chart const>>;
+
+	// Load the density thumbnails of many charts at once, with a single query. Charts that aren't
+	// in the library are left out of the result, and the order of results is unspecified. Thread-safe.
+	[[nodiscard]] auto load_density_thumbnails(span<MD5 const>) -> task<vector<DensityThumbnail>>;
+
+	// Find up to count charts that play the most like the provided one, by note density over time,
+	// NPS and BPM. The closest ones come first, and the chart itself is not included. Charts whose
+	// embeddings are still being calculated in the background after an upgrade are left out, and
+	// find nothing themselves. Thread-safe.
+	[[nodiscard]] auto find_similar_charts(MD5, ssize_t count) -> task<vector<SimilarChart>>;
 
 	Library(Library const&) = delete;
 	auto operator=(Library const&) -> Library& = delete;
@@ -104,6 +173,64 @@ private:
 		)sql"sv;
 		using Params = tuple<ssize_t>;
 	};
+	struct SongHasCharts {
+		static constexpr auto Query = R"sql(
+			SELECT 1 FROM charts WHERE song_id = ?1 LIMIT 1
+		)sql"sv;
+		using Params = tuple<ssize_t>;
+	};
+
+	// Audio store files each song refers to. Files that no song refers to are deleted
+	// in the background after the library is opened, once they're old enough.
+	static constexpr auto SongAudioSchema = R"sql(
+		CREATE TABLE IF NOT EXISTS song_audio(
+			song_id INTEGER NOT NULL REFERENCES songs ON DELETE CASCADE,
+			hash BLOB NOT NULL CHECK(length(hash) == 32),
+			UNIQUE(song_id, hash)
+		)
+	)sql"sv;
+	struct InsertSongAudio {
+		static constexpr auto Query = R"sql(
+			INSERT OR IGNORE INTO song_audio(song_id, hash) VALUES(?1, ?2)
+		)sql"sv;
+		using Params = tuple<ssize_t, span<byte const>>;
+	};
+	struct SelectSongAudio {
+		static constexpr auto Query = R"sql(
+			SELECT DISTINCT hash FROM song_audio
+		)sql"sv;
+		using Row = tuple<span<byte const>>;
+	};
+
+	// Songs that crashed an import worker twice in a row. Later imports skip them for as long as
+	// the song's total size and latest modification time stay the same; delete a row to try again.
+	static constexpr auto ImportQuarantineSchema = R"sql(
+		CREATE TABLE IF NOT EXISTS import_quarantine(
+			path TEXT PRIMARY KEY NOT NULL,
+			size INTEGER NOT NULL,
+			mtime INTEGER NOT NULL,
+			reason TEXT NOT NULL,
+			date_quarantined INTEGER DEFAULT(unixepoch())
+		)
+	)sql"sv;
+	struct QuarantineExists {
+		static constexpr auto Query = R"sql(
+			SELECT 1 FROM import_quarantine WHERE path = ?1 AND size = ?2 AND mtime = ?3
+		)sql"sv;
+		using Params = tuple<string_view, int64_t, int64_t>;
+	};
+	struct InsertQuarantine {
+		static constexpr auto Query = R"sql(
+			INSERT OR REPLACE INTO import_quarantine(path, size, mtime, reason) VALUES(?1, ?2, ?3, ?4)
+		)sql"sv;
+		using Params = tuple<string_view, int64_t, int64_t, string_view>;
+	};
+	struct DeleteQuarantine {
+		static constexpr auto Query = R"sql(
+			DELETE FROM import_quarantine WHERE path = ?1
+		)sql"sv;
+		using Params = tuple<string_view>;
+	};
 
 	static constexpr auto ChartsSchema = to_array({R"sql(
 		CREATE TABLE IF NOT EXISTS charts(
@@ -200,6 +327,79 @@ private:
 		using Params = tuple<span<byte const>, int, span<byte const>, span<byte const>, span<byte const>>;
 	};
 
+	// Downsampled copies of chart densities, so that chart lists can avoid decoding the full series
+	static constexpr auto ChartDensityThumbnailsSchema = R"sql(
+		CREATE TABLE IF NOT EXISTS chart_density_thumbnails(
+			md5 BLOB UNIQUE NOT NULL REFERENCES charts ON DELETE CASCADE,
+			resolution INTEGER NOT NULL CHECK(resolution >= 1),
+			key BLOB NOT NULL,
+			scratch BLOB NOT NULL,
+			ln BLOB NOT NULL
+		)
+	)sql"sv;
+	struct InsertChartDensityThumbnail {
+		static constexpr auto Query = R"sql(
+			INSERT INTO chart_density_thumbnails(md5, resolution, key, scratch, ln) VALUES(?1, ?2, ?3, ?4, ?5)
+		)sql"sv;
+		using Params = tuple<span<byte const>, int64_t, span<byte const>, span<byte const>, span<byte const>>;
+	};
+	// The MD5s are passed as a JSON array of hex strings. Charts imported before thumbnails existed
+	// fall back to their full density.
+	struct SelectDensityThumbnails {
+		static constexpr auto Query = R"sql(
+			SELECT
+				chart_densities.md5,
+				coalesce(chart_density_thumbnails.resolution, chart_densities.resolution),
+				coalesce(chart_density_thumbnails.key, chart_densities.key),
+				coalesce(chart_density_thumbnails.scratch, chart_densities.scratch),
+				coalesce(chart_density_thumbnails.ln, chart_densities.ln)
+				FROM chart_densities
+				LEFT JOIN chart_density_thumbnails ON chart_densities.md5 = chart_density_thumbnails.md5
+				WHERE chart_densities.md5 IN (SELECT unhex(value) FROM json_each(?1))
+		)sql"sv;
+		using Params = tuple<string_view>;
+		using Row = tuple<span<byte const>, int64_t, span<byte const>, span<byte const>, span<byte const>>;
+	};
+
+	static constexpr auto ChartEmbeddingsSchema = R"sql(
+		CREATE TABLE IF NOT EXISTS chart_embeddings(
+			md5 BLOB UNIQUE NOT NULL REFERENCES charts ON DELETE CASCADE,
+			version INTEGER NOT NULL,
+			embedding BLOB NOT NULL
+		)
+	)sql"sv;
+	struct InsertChartEmbedding {
+		static constexpr auto Query = R"sql(
+			INSERT OR REPLACE INTO chart_embeddings(md5, version, embedding) VALUES(?1, ?2, ?3)
+		)sql"sv;
+		using Params = tuple<span<byte const>, int, span<byte const>>;
+	};
+	struct SelectChartEmbeddings {
+		static constexpr auto Query = R"sql(
+			SELECT md5, embedding FROM chart_embeddings WHERE version = ?1
+		)sql"sv;
+		using Params = tuple<int>;
+		using Row = tuple<span<byte const>, span<byte const>>;
+	};
+	// Charts with no embedding, or one calculated by a different version
+	struct SelectChartsMissingEmbeddings {
+		static constexpr auto Query = R"sql(
+			SELECT
+				charts.md5, charts.note_count, charts.chart_duration, charts.average_nps, charts.peak_nps,
+				charts.min_bpm, charts.max_bpm, charts.main_bpm,
+				chart_densities.resolution, chart_densities.key, chart_densities.scratch, chart_densities.ln
+				FROM charts
+				INNER JOIN chart_densities ON charts.md5 = chart_densities.md5
+				LEFT JOIN chart_embeddings ON charts.md5 = chart_embeddings.md5
+				WHERE chart_embeddings.md5 IS NULL OR chart_embeddings.version != ?1
+				LIMIT ?2
+		)sql"sv;
+		using Params = tuple<int, int64_t>;
+		using Row = tuple<span<byte const>, int, int64_t, double, double,
+			double, double, double,
+			int64_t, span<byte const>, span<byte const>, span<byte const>>;
+	};
+
 	static constexpr auto ChartImportLogsSchema = R"sql(
 		CREATE TABLE IF NOT EXISTS chart_import_logs(
 			md5 BLOB UNIQUE NOT NULL REFERENCES charts ON DELETE CASCADE,
@@ -286,27 +486,48 @@ private:
 		atomic<ssize_t> songs_processed = 0;
 		atomic<ssize_t> songs_total = 0;
 		atomic<ssize_t> songs_failed = 0;
+		atomic<ssize_t> songs_quarantined = 0;
 		atomic<ssize_t> charts_added = 0;
 		atomic<ssize_t> charts_skipped = 0;
 		atomic<ssize_t> charts_failed = 0;
+		atomic<ssize_t> bytes_processed = 0;
+		array<atomic<int64_t>, enum_count<ImportStage>()> stage_times = {}; // in nanoseconds
 	};
 
 	Logger::Category cat;
-	unique_ptr<thread_pool>& pool;
+	Scheduler& scheduler;
 
 	lib::sqlite::DB db;
-	task_container import_tasks;
+	fs::path songs_path;
+	io::AudioStore audio_store;
+	unique_ptr<ImportWorkerPool> import_workers; // Outlives import_tasks, which can be waiting on it
+	TaskGroup import_tasks;
+	TaskGroup maintenance_tasks;
 	unordered_map<MD5, ssize_t> staging;
 	coro_mutex staging_lock;
 	unordered_node_map<ssize_t, coro_mutex> song_locks;
 	atomic<bool> dirty = true;
-	atomic<bool> stopping = false;
+	CancelToken cancel_token = CancelToken::make();
 	ImportStats import_stats;
+	SimilarityIndex similarity_index;
 
+	// Load all stored embeddings into the similarity index.
+	void load_similarity_index();
+	// Calculate the embeddings of charts imported before embeddings existed or changed, a batch
+	// at a time, and add them to the similarity index.
+	auto backfill_embeddings() -> task<>;
+	// Delete audio store files that no song refers to anymore, and that weren't recently used.
+	auto collect_audio_garbage() -> task<>;
 	[[nodiscard]] auto find_available_song_filename(string_view name) -> string;
+	void add_stage_time(ImportStage, nanoseconds);
+	// Add the time since the provided point to a stage, and return the current time.
+	auto finish_stage(ImportStage, steady_clock::time_point start) -> steady_clock::time_point;
 	auto import_many(fs::path) -> task<>;
 	auto import_one(fs::path) -> task<>;
-	auto import_chart(io::Song& song, ssize_t song_id, string chart_path, span<byte const>) -> task<MD5>;
+	// Store a built chart in the database. Returns false if the chart was already there.
+	auto commit_chart(ssize_t song_id, ImportedChart const&) -> bool;
+	// Delete a song that was created for an import, if the import didn't get to add any charts to it.
+	void remove_song_if_empty(ssize_t song_id, string_view song_filename);
 	auto deduplicate_previews(ssize_t song_id, span<MD5 const> new_charts) -> task<ssize_t>;
 };
 
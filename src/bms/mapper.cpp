@@ -15,7 +15,9 @@ or distributed except according to those terms.
 
 namespace playnote::bms {
 
-Mapper::Mapper()
+Mapper::Mapper():
+	debounce_duration{globals::config->get_handle(Config::Key<int>{"controls", "debounce_duration"})},
+	turntable_stop_timeout{globals::config->get_handle(Config::Key<int>{"controls", "turntable_stop_timeout"})}
 {
 	auto get_key = [](string_view conf) -> KeyInput::Code {
 		auto conf_entry = globals::config->get_entry<string>("controls", conf);
@@ -146,7 +148,7 @@ auto Mapper::from_key(KeyInput const& key, Playstyle playstyle) -> optional<Inpu
 	auto const lane = static_cast<Lane::Type>(distance(playstyle_binds.begin(), match));
 	auto& last = last_input[+playstyle][+lane];
 	auto const since_last = key.timestamp - last;
-	if (since_last <= milliseconds{globals::config->get_entry<int>("controls", "debounce_duration")}) return nullopt;
+	if (since_last <= milliseconds{*debounce_duration}) return nullopt;
 
 	last = key.timestamp;
 	return Input{
@@ -169,7 +171,7 @@ auto Mapper::from_button(ButtonInput const& button, Playstyle playstyle) -> opti
 	auto const lane = static_cast<Lane::Type>(distance(playstyle_binds.begin(), match));
 	auto& last = last_input[+playstyle][+lane];
 	auto const since_last = button.timestamp - last;
-	if (since_last <= milliseconds{globals::config->get_entry<int>("controls", "debounce_duration")}) return nullopt;
+	if (since_last <= milliseconds{*debounce_duration}) return nullopt;
 
 	last = button.timestamp;
 	return Input{
@@ -199,7 +201,7 @@ auto Mapper::submit_axis_input(AxisInput const& axis, Playstyle playstyle) -> st
 	auto& last = last_input[+playstyle][+lane];
 	auto const since_last = axis.timestamp - last;
 
-	if (current_direction != tt_state.direction && since_last > milliseconds{globals::config->get_entry<int>("controls", "debounce_duration")}) {
+	if (current_direction != tt_state.direction && since_last > milliseconds{*debounce_duration}) {
 		// Changing direction of existing rotation
 		if (tt_state.direction != TurntableState::Direction::None) {
 			inputs.emplace_back(Input{
@@ -237,7 +239,7 @@ auto Mapper::from_axis_state(Playstyle playstyle) -> static_vector<Input, 2>
 		if (tt.direction == TurntableState::Direction::None) continue;
 		auto now = globals::glfw->get_time();
 		auto elapsed = now - tt.last_stopped;
-		if (elapsed <= milliseconds{globals::config->get_entry<int>("controls", "turntable_stop_timeout")}) continue;
+		if (elapsed <= milliseconds{*turntable_stop_timeout}) continue;
 
 		inputs.emplace_back(Input{
 			.timestamp = now,
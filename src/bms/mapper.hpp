@@ -9,6 +9,7 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/config.hpp"
 #include "bms/chart.hpp"
 #include "input.hpp"
 
@@ -60,6 +61,8 @@ private:
 	array<array<optional<ConBinding>, 2>, enum_count<Playstyle>()> axis_bindings;
 	array<array<TurntableState, 2>, enum_count<Playstyle>()> turntable_states;
 	array<array<nanoseconds, enum_count<Lane::Type>()>, enum_count<Playstyle>()> last_input{};
+	Config::Handle<int> debounce_duration;
+	Config::Handle<int> turntable_stop_timeout;
 
 	[[nodiscard]] static auto tt_difference(float prev, float curr) -> float;
 	[[nodiscard]] static auto tt_direction(float prev, float curr) -> TurntableState::Direction;
@@ -0,0 +1,146 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bms/similarity.hpp"
+
+#include "preamble.hpp"
+
+namespace playnote::bms {
+
+// Layout of the embedding. Weights set how much each part contributes to the distance; where
+// the dense sections are matters less than how dense they are.
+static constexpr auto ShapePoints = 16z;
+static constexpr auto DistributionPoints = 8z;
+static constexpr auto ScalarPoints = 8z;
+static_assert(ShapePoints + DistributionPoints + ScalarPoints == static_cast<ssize_t>(tuple_size_v<ChartEmbedding>));
+static constexpr auto ShapeWeight = 0.5f;
+static constexpr auto DistributionWeight = 0.75f;
+static constexpr auto ScalarWeight = 1.0f;
+
+auto make_embedding(Metadata const& metadata) -> ChartEmbedding
+{
+	auto const& density = metadata.density;
+	auto total = vector<float>{};
+	total.reserve(density.key.size());
+	transform(views::zip(density.key, density.scratch, density.ln), back_inserter(total),
+		[](auto const& values) { return get<0>(values) + get<1>(values) + get<2>(values); });
+	auto const peak = fold_left(total, 0.0f, [](auto acc, auto v) { return max(acc, v); });
+
+	auto values = array<float, tuple_size_v<ChartEmbedding>>{};
+	auto out = values.begin();
+
+	// Density over time, as the average of each section relative to the peak
+	for (auto idx: views::iota(0z, ShapePoints)) {
+		auto const from = idx * ssize(total) / ShapePoints;
+		auto const to = (idx + 1) * ssize(total) / ShapePoints;
+		auto const section = span{total}.subspan(from, to - from);
+		auto const average = section.empty()? 0.0f : fold_left(section, 0.0f, std::plus{}) / section.size();
+		*out++ = peak > 0.0f? average / peak * ShapeWeight : 0.0f;
+	}
+
+	// Density percentiles, relative to the peak; flat for streams, steep for charts with bursts
+	auto sorted = total;
+	sort(sorted);
+	for (auto idx: views::iota(0z, DistributionPoints)) {
+		auto const value = sorted.empty()? 0.0f : sorted[(idx + 1) * (ssize(sorted) - 1) / DistributionPoints];
+		*out++ = peak > 0.0f? value / peak * DistributionWeight : 0.0f;
+	}
+
+	// Scalars, each scaled so that common values fall within 0..1
+	auto const sum = [](vector<float> const& series) { return fold_left(series, 0.0f, std::plus{}); };
+	auto const density_sum = fold_left(total, 0.0f, std::plus{});
+	auto const share = [&](vector<float> const& series) { return density_sum > 0.0f? sum(series) / density_sum : 0.0f; };
+	auto const min_bpm = max(metadata.bpm_range.min, 1.0f);
+	auto const scalars = to_array({
+		std::log2(1.0f + metadata.nps.average) / 6.0f, // 63 NPS
+		std::log2(1.0f + metadata.nps.peak) / 6.0f,
+		share(density.scratch),
+		share(density.ln),
+		std::log2(max(metadata.bpm_range.main, 1.0f)) / 9.0f, // 512 BPM
+		std::log2(max(metadata.bpm_range.max, min_bpm) / min_bpm) / 4.0f, // 16x BPM range
+		std::log2(1.0f + duration_cast<duration<float>>(metadata.chart_duration).count()) / 10.0f, // 17 minutes
+		std::log2(1.0f + metadata.note_count) / 14.0f, // 16k notes
+	});
+	static_assert(static_cast<ssize_t>(tuple_size_v<decltype(scalars)>) == ScalarPoints);
+	for (auto scalar: scalars) *out++ = scalar * ScalarWeight;
+
+	auto result = ChartEmbedding{};
+	transform(values, result.begin(), [](float v) {
+		return static_cast<int8_t>(std::lround(clamp(v, 0.0f, 1.0f) * 127.0f));
+	});
+	return result;
+}
+
+void SimilarityIndex::add(MD5 const& md5, ChartEmbedding const& embedding)
+{
+	auto lock = lock_guard{index_lock};
+	if (auto it = positions.find(md5); it != positions.end()) {
+		embeddings[it->second] = embedding;
+		return;
+	}
+	positions.emplace(md5, ssize(embeddings));
+	embeddings.emplace_back(embedding);
+	md5s.emplace_back(md5);
+}
+
+auto SimilarityIndex::get(MD5 const& md5) const -> optional<ChartEmbedding>
+{
+	auto lock = shared_lock{index_lock};
+	auto it = positions.find(md5);
+	if (it == positions.end()) return nullopt;
+	return embeddings[it->second];
+}
+
+auto SimilarityIndex::find(ChartEmbedding const& query, ssize_t count, optional<MD5> exclude) const -> vector<Match>
+{
+	if (count <= 0) return {};
+	auto lock = shared_lock{index_lock};
+	auto const excluded = exclude? [&] {
+		auto it = positions.find(*exclude);
+		return it != positions.end()? it->second : -1z;
+	}() : -1z;
+
+	// Max-heap of the closest charts so far, so that the farthest of them is on top
+	auto closest = vector<pair<int32_t, ssize_t>>{};
+	closest.reserve(count + 1);
+	for (auto idx: views::iota(0z, ssize(embeddings))) {
+		if (idx == excluded) continue;
+		auto const& embedding = embeddings[idx];
+		auto distance = int32_t{0};
+		for (auto i: views::iota(0z, ssize(query))) {
+			auto const diff = int32_t{embedding[i]} - int32_t{query[i]};
+			distance += diff * diff;
+		}
+		if (ssize(closest) == count && distance >= closest.front().first) continue;
+		closest.emplace_back(distance, idx);
+		std::ranges::push_heap(closest);
+		if (ssize(closest) > count) {
+			std::ranges::pop_heap(closest);
+			closest.pop_back();
+		}
+	}
+
+	std::ranges::sort_heap(closest);
+	auto result = vector<Match>{};
+	result.reserve(closest.size());
+	for (auto [distance, idx]: closest)
+		result.emplace_back(Match{
+			.md5 = md5s[idx],
+			.distance = sqrt(static_cast<float>(distance)) / 127.0f,
+		});
+	return result;
+}
+
+auto SimilarityIndex::size() const -> ssize_t
+{
+	auto lock = shared_lock{index_lock};
+	return ssize(embeddings);
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bms {
+
+// Fixed-length summary of how a chart plays: the shape of its note density over time, how evenly
+// the density is distributed, and its NPS, BPM and length. Charts that play alike are close
+// by Euclidean distance. Each component is quantized to 0..127.
+using ChartEmbedding = array<int8_t, 32>;
+
+// Increased whenever make_embedding() changes, so that stored embeddings get recalculated.
+constexpr auto ChartEmbeddingVersion = 1;
+
+// Calculate the embedding of a chart. Only the density, NPS, BPM range, note count
+// and chart duration are used.
+[[nodiscard]] auto make_embedding(Metadata const&) -> ChartEmbedding;
+
+// In-memory index of chart embeddings, for finding the charts most similar to a given one.
+// Queries scan the whole index; with 32 bytes per chart this stays within a few milliseconds
+// even for very large libraries. Thread-safe; queries run concurrently with each other, and
+// only wait for additions while those are being applied.
+class SimilarityIndex {
+public:
+	struct Match {
+		MD5 md5;
+		float distance; // 0.0 for identical embeddings
+	};
+
+	// Add a chart to the index, or replace its embedding if it's already there.
+	void add(MD5 const&, ChartEmbedding const&);
+
+	// Return the embedding of a chart in the index.
+	[[nodiscard]] auto get(MD5 const&) const -> optional<ChartEmbedding>;
+
+	// Return up to count charts closest to the embedding, closest first. The excluded chart
+	// is never returned, so that a chart isn't reported as similar to itself.
+	[[nodiscard]] auto find(ChartEmbedding const&, ssize_t count, optional<MD5> exclude = nullopt) const -> vector<Match>;
+
+	// Return the number of charts in the index.
+	[[nodiscard]] auto size() const -> ssize_t;
+
+private:
+	mutable shared_mutex index_lock;
+	vector<ChartEmbedding> embeddings;
+	vector<MD5> md5s; // Parallel to embeddings
+	unordered_map<MD5, ssize_t> positions;
+};
+
+}
@@ -33,8 +33,23 @@ Audio::Audio(Logger::Category cat, function<void(span<Sample>)> generator):
 		duration_cast<milliseconds>(lib::audio_latency(context->properties)).count());
 }
 
+Audio::Audio(Logger::Category cat, function<void(span<Sample>)> generator, OfflineSink sink):
+	cat{cat},
+	offline_properties{
+		.sampling_rate = sink.sampling_rate,
+		.sample_format = lib::SampleFormat::Float32,
+		.buffer_size = sink.buffer_size,
+	},
+	generator{move(generator)}
+{
+	ASSERT(sink.sampling_rate > 0 && sink.buffer_size > 0);
+	INFO_AS(cat, "Offline audio sink initialized: sample rate: {}Hz, buffer size: {}",
+		sink.sampling_rate, sink.buffer_size);
+}
+
 Audio::~Audio() noexcept
 {
+	if (is_offline()) return;
 #ifdef TARGET_LINUX
 	lib::pw::cleanup(move(context));
 	INFO_AS(cat, "Pipewire audio cleaned up");
@@ -44,30 +59,11 @@ Audio::~Audio() noexcept
 #endif
 }
 
-auto Audio::samples_to_ns(ssize_t samples, int sampling_rate) -> nanoseconds
-{
-	auto const rate = sampling_rate == -1? context->properties.sampling_rate : sampling_rate;
-	ASSERT(rate > 0);
-	auto const ns_per_sample = duration_cast<nanoseconds>(duration<double>{1.0 / rate});
-	auto const whole_seconds = samples / rate;
-	auto const remainder = samples % rate;
-	return 1s * whole_seconds + ns_per_sample * remainder;
-}
-
-auto Audio::ns_to_samples(nanoseconds ns, int sampling_rate) -> ssize_t
-{
-	auto const rate = sampling_rate == -1? context->properties.sampling_rate : sampling_rate;
-	ASSERT(rate > 0);
-	auto const ns_per_sample = duration_cast<nanoseconds>(duration<double>{1.0 / rate});
-	return ns / ns_per_sample;
-}
-
-auto lufs_to_gain(double lufs) -> float
+void Audio::render(span<Sample> buffer)
 {
-	constexpr auto LufsTarget = -14.0;
-	auto const db_from_target = LufsTarget - lufs;
-	auto const amplitude_ratio = pow(10.0, db_from_target / 20.0);
-	return static_cast<float>(amplitude_ratio);
+	ASSERT(is_offline());
+	on_process(buffer);
+	offline_samples += ssize(buffer);
 }
 
 }
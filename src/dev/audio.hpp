@@ -28,21 +28,45 @@ using lib::ChannelCount;
 
 class Audio {
 public:
+	// Properties of an offline sink, which doesn't open an audio device. The generator only runs
+	// when render() is called, at whatever pace the caller wants.
+	struct OfflineSink {
+		int sampling_rate;
+		int buffer_size;
+	};
+
 	// Initialize the audio device. The provider generator function is called repeatedly to fill in the sample buffer.
 	Audio(Logger::Category, function<void(span<Sample>)> generator);
+
+	// Initialize an offline sink instead of an audio device.
+	Audio(Logger::Category, function<void(span<Sample>)> generator, OfflineSink);
+
 	~Audio() noexcept;
 
 	// Return current sampling rate. The value is only valid while an Audio instance exists.
-	[[nodiscard]] auto get_sampling_rate() -> int { return ASSERT_VAL(context->properties.sampling_rate); }
+	[[nodiscard]] auto get_sampling_rate() -> int { return ASSERT_VAL(get_properties().sampling_rate); }
 
 	// Return current latency of the audio device.
-	[[nodiscard]] auto get_latency() -> nanoseconds { return samples_to_ns(context->properties.buffer_size); }
+	[[nodiscard]] auto get_latency() -> nanoseconds { return samples_to_ns(get_properties().buffer_size); }
+
+	// Return true if this is an offline sink.
+	[[nodiscard]] auto is_offline() const -> bool { return !context; }
+
+	// Fill the buffer by running the generator once. Offline sinks only.
+	void render(span<Sample> buffer);
 
-	// Convert a count of samples to their duration.
-	[[nodiscard]] auto samples_to_ns(ssize_t, int sampling_rate = -1) -> nanoseconds;
+	// Return the duration of audio rendered so far by an offline sink. Offline rendering
+	// doesn't follow the wall clock, so this takes its place.
+	[[nodiscard]] auto get_offline_time() -> nanoseconds { return samples_to_ns(offline_samples); }
 
-	// Convert a duration to a number of full audio samples.
-	[[nodiscard]] auto ns_to_samples(nanoseconds, int sampling_rate = -1) -> ssize_t;
+	// Convert a count of samples to their duration. Uses the device sampling rate if none is provided.
+	[[nodiscard]] auto samples_to_ns(ssize_t samples, int sampling_rate = -1) -> nanoseconds
+	{ return lib::samples_to_ns(samples, sampling_rate == -1? get_sampling_rate() : sampling_rate); }
+
+	// Convert a duration to a number of full audio samples. Uses the device sampling rate if none
+	// is provided.
+	[[nodiscard]] auto ns_to_samples(nanoseconds ns, int sampling_rate = -1) -> ssize_t
+	{ return lib::ns_to_samples(ns, sampling_rate == -1? get_sampling_rate() : sampling_rate); }
 
 	Audio(Audio const&) = delete;
 	auto operator=(Audio const&) -> Audio& = delete;
@@ -60,12 +84,24 @@ private:
 	lib::wasapi::Context context;
 #endif
 
+	lib::AudioProperties offline_properties = {};
+	ssize_t offline_samples = 0;
+
 	function<void(span<Sample>)> generator;
 
+	[[nodiscard]] auto get_properties() const -> lib::AudioProperties const&
+	{ return context? context->properties : offline_properties; }
+
 	void on_process(span<Sample> buffer) const { generator(buffer); }
 };
 
 // Converts LUFS relative to target to an amplitude gain value.
-[[nodiscard]] auto lufs_to_gain(double lufs) -> float;
+[[nodiscard]] inline auto lufs_to_gain(double lufs) -> float
+{
+	constexpr auto LufsTarget = -14.0;
+	auto const db_from_target = LufsTarget - lufs;
+	auto const amplitude_ratio = pow(10.0, db_from_target / 20.0);
+	return static_cast<float>(amplitude_ratio);
+}
 
 }
@@ -27,8 +27,9 @@ ControllerDispatcher::ControllerDispatcher(Logger::Category cat):
 	glfwSetJoystickCallback(joystick_event_callback);
 }
 
-auto ControllerDispatcher::poll() -> generator<ControllerEvent>
+auto ControllerDispatcher::poll() -> span<ControllerEvent const>
 {
+	events.clear();
 	for (auto jid: views::iota(GLFW_JOYSTICK_1, GLFW_JOYSTICK_LAST + 1)) {
 		if (!glfwJoystickPresent(jid)) continue;
 		auto& controller = controllers[jid];
@@ -39,12 +40,12 @@ auto ControllerDispatcher::poll() -> generator<ControllerEvent>
 		for (auto [idx, previous, current_raw]: views::zip(views::iota(0), controller.buttons, buttons)) {
 			auto current = current_raw == +lib::glfw::Action::Press;
 			if (previous == current) continue;
-			co_yield ControllerEvent{ButtonInput{
+			events.emplace_back(ButtonInput{
 				.controller = controller.id,
 				.timestamp = globals::glfw->get_time(),
 				.button = idx,
 				.state = current,
-			}};
+			});
 			previous = current;
 		}
 
@@ -53,15 +54,16 @@ auto ControllerDispatcher::poll() -> generator<ControllerEvent>
 		auto axes = span{axes_ptr, static_cast<size_t>(axes_count)};
 		for (auto [idx, previous, current]: views::zip(views::iota(0), controller.axes, axes)) {
 			if (previous == current) continue;
-			co_yield ControllerEvent{AxisInput{
+			events.emplace_back(AxisInput{
 				.controller = controller.id,
 				.timestamp = globals::glfw->get_time(),
 				.axis = idx,
 				.value = current,
-			}};
+			});
 			previous = current;
 		}
 	}
+	return events;
 }
 
 void ControllerDispatcher::joystick_event_callback(int jid, int event)
@@ -25,8 +25,8 @@ public:
 	explicit ControllerDispatcher(Logger::Category);
 
 	// Update state of all connected controllers. If a button state or axis value changed since
-	// the last poll, a corresponding event is generated.
-	auto poll() -> generator<ControllerEvent>;
+	// the last poll, a corresponding event is generated. Events remain valid until the next poll.
+	auto poll() -> span<ControllerEvent const>;
 
 private:
 	InstanceLimit<ControllerDispatcher, 1> instance_limit;
@@ -40,6 +40,7 @@ private:
 		vector<float> axes;
 	};
 	array<Controller, 16> controllers{};
+	vector<ControllerEvent> events; // Reused between polls
 
 	static void joystick_event_callback(int jid, int event);
 };
@@ -11,6 +11,8 @@ or distributed except according to those terms.
 
 #include "preamble.hpp"
 #include "utils/config.hpp"
+#include "lib/openssl.hpp"
+#include "io/file.hpp"
 
 namespace playnote::dev {
 
@@ -88,6 +90,51 @@ GPU::GPU(dev::Window& window, Logger::Category cat):
 	swapchain{create_swapchain(global_allocator, device, window.size())}
 { INFO_AS(cat, "Vulkan initialized"); }
 
+GPU::~GPU()
+{
+	runtime.wait_idle();
+	save_pipeline_cache();
+}
+
+void GPU::load_pipeline_cache(span<span<uint const> const> shaders)
+{
+	// A driver update or shader change invalidates the cache, so both are part of the filename
+	auto key = vector<byte>{};
+	auto const driver_id = lib::vk::get_pipeline_cache_id(physical_device);
+	copy(std::as_bytes(span{driver_id}), back_inserter(key));
+	for (auto shader: shaders) copy(std::as_bytes(shader), back_inserter(key));
+	pipeline_cache_path = fs::path{PipelineCachePath} / format("{}.bin", lib::openssl::md5_to_hex(lib::openssl::md5(key)));
+
+	if (!fs::exists(*pipeline_cache_path)) {
+		INFO_AS(cat, "No pipeline cache found, pipelines will be compiled from scratch");
+		return;
+	}
+	try {
+		auto const file = io::read_file(*pipeline_cache_path);
+		if (lib::vuk::load_pipeline_cache(runtime, file.contents))
+			INFO_AS(cat, "Loaded pipeline cache \"{}\"", *pipeline_cache_path);
+		else
+			WARN_AS(cat, "Pipeline cache \"{}\" was rejected by the driver", *pipeline_cache_path);
+	} catch (exception const& e) {
+		WARN_AS(cat, "Failed to load pipeline cache \"{}\": {}", *pipeline_cache_path, e.what());
+	}
+}
+
+void GPU::save_pipeline_cache() noexcept
+try {
+	if (!pipeline_cache_path) return;
+	auto const data = lib::vuk::save_pipeline_cache(runtime);
+	fs::create_directories(pipeline_cache_path->parent_path());
+	// Caches of previous drivers and shader versions will never be loaded again
+	for (auto const& entry: fs::directory_iterator{pipeline_cache_path->parent_path()})
+		if (entry.path() != *pipeline_cache_path) fs::remove(entry.path());
+	io::write_file(*pipeline_cache_path, data);
+	DEBUG_AS(cat, "Saved pipeline cache \"{}\" ({} bytes)", *pipeline_cache_path, data.size());
+}
+catch (exception const& e) {
+	WARN_AS(cat, "Failed to save pipeline cache: {}", e.what());
+}
+
 auto GPU::estimate_frame_sleep() -> nanoseconds
 {
 	if (!globals::config->get_entry<bool>("graphics", "low_latency")) return 0ns;
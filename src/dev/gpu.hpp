@@ -23,11 +23,16 @@ class GPU {
 public:
 	// Initialize the GPU context for the given window.
 	GPU(dev::Window&, Logger::Category);
-	~GPU() { runtime.wait_idle(); }
+	~GPU();
 
 	[[nodiscard]] auto get_window() const -> dev::Window& { return window; }
 	[[nodiscard]] auto get_global_allocator() -> lib::vuk::Allocator& { return global_allocator; }
 
+	// Load the pipeline cache saved for the current driver and this exact set of shaders, if any.
+	// Pipelines created from now on are added to the cache, which is written back to disk
+	// on destruction. Call before creating any pipelines.
+	void load_pipeline_cache(span<span<uint const> const> shaders);
+
 	// Prepare and present a single frame. All vuk draw commands must be submitted within
 	// the callback. The callback is provided with the frame allocator and swapchain image.
 	template<callable<ManagedImage(lib::vuk::Allocator&, ManagedImage&&)> Func>
@@ -100,6 +105,7 @@ private:
 		optional<lib::vuk::Swapchain> old = nullopt) const -> lib::vuk::Swapchain;
 
 	auto estimate_frame_sleep() -> nanoseconds;
+	void save_pipeline_cache() noexcept;
 
 	dev::Window& window;
 
@@ -111,6 +117,7 @@ private:
 	lib::vuk::GlobalResource global_resource;
 	lib::vuk::Allocator global_allocator;
 	lib::vuk::Swapchain swapchain;
+	optional<fs::path> pipeline_cache_path;
 
 	nanoseconds last_submit = {};
 };
@@ -17,7 +17,8 @@ namespace playnote::gfx {
 
 Playfield::Playfield(Transform transform, float height, bms::Cursor const& cursor,
 	bms::Score const& score):
-	transform{globals::create_transform(transform)}, cursor{cursor}, score{score}
+	transform{globals::create_transform(transform)}, cursor{cursor}, score{score},
+	judgment_timeout{playnote::globals::config->get_handle(Config::Key<int>{"gameplay", "judgment_timeout"})}
 {
 	static constexpr auto FieldSpacing = 70.0f;
 
@@ -63,7 +64,7 @@ void Playfield::enqueue(Renderer::Queue& queue, float scroll_speed, nanoseconds
 	scroll_speed /= 4.0f; // 1 beat -> 1 standard measure
 	scroll_speed *= 120.0f / cursor.get_chart().metadata.bpm_range.main; // Normalize to 120 BPM
 	auto const max_distance = 1.0f / scroll_speed;
-	for (auto&& note: cursor.upcoming_notes(max_distance, offset, true)) {
+	cursor.upcoming_notes([&](auto const& note) {
 		auto& lane = lanes[+note.lane];
 		auto existing = find(lane, note.lane_idx, &Note::lane_idx);
 		if (existing == lane.end()) {
@@ -79,7 +80,7 @@ void Playfield::enqueue(Renderer::Queue& queue, float scroll_speed, nanoseconds
 		} else {
 			existing->transform->position.y() = (1.0f - (note.distance / max_distance)) * size.y();
 		}
-	}
+	}, max_distance, offset, true);
 
 	// Enqueue lane backgrounds and hold display
 	for (auto [idx, lane, lane_transform]: views::zip(views::iota(0), lanes, lane_offsets)) {
@@ -120,7 +121,7 @@ void Playfield::enqueue(Renderer::Queue& queue, float scroll_speed, nanoseconds
 		constexpr auto TimingY = 237.0f;
 
 		auto const judgment = score.get_latest_judgment(idx);
-		if (judgment && cursor.get_progress_ns() - judgment->timestamp <= milliseconds{playnote::globals::config->get_entry<int>("gameplay", "judgment_timeout")}) {
+		if (judgment && cursor.get_progress_ns() - judgment->timestamp <= milliseconds{*judgment_timeout}) {
 			auto const judge_name = format("judgment{}", idx);
 			auto judge_str = string{enum_name(judgment->type)};
 			to_upper(judge_str);
@@ -9,6 +9,7 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/config.hpp"
 #include "gfx/transform.hpp"
 #include "gfx/renderer.hpp"
 #include "bms/cursor.hpp"
@@ -51,6 +52,7 @@ private:
 	float2 size;
 	bms::Cursor const& cursor;
 	bms::Score const& score;
+	Config::Handle<int> judgment_timeout;
 	static_vector<Field, 2> fields;
 	array<vector<Note>, enum_count<bms::Lane::Type>()> lanes;
 	array<TransformRef, enum_count<bms::Lane::Type>()> lane_offsets;
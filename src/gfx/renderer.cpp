@@ -12,6 +12,8 @@ or distributed except according to those terms.
 #include "preamble.hpp"
 #include "utils/assets.hpp"
 #include "utils/config.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/tracing.hpp"
 #include "lib/os.hpp"
 #include "lib/vuk.hpp"
 #include "gpu/shaders.hpp"
@@ -116,7 +118,7 @@ auto draw_all(dev::GPU& gpu, lib::vuk::ManagedImage&& dest,
 	lib::vuk::ManagedBuffer&& primitives_buf, lib::vuk::ManagedBuffer&& vertices_buf,
 	lib::vuk::ManagedBuffer&& worklists_buf, lib::vuk::ManagedBuffer&& worklist_sizes_buf,
 	lib::vuk::ImageView static_atlas_iv, lib::vuk::ManagedImage&& dynamic_atlas_ia,
-	lib::os::SubpixelLayout subpixel_layout) -> lib::vuk::ManagedImage
+	lib::vuk::ManagedImage&& image_ia, lib::os::SubpixelLayout subpixel_layout) -> lib::vuk::ManagedImage
 {
 	auto pass = lib::vuk::make_pass("draw_all",
 		[window_size = gpu.get_window().size(), static_atlas_iv, subpixel_layout] (
@@ -126,7 +128,8 @@ auto draw_all(dev::GPU& gpu, lib::vuk::ManagedImage&& dest,
 			VUK_BA(lib::vuk::Access::eComputeRead) vertices_buf,
 			VUK_BA(lib::vuk::Access::eComputeRead) worklists_buf,
 			VUK_BA(lib::vuk::Access::eComputeRead) worklist_sizes_buf,
-			VUK_IA(lib::vuk::Access::eComputeSampled) dynamic_atlas_ia
+			VUK_IA(lib::vuk::Access::eComputeSampled) dynamic_atlas_ia,
+			VUK_IA(lib::vuk::Access::eComputeSampled) image_ia
 		)
 	{
 		cmd
@@ -137,7 +140,8 @@ auto draw_all(dev::GPU& gpu, lib::vuk::ManagedImage&& dest,
 			.bind_buffer(0, 3, worklist_sizes_buf)
 			.bind_image(0, 4, static_atlas_iv).bind_sampler(0, 4, LinearSampler)
 			.bind_image(0, 5, dynamic_atlas_ia).bind_sampler(0, 5, LinearSampler)
-			.bind_image(0, 6, target)
+			.bind_image(0, 6, image_ia).bind_sampler(0, 6, LinearSampler)
+			.bind_image(0, 7, target)
 			.specialize_constants(0, window_size.x()).specialize_constants(1, window_size.y())
 			.specialize_constants(2, +subpixel_layout)
 			.specialize_constants(3, TextShaper::DistanceRange)
@@ -145,7 +149,7 @@ auto draw_all(dev::GPU& gpu, lib::vuk::ManagedImage&& dest,
 		return target;
 	});
 	return pass(move(dest), move(primitives_buf), move(vertices_buf),
-		move(worklists_buf), move(worklist_sizes_buf), move(dynamic_atlas_ia));
+		move(worklists_buf), move(worklist_sizes_buf), move(dynamic_atlas_ia), move(image_ia));
 }
 
 auto Renderer::Queue::physical_to_logical(float2 pos) -> float2
@@ -287,6 +291,15 @@ auto Renderer::Queue::text(Text const& text, Drawable common, TextParams params)
 	return *this;
 }
 
+auto Renderer::Queue::image(Drawable common, ImageParams params) -> Queue&
+{
+	ASSUME(ssize(params.pixels) == params.dimensions.x() * params.dimensions.y() * 4);
+	if (image_source) params.changed = params.changed || image_source->changed;
+	image_source = params;
+	enqueue_into(images, common, ImageRect{.size = params.size});
+	return *this;
+}
+
 template<typename T>
 void Renderer::Queue::enqueue_into(vector<tuple<Drawable, T, int>>& into, Drawable common, T params)
 {
@@ -299,25 +312,41 @@ void Renderer::Queue::enqueue_into(vector<tuple<Drawable, T, int>>& into, Drawab
 	group_depths.back().second = common.depth;
 }
 
-auto Renderer::Queue::to_primitive_list() const -> vector<Primitive>
+void Renderer::Queue::reset(Transform transform, Transform inv_transform)
+{
+	// clear() keeps the capacity from previous frames
+	pies.clear();
+	rects.clear();
+	polygons.clear();
+	glyphs.clear();
+	images.clear();
+	image_source.reset();
+	polygon_vertices.clear();
+	group_depths.clear();
+	inside_group = false;
+	this->transform = transform;
+	this->inv_transform = inv_transform;
+}
+
+void Renderer::Queue::to_primitive_list(vector<Primitive>& primitives) const
 {
 	// Create a group remapping table so that the groups are sorted by depth
 	sort(group_depths, [](auto const& a, auto const& b) {
 		return a.second < b.second;
 	});
-	auto group_remapping = vector<int>{};
 	group_remapping.resize(group_depths.size());
 	for (auto [idx, val]: group_depths | views::enumerate)
 		group_remapping[val.first] = idx;
 
-	auto primitives = vector<Primitive>{};
-	primitives.reserve(rects.size() + pies.size() + polygons.size() + glyphs.size());
+	primitives.clear();
+	primitives.reserve(rects.size() + pies.size() + polygons.size() + glyphs.size() + images.size());
 	auto enqueue_primitive = [&]<typename T>(Drawable const& common, T const& params, int group) {
 		constexpr auto type = [] {
 			if constexpr(same_as<T, PieParams>) return Primitive::Type::Pie;
 			if constexpr(same_as<T, RectParams>) return Primitive::Type::Rect;
 			if constexpr(same_as<T, PolygonParams>) return Primitive::Type::Polygon;
 			if constexpr(same_as<T, GlyphParams>) return Primitive::Type::Glyph;
+			if constexpr(same_as<T, ImageRect>) return Primitive::Type::Image;
 			unreachable();
 		}();
 		auto& prim = primitives.emplace_back(Primitive{
@@ -352,13 +381,16 @@ auto Renderer::Queue::to_primitive_list() const -> vector<Primitive>
 			.size = params.size,
 			.page = params.page,
 		};
+		else if constexpr(same_as<T, ImageRect>) prim.image_params = {
+			.size = params.size,
+		};
 		else unreachable();
 	};
 	for (auto const& pie: pies) apply(enqueue_primitive, pie);
 	for (auto const& rect: rects) apply(enqueue_primitive, rect);
 	for (auto const& polygon: polygons) apply(enqueue_primitive, polygon);
 	for (auto const& glyph: glyphs) apply(enqueue_primitive, glyph);
-	return primitives;
+	for (auto const& image: images) apply(enqueue_primitive, image);
 }
 
 Renderer::Renderer(dev::Window& window, Logger::Category cat):
@@ -383,21 +415,40 @@ Renderer::Renderer(dev::Window& window, Logger::Category cat):
 
 	auto& context = gpu.get_global_allocator().get_context();
 
-	text_shaper.load_font("Mplus2"_id, globals::assets->get("Mplus2-Regular.ttf"_id), 500);
-	text_shaper.load_font("Pretendard"_id, globals::assets->get("Pretendard-Regular.ttf"_id), 500);
-	text_shaper.define_style("Sans-Regular"_id, {"Mplus2"_id, "Pretendard"_id}, 500);
-	text_shaper.deserialize(globals::assets->get("font_atlas.zpp"_id));
+	// Fonts are loaded on a worker while the pipelines are being created
+	auto fonts_loaded = launch_pollable(Priority::Interactive, [](TextShaper& text_shaper) -> task<> {
+		text_shaper.load_font("Mplus2"_id, globals::assets->get("Mplus2-Regular.ttf"_id), 500);
+		text_shaper.load_font("Pretendard"_id, globals::assets->get("Pretendard-Regular.ttf"_id), 500);
+		text_shaper.define_style("Sans-Regular"_id, {"Mplus2"_id, "Pretendard"_id}, 500);
+		text_shaper.deserialize(globals::assets->get("font_atlas.zpp"_id));
+		co_return;
+	}(text_shaper));
+
+	try {
+		gpu.load_pipeline_cache(to_array<span<uint const>>({gpu::worklist_gen_spv, gpu::worklist_sort_spv, gpu::draw_all_spv}));
+		lib::vuk::create_compute_pipeline(context, "worklist_gen", gpu::worklist_gen_spv);
+		DEBUG_AS(cat, "Compiled worklist_gen pipeline");
+		lib::vuk::create_compute_pipeline(context, "worklist_sort", gpu::worklist_sort_spv);
+		DEBUG_AS(cat, "Compiled worklist_sort pipeline");
+		lib::vuk::create_compute_pipeline(context, "draw_all", gpu::draw_all_spv);
+		DEBUG_AS(cat, "Compiled draw_all pipeline");
+	} catch (...) {
+		fonts_loaded.wait(); // The task must not outlive the text shaper
+		throw;
+	}
+
+	fonts_loaded.get();
 	auto [new_atlas, atlas_upload] = lib::vuk::create_texture(gpu.get_global_allocator(), text_shaper.get_atlas(0), vuk::Format::eR8G8B8A8Unorm);
 	auto compiler = lib::vuk::Compiler{};
 	atlas_upload.as_released(lib::vuk::Access::eComputeSampled).wait(gpu.get_global_allocator(), compiler);
 	static_atlas = move(new_atlas);
 
-	lib::vuk::create_compute_pipeline(context, "worklist_gen", gpu::worklist_gen_spv);
-	DEBUG_AS(cat, "Compiled worklist_gen pipeline");
-	lib::vuk::create_compute_pipeline(context, "worklist_sort", gpu::worklist_sort_spv);
-	DEBUG_AS(cat, "Compiled worklist_sort pipeline");
-	lib::vuk::create_compute_pipeline(context, "draw_all", gpu::draw_all_spv);
-	DEBUG_AS(cat, "Compiled draw_all pipeline");
+	// Placeholder, so that the image binding is always valid
+	static constexpr auto BlankPixel = to_array({byte{0}, byte{0}, byte{0}, byte{255}});
+	auto [blank_image, blank_upload] = lib::vuk::create_texture(gpu.get_global_allocator(),
+		const_multi_array_ref<byte, 3>{BlankPixel.data(), extents[1][1][4]}, vuk::Format::eR8G8B8A8Srgb);
+	blank_upload.as_released(lib::vuk::Access::eComputeSampled).wait(gpu.get_global_allocator(), compiler);
+	image = move(blank_image);
 
 	INFO_AS(cat, "Renderer initialized");
 }
@@ -412,20 +463,22 @@ auto Renderer::prepare_text(TextStyle style, string_view text, optional<float> m
 	return text_shaper.shape(style_id, text, max_width.transform([&](auto w) { return w * TextShaper::PixelsPerEm; }));
 }
 
-auto Renderer::create_queue() -> Queue
+void Renderer::reset_queue()
 {
 	auto const transform = generate_transform(gpu.get_window().size(), gpu.get_window().scale());
 	auto const inverse_transform = Transform{
 		.offset = transform.offset * float2{-1.0f, -1.0f},
 		.scale = 1.0f / transform.scale,
 	};
-	return Queue{transform, inverse_transform};
+	queue.reset(transform, inverse_transform);
 }
 
-void Renderer::draw_frame(Queue&& queue)
+void Renderer::draw_frame()
 {
-	auto primitives = queue.to_primitive_list();
+	TRACE_ZONE("Draw frame");
+	queue.to_primitive_list(primitives);
 	gpu.frame([&, this](auto& allocator, auto&& target) -> lib::vuk::ManagedImage {
+		TRACE_ZONE("Record GPU work");
 		// Update font atlas if needed
 		auto atlas = lib::vuk::ManagedImage{};
 		if (text_shaper.is_atlas_dirty()) {
@@ -436,13 +489,33 @@ void Renderer::draw_frame(Queue&& queue)
 			atlas = lib::vuk::acquire_ia("atlas", dynamic_atlas.attachment, lib::vuk::Access::eComputeSampled);
 		}
 
+		// Update the image if needed. The texture is only recreated when the image's dimensions
+		// change; otherwise the new pixels are uploaded into it
+		auto image_ia = lib::vuk::ManagedImage{};
+		if (queue.image_source && queue.image_source->changed) {
+			auto const& source = *queue.image_source;
+			auto const pixels = const_multi_array_ref<byte, 3>{source.pixels.data(),
+				extents[source.dimensions.x()][source.dimensions.y()][4]};
+			if (image.attachment.extent.width == static_cast<uint>(source.dimensions.x()) &&
+				image.attachment.extent.height == static_cast<uint>(source.dimensions.y())) {
+				image_ia = lib::vuk::update_texture(allocator, image, pixels, lib::vuk::Access::eComputeSampled);
+			} else {
+				auto [new_image, image_upload] = lib::vuk::create_texture(gpu.get_global_allocator(),
+					pixels, vuk::Format::eR8G8B8A8Srgb);
+				image = move(new_image);
+				image_ia = move(image_upload);
+			}
+		} else {
+			image_ia = lib::vuk::acquire_ia("image", image.attachment, lib::vuk::Access::eComputeSampled);
+		}
+
 		auto next = lib::vuk::clear_image(move(target), {0.0f, 0.0f, 0.0f, 1.0f});
 		if (!primitives.empty()) {
 			auto [primitives_buf, vertices_buf, worklists_buf, worklist_sizes_buf]
 				= generate_worklists(gpu, allocator, primitives, queue.polygon_vertices, queue.transform);
 			next = draw_all(gpu, move(next), move(primitives_buf), move(vertices_buf),
 				move(worklists_buf), move(worklist_sizes_buf), static_atlas.view.get(), move(atlas),
-				subpixel_layout);
+				move(image_ia), subpixel_layout);
 		}
 		return imgui.draw(allocator, move(next));
 	});
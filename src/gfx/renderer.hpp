@@ -10,6 +10,7 @@ or distributed except according to those terms.
 #pragma once
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/tracing.hpp"
 #include "lib/os.hpp"
 #include "dev/window.hpp"
 #include "dev/gpu.hpp"
@@ -81,6 +82,13 @@ public:
 		Cap cap;
 	};
 
+	struct ImageParams {
+		float2 size; // total width and height
+		span<byte const> pixels; // 8-bit RGBA in sRGB, rows top to bottom
+		int2 dimensions; // of the pixel data
+		bool changed; // true if the pixels differ from the previously drawn image
+	};
+
 	struct TextParams {
 		float size = 12.0f; // em-height, in units
 		float line_height = 1.0f; // in size-scaled ems
@@ -89,7 +97,8 @@ public:
 		SansRegular,
 	};
 
-	// An accumulator of primitives to draw.
+	// An accumulator of primitives to draw. Storage is kept between frames, so that
+	// a steady-state frame doesn't allocate.
 	class Queue {
 	public:
 		// Draw a group of several shapes as a compound shape by enqueuing them within
@@ -114,6 +123,9 @@ public:
 		auto polygon(Drawable, span<PolygonVertex const>) -> Queue&;
 		auto polygon(Drawable d, initializer_list<PolygonVertex> vs) -> Queue& { return polygon(d, span{vs}); }
 		auto text(Text const&, Drawable, TextParams) -> Queue&;
+		// The image is multiplied by the fill color. Only one image can be drawn per frame;
+		// its pixel data must stay valid until the frame is drawn.
+		auto image(Drawable, ImageParams) -> Queue&;
 
 	private:
 		friend class Renderer;
@@ -129,20 +141,28 @@ public:
 			int page;
 		};
 
+		struct ImageRect {
+			float2 size;
+		};
+
 		bool inside_group = false;
 		vector<tuple<Drawable, PieParams, int>> pies; // third: group id
 		vector<tuple<Drawable, RectParams, int>> rects; // third: group id
 		vector<tuple<Drawable, PolygonParams, int>> polygons; // third: group id
 		vector<tuple<Drawable, GlyphParams, int>> glyphs; // third: group id
+		vector<tuple<Drawable, ImageRect, int>> images; // third: group id
+		optional<ImageParams> image_source;
 		vector<PolygonVertex> polygon_vertices;
 		mutable vector<pair<int, int>> group_depths; // first: group id (initially equal to index), second: depth
+		mutable vector<int> group_remapping;
 		Transform transform;
 		Transform inv_transform;
 
-		Queue(Transform transform, Transform inv_transform): transform{transform}, inv_transform{inv_transform} {}
+		Queue() = default;
+		void reset(Transform transform, Transform inv_transform);
 		template<typename T>
 		void enqueue_into(vector<tuple<Drawable, T, int>>&, Drawable common, T params);
-		[[nodiscard]] auto to_primitive_list() const -> vector<Primitive>;
+		void to_primitive_list(vector<Primitive>& out) const;
 	};
 
 	// Create a renderer for the given window. Manages the window's GPU context.
@@ -164,10 +184,13 @@ private:
 	TextShaper text_shaper;
 	lib::vuk::Texture static_atlas;
 	lib::vuk::Texture dynamic_atlas;
+	lib::vuk::Texture image;
 	lib::os::SubpixelLayout subpixel_layout;
+	Queue queue;
+	vector<Primitive> primitives;
 
-	auto create_queue() -> Queue;
-	void draw_frame(Queue&&);
+	void reset_queue();
+	void draw_frame();
 };
 
 template<callable<void()> Func>
@@ -183,9 +206,12 @@ inline void Renderer::Queue::group(Func&& func)
 template<callable<void(Renderer::Queue&)> Func>
 void Renderer::frame(Func&& func)
 {
-	auto queue = create_queue();
-	imgui.enqueue([&] { func(queue); });
-	draw_frame(move(queue));
+	reset_queue();
+	imgui.enqueue([&] {
+		TRACE_ZONE("Build frame");
+		func(queue);
+	});
+	draw_frame();
 }
 
 }
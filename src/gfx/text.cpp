@@ -10,6 +10,7 @@ or distributed except according to those terms.
 #include "gfx/text.hpp"
 
 #include "preamble.hpp"
+#include "lib/openssl.hpp"
 #include "lib/bits.hpp"
 #include "lib/icu.hpp"
 #include "preamble/algorithm.hpp"
@@ -20,12 +21,28 @@ TextShaper::TextShaper(Logger::Category cat, int initial_size):
 	cat{cat},
 	ctx{lib::harfbuzz::init()},
 	dynamic_atlas{initial_size}
-{ dynamic_atlas.atlasGenerator().setThreadCount(max(1u, jthread::hardware_concurrency() - 2u)); }
+{
+	dynamic_atlas.atlasGenerator().setThreadCount(max(1u, jthread::hardware_concurrency() - 2u));
+	update_atlas_memory();
+}
 
 void TextShaper::load_font(FontID font_id, vector<byte>&& data, int weight)
 {
 	auto const& font_data = this->font_data.emplace_back(move(data));
-	fonts.emplace(make_pair(font_id, weight), lib::harfbuzz::create_font(ctx, font_data));
+	load_font(font_id, span{font_data}, weight);
+}
+
+void TextShaper::load_font(FontID font_id, span<byte const> data, int weight)
+{
+	fonts.emplace(make_pair(font_id, weight), lib::harfbuzz::create_font(ctx, data));
+	if (has_glyph_cache) font_hashes.emplace(make_pair(font_id, weight), lib::openssl::md5(data));
+}
+
+void TextShaper::set_glyph_cache(lib::msdf::GlyphCache& cache)
+{
+	ASSERT(fonts.empty());
+	lib::msdf::attach_glyph_cache(dynamic_atlas, cache);
+	has_glyph_cache = true;
 }
 
 void TextShaper::define_style(StyleID style_id, initializer_list<FontID> fonts, int weight)
@@ -135,6 +152,7 @@ void TextShaper::deserialize(span<byte const> data)
 	for (auto& [_, value]: atlas_cache) value.first = 0;
 
 	atlas_dirty = true;
+	update_atlas_memory();
 }
 
 auto TextShaper::generate_lines(string_view text, StyleID style_id,
@@ -314,6 +332,7 @@ void TextShaper::cache_glyphs(span<CacheKey const> glyph_keys)
 {
 	auto glyphs = vector<lib::msdf::GlyphGeometry>{};
 	auto keys = vector<CacheKey>{};
+	auto glyph_cache_keys = vector<lib::msdf::GlyphCache::Key>{};
 	glyphs.reserve(glyph_keys.size());
 	keys.reserve(glyph_keys.size());
 
@@ -329,6 +348,8 @@ void TextShaper::cache_glyphs(span<CacheKey const> glyph_keys)
 			if (auto glyph = loader.load_glyph(glyph_idx)) {
 				glyphs.emplace_back(move(*glyph));
 				keys.emplace_back(key);
+				if (has_glyph_cache)
+					glyph_cache_keys.emplace_back(font_hashes.at({font_id, weight}), glyph_idx, PixelsPerEm, DistanceRange);
 			} else {
 				// Failed to load; cache as empty to prevent re-loading attempts
 				atlas_cache.emplace(key, pair{1, lib::msdf::GlyphLayout{}});
@@ -337,14 +358,21 @@ void TextShaper::cache_glyphs(span<CacheKey const> glyph_keys)
 	}
 
 	// Rasterize and pack
-	auto layouts = lib::msdf::add_glyphs(dynamic_atlas, glyphs);
+	auto layouts = lib::msdf::add_glyphs(dynamic_atlas, glyphs, glyph_cache_keys);
 
 	// Update cache
 	for (auto [layout, key]: views::zip(layouts, keys))
 		atlas_cache.emplace(key, pair{1, layout});
 
 	atlas_dirty = true;
+	update_atlas_memory();
 	TRACE_AS(cat, "Rasterized {} glyphs", glyphs.size());
 }
 
+void TextShaper::update_atlas_memory()
+{
+	auto const dynamic_view = lib::msdf::get_atlas_contents(dynamic_atlas);
+	atlas_memory.set(static_cast<ssize_t>(static_atlas.num_elements() + dynamic_view.num_elements()));
+}
+
 }
@@ -11,6 +11,7 @@ or distributed except according to those terms.
 
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/memory.hpp"
 #include "lib/harfbuzz.hpp"
 #include "lib/msdf.hpp"
 
@@ -48,6 +49,14 @@ public:
 	// Add a font file into available fonts at the specified weight.
 	void load_font(FontID, vector<byte>&&, int weight);
 
+	// Add a font file without copying it. The data must outlive the shaper.
+	void load_font(FontID, span<byte const>, int weight);
+
+	// Reuse rasterized glyphs from the cache instead of rasterizing them again, and add newly
+	// rasterized ones to it. Must be called before any fonts are loaded. The cache must outlive
+	// the shaper.
+	void set_glyph_cache(lib::msdf::GlyphCache&);
+
 	// Add a style, which is a font fallback cascade at a specified weight. The fonts must all
 	// have been previously added with that exact weight.
 	void define_style(StyleID, initializer_list<FontID>, int weight = 500);
@@ -90,11 +99,14 @@ private:
 	lib::harfbuzz::Context ctx;
 	vector<vector<byte>> font_data;
 	unordered_map<pair<FontID, int>, lib::harfbuzz::Font> fonts; // key: font id, weight
+	unordered_map<pair<FontID, int>, array<byte, 16>> font_hashes; // Only kept with a glyph cache
 	unordered_map<StyleID, pair<vector<FontID>, int>> styles; // value: font cascade by id, weight
 	multi_array<byte, 3> static_atlas;
 	lib::msdf::MTSDFAtlas dynamic_atlas;
 	unordered_map<CacheKey, pair<ssize_t, lib::msdf::GlyphLayout>> atlas_cache; // value: atlas page (0 = static), glyph layout
 	bool atlas_dirty = true;
+	bool has_glyph_cache = false;
+	MemoryCharge atlas_memory{MemoryTag::TextAtlas};
 
 	using Run = pair<string_view, ssize_t>;
 	auto generate_lines(string_view, StyleID, optional<float> max_width) -> generator<vector<PendingGlyph>>;
@@ -103,6 +115,7 @@ private:
 	auto itemize(string_view, span<FontRef const>) -> generator<Run>;
 	auto itemize(string&&, span<FontRef const>) -> generator<Run> = delete;
 	void cache_glyphs(span<CacheKey const>);
+	void update_atlas_memory();
 };
 
 using Text = TextShaper::Text;
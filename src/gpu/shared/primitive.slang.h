@@ -34,12 +34,18 @@ struct Primitive {
 		int page;
 		int _pad0[2];
 	};
+	struct ImageParams {
+		float2 size;
+		int _pad0[2];
+		int _pad1[4];
+	};
 
 	enum class Type: int {
 		Pie,
 		Rect,
 		Polygon,
 		Glyph,
+		Image, // Rect filled with the frame's image, multiplied by the fill color
 	};
 	Type type;
 	int group_id;
@@ -60,6 +66,7 @@ struct Primitive {
 		RectParams rect_params;
 		PolygonParams polygon_params;
 		GlyphParams glyph_params;
+		ImageParams image_params;
 	};
 #endif
 };
@@ -12,6 +12,7 @@ except according to those terms.
 #include "utils/broadcaster.hpp"
 #include "utils/config.hpp"
 #include "utils/logger.hpp"
+#include "utils/alloc_audit.hpp"
 #include "lib/os.hpp"
 #include "dev/controller.hpp"
 #include "dev/window.hpp"
@@ -21,7 +22,10 @@ namespace playnote {
 static void run_input(Broadcaster& broadcaster, dev::Window& window, Logger::Category cat)
 {
 	// Register input handlers
+	// Reserved up front, so that registering a queue mid-gameplay doesn't allocate
+	static constexpr auto MaxInputQueues = 8z;
 	auto input_queues = vector<shared_ptr<spsc_queue<UserInput>>>{};
+	input_queues.reserve(MaxInputQueues);
 	window.register_key_callback([&](dev::Window::KeyCode keycode, bool state) {
 		for (auto& queue: input_queues) {
 			queue->enqueue(KeyInput{
@@ -37,16 +41,19 @@ static void run_input(Broadcaster& broadcaster, dev::Window& window, Logger::Cat
 		TRACE_AS(cat, "{} path(s) dropped:", event.paths.size());
 		for (auto const& path: event.paths) TRACE_AS(cat, "  {}", path);
 		broadcaster.shout(move(event));
+		// Copying the paths allocates by necessity, and a drop is a one-off user action rather
+		// than part of the steady state
+		ALLOC_AUDIT_RESET();
 	});
 	auto con_dispatcher = dev::ControllerDispatcher{cat};
 
 	while (!window.is_closing()) {
 		// Handle queue changes
-		for (auto q: broadcaster.receive_all<RegisterInputQueue>()) {
+		broadcaster.receive_all<RegisterInputQueue>([&](auto&& q) {
 			input_queues.emplace_back(q.queue.lock());
 			TRACE_AS(cat, "Registered input queue");
-		}
-		for (auto q: broadcaster.receive_all<UnregisterInputQueue>()) {
+		});
+		broadcaster.receive_all<UnregisterInputQueue>([&](auto&& q) {
 			auto queue = q.queue.lock();
 			auto it = find(input_queues, queue);
 			if (it != input_queues.end()) {
@@ -55,17 +62,18 @@ static void run_input(Broadcaster& broadcaster, dev::Window& window, Logger::Cat
 			} else {
 				WARN_AS(cat, "Attempted to unregister input queue that was not registered");
 			}
-		}
+		});
 
 		// Poll and handle input events
 		globals::glfw->poll();
-		for (auto event: con_dispatcher.poll()) {
-			visit([&](auto&& e) {
+		for (auto const& event: con_dispatcher.poll()) {
+			visit([&](auto const& e) {
 				for (auto& queue: input_queues) {
-					queue->enqueue(move(e));
+					queue->enqueue(e);
 				}
 			}, event);
 		}
+		ALLOC_AUDIT_FRAME("Input");
 		yield();
 	}
 }
@@ -74,8 +82,8 @@ void input_thread(Broadcaster& broadcaster, Barriers<2>& barriers, dev::Window&
 try {
 	lib::os::name_current_thread("input");
 	broadcaster.register_as_endpoint();
-	broadcaster.subscribe<RegisterInputQueue>();
-	broadcaster.subscribe<UnregisterInputQueue>();
+	broadcaster.subscribe<RegisterInputQueue>(Broadcaster::DefaultChannelCapacity, Broadcaster::Overflow::Grow);
+	broadcaster.subscribe<UnregisterInputQueue>(Broadcaster::DefaultChannelCapacity, Broadcaster::Overflow::Grow);
 	barriers.startup.arrive_and_wait();
 	auto input_log_level = globals::config->get_entry<string>("logging", "input");
 	auto cat = globals::logger->create_category("Input", *enum_cast<Logger::Level>(input_log_level).or_else(
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "io/audio_store.hpp"
+
+#include "preamble.hpp"
+#include "utils/tracing.hpp"
+
+namespace playnote::io {
+
+AudioStore::AudioStore(fs::path dir, string temp_tag):
+	dir{move(dir)},
+	temp_tag{move(temp_tag)}
+{ fs::create_directories(this->dir); }
+
+auto AudioStore::contains(Hash const& hash) -> bool
+{
+	auto ec = std::error_code{};
+	fs::last_write_time(path_of(hash), fs::file_time_type::clock::now(), ec);
+	auto const found = !ec;
+	(found? hits : misses).fetch_add(1);
+	return found;
+}
+
+void AudioStore::insert(Hash const& hash, span<byte const> contents)
+{
+	// Written under a temporary name and renamed, so that the file is never seen half-written
+	auto const path = path_of(hash);
+	auto temp_path = path;
+	temp_path.concat(format(".{}{}.tmp", temp_tag, next_temp.fetch_add(1)));
+	auto deleter = FileDeleter{temp_path};
+	write_file(temp_path, contents);
+	fs::rename(temp_path, path);
+	deleter.disarm();
+}
+
+auto AudioStore::open(Hash const& hash) const -> ReadFile
+{ return read_file(path_of(hash)); }
+
+auto AudioStore::collect_garbage(unordered_set<Hash> const& referenced) -> ssize_t
+{
+	TRACE_ZONE("Collect audio garbage");
+	auto const cutoff = fs::file_time_type::clock::now() - GarbageGracePeriod;
+	auto deleted = 0z;
+	for (auto const& entry: fs::directory_iterator{dir}) {
+		auto ec = std::error_code{};
+		if (!entry.is_regular_file(ec)) continue;
+		// Recent files could belong to an import that hasn't committed yet, or still be
+		// written by one under a temp name
+		auto const mtime = entry.last_write_time(ec);
+		if (ec || mtime > cutoff) continue;
+		auto const& path = entry.path();
+		auto keep = false;
+		if (path.extension() == ".ogg") {
+			auto const hash = lib::openssl::sha256_from_hex(path.stem().string());
+			keep = hash && referenced.contains(*hash);
+		}
+		if (keep) continue;
+		// Another process could be collecting at the same time
+		if (fs::remove(path, ec)) deleted += 1;
+	}
+	return deleted;
+}
+
+void AudioStore::add_stats(ssize_t hits, ssize_t misses)
+{
+	this->hits.fetch_add(hits);
+	this->misses.fetch_add(misses);
+}
+
+void AudioStore::reset_stats()
+{
+	hits.store(0);
+	misses.store(0);
+}
+
+auto AudioStore::path_of(Hash const& hash) const -> fs::path
+{ return dir / format("{}.ogg", lib::openssl::sha256_to_hex(hash)); }
+
+}
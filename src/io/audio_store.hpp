@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "lib/openssl.hpp"
+#include "io/file.hpp"
+
+namespace playnote::io {
+
+// Extension of songzip entries that stand in for a file held by an AudioStore. The entry contains
+// the file's hash in hex.
+static constexpr auto StoreReferenceExtension = ".ref"sv;
+
+// A directory of transcoded audio files, each held once and named by the hash of the source file
+// it was transcoded from. Songs that ship the same keysounds share a single copy, and the source
+// doesn't need to be transcoded again. Thread-safe.
+class AudioStore {
+public:
+	using Hash = lib::openssl::SHA256;
+
+	// Open the store at the provided directory, creating it if needed. Processes that share a store
+	// must each use a different temp_tag, which keeps their half-written files apart.
+	explicit AudioStore(fs::path dir, string temp_tag = {});
+
+	// Return the hash that identifies a source file.
+	[[nodiscard]] static auto hash(span<byte const> source) -> Hash { return lib::openssl::sha256(source); }
+
+	// Return true if the store holds the file transcoded from the source with this hash.
+	// A file that's found is refreshed, so that garbage collection leaves it alone while the song
+	// reusing it gets committed. Counts as a hit or a miss for the statistics.
+	[[nodiscard]] auto contains(Hash const&) -> bool;
+
+	// Add a transcoded file. Adding a file that's already present is harmless.
+	void insert(Hash const&, span<byte const> contents);
+
+	// Map a stored file into memory.
+	// Throws runtime_error if the file is not in the store.
+	[[nodiscard]] auto open(Hash const&) const -> ReadFile;
+
+	// Delete all stored files whose hash is not in the provided set, and return how many were
+	// deleted. Imports in this or any other process insert files before they're referenced,
+	// so only files that weren't written or reused within the grace period are deleted.
+	auto collect_garbage(unordered_set<Hash> const& referenced) -> ssize_t;
+
+	// How long a file is kept regardless of its references.
+	static constexpr auto GarbageGracePeriod = std::chrono::hours{24};
+
+	// Return the number of contains() calls that found the file.
+	[[nodiscard]] auto get_hits() const -> ssize_t { return hits.load(); }
+
+	// Return the number of contains() calls that didn't find the file.
+	[[nodiscard]] auto get_misses() const -> ssize_t { return misses.load(); }
+
+	// Add hits and misses counted by another instance, such as one in an import worker process.
+	void add_stats(ssize_t hits, ssize_t misses);
+
+	// Set the statistics to zero.
+	void reset_stats();
+
+	// Return the directory the store is in.
+	[[nodiscard]] auto get_path() const -> fs::path const& { return dir; }
+
+	AudioStore(AudioStore const&) = delete;
+	auto operator=(AudioStore const&) -> AudioStore& = delete;
+	AudioStore(AudioStore&&) = delete;
+	auto operator=(AudioStore&&) -> AudioStore& = delete;
+
+private:
+	fs::path dir;
+	string temp_tag;
+	atomic<ssize_t> hits = 0;
+	atomic<ssize_t> misses = 0;
+	atomic<ssize_t> next_temp = 0; // Keeps concurrent inserts of the same file apart
+
+	[[nodiscard]] auto path_of(Hash const&) const -> fs::path;
+};
+
+}
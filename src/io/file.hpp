@@ -21,6 +21,12 @@ static constexpr auto BMSExtensions = {
 static constexpr auto AudioExtensions = {
 	".wav"sv, ".mp3"sv, ".ogg"sv, ".flac"sv, ".wma"sv, ".m4a"sv, ".opus"sv, ".aac"sv, ".aiff"sv, ".aif"sv
 };
+static constexpr auto ImageExtensions = {
+	".bmp"sv, ".png"sv, ".jpg"sv, ".jpeg"sv, ".gif"sv
+};
+static constexpr auto VideoExtensions = {
+	".mpg"sv, ".mpeg"sv, ".avi"sv, ".wmv"sv, ".mp4"sv, ".m4v"sv, ".webm"sv, ".mkv"sv, ".flv"sv
+};
 static constexpr auto WastefulAudioExtensions = {
 	".wav"sv, ".aiff"sv, ".aif"sv
 };
@@ -11,38 +11,60 @@ or distributed except according to those terms.
 
 #include "preamble.hpp"
 #include "utils/task_pool.hpp"
+#include "utils/tracing.hpp"
 #include "lib/archive.hpp"
 #include "lib/ffmpeg.hpp"
 
 namespace playnote::io {
 
-static auto optimize_audio(Logger::Category cat, fs::path path, vector<byte> data) -> task<pair<fs::path, vector<byte>>>
+// Transcode an audio file to a more compact format. With a store, the result is kept there and
+// replaced with a reference, and files the store already holds are not transcoded at all.
+static auto optimize_audio(Logger::Category cat, fs::path path, vector<byte> data,
+	AudioStore* store, CancelToken cancel) -> task<pair<fs::path, tracked_vector<byte>>>
 {
+	TRACE_ZONE("Optimize audio");
+	auto const hash = store? optional{AudioStore::hash(data)} : nullopt;
+	auto const reference = [&] {
+		auto const hex = lib::openssl::sha256_to_hex(*hash);
+		path.replace_extension(StoreReferenceExtension);
+		auto const bytes = std::as_bytes(span{hex});
+		return make_pair(move(path), tracked_vector<byte>{bytes.begin(), bytes.end(), TrackedAllocator<byte>{MemoryTag::ImportStaging}});
+	};
+	if (store && store->contains(*hash)) co_return reference();
+
 	lib::ffmpeg::set_thread_log_category(cat);
-	data = lib::ffmpeg::encode_as_ogg(lib::ffmpeg::decode_and_resample_file_buffer(data, 48000), 48000);
+	auto const decoded = lib::ffmpeg::decode_and_resample_file_buffer(data, 48000, MemoryTag::ImportStaging, cancel);
+	auto encoded = lib::ffmpeg::encode_as_ogg(decoded, 48000, MemoryTag::ImportStaging, cancel);
+	if (store) {
+		store->insert(*hash, encoded);
+		co_return reference();
+	}
 	path.replace_extension(".ogg");
-	co_return make_pair(move(path), move(data));
+	co_return make_pair(move(path), move(encoded));
 }
 
 template<callable<bool(fs::path const&)> Func>
-auto optimize_files(Logger::Category cat, unique_ptr<thread_pool>& pool, Source const& src,
-	Func&& filter) -> task<unordered_map<fs::path, pair<fs::path, vector<byte>>>>
+auto optimize_files(Logger::Category cat, Scheduler& scheduler, Source const& src,
+	Func&& filter, AudioStore* store, CancelToken cancel) -> task<unordered_map<fs::path, pair<fs::path, tracked_vector<byte>>>>
 {
 	// when_all requires an ordered container
-	auto optimize_tasks = vector<task<pair<fs::path, vector<byte>>>>{};
+	auto optimize_tasks = vector<task<pair<fs::path, tracked_vector<byte>>>>{};
 	auto optimized_paths = vector<fs::path>{};
+	auto source_bytes = MemoryCharge{MemoryTag::ImportStaging}; // Held by the tasks until they finish
 	for (auto&& ref: src.for_each_file()) {
 		auto path = ref.get_path();
 		if (!filter(path)) continue;
 		if (!has_extension(path, WastefulAudioExtensions)) continue;
 		auto data = ref.read_owned();
+		source_bytes.add(static_cast<ssize_t>(data.size()));
 		optimized_paths.emplace_back(path);
-		optimize_tasks.emplace_back(schedule_task_on(pool, optimize_audio(cat, move(path), move(data))));
+		optimize_tasks.emplace_back(schedule_task_on(scheduler, optimize_audio(cat, move(path), move(data), store, cancel)));
 	}
 	auto optimize_results = co_await when_all(move(optimize_tasks));
+	cancel.check(); // Otherwise cancelled files would be reported as failed optimizations
 
 	// Convert results to a hashmap for faster lookup
-	auto optimized_files = unordered_map<fs::path, pair<fs::path, vector<byte>>>{};
+	auto optimized_files = unordered_map<fs::path, pair<fs::path, tracked_vector<byte>>>{};
 	for (auto [result, path]: views::zip(optimize_results, optimized_paths)) {
 		try {
 			auto [opt_path, opt_data] = result.return_value();
@@ -58,16 +80,20 @@ enum class FileType {
 	Unknown, // 0
 	BMS,     // 1
 	Audio,   // 2
+	Image,   // 3
+	Video,   // 4
 };
 
 static auto type_from_path(fs::path const& path) -> FileType
 {
 	if (has_extension(path, BMSExtensions)) return FileType::BMS;
 	if (has_extension(path, AudioExtensions)) return FileType::Audio;
+	if (has_extension(path, ImageExtensions)) return FileType::Image;
+	if (has_extension(path, VideoExtensions)) return FileType::Video;
 	return FileType::Unknown;
 }
 
-Song::Song(Logger::Category cat, ReadFile&& file):
+Song::Song(Logger::Category cat, ReadFile&& file, AudioStore* store):
 	cat{cat},
 	file{move(file)},
 	db{lib::sqlite::open(":memory:")}
@@ -83,20 +109,40 @@ Song::Song(Logger::Category cat, ReadFile&& file):
 		auto const data = lib::archive::read_data_block(archive);
 		if (!data) continue;
 		auto path = fs::path{filepath};
+		if (path.extension() == StoreReferenceExtension) {
+			auto const hex = string_view{reinterpret_cast<char const*>(data->data()), data->size()};
+			auto const hash = lib::openssl::sha256_from_hex(hex);
+			if (!store || !hash) {
+				WARN_AS(cat, "Audio file \"{}\" is held in an audio store that's not available", filepath);
+				continue;
+			}
+			try {
+				auto const& stored = store_files.emplace_back(store->open(*hash));
+				store_references.emplace_back(*hash);
+				path.replace_extension();
+				lib::sqlite::execute(insert_contents, path.string(), +FileType::Audio,
+					static_cast<void const*>(stored.contents.data()), stored.contents.size());
+			} catch (exception const& e) {
+				WARN_AS(cat, "Failed to open audio file \"{}\" from the audio store: {}", filepath, e.what());
+			}
+			continue;
+		}
 		auto const type = type_from_path(path);
-		if (has_extension(path, AudioExtensions)) path.replace_extension();
+		if (type == FileType::Audio || type == FileType::Image || type == FileType::Video) path.replace_extension();
 		lib::sqlite::execute(insert_contents, path.string(), +type, static_cast<void const*>(data->data()), data->size());
 	}
 }
 
-auto Song::from_source(Logger::Category cat, unique_ptr<thread_pool>& pool,
-	Source const& src, fs::path const& dst) -> task<Song>
+auto Song::from_source(Logger::Category cat, Scheduler& scheduler,
+	Source const& src, fs::path const& dst, CancelToken cancel, AudioStore* store) -> task<Song>
 {
+	TRACE_ASYNC_SPAN("Write songzip");
 	auto ar = lib::archive::open_write(dst);
-	auto optimized_files = co_await optimize_files(cat, pool, src, [](auto const&) { return true; });
+	auto optimized_files = co_await optimize_files(cat, scheduler, src, [](auto const&) { return true; }, store, cancel);
 
 	auto wrote_something = false;
 	for (auto&& ref: src.for_each_file()) {
+		cancel.check();
 		auto path = ref.get_path();
 		auto optimized = optimized_files.find(path);
 		if (optimized != optimized_files.end()) {
@@ -113,12 +159,13 @@ auto Song::from_source(Logger::Category cat, unique_ptr<thread_pool>& pool,
 	if (!wrote_something)
 		throw runtime_error_fmt("Failed to create library zip from \"{}\": empty archive", src.get_path());
 	ar.reset(); // Finalize archive
-	co_return Song{cat, read_file(dst)};
+	co_return Song{cat, read_file(dst), store};
 }
 
-auto Song::from_source_append(Logger::Category cat, unique_ptr<thread_pool>& pool,
-	ReadFile&& src, Source const& ext, fs::path const& dst) -> task<Song>
+auto Song::from_source_append(Logger::Category cat, Scheduler& scheduler,
+	ReadFile&& src, Source const& ext, fs::path const& dst, CancelToken cancel, AudioStore* store) -> task<Song>
 {
+	TRACE_ASYNC_SPAN("Extend songzip");
 	auto ar = lib::archive::open_write(dst);
 	auto written_paths = unordered_set<string>{};
 
@@ -126,17 +173,18 @@ auto Song::from_source_append(Logger::Category cat, unique_ptr<thread_pool>& poo
 	// (We can't just copy the file, because libarchive doesn't support append)
 	auto src_ar = lib::archive::open_read(src.contents);
 	for (auto pathname: lib::archive::for_each_entry(src_ar)) {
-		auto data = lib::archive::read_data(src_ar);
+		auto data = lib::archive::read_data(src_ar, cancel);
 		lib::archive::write_entry(ar, pathname, data);
 		written_paths.emplace(pathname);
 	}
 
-	auto optimized_files = co_await optimize_files(cat, pool, ext, [&](auto const& path) {
+	auto optimized_files = co_await optimize_files(cat, scheduler, ext, [&](auto const& path) {
 		return !written_paths.contains(path.string());
-	});
+	}, store, cancel);
 
 	// Append missing files
 	for (auto&& ref: ext.for_each_file()) {
+		cancel.check();
 		auto path = ref.get_path();
 		if (written_paths.contains(path.string())) continue;
 		auto optimized = optimized_files.find(path);
@@ -150,7 +198,7 @@ auto Song::from_source_append(Logger::Category cat, unique_ptr<thread_pool>& poo
 	}
 
 	ar.reset(); // Finalize archive
-	co_return Song{cat, read_file(dst)};
+	co_return Song{cat, read_file(dst), store};
 }
 
 auto Song::for_each_chart() -> generator<tuple<string_view, span<byte const>>>
@@ -171,40 +219,42 @@ auto Song::load_file(string_view filepath) -> span<byte const>
 	return file;
 }
 
-auto Song::preload_audio_files(unique_ptr<thread_pool>& pool, int sampling_rate) -> task<>
+auto Song::preload_audio_files(Scheduler& scheduler, int sampling_rate, CancelToken cancel) -> task<>
 {
-	auto tasks = vector<task<vector<dev::Sample>>>{};
+	auto tasks = vector<task<tracked_vector<dev::Sample>>>{};
 	auto paths = vector<string>{};
 	for (auto [filepath, ptr, size]: lib::sqlite::query(select_audio_files)) {
 		// Normally the db collation handles case-insensitive lookup for us, but we need to do it manually for the cache
 		auto filepath_low = string{filepath};
 		to_lower(filepath_low);
 		auto file = span{static_cast<byte const*>(ptr), static_cast<size_t>(size)};
-		tasks.emplace_back(schedule_task_on(pool, [](Logger::Category cat, span<byte const> file, ssize_t sampling_rate) -> task<vector<dev::Sample>> {
+		tasks.emplace_back(schedule_task_on(scheduler, [](Logger::Category cat, span<byte const> file, ssize_t sampling_rate, CancelToken cancel) -> task<tracked_vector<dev::Sample>> {
+			TRACE_ZONE("Decode audio");
 			lib::ffmpeg::set_thread_log_category(cat);
-			co_return lib::ffmpeg::decode_and_resample_file_buffer(file, sampling_rate);
-		}(cat, file, sampling_rate)));
+			co_return lib::ffmpeg::decode_and_resample_file_buffer(file, sampling_rate, MemoryTag::AudioCache, cancel);
+		}(cat, file, sampling_rate, cancel)));
 		paths.emplace_back(move(filepath_low));
 	}
 
 	auto results = co_await when_all(move(tasks));
+	cancel.check();
 	for (auto [result, path]: views::zip(results, paths)) {
 		try {
-			audio_cache.emplace(path, move(result.return_value()));
+			audio_cache.emplace(path, make_shared<tracked_vector<dev::Sample> const>(move(result.return_value())));
 		} catch (exception const& e) {
 			WARN_AS(cat, "Failed to preload \"{}\": {}", path, e.what());
 		}
 	}
 }
 
-auto Song::load_audio_file(string_view filepath, int sampling_rate) -> vector<dev::Sample>
+auto Song::load_audio_file(string_view filepath, int sampling_rate, MemoryTag tag,
+	CancelToken const& cancel) -> shared_ptr<tracked_vector<dev::Sample> const>
 {
 	if (!audio_cache.empty()) {
 		auto filepath_low = string{filepath};
 		to_lower(filepath_low);
 		auto it = audio_cache.find(filepath_low);
-		if (it != audio_cache.end())
-			return it->second;
+		if (it != audio_cache.end()) return it->second;
 	}
 
 	auto file = span<byte const>{};
@@ -216,7 +266,17 @@ auto Song::load_audio_file(string_view filepath, int sampling_rate) -> vector<de
 	if (!file.data())
 		throw runtime_error_fmt("Audio file \"{}\" doesn't exist within the song archive", filepath);
 	lib::ffmpeg::set_thread_log_category(cat);
-	return lib::ffmpeg::decode_and_resample_file_buffer(file, sampling_rate);
+	return make_shared<tracked_vector<dev::Sample> const>(lib::ffmpeg::decode_and_resample_file_buffer(file, sampling_rate, tag, cancel));
+}
+
+auto Song::load_bga_file(string_view filepath) -> pair<BGAType, span<byte const>>
+{
+	auto select_bga_file = lib::sqlite::prepare<SelectBGAFile>(this->db);
+	for (auto [type, ptr, size]: lib::sqlite::query(select_bga_file, filepath)) {
+		auto const bga_type = type == +FileType::Image? BGAType::Image : BGAType::Video;
+		return {bga_type, span{static_cast<byte const*>(ptr), static_cast<size_t>(size)}};
+	}
+	throw runtime_error_fmt("BGA file \"{}\" doesn't exist within the song archive", filepath);
 }
 
 void Song::remove() && noexcept
@@ -9,26 +9,35 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/scheduler.hpp"
+#include "utils/cancel.hpp"
+#include "utils/memory.hpp"
 #include "lib/sqlite.hpp"
 #include "dev/audio.hpp"
 #include "io/source.hpp"
 #include "io/file.hpp"
+#include "io/audio_store.hpp"
 
 namespace playnote::io {
 
 // An archive optimized for file lookup and zero-copy access. Once opened, the contents are immutable.
 class Song {
 public:
-	// Create from an existing songzip.
-	explicit Song(Logger::Category, ReadFile&&);
+	// Create from an existing songzip. Audio files held in an AudioStore are opened from the provided
+	// store; without one, they are treated as missing.
+	explicit Song(Logger::Category, ReadFile&&, AudioStore* = nullptr);
 
-	// Convert from a Source.
-	static auto from_source(Logger::Category, unique_ptr<thread_pool>&,
-		Source const&, fs::path const& dst) -> task<Song>;
+	// Convert from a Source. On cancellation, throws cancelled_error and leaves a partial file
+	// at dst for the caller to clean up. With an AudioStore, transcoded audio is kept in the store
+	// and only referenced by the songzip, and audio the store already holds isn't transcoded again.
+	static auto from_source(Logger::Category, Scheduler&,
+		Source const&, fs::path const& dst, CancelToken = {}, AudioStore* = nullptr) -> task<Song>;
 
-	// Convert from a Source, using an existing songzip as base.
-	static auto from_source_append(Logger::Category, unique_ptr<thread_pool>&,
-		ReadFile&& src, Source const& ext, fs::path const& dst) -> task<Song>;
+	// Convert from a Source, using an existing songzip as base. Cancellation and the AudioStore
+	// behave as in from_source().
+	static auto from_source_append(Logger::Category, Scheduler&,
+		ReadFile&& src, Source const& ext, fs::path const& dst, CancelToken = {},
+		AudioStore* = nullptr) -> task<Song>;
 
 	// Return all charts of the song.
 	auto for_each_chart() -> generator<tuple<string_view, span<byte const>>>;
@@ -38,10 +47,27 @@ public:
 
 	// Preload all audio files to an internal cache. This cache will be used in any later load_audio_file() calls.
 	// The loads are performed in parallel. Useful when loading multiple charts of the same song.
-	auto preload_audio_files(unique_ptr<thread_pool>&, int sampling_rate) -> task<>;
+	auto preload_audio_files(Scheduler&, int sampling_rate, CancelToken = {}) -> task<>;
 
 	// Load the requested audio file, decode it, and resample to current device sample rate.
-	auto load_audio_file(string_view filepath, int sampling_rate) -> vector<dev::Sample>;
+	// A preloaded file is shared with the cache, and stays charged to AudioCache; otherwise,
+	// the result is charged to the provided subsystem.
+	auto load_audio_file(string_view filepath, int sampling_rate, MemoryTag = MemoryTag::Other,
+		CancelToken const& = {}) -> shared_ptr<tracked_vector<dev::Sample> const>;
+
+	enum class BGAType {
+		Image,
+		Video,
+	};
+
+	// Find the requested BGA file. Like audio files, BGA files are matched regardless of their
+	// extension, since charts often reference a different format than the one that was shipped.
+	// Images are preferred if both kinds share the name.
+	// Throws runtime_error if the file doesn't exist.
+	auto load_bga_file(string_view filepath) -> pair<BGAType, span<byte const>>;
+
+	// Return the hashes of all AudioStore files that the song refers to.
+	[[nodiscard]] auto get_store_references() const -> span<AudioStore::Hash const> { return store_references; }
 
 	// Destroy the song and delete the underlying songzip from disk.
 	void remove() && noexcept;
@@ -83,6 +109,13 @@ private:
 		using Params = tuple<string_view>;
 		using Row = tuple<void const*, ssize_t>;
 	};
+	struct SelectBGAFile {
+		static constexpr auto Query = R"sql(
+			SELECT type, ptr, size FROM contents WHERE type IN (3, 4) AND path = ?1 ORDER BY type
+		)sql"sv;
+		using Params = tuple<string_view>;
+		using Row = tuple<int, void const*, ssize_t>;
+	};
 	struct SelectAudioFiles {
 		static constexpr auto Query = R"sql(
 			SELECT path, ptr, size FROM contents WHERE type = 2
@@ -92,11 +125,13 @@ private:
 
 	Logger::Category cat;
 	ReadFile file;
+	vector<ReadFile> store_files; // Mappings of the AudioStore files the song refers to
+	vector<AudioStore::Hash> store_references;
 	lib::sqlite::DB db;
 	lib::sqlite::Statement<SelectCharts> select_charts;
 	lib::sqlite::Statement<SelectFile> select_file;
 	lib::sqlite::Statement<SelectAudioFiles> select_audio_files;
-	unordered_map<string, vector<dev::Sample>, string_hash> audio_cache;
+	unordered_map<string, shared_ptr<tracked_vector<dev::Sample> const>, string_hash> audio_cache;
 };
 
 }
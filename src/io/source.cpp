@@ -23,7 +23,7 @@ auto Source::FileReference::read() -> span<byte const>
 			result = e.file->contents;
 		},
 		[&](ArchiveEntry& e) {
-			if (!e.contents) e.contents = lib::archive::read_data(e.archive);
+			if (!e.contents) e.contents = lib::archive::read_data(e.archive, e.cancel);
 			result = *e.contents;
 		}
 	}, entry);
@@ -39,8 +39,9 @@ auto Source::FileReference::read_owned() -> vector<byte>
 	}, entry);
 }
 
-Source::Source(fs::path const& path):
-	path{path}
+Source::Source(fs::path const& path, CancelToken cancel):
+	path{path},
+	cancel{move(cancel)}
 {
 	if (!fs::exists(path)) throw runtime_error_fmt("Path does not exist: {}", path.string());
 	if (fs::is_regular_file(path)) {
@@ -84,14 +85,16 @@ auto Source::for_each_file() const -> generator<FileReference> {
 	if (archive) {
 		auto ar = lib::archive::open_read(archive->file.contents);
 		for (auto pathname: lib::archive::for_each_entry(ar)) {
+			cancel.check();
 			auto const pathname_bytes = span{reinterpret_cast<byte const*>(pathname.data()), pathname.size()};
 			auto const pathname_utf8 = lib::icu::to_utf8(pathname_bytes, archive->encoding);
 			auto rel_path = fs::relative(pathname_utf8, archive->prefix);
 			if (!rel_path.empty() && *rel_path.begin() == "..") continue;
-			co_yield FileReference(rel_path, FileReference::ArchiveEntry{ar});
+			co_yield FileReference(rel_path, FileReference::ArchiveEntry{ar, cancel});
 		}
 	} else {
 		for (auto const& entry: fs::recursive_directory_iterator{path}) {
+			cancel.check();
 			if (!entry.is_regular_file()) continue;
 			auto rel_path = fs::relative(entry.path(), path);
 			co_yield FileReference(rel_path, FileReference::DirEntry{entry});
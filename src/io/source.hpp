@@ -9,6 +9,7 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/cancel.hpp"
 #include "lib/archive.hpp"
 #include "io/file.hpp"
 
@@ -38,6 +39,7 @@ public:
 		};
 		struct ArchiveEntry {
 			lib::archive::ReadArchive& archive;
+			CancelToken const& cancel;
 			optional<vector<byte>> contents;
 		};
 		fs::path path;
@@ -48,7 +50,8 @@ public:
 	};
 
 	// Construct from path. Will throw if the path doesn't contain at least one BMS file inside.
-	Source(fs::path const&);
+	// Iteration and reads will throw cancelled_error once the token is cancelled.
+	Source(fs::path const&, CancelToken = {});
 
 	auto get_path() const -> fs::path const& { return path; }
 
@@ -65,6 +68,7 @@ private:
 	};
 	fs::path path;
 	optional<ArchiveDetails> archive;
+	CancelToken cancel;
 };
 
 }
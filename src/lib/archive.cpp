@@ -43,11 +43,18 @@ void detail::ReadArchiveDeleter::operator()(::archive* ar) noexcept
 	archive_read_free(ar);
 }
 
-auto open_write(fs::path const& path) -> WriteArchive
+auto open_write(fs::path const& path, ArchiveFormat format) -> WriteArchive
 {
 	auto archive = archive_write_new();
-	archive_write_set_format_zip(archive);
-	archive_write_zip_set_compression_store(archive);
+	switch (format) {
+	case ArchiveFormat::Zip:
+		archive_write_set_format_zip(archive);
+		archive_write_zip_set_compression_store(archive);
+		break;
+	case ArchiveFormat::SevenZip:
+		archive_write_set_format_7zip(archive);
+		break;
+	}
 	auto const ret = archive_write_open_filename(archive, path.string().c_str());
 	auto result = WriteArchive{archive};
 	ret_check(ret, result);
@@ -71,13 +78,14 @@ auto for_each_entry(ReadArchive& archive) -> generator<string_view>
 	}
 }
 
-auto read_data(ReadArchive& archive) -> vector<byte>
+auto read_data(ReadArchive& archive, CancelToken const& cancel) -> vector<byte>
 {
 	auto result = vector<byte>{};
 	auto* buf = static_cast<byte const*>(nullptr);
 	auto size = 0zu;
 	auto offset = 0z;
 	while (true) {
+		cancel.check();
 		auto const ret = archive_read_data_block(archive.get(), reinterpret_cast<void const**>(&buf),
 			&size, &offset);
 		if (ret == ARCHIVE_EOF) break;
@@ -9,6 +9,7 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/cancel.hpp"
 
 // Forward declarations
 
@@ -32,15 +33,22 @@ using WriteArchive = unique_resource<::archive*, detail::WriteArchiveDeleter>;
 // Open an archive for reading.
 auto open_read(span<byte const>) -> ReadArchive;
 
+// Container format of an archive being written.
+enum class ArchiveFormat {
+	Zip, // Uncompressed
+	SevenZip, // LZMA2
+};
+
 // Open an archive for writing.
-auto open_write(fs::path const&) -> WriteArchive;
+auto open_write(fs::path const&, ArchiveFormat = ArchiveFormat::Zip) -> WriteArchive;
 
 // Return every entry in the archive. You can optionally call read_data() or read_data_block()
 // to retrieve the entry's contents.
 auto for_each_entry(ReadArchive&) -> generator<string_view>;
 
 // Read the contents of the current entry. To be used from within a for_each_entry() callback.
-auto read_data(ReadArchive&) -> vector<byte>;
+// Throws cancelled_error if the token is cancelled between blocks.
+auto read_data(ReadArchive&, CancelToken const& = {}) -> vector<byte>;
 
 // Read a block of the current entry's contents. To be used from within a for_each_entry() callback.
 // If entry is uncompressed, the block is guaranteed to be the size of the entire entry.  If EOF
@@ -9,6 +9,7 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/assert.hpp"
 
 namespace playnote::lib {
 
@@ -34,6 +35,24 @@ struct AudioProperties {
 	int buffer_size;
 };
 
+// Convert a count of samples to their duration.
+inline auto samples_to_ns(ssize_t samples, int sampling_rate) -> nanoseconds
+{
+	ASSERT(sampling_rate > 0);
+	auto const ns_per_sample = duration_cast<nanoseconds>(duration<double>{1.0 / sampling_rate});
+	auto const whole_seconds = samples / sampling_rate;
+	auto const remainder = samples % sampling_rate;
+	return 1s * whole_seconds + ns_per_sample * remainder;
+}
+
+// Convert a duration to a number of full audio samples.
+inline auto ns_to_samples(nanoseconds ns, int sampling_rate) -> ssize_t
+{
+	ASSERT(sampling_rate > 0);
+	auto const ns_per_sample = duration_cast<nanoseconds>(duration<double>{1.0 / sampling_rate});
+	return ns / ns_per_sample;
+}
+
 inline auto audio_latency(AudioProperties const& props) -> nanoseconds
 {
 	return duration_cast<nanoseconds>(
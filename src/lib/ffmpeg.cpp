@@ -11,6 +11,7 @@ or distributed except according to those terms.
 
 extern "C" {
 #include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
 #include <libavformat/version_major.h>
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
@@ -149,7 +150,7 @@ static auto av_io_seek(void* opaque, int64_t offset, int whence) -> int64_t
 	return static_cast<int64_t>(new_cursor);
 }
 
-// The write callback uses a vector<byte> rather than SeekBuffer!
+// The write callback uses a tracked_vector<byte> rather than SeekBuffer!
 // However, there should be no overlap between read and write callbacks.
 #if LIBAVFORMAT_VERSION_MAJOR < 61
 static auto av_io_write(void* opaque, uint8_t* buf, int buf_size) -> int
@@ -157,7 +158,7 @@ static auto av_io_write(void* opaque, uint8_t* buf, int buf_size) -> int
 static auto av_io_write(void* opaque, uint8_t const* buf, int buf_size) -> int
 #endif
 {
-	auto& out_buf = *static_cast<vector<byte>*>(opaque);
+	auto& out_buf = *static_cast<tracked_vector<byte>*>(opaque);
 	auto const* in_buf = reinterpret_cast<byte const*>(buf);
 	out_buf.reserve(out_buf.size() + buf_size);
 	copy(span{in_buf, static_cast<size_t>(buf_size)}, back_inserter(out_buf));
@@ -169,7 +170,7 @@ void set_thread_log_category(Logger::Category new_cat)
 	cat = new_cat;
 }
 
-auto decode_file_buffer(span<byte const> file_contents) -> DecoderOutput
+auto decode_file_buffer(span<byte const> file_contents, CancelToken const& cancel) -> DecoderOutput
 {
 	set_log_callback();
 	auto file_buffer = SeekBuffer{ .buffer = file_contents, .cursor = 0 };
@@ -202,12 +203,12 @@ auto decode_file_buffer(span<byte const> file_contents) -> DecoderOutput
 	codec_ctx->pkt_timebase = stream->time_base; // Fix "Could not update timestamps for discarded samples."
 	ret_check(avcodec_open2(codec_ctx.get(), codec, nullptr));
 
-	auto result = new DecoderOutput_t{
+	auto result = unique_ptr<DecoderOutput_t>{new DecoderOutput_t{
 		.sample_format = codec_ctx->sample_fmt,
 		.sample_rate = codec_ctx->sample_rate,
 		.channel_layout = codec_ctx->ch_layout,
 		.planar = static_cast<bool>(av_sample_fmt_is_planar(codec_ctx->sample_fmt)),
-	};
+	}};
 	auto const planes = result->planar? result->channel_layout.nb_channels : 1u;
 	auto const bytes_per_sample = av_get_bytes_per_sample(codec_ctx->sample_fmt);
 	auto const samples_per_frame = result->planar? 1u : result->channel_layout.nb_channels;
@@ -224,6 +225,7 @@ auto decode_file_buffer(span<byte const> file_contents) -> DecoderOutput
 	auto out_frame = ::AVFrame{};
 	auto flushing = false;
 	while (!flushing) {
+		cancel.check();
 		auto const ret = av_read_frame(format.get(), &in_packet);
 		if (ret == AVERROR_EOF)
 			flushing = true;
@@ -260,10 +262,10 @@ auto decode_file_buffer(span<byte const> file_contents) -> DecoderOutput
 	ASSERT(cursor % bytes_per_sample == 0);
 	result->sample_count = cursor / (bytes_per_sample * samples_per_frame);
 
-	return result;
+	return result.release();
 }
 
-auto resample_buffer(DecoderOutput&& input, int sampling_rate) -> vector<Sample>
+auto resample_buffer(DecoderOutput&& input, int sampling_rate, MemoryTag tag) -> tracked_vector<Sample>
 {
 	set_log_callback();
 	auto* swr = static_cast<SwrContext*>(nullptr);
@@ -275,7 +277,7 @@ auto resample_buffer(DecoderOutput&& input, int sampling_rate) -> vector<Sample>
 	ret_check(swr_init(swr));
 
 	auto max_out_samples = ret_check(swr_get_out_samples(swr, static_cast<int>(input->sample_count)));
-	auto output = vector<Sample>{};
+	auto output = make_tracked_vector<Sample>(tag);
 	output.resize(max_out_samples);
 	auto in_ptrs = vector<uint8_t const*>{};
 	in_ptrs.reserve(input->data.size());
@@ -292,18 +294,20 @@ auto resample_buffer(DecoderOutput&& input, int sampling_rate) -> vector<Sample>
 	return output;
 }
 
-auto decode_and_resample_file_buffer(span<byte const> file_contents, int sampling_rate) -> vector<Sample>
+auto decode_and_resample_file_buffer(span<byte const> file_contents, int sampling_rate,
+	MemoryTag tag, CancelToken const& cancel) -> tracked_vector<Sample>
 {
 	set_log_callback();
-	auto decoder_output = decode_file_buffer(file_contents);
-	auto result = resample_buffer(move(decoder_output), sampling_rate);
+	auto decoder_output = decode_file_buffer(file_contents, cancel);
+	auto result = resample_buffer(move(decoder_output), sampling_rate, tag);
 	return result;
 }
 
-auto encode_as_ogg(span<Sample const> samples, int sampling_rate) -> vector<byte>
+auto encode_as_ogg(span<Sample const> samples, int sampling_rate,
+	MemoryTag tag, CancelToken const& cancel) -> tracked_vector<byte>
 {
 	set_log_callback();
-	auto output = vector<byte>{};
+	auto output = make_tracked_vector<byte>(tag);
 	auto* format_ctx_ptr = static_cast<AVFormatContext*>(nullptr);
 	ret_check(avformat_alloc_output_context2(&format_ctx_ptr, nullptr, "ogg", nullptr));
 	auto format_ctx = AVFormat{format_ctx_ptr};
@@ -351,6 +355,7 @@ auto encode_as_ogg(span<Sample const> samples, int sampling_rate) -> vector<byte
 
 	auto pts = 0z;
 	for (auto in_slice: samples | views::chunk(in_frame->nb_samples)) {
+		cancel.check();
 		ret_check(av_frame_make_writable(in_frame.get()));
 		auto* out_left = reinterpret_cast<float*>(in_frame->data[0]);
 		auto* out_right = reinterpret_cast<float*>(in_frame->data[1]);
@@ -370,10 +375,11 @@ auto encode_as_ogg(span<Sample const> samples, int sampling_rate) -> vector<byte
 	return output;
 }
 
-auto encode_as_opus(span<Sample const> samples, int sampling_rate) -> vector<byte>
+auto encode_as_opus(span<Sample const> samples, int sampling_rate,
+	MemoryTag tag, CancelToken const& cancel) -> tracked_vector<byte>
 {
 	set_log_callback();
-	auto output = vector<byte>{};
+	auto output = make_tracked_vector<byte>(tag);
 	auto* format_ctx_ptr = static_cast<AVFormatContext*>(nullptr);
 	ret_check(avformat_alloc_output_context2(&format_ctx_ptr, nullptr, "opus", nullptr));
 	auto format_ctx = AVFormat{format_ctx_ptr};
@@ -421,6 +427,7 @@ auto encode_as_opus(span<Sample const> samples, int sampling_rate) -> vector<byt
 
 	auto pts = 0z;
 	for (auto in_slice: samples | views::chunk(in_frame->nb_samples)) {
+		cancel.check();
 		ret_check(av_frame_make_writable(in_frame.get()));
 		auto* out_buf = reinterpret_cast<Sample*>(in_frame->data[0]);
 		ASSUME(out_buf);
@@ -437,4 +444,268 @@ auto encode_as_opus(span<Sample const> samples, int sampling_rate) -> vector<byt
 	return output;
 }
 
+struct FileEncoder_t {
+	AVFormat format_ctx;
+	AVCodec codec_ctx;
+	AVFrame frame;
+	AVPacket packet;
+	AVStream* stream;
+	ssize_t frame_size;
+	vector<Sample> pending; // Samples that don't fill a whole frame yet
+	ssize_t pts;
+};
+
+void FileEncoderDeleter::operator()(FileEncoder_t* encoder) const noexcept
+{
+	// If the encoder wasn't finished, the file is left incomplete
+	if (encoder->format_ctx->pb) avio_closep(&encoder->format_ctx->pb);
+	delete encoder;
+}
+
+auto open_file_encoder(fs::path const& path, FileFormat format, int sampling_rate) -> FileEncoder
+{
+	set_log_callback();
+	auto const [format_name, codec_id, sample_fmt] = [&] {
+		switch (format) {
+		case FileFormat::Wav: return tuple{"wav", AV_CODEC_ID_PCM_S16LE, AV_SAMPLE_FMT_S16};
+		case FileFormat::Flac: return tuple{"flac", AV_CODEC_ID_FLAC, AV_SAMPLE_FMT_S16};
+		case FileFormat::Opus: return tuple{"opus", AV_CODEC_ID_OPUS, AV_SAMPLE_FMT_FLT};
+		default: PANIC();
+		}
+	}();
+
+	auto* format_ctx_ptr = static_cast<AVFormatContext*>(nullptr);
+	ret_check(avformat_alloc_output_context2(&format_ctx_ptr, nullptr, format_name, nullptr));
+	auto format_ctx = AVFormat{format_ctx_ptr};
+	auto* codec = ptr_check(avcodec_find_encoder(codec_id));
+	auto codec_ctx = AVCodec{ptr_check(avcodec_alloc_context3(codec))};
+	codec_ctx->sample_fmt = sample_fmt;
+	codec_ctx->sample_rate = sampling_rate;
+	codec_ctx->time_base = AVRational{1, sampling_rate};
+	codec_ctx->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+	if (format == FileFormat::Opus) codec_ctx->bit_rate = 160 * 1000;
+	ret_check(avcodec_open2(codec_ctx.get(), codec, nullptr));
+	// PCM encoders accept frames of any size
+	auto const frame_size = codec_ctx->frame_size > 0? codec_ctx->frame_size : 4096;
+
+	auto frame = AVFrame{ptr_check(av_frame_alloc())};
+	frame->nb_samples = frame_size;
+	frame->format = sample_fmt;
+	frame->ch_layout = AV_CHANNEL_LAYOUT_STEREO;
+	ret_check(av_frame_get_buffer(frame.get(), 0));
+
+	auto* stream = ptr_check(avformat_new_stream(format_ctx.get(), nullptr));
+	ret_check(avcodec_parameters_from_context(stream->codecpar, codec_ctx.get()));
+	stream->time_base = codec_ctx->time_base;
+	auto const url = path.u8string();
+	ret_check(avio_open(&format_ctx->pb, reinterpret_cast<char const*>(url.c_str()), AVIO_FLAG_WRITE));
+
+	auto encoder = FileEncoder{new FileEncoder_t{
+		.format_ctx = move(format_ctx),
+		.codec_ctx = move(codec_ctx),
+		.frame = move(frame),
+		.packet = AVPacket{ptr_check(av_packet_alloc())},
+		.stream = stream,
+		.frame_size = frame_size,
+		.pending = {},
+		.pts = 0,
+	}};
+	encoder->pending.reserve(frame_size);
+	ret_check(avformat_write_header(encoder->format_ctx.get(), nullptr));
+	return encoder;
+}
+
+// Send a frame (or nullptr to flush) to the encoder, and write out all packets it produces.
+static void encode_and_write(FileEncoder_t& encoder, ::AVFrame* frame)
+{
+	ret_check(avcodec_send_frame(encoder.codec_ctx.get(), frame));
+	while (true) {
+		auto const ret = avcodec_receive_packet(encoder.codec_ctx.get(), encoder.packet.get());
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
+		ret_check(ret);
+
+		encoder.packet->stream_index = encoder.stream->index;
+		av_packet_rescale_ts(encoder.packet.get(), encoder.codec_ctx->time_base, encoder.stream->time_base);
+		ret_check(av_interleaved_write_frame(encoder.format_ctx.get(), encoder.packet.get()));
+		av_packet_unref(encoder.packet.get());
+	}
+}
+
+// Encode up to one frame's worth of samples.
+static void encode_frame(FileEncoder_t& encoder, span<Sample const> samples)
+{
+	auto& frame = encoder.frame;
+	ret_check(av_frame_make_writable(frame.get()));
+	frame->nb_samples = samples.size();
+	frame->pts = encoder.pts;
+	encoder.pts += samples.size();
+	if (frame->format == AV_SAMPLE_FMT_FLT) {
+		auto* out_buf = reinterpret_cast<Sample*>(frame->data[0]);
+		ASSUME(out_buf);
+		copy(samples, out_buf);
+	} else {
+		auto* out_buf = reinterpret_cast<int16_t*>(frame->data[0]);
+		ASSUME(out_buf);
+		auto const to_s16 = [](float v) { return static_cast<int16_t>(std::lround(clamp(v, -1.0f, 1.0f) * 32767.0f)); };
+		for (auto const& sample: samples) {
+			*out_buf++ = to_s16(sample.left);
+			*out_buf++ = to_s16(sample.right);
+		}
+	}
+	encode_and_write(encoder, frame.get());
+}
+
+void encode_chunk(FileEncoder& encoder, span<Sample const> samples)
+{
+	auto& enc = *encoder;
+	// Complete the frame left over from the previous chunk first
+	if (!enc.pending.empty()) {
+		auto const needed = min(enc.frame_size - ssize(enc.pending), ssize(samples));
+		enc.pending.insert(enc.pending.end(), samples.begin(), samples.begin() + needed);
+		samples = samples.subspan(needed);
+		if (ssize(enc.pending) < enc.frame_size) return;
+		encode_frame(enc, enc.pending);
+		enc.pending.clear();
+	}
+	while (ssize(samples) >= enc.frame_size) {
+		encode_frame(enc, samples.first(enc.frame_size));
+		samples = samples.subspan(enc.frame_size);
+	}
+	enc.pending.assign(samples.begin(), samples.end());
+}
+
+void finish_file_encoder(FileEncoder&& encoder)
+{
+	auto enc = move(encoder);
+	if (!enc->pending.empty()) encode_frame(*enc, enc->pending);
+	encode_and_write(*enc, nullptr);
+	ret_check(av_write_trailer(enc->format_ctx.get()));
+	avio_closep(&enc->format_ctx->pb);
+}
+
+struct VideoDecoder_t {
+	SeekBuffer file_buffer;
+	AVIO io;
+	AVFormat format;
+	AVCodec codec_ctx;
+	AVPacket packet;
+	AVFrame frame;
+	SwsContext* scaler;
+	int stream_idx;
+	AVRational time_base;
+	int64_t start_pts; // Timestamps are shifted so that the first frame is at 0
+	nanoseconds frame_duration; // Fallback for frames without a duration
+	nanoseconds next_timestamp; // Fallback for frames without a timestamp
+	bool flushing;
+};
+
+void VideoDecoderDeleter::operator()(VideoDecoder_t* decoder) const noexcept
+{
+	sws_freeContext(decoder->scaler);
+	delete decoder;
+}
+
+static auto to_ns(int64_t value, AVRational time_base) -> nanoseconds
+{ return nanoseconds{av_rescale_q(value, time_base, AVRational{1, 1'000'000'000})}; }
+
+auto open_video(span<byte const> file_contents) -> VideoDecoder
+{
+	set_log_callback();
+	auto decoder = VideoDecoder{new VideoDecoder_t{}};
+	auto& dec = *decoder;
+	dec.file_buffer = SeekBuffer{ .buffer = file_contents, .cursor = 0 };
+	auto io_buffer = AVBuffer{av_malloc(PageSize)};
+	dec.io = AVIO{ptr_check(avio_alloc_context(static_cast<unsigned char*>(io_buffer.get()), PageSize, 0,
+		&dec.file_buffer, &av_io_read, nullptr, &av_io_seek))};
+	io_buffer.release(); // AVIOContext takes control over the buffer from now on
+	auto format = AVFormat{ptr_check(avformat_alloc_context())};
+	format->pb = dec.io.get();
+
+	auto* format_rw = format.get();
+	format.release(); // avformat_open_input frees it on failure
+	ret_check(avformat_open_input(&format_rw, "", nullptr, nullptr));
+	dec.format = AVFormat{format_rw}; // No failure; take back control
+
+	ret_check(avformat_find_stream_info(dec.format.get(), nullptr));
+	dec.stream_idx = av_find_best_stream(dec.format.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (dec.stream_idx < 0) throw runtime_error{"No video stream found"};
+	auto* stream = dec.format->streams[dec.stream_idx];
+
+	auto* codec = ptr_check(avcodec_find_decoder(stream->codecpar->codec_id));
+	dec.codec_ctx = AVCodec{ptr_check(avcodec_alloc_context3(codec))};
+	ret_check(avcodec_parameters_to_context(dec.codec_ctx.get(), stream->codecpar));
+	dec.codec_ctx->pkt_timebase = stream->time_base;
+	ret_check(avcodec_open2(dec.codec_ctx.get(), codec, nullptr));
+
+	dec.packet = AVPacket{ptr_check(av_packet_alloc())};
+	dec.frame = AVFrame{ptr_check(av_frame_alloc())};
+	dec.time_base = stream->time_base;
+	dec.start_pts = stream->start_time != AV_NOPTS_VALUE? stream->start_time : 0;
+	auto const frame_rate = av_guess_frame_rate(dec.format.get(), stream, nullptr);
+	dec.frame_duration = frame_rate.num > 0 && frame_rate.den > 0?
+		to_ns(1, av_inv_q(frame_rate)) :
+		duration_cast<nanoseconds>(1s) / 30; // Common for BGA videos
+	return decoder;
+}
+
+// Convert the decoder's current frame to RGBA, and store it in the picture.
+static void convert_frame(VideoDecoder_t& dec, Picture& out, optional<int2> size)
+{
+	auto const& frame = *dec.frame;
+	auto const out_size = size.value_or(int2{frame.width, frame.height});
+	dec.scaler = ptr_check(sws_getCachedContext(dec.scaler,
+		frame.width, frame.height, static_cast<AVPixelFormat>(frame.format),
+		out_size.x(), out_size.y(), AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr));
+	out.width = out_size.x();
+	out.height = out_size.y();
+	out.pixels.resize(out.width * out.height * 4);
+	uint8_t* const out_planes[4] = {reinterpret_cast<uint8_t*>(out.pixels.data())};
+	int const out_strides[4] = {out.width * 4};
+	ret_check(sws_scale(dec.scaler, frame.data, frame.linesize, 0, frame.height, out_planes, out_strides));
+
+	out.timestamp = frame.best_effort_timestamp != AV_NOPTS_VALUE?
+		to_ns(frame.best_effort_timestamp - dec.start_pts, dec.time_base) :
+		dec.next_timestamp;
+	out.duration = frame.duration > 0? to_ns(frame.duration, dec.time_base) : dec.frame_duration;
+	dec.next_timestamp = out.timestamp + out.duration;
+}
+
+auto decode_frame(VideoDecoder& decoder, Picture& out, optional<int2> size) -> bool
+{
+	auto& dec = *decoder;
+	while (true) {
+		auto const ret = avcodec_receive_frame(dec.codec_ctx.get(), dec.frame.get());
+		if (ret == AVERROR_EOF) return false;
+		if (ret != AVERROR(EAGAIN)) {
+			ret_check(ret);
+			convert_frame(dec, out, size);
+			av_frame_unref(dec.frame.get());
+			return true;
+		}
+
+		// The decoder needs more data
+		if (dec.flushing) return false;
+		auto const read = av_read_frame(dec.format.get(), dec.packet.get());
+		if (read == AVERROR_EOF) {
+			dec.flushing = true;
+			ret_check(avcodec_send_packet(dec.codec_ctx.get(), nullptr));
+			continue;
+		}
+		ret_check(read);
+		if (dec.packet->stream_index == dec.stream_idx)
+			ret_check(avcodec_send_packet(dec.codec_ctx.get(), dec.packet.get()));
+		av_packet_unref(dec.packet.get());
+	}
+}
+
+auto decode_image(span<byte const> file_contents, MemoryTag tag) -> Picture
+{
+	auto decoder = open_video(file_contents);
+	auto picture = Picture{.pixels = make_tracked_vector<byte>(tag)};
+	if (!decode_frame(decoder, picture)) throw runtime_error{"No picture found"};
+	picture.timestamp = 0ns;
+	picture.duration = 0ns;
+	return picture;
+}
+
 }
@@ -10,6 +10,8 @@ or distributed except according to those terms.
 #pragma once
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/cancel.hpp"
+#include "utils/memory.hpp"
 #include "lib/audio_common.hpp"
 
 namespace playnote::lib::ffmpeg {
@@ -24,23 +26,81 @@ void set_thread_log_category(Logger::Category);
 
 // Decode an audio file from a buffer into uncompressed audio data. The returned output must be
 // consumed by resample_buffer() to free the underlying resources.
-// Throws runtime_error if ffmpeg throws.
-auto decode_file_buffer(span<byte const> file_contents) -> DecoderOutput;
+// Throws runtime_error if ffmpeg throws, or cancelled_error if the token is cancelled between packets.
+auto decode_file_buffer(span<byte const> file_contents, CancelToken const& = {}) -> DecoderOutput;
 
-// Resample decoded audio to a known format.
+// Resample decoded audio to a known format. The result is charged to the provided subsystem.
 // Throws runtime_error if ffmpeg throws.
-auto resample_buffer(DecoderOutput&& input, int sampling_rate) -> vector<Sample>;
+auto resample_buffer(DecoderOutput&& input, int sampling_rate,
+	MemoryTag = MemoryTag::Other) -> tracked_vector<Sample>;
 
 // Perform both decoding and resampling in one step.
-// Throws runtime_error if ffmpeg throws.
-auto decode_and_resample_file_buffer(span<byte const> file_contents, int sampling_rate) -> vector<Sample>;
+// Throws runtime_error if ffmpeg throws, or cancelled_error if the token is cancelled.
+auto decode_and_resample_file_buffer(span<byte const> file_contents, int sampling_rate,
+	MemoryTag = MemoryTag::Other, CancelToken const& = {}) -> tracked_vector<Sample>;
 
 // Encode audio samples to an OGG Vorbis buffer.
-// Throws runtime_error if ffmpeg throws.
-auto encode_as_ogg(span<Sample const> samples, int sampling_rate) -> vector<byte>;
+// Throws runtime_error if ffmpeg throws, or cancelled_error if the token is cancelled between frames.
+auto encode_as_ogg(span<Sample const> samples, int sampling_rate,
+	MemoryTag = MemoryTag::Other, CancelToken const& = {}) -> tracked_vector<byte>;
 
 // Encode audio samples to an Opus buffer.
+// Throws runtime_error if ffmpeg throws, or cancelled_error if the token is cancelled between frames.
+auto encode_as_opus(span<Sample const> samples, int sampling_rate,
+	MemoryTag = MemoryTag::Other, CancelToken const& = {}) -> tracked_vector<byte>;
+
+// Format of an audio file written by a FileEncoder.
+enum class FileFormat {
+	Wav, // 16-bit PCM
+	Flac, // 16-bit
+	Opus, // 160kbps; 48000Hz sampling rate only
+};
+
+// Opaque state of an audio file being encoded.
+struct FileEncoder_t;
+struct FileEncoderDeleter { void operator()(FileEncoder_t*) const noexcept; };
+using FileEncoder = unique_ptr<FileEncoder_t, FileEncoderDeleter>;
+
+// Create or overwrite an audio file, and prepare to encode audio into it. Audio is written
+// in chunks, so that it never needs to be held in memory in full.
+// Throws runtime_error if ffmpeg throws.
+auto open_file_encoder(fs::path const&, FileFormat, int sampling_rate) -> FileEncoder;
+
+// Encode a chunk of audio samples of any length, and write out all complete frames.
+// Throws runtime_error if ffmpeg throws.
+void encode_chunk(FileEncoder&, span<Sample const> samples);
+
+// Encode the remaining samples and finalize the file. The encoder can't be used afterwards.
+// Throws runtime_error if ffmpeg throws.
+void finish_file_encoder(FileEncoder&&);
+
+// A decoded still image or video frame.
+struct Picture {
+	int width;
+	int height;
+	nanoseconds timestamp; // Presentation time within the video; zero for still images
+	nanoseconds duration; // How long the frame stays on screen; zero for still images
+	tracked_vector<byte> pixels; // 8-bit RGBA in sRGB, rows top to bottom without padding
+};
+
+// Decode a still image from a buffer, in any format ffmpeg can detect (BMP, PNG, JPEG...)
+// The result is charged to the provided subsystem.
+// Throws runtime_error if ffmpeg throws, or if the file contains no picture.
+auto decode_image(span<byte const> file_contents, MemoryTag = MemoryTag::Other) -> Picture;
+
+// Opaque state of a video being decoded.
+struct VideoDecoder_t;
+struct VideoDecoderDeleter { void operator()(VideoDecoder_t*) const noexcept; };
+using VideoDecoder = unique_ptr<VideoDecoder_t, VideoDecoderDeleter>;
+
+// Open a video stored in a buffer. The buffer must outlive the decoder.
+// Throws runtime_error if ffmpeg throws, or if the file has no video stream.
+auto open_video(span<byte const> file_contents) -> VideoDecoder;
+
+// Decode the next frame of the video, scaled to the given size or kept at its native size.
+// The picture's pixel buffer is reused, so that a steady stream of same-sized frames doesn't
+// allocate. Returns false once the video ends.
 // Throws runtime_error if ffmpeg throws.
-auto encode_as_opus(span<Sample const> samples, int sampling_rate) -> vector<byte>;
+auto decode_frame(VideoDecoder&, Picture& out, optional<int2> size = nullopt) -> bool;
 
 }
@@ -91,6 +91,21 @@ auto to_utf8(span<byte const> input, string_view input_charset) -> string
 	return contents;
 }
 
+auto from_utf8(string_view input, string_view output_charset) -> vector<byte>
+{
+	auto contents = vector<byte>{};
+	auto contents_capacity = input.size() * 2 + 1; // Stateful encodings can expand beyond the input
+	contents.resize(contents_capacity);
+	auto err = U_ZERO_ERROR;
+	auto converted = ucnv_convert(string{output_charset}.c_str(), "UTF-8",
+		reinterpret_cast<char*>(contents.data()), contents_capacity,
+		input.data(), input.size(), &err);
+	handle_icu_error(err);
+	ASSERT(converted < contents_capacity);
+	contents.resize(converted);
+	return contents;
+}
+
 auto grapheme_clusters(string_view input) -> generator<string_view>
 {
 	auto err = U_ZERO_ERROR;
@@ -22,6 +22,11 @@ auto detect_encoding(span<byte const> input, initializer_list<string_view> chars
 // as a replacement character.
 auto to_utf8(span<byte const> input, string_view input_charset) -> string;
 
+// Convert UTF-8 text to the provided charset. Characters that can't be represented are replaced
+// by the charset's substitution character.
+// Throws on ICU error.
+auto from_utf8(string_view input, string_view output_charset) -> vector<byte>;
+
 // Iterate over a UTF-8 string, returning all grapheme clusters in turn. By definition,
 // the returned spans might contain one or multiple UTF-8 scalars.
 // Throws on ICU error.
@@ -32,7 +32,7 @@ void detail::ContextDeleter::operator()(Context_t* ctx) noexcept
 	delete ctx;
 }
 
-auto init(glfw::Window window, vuk::Allocator& global_allocator, vector<byte>&& font_data) -> Context
+auto init(glfw::Window window, vuk::Allocator& global_allocator, span<byte const> font_data) -> Context
 {
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -58,7 +58,8 @@ auto init(glfw::Window window, vuk::Allocator& global_allocator, vector<byte>&&
 	builder.AddRanges(io.Fonts->GetGlyphRangesKorean());
 	builder.AddRanges(io.Fonts->GetGlyphRangesChineseFull());
 	builder.BuildRanges(&ranges);
-	ASSERT(io.Fonts->AddFontFromMemoryTTF(font_data.data(), font_data.size(), 16.0f, &config, ranges.Data));
+	// The atlas doesn't own the data, so it's never written to
+	ASSERT(io.Fonts->AddFontFromMemoryTTF(const_cast<byte*>(font_data.data()), font_data.size(), 16.0f, &config, ranges.Data));
 	auto* pixels = static_cast<unsigned char*>(nullptr);
 	auto width = 0;
 	auto height = 0;
@@ -238,19 +239,24 @@ void same_line() { ImGui::SameLine(); }
 
 auto button(char const* str) -> bool { return ImGui::Button(str); }
 
-void text(string_view str) { ImGui::TextWrapped("%s", string{str}.c_str()); }
+auto detail::text_buffer() -> string&
+{
+	thread_local auto buffer = string{};
+	return buffer;
+}
+
+void text(string_view str) { ImGui::TextWrapped("%.*s", static_cast<int>(str.size()), str.data()); }
 
 void text_styled(string_view str, optional<float4> color, float size, TextAlignment alignment)
 {
 	if (size != 1.0f) ImGui::SetWindowFontScale(size);
 	if (color) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4{color->r(), color->g(), color->b(), color->a()});
-	auto const text = string{str};
 	if (alignment == TextAlignment::Center) {
 		auto const window_width = ImGui::GetWindowSize().x;
-		auto const text_width = ImGui::CalcTextSize(text.c_str()).x;
+		auto const text_width = ImGui::CalcTextSize(str.data(), str.data() + str.size()).x;
 		ImGui::SetCursorPosX((window_width - text_width) * 0.5f);
 	}
-	ImGui::TextWrapped("%s", text.c_str());
+	ImGui::TextWrapped("%.*s", static_cast<int>(str.size()), str.data());
 	if (color) ImGui::PopStyleColor();
 	if (size != 1.0f) ImGui::SetWindowFontScale(1.0f);
 }
@@ -274,10 +280,13 @@ void input_double(char const* str, double& value, double step, double step_fast,
 
 void progress_bar(optional<float> progress, string_view text)
 {
+	// The overlay needs to be null-terminated
+	auto& overlay = detail::text_buffer();
+	overlay.assign(text);
 	if (progress)
-		ImGui::ProgressBar(*progress, ImVec2{-1.0f, 0.0f}, string{text}.c_str());
+		ImGui::ProgressBar(*progress, ImVec2{-1.0f, 0.0f}, overlay.c_str());
 	else
-		ImGui::ProgressBar(-1.0f * (static_cast<float>(ImGui::GetTime()) / 2.0f), ImVec2{-1.0f, 0.0f}, string{text}.c_str());
+		ImGui::ProgressBar(-1.0f * (static_cast<float>(ImGui::GetTime()) / 2.0f), ImVec2{-1.0f, 0.0f}, overlay.c_str());
 }
 
 void plot(char const* label, initializer_list<PlotValues> values,
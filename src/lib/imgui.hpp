@@ -27,7 +27,7 @@ using Context = unique_ptr<Context_t, detail::ContextDeleter>;
 
 // Initialize Imgui and relevant GPU resources. font_data should be the contents of a TTF font.
 // Throws if vuk throws.
-auto init(glfw::Window window, vuk::Allocator& global_allocator, vector<byte>&& font_data) -> Context;
+auto init(glfw::Window window, vuk::Allocator& global_allocator, span<byte const> font_data) -> Context;
 
 // Mark the start of a new frame for Imgui. All Imgui commands must come after this is called.
 void begin();
@@ -64,11 +64,19 @@ auto button(char const* str) -> bool;
 // Static text.
 void text(string_view str);
 
+namespace detail {
+// Storage reused by formatting calls, so that they don't allocate a new string every frame.
+[[nodiscard]] auto text_buffer() -> string&;
+}
+
 // Static text, fmt overload.
 template<typename... Args>
 void text(fmtquill::format_string<Args...> fmt, Args&&... args)
 {
-	text(format(fmt, forward<Args>(args)...).c_str());
+	auto& buffer = detail::text_buffer();
+	buffer.clear();
+	format_to(back_inserter(buffer), fmt, forward<Args>(args)...);
+	text(string_view{buffer});
 }
 
 enum class TextAlignment {
@@ -12,9 +12,73 @@ or distributed except according to those terms.
 #include "msdfgen/ext/import-font.h"
 #include "msdf-atlas-gen/image-save.h"
 #include "preamble.hpp"
+#include "utils/assert.hpp"
+#include "lib/bits.hpp"
 
 namespace playnote::lib::msdf {
 
+// Bump whenever glyph rasterization changes in a way that's not captured by the cache key
+// or describe_generator()
+static constexpr auto GlyphCacheVersion = 2u;
+
+#ifndef MSDF_ATLAS_GEN_VERSION
+#error MSDF_ATLAS_GEN_VERSION must be defined by the build
+#endif
+
+// Describe everything outside of the cache key that affects rasterized glyphs.
+static auto describe_generator(msdf_atlas::GeneratorAttributes const& attributes) -> string
+{
+	auto const& error_correction = attributes.config.errorCorrection;
+	return format("msdf-atlas-gen {}; overlap {}; scanline {}; error correction {} {} {} {}",
+		MSDF_ATLAS_GEN_VERSION, attributes.config.overlapSupport, attributes.scanlinePass,
+		static_cast<int>(error_correction.mode), static_cast<int>(error_correction.distanceCheckMode),
+		error_correction.minDeviationRatio, error_correction.minImproveRatio);
+}
+
+void CachingGenerator::generate(GlyphGeometry const* glyphs, int count)
+{
+	if (!cache) {
+		generator.generate(glyphs, count);
+		return;
+	}
+	ASSERT(ssize(keys) == count);
+	if (auto generator_desc = describe_generator(attributes); cache->generator != generator_desc) {
+		cache->glyphs.clear();
+		cache->generator = move(generator_desc);
+	}
+
+	// Copy cached glyphs into place, and rasterize the rest
+	auto& storage = const_cast<Storage&>(generator.atlasStorage());
+	auto missing = vector<GlyphGeometry>{};
+	auto missing_keys = vector<GlyphCache::Key>{};
+	for (auto const& [glyph, key]: views::zip(span{glyphs, static_cast<size_t>(count)}, keys)) {
+		cache->used.emplace(key);
+		auto const box = glyph.getBoxRect();
+		auto const cached = cache->glyphs.find(key);
+		if (cached != cache->glyphs.end() && cached->second.width == box.w && cached->second.height == box.h) {
+			storage.put(box.x, box.y, msdfgen::BitmapConstRef<msdf_atlas::byte, 4>{
+				reinterpret_cast<msdf_atlas::byte const*>(cached->second.pixels.data()), box.w, box.h});
+			cache->hits += 1;
+		} else {
+			missing.emplace_back(glyph);
+			missing_keys.emplace_back(key);
+			cache->misses += 1;
+		}
+	}
+	generator.generate(missing.data(), static_cast<int>(missing.size()));
+
+	// Read back the new glyphs
+	for (auto const& [glyph, key]: views::zip(missing, missing_keys)) {
+		auto const box = glyph.getBoxRect();
+		auto& entry = cache->glyphs[key];
+		entry = GlyphCache::Glyph{.width = box.w, .height = box.h};
+		entry.pixels.resize(box.w * box.h * 4);
+		storage.get(box.x, box.y, msdfgen::BitmapRef<msdf_atlas::byte, 4>{
+			reinterpret_cast<msdf_atlas::byte*>(entry.pixels.data()), box.w, box.h});
+	}
+	keys = {};
+}
+
 GlyphLoader::GlyphLoader(lib::harfbuzz::Font const& ft_font, float pixels_per_em, float distance_range):
 	ft_font{ft_font},
 	font{msdfgen::adoptFreetypeFont(ft_font->face)},
@@ -37,8 +101,9 @@ auto GlyphLoader::load_glyph(ssize_t glyph_idx) -> optional<GlyphGeometry>
 	return nullopt;
 }
 
-auto add_glyphs(MTSDFAtlas& atlas, span<GlyphGeometry> glyphs) -> vector<GlyphLayout>
+auto add_glyphs(MTSDFAtlas& atlas, span<GlyphGeometry> glyphs, span<GlyphCache::Key const> cache_keys) -> vector<GlyphLayout>
 {
+	atlas.atlasGenerator().keys = cache_keys;
 	atlas.add(glyphs.data(), glyphs.size());
 
 	auto layouts = vector<GlyphLayout>{};
@@ -62,6 +127,33 @@ auto add_glyphs(MTSDFAtlas& atlas, span<GlyphGeometry> glyphs) -> vector<GlyphLa
 	return layouts;
 }
 
+void attach_glyph_cache(MTSDFAtlas& atlas, GlyphCache& cache)
+{ atlas.atlasGenerator().cache = &cache; }
+
+auto serialize_glyph_cache(GlyphCache const& cache) -> vector<byte>
+{
+	auto used_glyphs = unordered_map<GlyphCache::Key, GlyphCache::Glyph>{};
+	for (auto const& key: cache.used) {
+		if (auto const glyph = cache.glyphs.find(key); glyph != cache.glyphs.end())
+			used_glyphs.emplace(key, glyph->second);
+	}
+	auto data = vector<byte>{};
+	auto out = lib::bits::out{data};
+	out(GlyphCacheVersion, cache.generator, used_glyphs).or_throw();
+	return data;
+}
+
+auto deserialize_glyph_cache(span<byte const> data) -> GlyphCache
+{
+	auto in = lib::bits::in{data};
+	auto version = 0u;
+	in(version).or_throw();
+	auto cache = GlyphCache{};
+	if (version != GlyphCacheVersion) return cache;
+	in(cache.generator, cache.glyphs).or_throw();
+	return cache;
+}
+
 auto get_atlas_contents(MTSDFAtlas const& atlas) -> AtlasView
 {
 	auto const& storage = atlas.atlasGenerator().atlasStorage();
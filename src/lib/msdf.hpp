@@ -25,14 +25,60 @@ namespace playnote::lib::msdf {
 // The curves defining a glyph; opaque type
 using msdf_atlas::GlyphGeometry;
 
+// Rasterized glyphs kept between atlas generations, so that unchanged glyphs don't need
+// to be rasterized again.
+struct GlyphCache {
+	// Font file hash, glyph index, pixels per em, distance range
+	using Key = tuple<array<byte, 16>, ssize_t, float, float>;
+
+	struct Glyph {
+		int width;
+		int height;
+		vector<byte> pixels; // 4 channels
+	};
+
+	string generator; // Library version and attributes the glyphs were rasterized with
+	unordered_map<Key, Glyph> glyphs;
+	unordered_set<Key> used; // Glyphs requested since the cache was created
+	ssize_t hits = 0;
+	ssize_t misses = 0;
+};
+
+// Atlas generator rasterizing MTSDF glyphs. If a glyph cache is attached, cached glyphs are copied
+// instead, and newly rasterized ones are added to the cache. The atlas contents are the same
+// either way; glyphs rasterized by a different library version or with different attributes
+// are dropped from the cache first.
+class CachingGenerator {
+public:
+	using Storage = msdf_atlas::BitmapAtlasStorage<msdf_atlas::byte, 4>;
+
+	GlyphCache* cache = nullptr;
+	span<GlyphCache::Key const> keys; // Identify the glyphs of the next generate() call
+
+	CachingGenerator() = default;
+	CachingGenerator(int width, int height): generator{width, height} {}
+
+	// Interface expected by msdf_atlas::DynamicAtlas
+	void generate(GlyphGeometry const* glyphs, int count);
+	void resize(int width, int height) { generator.resize(width, height); }
+	void rearrange(int width, int height, msdf_atlas::Remap const* remapping, int count)
+	{ generator.rearrange(width, height, remapping, count); }
+	void setAttributes(msdf_atlas::GeneratorAttributes const& attributes)
+	{
+		this->attributes = attributes;
+		generator.setAttributes(attributes);
+	}
+	void setThreadCount(int thread_count) { generator.setThreadCount(thread_count); }
+	[[nodiscard]] auto atlasStorage() const -> Storage const& { return generator.atlasStorage(); }
+
+private:
+	msdf_atlas::ImmediateAtlasGenerator<float, 4, &msdf_atlas::mtsdfGenerator, Storage> generator;
+	msdf_atlas::GeneratorAttributes attributes; // Mirrors the generator's
+};
+
 // A font atlas holding MTSDF (MSDF in RGB, SDF in alpha) data. Constructor optionally takes in
 // the initial size of the atlas in pixels.
-using MTSDFAtlas = msdf_atlas::DynamicAtlas<
-	msdf_atlas::ImmediateAtlasGenerator<
-		float, 4, &msdf_atlas::mtsdfGenerator,
-		msdf_atlas::BitmapAtlasStorage<msdf_atlas::byte, 4>
-	>
->;
+using MTSDFAtlas = msdf_atlas::DynamicAtlas<CachingGenerator>;
 
 // View into the atlas' pixel array.
 using AtlasView = const_multi_array_ref<byte, 3>;
@@ -69,8 +115,19 @@ struct GlyphLayout {
 };
 
 // Expand the atlas with additional glyphs. The new glyphs' atlas positions are returned,
-// with indices matching input data.
-auto add_glyphs(MTSDFAtlas&, span<GlyphGeometry>) -> vector<GlyphLayout>;
+// with indices matching input data. If the atlas has a glyph cache, the glyphs' cache keys
+// must be provided as well.
+auto add_glyphs(MTSDFAtlas&, span<GlyphGeometry>, span<GlyphCache::Key const> cache_keys = {}) -> vector<GlyphLayout>;
+
+// Attach a glyph cache to the atlas. The cache must outlive the atlas.
+void attach_glyph_cache(MTSDFAtlas&, GlyphCache&);
+
+// Serialize the glyph cache, keeping only the glyphs that were used since it was created.
+auto serialize_glyph_cache(GlyphCache const&) -> vector<byte>;
+
+// Restore a glyph cache. Returns an empty cache if the data is from an incompatible version.
+// Throws runtime_error if the data is corrupted.
+auto deserialize_glyph_cache(span<byte const>) -> GlyphCache;
 
 // Return atlas contents as a read-only view.
 auto get_atlas_contents(MTSDFAtlas const&) -> AtlasView;
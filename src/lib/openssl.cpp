@@ -10,6 +10,7 @@ or distributed except according to those terms.
 #include "lib/openssl.hpp"
 
 #include <openssl/evp.h>
+#include <charconv>
 #include "preamble.hpp"
 
 namespace playnote::lib::openssl {
@@ -21,15 +22,49 @@ auto md5(span<byte const> data) -> MD5
 	return result;
 }
 
-auto md5_to_hex(const MD5& md5) -> string
+static auto to_hex(span<byte const> hash) -> string
 {
 	auto result = string{};
-	result.reserve(md5.size() * 2);
-	for (auto b: md5) {
+	result.reserve(hash.size() * 2);
+	for (auto b: hash) {
 		auto const hex = format("{:02x}", static_cast<uint8_t>(b));
 		result.append(hex);
 	}
 	return result;
 }
 
+auto md5_to_hex(const MD5& md5) -> string
+{ return to_hex(md5); }
+
+auto sha256(span<byte const> data) -> SHA256
+{
+	auto result = SHA256{};
+	EVP_Q_digest(nullptr, "SHA256", nullptr, data.data(), data.size(), reinterpret_cast<unsigned char*>(result.data()), nullptr);
+	return result;
+}
+
+auto sha256_to_hex(SHA256 const& sha256) -> string
+{ return to_hex(sha256); }
+
+template<std::size_t N>
+static auto from_hex(string_view hex) -> optional<array<byte, N>>
+{
+	auto result = array<byte, N>{};
+	if (hex.size() != result.size() * 2) return nullopt;
+	for (auto [idx, b]: result | views::enumerate) {
+		auto value = uint8_t{};
+		auto const* first = hex.data() + idx * 2;
+		auto const [ptr, ec] = std::from_chars(first, first + 2, value, 16);
+		if (ec != std::errc{} || ptr != first + 2) return nullopt;
+		b = static_cast<byte>(value);
+	}
+	return result;
+}
+
+auto md5_from_hex(string_view hex) -> optional<MD5>
+{ return from_hex<tuple_size_v<MD5>>(hex); }
+
+auto sha256_from_hex(string_view hex) -> optional<SHA256>
+{ return from_hex<tuple_size_v<SHA256>>(hex); }
+
 }
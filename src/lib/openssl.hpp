@@ -13,6 +13,7 @@ or distributed except according to those terms.
 namespace playnote::lib::openssl {
 
 using MD5 = array<byte, 16>;
+using SHA256 = array<byte, 32>;
 
 // Calculate and return the MD5 hash of provided data.
 auto md5(span<byte const> data) -> MD5;
@@ -20,4 +21,16 @@ auto md5(span<byte const> data) -> MD5;
 // Convert an MD5 hash to a hex string.
 [[nodiscard]] auto md5_to_hex(MD5 const&) -> string;
 
+// Calculate and return the SHA-256 hash of provided data.
+auto sha256(span<byte const> data) -> SHA256;
+
+// Convert a SHA-256 hash to a hex string.
+[[nodiscard]] auto sha256_to_hex(SHA256 const&) -> string;
+
+// Parse a hex string into an MD5 hash. Returns nullopt if the string isn't a valid hash.
+[[nodiscard]] auto md5_from_hex(string_view) -> optional<MD5>;
+
+// Parse a hex string into a SHA-256 hash. Returns nullopt if the string isn't a valid hash.
+[[nodiscard]] auto sha256_from_hex(string_view) -> optional<SHA256>;
+
 }
@@ -21,18 +21,29 @@ or distributed except according to those terms.
 #include <timeapi.h>
 #include <shellapi.h>
 #include <dwrite.h>
+#include <psapi.h>
 #elifdef TARGET_LINUX
 #include <fontconfig/fontconfig.h>
 #include <linux/ioprio.h>
+#include <sys/resource.h>
 #include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <poll.h>
+#include <signal.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <sched.h>
 #endif
 #include <cstdlib>
+#include <cstdio>
+#ifndef ENABLE_ALLOC_AUDIT
 #include "mimalloc.h"
+#endif
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "utils/tracing.hpp"
 
 namespace playnote::lib::os {
 
@@ -46,6 +57,9 @@ static void ret_check(HRESULT hr, string_view message = "DirectWrite error")
 
 void check_mimalloc()
 {
+#ifdef ENABLE_ALLOC_AUDIT
+	INFO("mimalloc is not linked in allocation audit builds");
+#else
 	if (mi_version() <= 0) {
 		WARN("mimalloc is not loaded");
 		return;
@@ -59,10 +73,12 @@ void check_mimalloc()
 		WARN("mimalloc override is not active (new: {}, malloc: {})", new_ok, malloc_ok);
 	free(q);
 	delete p;
+#endif
 }
 
 void name_current_thread(string_view name)
 {
+	TRACE_THREAD_NAME(name);
 #ifdef TARGET_WINDOWS
 	auto const lname = std::wstring{name.begin(), name.end()}; // No reencoding; not expecting non-ASCII here
 	auto const err = SetThreadDescription(GetCurrentThread(), lname.c_str());
@@ -109,6 +125,328 @@ void block_with_message([[maybe_unused]] string_view message)
 #endif
 }
 
+auto get_process_usage() -> ProcessUsage
+{
+#ifdef TARGET_WINDOWS
+	auto creation = FILETIME{};
+	auto exit = FILETIME{};
+	auto kernel = FILETIME{};
+	auto user = FILETIME{};
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		throw runtime_error_fmt("Failed to get process times: error {}", GetLastError());
+	auto to_ns = [](FILETIME time) { // 100ns units
+		return nanoseconds{((static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 100};
+	};
+	auto memory = PROCESS_MEMORY_COUNTERS{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+		throw runtime_error_fmt("Failed to get process memory info: error {}", GetLastError());
+	return ProcessUsage{
+		.cpu_time = to_ns(kernel) + to_ns(user),
+		.rss = static_cast<ssize_t>(memory.WorkingSetSize),
+		.peak_rss = static_cast<ssize_t>(memory.PeakWorkingSetSize),
+	};
+#elifdef TARGET_LINUX
+	auto usage = rusage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		throw system_error("Failed to get process usage");
+	auto to_ns = [](timeval time) { return seconds{time.tv_sec} + nanoseconds{time.tv_usec * 1000}; };
+	// getrusage() only knows the peak; the current size is in pages, second field of statm
+	auto* statm = std::fopen("/proc/self/statm", "r");
+	if (!statm) throw system_error("Failed to open /proc/self/statm");
+	auto total_pages = 0l;
+	auto resident_pages = 0l;
+	auto const fields = std::fscanf(statm, "%ld %ld", &total_pages, &resident_pages);
+	std::fclose(statm);
+	if (fields != 2) throw runtime_error("Failed to parse /proc/self/statm");
+	return ProcessUsage{
+		.cpu_time = to_ns(usage.ru_utime) + to_ns(usage.ru_stime),
+		.rss = static_cast<ssize_t>(resident_pages) * sysconf(_SC_PAGESIZE),
+		.peak_rss = static_cast<ssize_t>(usage.ru_maxrss) * 1024, // Reported in KiB
+	};
+#endif
+}
+
+auto get_executable_path() -> fs::path
+{
+#ifdef TARGET_WINDOWS
+	auto buffer = std::wstring(MAX_PATH, L'\0');
+	while (true) {
+		auto const length = GetModuleFileNameW(nullptr, buffer.data(), static_cast<DWORD>(buffer.size()));
+		if (length == 0)
+			throw runtime_error_fmt("Failed to get executable path: error {}", GetLastError());
+		if (length < buffer.size()) {
+			buffer.resize(length);
+			return fs::path{buffer};
+		}
+		buffer.resize(buffer.size() * 2);
+	}
+#elifdef TARGET_LINUX
+	auto error = std::error_code{};
+	auto path = std::filesystem::read_symlink("/proc/self/exe", error);
+	if (error) throw runtime_error_fmt("Failed to get executable path: {}", error.message());
+	return path;
+#endif
+}
+
+struct detail::ChildProcess_t {
+#ifdef TARGET_WINDOWS
+	HANDLE process;
+	HANDLE input; // Write end of the child's standard input
+	HANDLE output; // Read end of the child's standard output
+#elifdef TARGET_LINUX
+	pid_t pid;
+	int socket; // Connected to both the standard input and output of the child
+#endif
+	string buffer; // Output received past the last returned line
+	bool closed; // The child closed its output; buffer holds everything it will ever write
+};
+
+// Time a child is given to exit on its own once its input is closed
+static constexpr auto ChildExitTimeout = 1s;
+
+void detail::ChildProcessDeleter::operator()(ChildProcess_t* child) noexcept
+{
+#ifdef TARGET_WINDOWS
+	CloseHandle(child->input);
+	if (WaitForSingleObject(child->process, static_cast<DWORD>(ChildExitTimeout / 1ms)) != WAIT_OBJECT_0) {
+		TerminateProcess(child->process, EXIT_FAILURE);
+		WaitForSingleObject(child->process, INFINITE);
+	}
+	CloseHandle(child->output);
+	CloseHandle(child->process);
+#elifdef TARGET_LINUX
+	close(child->socket);
+	auto const deadline = steady_clock::now() + ChildExitTimeout;
+	auto exited = false;
+	while (!exited && steady_clock::now() < deadline) {
+		exited = waitpid(child->pid, nullptr, WNOHANG) != 0;
+		if (!exited) sleep_for(10ms);
+	}
+	if (!exited) {
+		kill(child->pid, SIGKILL);
+		waitpid(child->pid, nullptr, 0);
+	}
+#endif
+	delete child;
+}
+
+#ifdef TARGET_WINDOWS
+// Quote an argument so that the child's CommandLineToArgvW() or C runtime parses it back unchanged.
+// Backslashes are only special when they precede a quote, including the closing one.
+static auto quote_argument(std::wstring_view arg) -> std::wstring
+{
+	auto result = std::wstring{L"\""};
+	auto backslashes = 0z;
+	for (auto c: arg) {
+		if (c == L'\\') {
+			backslashes += 1;
+			continue;
+		}
+		if (c == L'"') backslashes = backslashes * 2 + 1;
+		result.append(backslashes, L'\\');
+		backslashes = 0;
+		result.push_back(c);
+	}
+	result.append(backslashes * 2, L'\\');
+	result.push_back(L'"');
+	return result;
+}
+#endif
+
+auto spawn_process(fs::path const& executable, span<string const> args) -> ChildProcess
+{
+#ifdef TARGET_WINDOWS
+	auto security = SECURITY_ATTRIBUTES{
+		.nLength = sizeof(SECURITY_ATTRIBUTES),
+		.lpSecurityDescriptor = nullptr,
+		.bInheritHandle = TRUE,
+	};
+	auto child_input = HANDLE{};
+	auto input = HANDLE{};
+	auto output = HANDLE{};
+	auto child_output = HANDLE{};
+	if (!CreatePipe(&child_input, &input, &security, 0))
+		throw runtime_error_fmt("Failed to create a pipe: error {}", GetLastError());
+	if (!CreatePipe(&output, &child_output, &security, 0)) {
+		auto const error = GetLastError();
+		CloseHandle(child_input);
+		CloseHandle(input);
+		throw runtime_error_fmt("Failed to create a pipe: error {}", error);
+	}
+	SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+	auto child_error = HANDLE{};
+	if (auto const error_handle = GetStdHandle(STD_ERROR_HANDLE); error_handle && error_handle != INVALID_HANDLE_VALUE)
+		DuplicateHandle(GetCurrentProcess(), error_handle, GetCurrentProcess(), &child_error, 0, TRUE, DUPLICATE_SAME_ACCESS);
+
+	// The child inherits only the handles on this list. Without it, it would also inherit
+	// the pipes of children being spawned by other threads at the same time, and those
+	// children would never see their input close
+	auto inherited = vector<HANDLE>{child_input, child_output};
+	if (child_error) inherited.emplace_back(child_error);
+	auto attributes_size = SIZE_T{};
+	InitializeProcThreadAttributeList(nullptr, 1, 0, &attributes_size);
+	auto attributes_storage = vector<byte>(attributes_size);
+	auto* attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributes_storage.data());
+	auto const attributes_initialized = InitializeProcThreadAttributeList(attributes, 1, 0, &attributes_size);
+	auto const attributes_ready = attributes_initialized &&
+		UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited.data(),
+			inherited.size() * sizeof(HANDLE), nullptr, nullptr);
+
+	auto command_line = quote_argument(executable.wstring());
+	for (auto const& arg: args) command_line += L" " + quote_argument(fs::path{arg}.wstring());
+	auto startup = STARTUPINFOEXW{};
+	startup.StartupInfo.cb = sizeof(startup);
+	startup.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+	startup.StartupInfo.hStdInput = child_input;
+	startup.StartupInfo.hStdOutput = child_output;
+	startup.StartupInfo.hStdError = child_error;
+	startup.lpAttributeList = attributes;
+	auto process_info = PROCESS_INFORMATION{};
+	auto const created = attributes_ready && CreateProcessW(nullptr, command_line.data(), nullptr, nullptr, TRUE,
+		CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startup.StartupInfo, &process_info);
+	auto const error = GetLastError();
+	if (attributes_initialized) DeleteProcThreadAttributeList(attributes);
+	CloseHandle(child_input);
+	CloseHandle(child_output);
+	if (child_error) CloseHandle(child_error);
+	if (!created) {
+		CloseHandle(input);
+		CloseHandle(output);
+		throw runtime_error_fmt("Failed to start \"{}\": error {}", executable, error);
+	}
+	CloseHandle(process_info.hThread);
+	return ChildProcess{new detail::ChildProcess_t{
+		.process = process_info.hProcess,
+		.input = input,
+		.output = output,
+	}};
+#elifdef TARGET_LINUX
+	// A socket rather than a pipe, so that writes to a crashed child don't raise SIGPIPE
+	auto sockets = array<int, 2>{};
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets.data()) != 0)
+		throw system_error("Failed to create a socket pair");
+	auto actions = posix_spawn_file_actions_t{};
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, sockets[1], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, sockets[1], STDOUT_FILENO);
+
+	auto const executable_str = executable.string();
+	auto argv = vector<char*>{};
+	argv.emplace_back(const_cast<char*>(executable_str.c_str()));
+	for (auto const& arg: args) argv.emplace_back(const_cast<char*>(arg.c_str()));
+	argv.emplace_back(nullptr);
+	auto pid = pid_t{};
+	auto const error = posix_spawn(&pid, executable_str.c_str(), &actions, nullptr, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(sockets[1]);
+	if (error != 0) {
+		close(sockets[0]);
+		errno = error;
+		throw system_error_fmt("Failed to start \"{}\"", executable);
+	}
+	return ChildProcess{new detail::ChildProcess_t{
+		.pid = pid,
+		.socket = sockets[0],
+	}};
+#endif
+}
+
+auto write_to_process(ChildProcess& child, string_view data) -> bool
+{
+	while (!data.empty()) {
+#ifdef TARGET_WINDOWS
+		auto written = DWORD{};
+		if (!WriteFile(child->input, data.data(), static_cast<DWORD>(data.size()), &written, nullptr))
+			return false;
+#elifdef TARGET_LINUX
+		auto const written = send(child->socket, data.data(), data.size(), MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR) continue;
+		if (written < 0) return false;
+#endif
+		data.remove_prefix(written);
+	}
+	return true;
+}
+
+auto read_line_from_process(ChildProcess& child) -> optional<string>
+{
+	auto chunk = array<char, 4096>{};
+	while (true) {
+		if (auto const end = child->buffer.find('\n'); end != string::npos) {
+			auto line = child->buffer.substr(0, end);
+			child->buffer.erase(0, end + 1);
+			if (line.ends_with('\r')) line.pop_back();
+			return line;
+		}
+		if (child->closed) return nullopt;
+#ifdef TARGET_WINDOWS
+		auto received = DWORD{};
+		if (!ReadFile(child->output, chunk.data(), static_cast<DWORD>(chunk.size()), &received, nullptr) || received == 0)
+			return nullopt;
+#elifdef TARGET_LINUX
+		auto const received = recv(child->socket, chunk.data(), chunk.size(), 0);
+		if (received < 0 && errno == EINTR) continue;
+		if (received <= 0) return nullopt;
+#endif
+		child->buffer.append(chunk.data(), received);
+	}
+}
+
+auto wait_for_process_output(ChildProcess& child, milliseconds timeout) -> bool
+{
+	// Whatever is available is read into the buffer without blocking, so that a child which writes
+	// part of a line and then hangs can't stall the caller past the timeout
+	auto chunk = array<char, 4096>{};
+	auto const deadline = steady_clock::now() + timeout;
+	while (true) {
+		if (child->buffer.contains('\n') || child->closed) return true;
+#ifdef TARGET_WINDOWS
+		// Anonymous pipes can't be waited on, so poll them along with the process
+		static constexpr auto PollInterval = 10ms;
+		auto available = DWORD{};
+		if (!PeekNamedPipe(child->output, nullptr, 0, nullptr, &available, nullptr)) {
+			child->closed = true;
+			continue;
+		}
+		if (available > 0) {
+			auto received = DWORD{};
+			if (!ReadFile(child->output, chunk.data(), min(available, static_cast<DWORD>(chunk.size())), &received, nullptr) || received == 0)
+				child->closed = true;
+			else
+				child->buffer.append(chunk.data(), received);
+			continue;
+		}
+		if (steady_clock::now() >= deadline) return false;
+		// Once the process is gone, the pipe reports the end of its output on the next peek
+		WaitForSingleObject(child->process, static_cast<DWORD>(PollInterval / 1ms));
+#elifdef TARGET_LINUX
+		auto const remaining = max(duration_cast<milliseconds>(deadline - steady_clock::now()), 0ms);
+		auto fd = pollfd{.fd = child->socket, .events = POLLIN};
+		auto const ready = poll(&fd, 1, static_cast<int>(remaining / 1ms));
+		if (ready < 0 && errno == EINTR) continue;
+		if (ready == 0) return false;
+		if (ready < 0) {
+			child->closed = true;
+			continue;
+		}
+		auto const received = recv(child->socket, chunk.data(), chunk.size(), MSG_DONTWAIT);
+		if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+		if (received <= 0) child->closed = true;
+		else child->buffer.append(chunk.data(), received);
+#endif
+	}
+}
+
+void kill_process(ChildProcess& child) noexcept
+{
+#ifdef TARGET_WINDOWS
+	TerminateProcess(child->process, EXIT_FAILURE);
+#elifdef TARGET_LINUX
+	kill(child->pid, SIGKILL);
+#endif
+}
+
 auto get_subpixel_layout() -> SubpixelLayout
 {
 #ifdef TARGET_WINDOWS
@@ -35,6 +35,53 @@ void end_scheduler_period([[maybe_unused]] milliseconds period) noexcept;
 // Windows-only; on Linux use stderr output, as the console is always available there.
 void block_with_message(string_view message);
 
+// Resources used by the current process since it started.
+struct ProcessUsage {
+	nanoseconds cpu_time; // User and kernel time of all threads
+	ssize_t rss; // Current resident set size, in bytes
+	ssize_t peak_rss; // Largest resident set size since the process started, in bytes
+};
+
+// Retrieve the resource usage of the current process.
+// Throws runtime_error on failure.
+auto get_process_usage() -> ProcessUsage;
+
+// Return the path of the running executable.
+// Throws runtime_error on failure.
+[[nodiscard]] auto get_executable_path() -> fs::path;
+
+namespace detail {
+struct ChildProcess_t;
+struct ChildProcessDeleter {
+	static void operator()(ChildProcess_t*) noexcept;
+};
+}
+
+// A running executable, with its standard input and output connected to the parent. Once destroyed,
+// the child's input is closed, and the child is given a moment to exit before it's killed.
+using ChildProcess = unique_resource<detail::ChildProcess_t*, detail::ChildProcessDeleter>;
+
+// Start an executable with the provided arguments. Its standard error is inherited.
+// Throws runtime_error on failure.
+[[nodiscard]] auto spawn_process(fs::path const& executable, span<string const> args) -> ChildProcess;
+
+// Write to the standard input of a child process. Returns false if the child closed it,
+// such as by exiting or crashing.
+auto write_to_process(ChildProcess&, string_view) -> bool;
+
+// Read a line from the standard output of a child process, without the line terminator. Blocks until
+// a full line is available. Returns nullopt once the child closes it, such as by exiting or crashing.
+[[nodiscard]] auto read_line_from_process(ChildProcess&) -> optional<string>;
+
+// Wait up to the timeout for a child process to write a full line to its standard output, or to exit.
+// Returns true if read_line_from_process() can return without blocking, false if the timeout expired
+// first. Partial lines received in the meantime are kept for later.
+[[nodiscard]] auto wait_for_process_output(ChildProcess&, milliseconds timeout) -> bool;
+
+// Kill a child process immediately, without waiting for it to exit on its own. It can still
+// be destroyed as usual afterwards.
+void kill_process(ChildProcess&) noexcept;
+
 // OS subpixel layout setting value.
 enum class SubpixelLayout {
 	None,
@@ -63,6 +63,18 @@ auto create_runtime(vk::Instance instance, vk::Device device, vk::QueueSet const
 	}};
 }
 
+auto load_pipeline_cache(Runtime& runtime, span<byte const> data) -> bool
+{
+	// vuk only reads from the span
+	return runtime.load_pipeline_cache(std::span{const_cast<byte*>(data.data()), data.size()});
+}
+
+auto save_pipeline_cache(Runtime& runtime) -> vector<byte>
+{
+	auto data = runtime.save_pipeline_cache();
+	return vector<byte>{data.begin(), data.end()};
+}
+
 [[nodiscard]] auto create_swapchain(Allocator& allocator, vk::Device device, int2 size,
 	int image_count, optional<Swapchain> old) -> Swapchain
 {
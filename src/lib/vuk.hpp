@@ -46,6 +46,14 @@ struct Texture {
 // Throws if vuk throws.
 auto create_runtime(vk::Instance instance, vk::Device device, vk::QueueSet const& queues) -> Runtime;
 
+// Replace the runtime's pipeline cache with previously saved data. Must be called before any
+// pipelines are created. Returns false if the data was rejected, in which case the cache is empty.
+auto load_pipeline_cache(Runtime& runtime, span<byte const> data) -> bool;
+
+// Serialize the runtime's pipeline cache, including all pipelines created so far.
+// Throws if vuk throws.
+auto save_pipeline_cache(Runtime& runtime) -> vector<byte>;
+
 // An allocator resource providing memory for objects that span multiple frames, and is the parent
 // resource for single-frame resources.
 using GlobalResource = DeviceSuperFrameResource;
@@ -142,6 +150,20 @@ auto create_texture(Allocator& allocator, const_multi_array_ref<T, 3> data, Form
 	return {move(result), host_data_to_image(allocator, DomainFlagBits::eTransferOnTransfer, ia, data.data())};
 }
 
+// Overwrite the contents of an existing texture with data of the same dimensions, staged through
+// a buffer from the provided frame allocator. The texture's previous uses must match the given
+// access. Returns the future of the upload.
+// Throws if vuk throws.
+template<typename T>
+auto update_texture(Allocator& allocator, Texture const& texture, const_multi_array_ref<T, 3> data,
+	Access previous_access) -> ManagedImage
+{
+	auto const staging_raw = create_scratch_buffer(allocator, span{data.data(), data.num_elements()});
+	auto staging = acquire_buf("texture staging", staging_raw, Access::eNone);
+	auto dest = acquire_ia("texture", texture.attachment, previous_access);
+	return ::vuk::copy(move(staging), move(dest));
+}
+
 // Set the default command buffer configuration used by this application.
 // Throws if vuk throws.
 auto set_cmd_defaults(CommandBuffer& cmd) -> CommandBuffer&;
@@ -176,6 +176,14 @@ auto get_device_name(PhysicalDevice const& physical_device) -> string_view
 	return physical_device->properties.deviceName;
 }
 
+auto get_pipeline_cache_id(PhysicalDevice const& physical_device) -> string
+{
+	auto const& properties = physical_device->properties;
+	auto result = format("{:04x}-{:04x}-{:08x}-", properties.vendorID, properties.deviceID, properties.driverVersion);
+	for (auto b: properties.pipelineCacheUUID) format_to(back_inserter(result), "{:02x}", b);
+	return result;
+}
+
 auto create_device(PhysicalDevice const& physical_device) -> Device
 {
 	auto device_result = vkb::DeviceBuilder(*physical_device).build();
@@ -70,6 +70,10 @@ auto get_driver_version(PhysicalDevice const& physical_device) -> array<uint, 3>
 // Return a GPU's name as reported by the driver.
 auto get_device_name(PhysicalDevice const& physical_device) -> string_view;
 
+// Return a string that identifies the GPU and driver combination. Pipeline cache data is only
+// reusable between runs with the same identifier.
+auto get_pipeline_cache_id(PhysicalDevice const& physical_device) -> string;
+
 // A logical Vulkan device created from a physical one.
 using Device = vkb::Device*;
 
@@ -10,6 +10,7 @@ or distributed except according to those terms.
 #include "lib/zstd.hpp"
 
 #include <zstd.h>
+#include <zdict.h>
 #include "preamble.hpp"
 
 namespace playnote::lib::zstd {
@@ -31,6 +32,18 @@ auto compress(span<byte const> data, CompressionLevel level) -> vector<byte>
 	return result;
 }
 
+auto compress(span<byte const> data, span<byte const> dictionary, CompressionLevel level) -> vector<byte>
+{
+	auto ctx = unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)>{ZSTD_createCCtx(), &ZSTD_freeCCtx};
+	if (!ctx) throw runtime_error{"zstd error: failed to create compression context"};
+	auto result = vector<byte>{};
+	result.resize(ZSTD_compressBound(data.size()));
+	auto const size = ret_check(ZSTD_compress_usingDict(ctx.get(), result.data(), result.size(),
+		data.data(), data.size(), dictionary.data(), dictionary.size(), +level));
+	result.resize(size);
+	return result;
+}
+
 auto decompress(span<byte const> data) -> vector<byte>
 {
 	auto result = vector<byte>{};
@@ -39,4 +52,32 @@ auto decompress(span<byte const> data) -> vector<byte>
 	return result;
 }
 
+auto decompress(span<byte const> data, span<byte const> dictionary) -> vector<byte>
+{
+	auto ctx = unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>{ZSTD_createDCtx(), &ZSTD_freeDCtx};
+	if (!ctx) throw runtime_error{"zstd error: failed to create decompression context"};
+	auto result = vector<byte>{};
+	result.resize(ret_check(ZSTD_getFrameContentSize(data.data(), data.size())));
+	ret_check(ZSTD_decompress_usingDict(ctx.get(), result.data(), result.size(),
+		data.data(), data.size(), dictionary.data(), dictionary.size()));
+	return result;
+}
+
+auto train_dictionary(span<span<byte const> const> samples, ssize_t max_size) -> vector<byte>
+{
+	// ZDICT expects all samples concatenated
+	auto buffer = vector<byte>{};
+	auto sizes = vector<size_t>{};
+	for (auto sample: samples) {
+		copy(sample, back_inserter(buffer));
+		sizes.emplace_back(sample.size());
+	}
+	auto result = vector<byte>{};
+	result.resize(max_size);
+	auto const size = ZDICT_trainFromBuffer(result.data(), result.size(), buffer.data(), sizes.data(), sizes.size());
+	if (ZDICT_isError(size)) throw runtime_error_fmt("Failed to train zstd dictionary: {}", ZDICT_getErrorName(size));
+	result.resize(size);
+	return result;
+}
+
 }
@@ -20,7 +20,19 @@ enum class CompressionLevel {
 // Compress arbitrary data.
 auto compress(span<byte const> data, CompressionLevel = CompressionLevel::Normal) -> vector<byte>;
 
+// Compress data with a shared dictionary. The same dictionary is needed to decompress it.
+auto compress(span<byte const> data, span<byte const> dictionary,
+	CompressionLevel = CompressionLevel::Normal) -> vector<byte>;
+
 // Decompress arbitrary data.
 auto decompress(span<byte const> data) -> vector<byte>;
 
+// Decompress data that was compressed with a shared dictionary.
+auto decompress(span<byte const> data, span<byte const> dictionary) -> vector<byte>;
+
+// Train a dictionary of at most max_size bytes from a set of samples that are similar
+// to each other.
+// Throws runtime_error if there are too few samples to train on.
+auto train_dictionary(span<span<byte const> const> samples, ssize_t max_size) -> vector<byte>;
+
 }
@@ -55,6 +55,7 @@ using std::ranges::fold_left;
 using std::ranges::any_of;
 using std::ranges::min_element;
 using std::ranges::max_element;
+using std::ranges::lower_bound;
 
 using std::distance;
 using std::function;
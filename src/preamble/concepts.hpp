@@ -16,6 +16,7 @@ namespace playnote {
 
 using std::same_as;
 using std::convertible_to;
+using std::copy_constructible;
 
 template<typename T, typename Base>
 concept implements = std::derived_from<T, Base>;
@@ -22,6 +22,7 @@ or distributed except according to those terms.
 #include <boost/container/static_vector.hpp>
 #include <boost/container/small_vector.hpp>
 #include <boost/container/vector.hpp>
+#include <boost/container/deque.hpp>
 #include "readerwriterqueue.h"
 #include "concurrentqueue/moodycamel/concurrentqueue.h"
 #include "plf_colony.h"
@@ -32,6 +33,7 @@ namespace playnote {
 using boost::container::vector;
 using boost::container::static_vector;
 using boost::container::small_vector;
+using boost::container::deque;
 using plf::colony;
 using std::back_inserter;
 using std::array;
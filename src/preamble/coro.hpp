@@ -14,11 +14,14 @@ namespace playnote {
 
 template<typename T = void>
 using task = coro::task<T>;
-using task_container = coro::task_container<coro::thread_pool>;
 using coro::generator;
 using coro::when_all;
 using coro::sync_wait;
-using coro::thread_pool;
 using coro_mutex = coro::mutex;
 
+// Coroutine frame allocator, implemented in utils/frame_pool.cpp. Task promises use it via
+// a patch applied to libcoro (cmake/PatchLibcoro.cmake).
+[[nodiscard]] auto allocate_coro_frame(std::size_t) -> void*;
+void free_coro_frame(void*, std::size_t) noexcept;
+
 }
@@ -12,6 +12,7 @@ or distributed except according to those terms.
 #include <atomic>
 #include <future>
 #include <thread>
+#include <shared_mutex>
 #include <mutex>
 #include <latch>
 
@@ -19,23 +20,36 @@ namespace playnote {
 
 namespace fs {
 	using std::filesystem::path;
+	using std::filesystem::file_time_type;
 	using std::filesystem::status;
 	using std::filesystem::exists;
 	using std::filesystem::is_regular_file;
 	using std::filesystem::is_directory;
+	using std::filesystem::file_size;
+	using std::filesystem::last_write_time;
+	using std::filesystem::absolute;
+	using std::filesystem::temp_directory_path;
 	using std::filesystem::create_directory;
+	using std::filesystem::create_directories;
 	using std::filesystem::directory_iterator;
 	using std::filesystem::recursive_directory_iterator;
 	using std::filesystem::directory_entry;
 	using std::filesystem::relative;
 	using std::filesystem::remove;
+	using std::filesystem::remove_all;
 	using std::filesystem::rename;
 }
 using std::jthread;
 using std::this_thread::sleep_for;
 using std::this_thread::yield;
 using std::atomic;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
 using std::mutex;
+using std::recursive_mutex;
+using std::shared_mutex;
+using std::shared_lock;
 using std::lock_guard;
 using std::latch;
 using std::promise;
@@ -34,6 +34,7 @@ using std::literals::operator""s;
 using std::literals::operator""sv;
 using fmtquill::format_string;
 using fmtquill::format;
+using fmtquill::format_to;
 using fmtquill::print;
 using boost::iequals;
 using boost::trim_copy;
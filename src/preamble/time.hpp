@@ -21,6 +21,7 @@ using std::chrono::seconds;
 using std::chrono::duration;
 using std::chrono::duration_cast;
 using std::chrono::abs;
+using std::chrono::steady_clock;
 
 // Returns the ratio of two durations as a floating-point number.
 template<typename LRep, typename LPeriod, typename RRep, typename RPeriod>
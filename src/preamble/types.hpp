@@ -22,6 +22,7 @@ using std::uint16_t;
 using uint = std::uint32_t;
 using std::uint64_t;
 using std::size_t;
+using std::uintptr_t;
 using ssize_t = decltype(0z);
 using std::byte;
 
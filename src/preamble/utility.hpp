@@ -20,6 +20,7 @@ or distributed except according to those terms.
 #include <tuple>
 #include <bit>
 #include <boost/scope/unique_resource.hpp>
+#include <boost/scope/scope_exit.hpp>
 #define MAGIC_ENUM_RANGE_MIN -1
 #define MAGIC_ENUM_RANGE_MAX 64
 #include <magic_enum/magic_enum.hpp>
@@ -51,6 +52,7 @@ using std::make_shared;
 using std::weak_ptr;
 using std::static_pointer_cast;
 using boost::scope::unique_resource;
+using boost::scope::scope_exit;
 using std::type_index;
 using std::void_t;
 using std::remove_cvref_t;
@@ -59,9 +61,11 @@ using std::make_index_sequence;
 using std::tuple_size_v;
 using std::tuple_element_t;
 using std::unreachable;
+using std::bit_cast;
 using magic_enum::enum_name;
 using magic_enum::enum_cast;
 using magic_enum::enum_count;
+using magic_enum::enum_values;
 
 // Constructs a type with overloaded operator()s, for use as a std::variant visitor
 template<typename... Ts>
@@ -15,8 +15,13 @@ except according to those terms.
 #include "utils/logger.hpp"
 #include "utils/assets.hpp"
 #include "utils/config.hpp"
+#include "utils/frame_pool.hpp"
+#include "utils/memory.hpp"
+#include "utils/tracing.hpp"
+#include "utils/alloc_audit.hpp"
 #include "lib/imgui.hpp"
 #include "lib/os.hpp"
+#include "lib/openssl.hpp"
 #include "dev/window.hpp"
 #include "gfx/playfield.hpp"
 #include "gfx/transform.hpp"
@@ -24,6 +29,8 @@ except according to those terms.
 #include "audio/player.hpp"
 #include "bms/library.hpp"
 #include "bms/cursor.hpp"
+#include "bms/bga.hpp"
+#include "bms/ghost.hpp"
 #include "bms/mapper.hpp"
 #include "bms/chart.hpp"
 #include "bms/score.hpp"
@@ -51,6 +58,8 @@ struct SelectContext {
 	vector<bms::Library::ChartEntry> charts;
 	optional<future<vector<bms::Library::ChartEntry>>> library_reload_result;
 	optional<future<shared_ptr<bms::Chart const>>> chart_load_result;
+	optional<future<vector<bms::Library::SimilarChart>>> similar_result;
+	vector<bms::Library::SimilarChart> similar_charts; // Results of the last similarity search
 	gfx::TransformRef mouse;
 	gfx::Text some_text;
 };
@@ -61,7 +70,11 @@ struct GameplayContext {
 	optional<bms::Score> score;
 	audio::Player player;
 	optional<gfx::Playfield> playfield;
+	optional<bms::BGAPlayer> bga;
+	vector<unique_ptr<bms::Ghost>> ghosts; // Earlier attempts at the chart, oldest first
+	nanoseconds ghost_update_time; // Spent advancing all ghosts on the last frame
 	double scroll_speed;
+	Config::Observer scroll_speed_observer; // Keeps scroll_speed in sync with the config entry
 	milliseconds offset;
 };
 
@@ -118,6 +131,24 @@ static void show_metadata(GameplayContext const& context)
 	}, 120, true);
 }
 
+// Start the chart over with a new cursor. The attempt that was in progress becomes a ghost.
+static void restart_gameplay(GameplayContext& context, bool autoplay)
+{
+	static constexpr auto MaxGhosts = 64z;
+	context.player.remove_cursor(context.cursor);
+	if (auto recording = context.cursor->get_recording(); recording && !recording->empty()) {
+		if (ssize(context.ghosts) >= MaxGhosts) context.ghosts.erase(context.ghosts.begin());
+		context.ghosts.emplace_back(make_unique<bms::Ghost>(context.chart, move(recording)));
+	}
+	context.cursor = make_shared<bms::Cursor>(context.chart, autoplay);
+	if (!autoplay) context.cursor->start_recording();
+	context.player.add_cursor(context.cursor, bms::Mapper{});
+	context.score = bms::Score{*context.chart};
+	context.playfield.emplace(gfx::Transform{30.0f, 0.0f}, 420.f, *context.cursor, *context.score);
+	// A restart replaces the cursor, score and playfield, and the frames after it refill their caches
+	ALLOC_AUDIT_RESET();
+}
+
 static void show_playback_controls(GameState& state)
 {
 	auto& context = state.gameplay_context();
@@ -125,21 +156,9 @@ static void show_playback_controls(GameState& state)
 	lib::imgui::same_line();
 	if (lib::imgui::button("Pause")) context.player.pause();
 	lib::imgui::same_line();
-	if (lib::imgui::button("Restart")) {
-		context.player.remove_cursor(context.cursor);
-		context.cursor = make_shared<bms::Cursor>(context.chart, false);
-		context.player.add_cursor(context.cursor, bms::Mapper{});
-		context.score = bms::Score{*context.chart};
-		context.playfield.emplace(gfx::Transform{30.0f, 0.0f}, 420.f, *context.cursor, *context.score);
-	}
+	if (lib::imgui::button("Restart")) restart_gameplay(context, false);
 	lib::imgui::same_line();
-	if (lib::imgui::button("Autoplay")) {
-		context.player.remove_cursor(context.cursor);
-		context.cursor = make_shared<bms::Cursor>(context.chart, true);
-		context.player.add_cursor(context.cursor, bms::Mapper{});
-		context.score = bms::Score{*context.chart};
-		context.playfield.emplace(gfx::Transform{30.0f, 0.0f}, 420.f, *context.cursor, *context.score);
-	}
+	if (lib::imgui::button("Autoplay")) restart_gameplay(context, true);
 	lib::imgui::same_line();
 	if (lib::imgui::button("Back")) state.requested = State::Select;
 }
@@ -171,24 +190,70 @@ static void show_results(bms::Score const& score)
 	lib::imgui::text(" Rank: {}", enum_name(score.get_rank()));
 }
 
+// Compare the live score against the best ghost at the same point of the chart.
+static void show_ghosts(GameplayContext const& context)
+{
+	if (context.ghosts.empty()) return;
+	auto const& best = *max_element(context.ghosts, [](auto const& left, auto const& right) {
+		return left->get_score().get_score() < right->get_score().get_score();
+	});
+	auto const diff = context.score->get_score() - best->get_score().get_score();
+	lib::imgui::text("Ghosts: {}, best {} ({:+})", ssize(context.ghosts), best->get_score().get_score(), diff);
+	lib::imgui::text("Ghost update: {}us", context.ghost_update_time / 1us);
+}
+
+static void start_chart_load(GameState& state, bms::MD5 md5)
+{
+	state.select_context().chart_load_result = launch_pollable(Priority::Load,
+		[](shared_ptr<bms::Library> library, bms::MD5 md5, int sampling_rate) -> task<shared_ptr<bms::Chart const>> {
+			co_return co_await library->load_chart(*globals::scheduler, md5, sampling_rate);
+		}(state.library, md5, globals::mixer->get_audio().get_sampling_rate()));
+	state.requested = State::Gameplay;
+}
+
+// List the charts found by the last similarity search, if any.
+static void show_similar_charts(GameState& state)
+{
+	auto& context = state.select_context();
+	if (context.similar_result && context.similar_result->wait_for(0s) == future_status::ready) {
+		context.similar_charts = context.similar_result->get();
+		context.similar_result = nullopt;
+	}
+	if (context.similar_charts.empty()) return;
+
+	lib::imgui::begin_window("similar", {860, 48}, 400, lib::imgui::WindowStyle::Static);
+	lib::imgui::text("Similar charts:");
+	for (auto const& similar: context.similar_charts) {
+		auto const entry = find_if(context.charts, [&](auto const& chart) { return chart.md5 == similar.md5; });
+		if (entry == context.charts.end()) continue;
+		if (lib::imgui::selectable(entry->title.c_str())) start_chart_load(state, similar.md5);
+		lib::imgui::same_line();
+		lib::imgui::text("{:.3f}", similar.distance);
+	}
+	lib::imgui::end_window();
+}
+
 static void render_select(gfx::Renderer::Queue& queue, GameState& state)
 {
+	static constexpr auto SimilarChartCount = 10z;
 	auto& context = state.select_context();
 	lib::imgui::begin_window("library", {8, 8}, 800, lib::imgui::WindowStyle::Static);
 	if (context.charts.empty()) {
 		lib::imgui::text("The library is empty. Drag a song folder or archive onto the game window to import.");
 	} else {
 		for (auto const& chart: context.charts) {
-			if (lib::imgui::selectable(chart.title.c_str())) {
-				context.chart_load_result = pollable_fg(
-					[](shared_ptr<bms::Library> library, bms::MD5 md5) -> task<shared_ptr<bms::Chart const>> {
-						co_return co_await library->load_chart(*globals::fg_pool, md5);
+			if (lib::imgui::button(format("Similar##{}", lib::openssl::md5_to_hex(chart.md5)).c_str())) {
+				context.similar_result = launch_pollable(Priority::Interactive,
+					[](shared_ptr<bms::Library> library, bms::MD5 md5) -> task<vector<bms::Library::SimilarChart>> {
+						co_return co_await library->find_similar_charts(md5, SimilarChartCount);
 					}(state.library, chart.md5));
-				state.requested = State::Gameplay;
 			}
+			lib::imgui::same_line();
+			if (lib::imgui::selectable(chart.title.c_str())) start_chart_load(state, chart.md5);
 		}
 	}
 	lib::imgui::end_window();
+	show_similar_charts(state);
 
 	if (context.chart_load_result) {
 		lib::imgui::begin_window("chart_load", {860, 8}, 96, lib::imgui::WindowStyle::Static);
@@ -619,15 +684,49 @@ static void render_gameplay(gfx::Renderer::Queue& queue, GameState& state)
 	auto& score = *context.score;
 
 	// Update scoring
-	for (auto&& ev: context.cursor->pending_judgment_events())
+	context.cursor->pending_judgment_events([&](auto&& ev) {
+		if (!ev.timing) context.bga->show_poor(cursor.get_progress_ns());
 		score.submit_judgment_event(move(ev));
+	});
+
+	// Ghosts follow the audible position, like the playfield
+	auto const ghost_start = steady_clock::now();
+	for (auto& ghost: context.ghosts) ghost->update(cursor.get_progress_ns());
+	context.ghost_update_time = steady_clock::now() - ghost_start;
+
+	// Update and draw the BGA; rewinding on restart is handled by the player
+	auto const bga_changed = context.bga->update(cursor.get_progress_ns());
+	if (context.bga->is_visible()) {
+		queue.image({
+			.position = {660.0f, 240.0f},
+			.color = {1.0f, 1.0f, 1.0f, 1.0f},
+			.depth = 999, // Just in front of the background
+		}, {
+			.size = {400.0f, 400.0f},
+			.pixels = context.bga->get_image(),
+			.dimensions = {bms::BGAPlayer::CanvasSize, bms::BGAPlayer::CanvasSize},
+			.changed = bga_changed,
+		});
+	}
 
 	lib::imgui::begin_window("info", {860, 8}, 412, lib::imgui::WindowStyle::Static);
 	show_metadata(context);
 	lib::imgui::text("");
 	show_playback_controls(state);
 	lib::imgui::text("");
+	auto const previous_scroll_speed = context.scroll_speed;
 	show_scroll_speed_controls(context.scroll_speed);
+	if (context.scroll_speed != previous_scroll_speed) {
+		globals::config->set_entry(Config::Entry{
+			.category = "gameplay",
+			.name = "scroll_speed",
+			.value = context.scroll_speed,
+		});
+	}
+	auto const bga_stats = context.bga->get_stats();
+	lib::imgui::text("BGA: {} frames decoded in {}ms, {} late", bga_stats.frames_decoded,
+		bga_stats.decode_time / 1ms, bga_stats.frames_late);
+	show_ghosts(context);
 	context.playfield->enqueue(queue, context.scroll_speed, context.offset);
 	lib::imgui::end_window();
 
@@ -669,44 +768,113 @@ static auto render_import_status(ImportStatus const& status) -> bool
 	return reset;
 }
 
+static auto bytes_to_mib(ssize_t bytes) -> double { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+static void render_memory_usage()
+{
+	lib::imgui::begin_window("memory", {8, 560}, 320, lib::imgui::WindowStyle::Static);
+	for (auto tag: enum_values<MemoryTag>()) {
+		auto const usage = get_memory_usage(tag);
+		lib::imgui::text("{}: {:.1f} MiB (peak {:.1f} MiB)", enum_name(tag),
+			bytes_to_mib(usage.current), bytes_to_mib(usage.peak));
+	}
+	lib::imgui::end_window();
+}
+
+// Log memory usage of all subsystems, if any of it changed since the last call.
+static void log_memory_usage(Logger::Category cat, array<ssize_t, enum_count<MemoryTag>()>& last_logged)
+{
+	auto changed = false;
+	auto line = string{"Memory usage:"};
+	for (auto tag: enum_values<MemoryTag>()) {
+		auto const usage = get_memory_usage(tag);
+		if (usage.current != last_logged[+tag]) changed = true;
+		last_logged[+tag] = usage.current;
+		line.append(format(" {} {:.1f} MiB (peak {:.1f} MiB);", enum_name(tag),
+			bytes_to_mib(usage.current), bytes_to_mib(usage.peak)));
+	}
+	line.pop_back();
+	if (changed) INFO_AS(cat, "{}", line);
+}
+
+#ifdef ENABLE_TRACING
+static void render_tracing_controls()
+{
+	lib::imgui::begin_window("tracing", {8, 680}, 120, lib::imgui::WindowStyle::Static);
+	if (lib::imgui::button("Save trace")) tracing::export_chrome_trace(TracePath);
+	lib::imgui::end_window();
+}
+#endif
+
 static void run_render(Broadcaster& broadcaster, dev::Window& window, Logger::Category cat)
 {
-	// Init subsystems
-	auto fg_pool_stub = globals::fg_pool.provide(thread_pool::make_unique({
-		.thread_count = max(1u, jthread::hardware_concurrency() / 2),
-		.on_thread_start_functor = [](auto worker_idx) {
-			lib::os::name_current_thread(format("fg_worker{}", worker_idx));
+	// Init subsystems. Steps that don't need this thread run on the workers in the meantime
+	auto const startup_begin = window.get_time();
+	// Only import and maintenance work runs at lowered OS priority; the user is waiting on the rest.
+	// The groups split the cores between them, and idle foreground workers help with imports
+	auto const thread_count = static_cast<ssize_t>(max(1u, jthread::hardware_concurrency()));
+	auto const foreground_count = max(1z, thread_count / 2);
+	auto scheduler_stub = globals::scheduler.provide(Scheduler::WorkerSet{
+		.thread_count = foreground_count,
+		.on_thread_start = [](auto worker_idx) {
+			lib::os::name_current_thread(format("worker{}", worker_idx));
 		},
-	}));
-	auto bg_pool_stub = globals::bg_pool.provide(thread_pool::make_unique({
-		.thread_count = max(1u, jthread::hardware_concurrency() / 2),
-		.on_thread_start_functor = [](auto worker_idx) {
-			lib::os::name_current_thread(format("bg_worker{}", worker_idx));
+	}, Scheduler::WorkerSet{
+		.thread_count = max(1z, thread_count - foreground_count),
+		.on_thread_start = [](auto worker_idx) {
+			lib::os::name_current_thread(format("worker{}", worker_idx));
 			lib::os::lower_current_thread_priority();
 		},
-	}));
-	DEBUG_AS(cat, "Task pools initialized");
-	auto assets_stub = globals::assets.provide(AssetDBPath);
+	});
+	DEBUG_AS(cat, "Scheduler initialized");
+	auto library_log_level = globals::config->get_entry<string>("logging", "library");
+	auto library_cat = globals::logger->create_category("Library",
+		*enum_cast<Logger::Level>(library_log_level).or_else([&] -> optional<Logger::Level> {
+			throw runtime_error_fmt("Invalid log level: {}", library_log_level);
+		}
+	));
+	auto const import_workers = globals::config->get_entry<int>("system", "import_workers");
+	auto library_opened = launch_pollable(Priority::Interactive,
+		[](Logger::Category library_cat, int import_workers) -> task<shared_ptr<bms::Library>> {
+			auto library = make_shared<bms::Library>(library_cat, *globals::scheduler, LibraryDBPath);
+			if (import_workers > 0)
+				library->use_import_workers(lib::os::get_executable_path().parent_path() / ImportWorkerFilename, import_workers);
+			co_return library;
+		}(library_cat, import_workers));
+	// If startup fails, the library must still be destroyed here rather than on a worker,
+	// since its destructor waits on tasks while the scheduler would already be shutting down
+	auto library_guard = scope_exit{[&] {
+		if (!library_opened.valid()) return;
+		try {
+			auto const library = library_opened.get();
+		} catch (...) {}
+	}};
+	auto assets_stub = globals::assets.provide(AssetPackPath);
 	auto audio_log_level = globals::config->get_entry<string>("logging", "audio");
 	auto audio_cat =  globals::logger->create_category("Audio",
 		*enum_cast<Logger::Level>(audio_log_level).or_else([&] -> optional<Logger::Level> {
 			throw runtime_error_fmt("Invalid log level: {}", audio_log_level);
 		}
 	));
+	auto const audio_begin = window.get_time();
 	auto mixer_stub = globals::mixer.provide(audio_cat);
 	auto transform_pool_stub = gfx::globals::transform_pool.provide();
+	auto const renderer_begin = window.get_time();
 	auto renderer = gfx::Renderer{window, cat};
+	auto const renderer_end = window.get_time();
 
 	// Init game state
 	auto state = GameState{ .window = window };
-	auto library_log_level = globals::config->get_entry<string>("logging", "library");
-	auto library_cat = globals::logger->create_category("Library",
-		*enum_cast<Logger::Level>(library_log_level).or_else([&] -> optional<Logger::Level> {
-			throw runtime_error_fmt("Invalid log level: {}", library_log_level);
-		}
-	));
-	state.library = make_shared<bms::Library>(library_cat, *globals::bg_pool, LibraryDBPath);
+	state.library = library_opened.get();
+	auto const library_wait = window.get_time() - renderer_end;
 	state.requested = State::Select;
+	auto const exit_after_first_frame = globals::config->get_entry<bool>("system", "exit_after_first_frame");
+	auto first_frame = true;
+	auto reported_dropped = 0z;
+	auto const show_memory_usage = globals::config->get_entry<bool>("system", "show_memory_usage");
+	static constexpr auto MemoryLogInterval = 60s;
+	auto next_memory_log = steady_clock::now() + MemoryLogInterval;
+	auto last_logged_memory = array<ssize_t, enum_count<MemoryTag>()>{};
 
 	while (!window.is_closing()) {
 		// Handle state changes
@@ -719,7 +887,7 @@ static void run_render(Broadcaster& broadcaster, dev::Window& window, Logger::Ca
 			state.context.emplace<SelectContext>();
 			state.select_context().mouse = gfx::globals::create_transform();
 			state.select_context().some_text = renderer.prepare_text(gfx::Renderer::TextStyle::SansRegular, "Hello World!\nこんにちは、世界！\n안녕하세요, 세상!");
-			state.select_context().library_reload_result = pollable_fg(
+			state.select_context().library_reload_result = launch_pollable(Priority::Interactive,
 				[](shared_ptr<bms::Library> library) -> task<vector<bms::Library::ChartEntry>> {
 					co_return co_await library->list_charts();
 				}(state.library));
@@ -734,25 +902,35 @@ static void run_render(Broadcaster& broadcaster, dev::Window& window, Logger::Ca
 			auto& context = state.gameplay_context();
 			context.chart = move(chart);
 			context.cursor = make_shared<bms::Cursor>(context.chart, false);
+			context.cursor->start_recording();
 			context.score = bms::Score{*context.chart};
 			broadcaster.shout(RegisterInputQueue{
 				.queue = weak_ptr{context.player.get_input_queue()},
 			});
 			context.player.add_cursor(context.cursor, bms::Mapper{});
 			context.playfield.emplace(gfx::Transform{30.0f, 0.0f}, 420.f, *context.cursor, *context.score);
-			context.scroll_speed = globals::config->get_entry<double>("gameplay", "scroll_speed"),
+			context.bga.emplace(context.chart);
+			static constexpr auto ScrollSpeed = Config::Key<double>{"gameplay", "scroll_speed"};
+			context.scroll_speed = globals::config->get_entry(ScrollSpeed);
+			context.scroll_speed_observer = globals::config->observe(ScrollSpeed,
+				[&context](double const& speed) { context.scroll_speed = speed; });
 			context.offset = milliseconds{globals::config->get_entry<int>("gameplay", "note_offset")};
 			state.current = State::Gameplay;
 			state.requested = State::None;
 		}
 
 		// Handle chart library
-		for (auto ev: broadcaster.receive_all<FileDrop>())
+		broadcaster.receive_all<FileDrop>([&](auto&& ev) {
 			for (auto const& path: ev.paths) state.library->import(path);
+		});
+		if (auto const dropped = broadcaster.get_total_dropped_count(); dropped != reported_dropped) {
+			WARN_AS(cat, "{} cross-thread messages were dropped because a channel was full", dropped - reported_dropped);
+			reported_dropped = dropped;
+		}
 		if (state.current == State::Select) {
 			auto& context = state.select_context();
 			if (state.library->is_dirty() && !context.library_reload_result) {
-				state.select_context().library_reload_result = pollable_fg(
+				state.select_context().library_reload_result = launch_pollable(Priority::Interactive,
 					[](shared_ptr<bms::Library> library) -> task<vector<bms::Library::ChartEntry>> {
 						co_return co_await library->list_charts();
 					}(state.library)
@@ -784,6 +962,12 @@ static void run_render(Broadcaster& broadcaster, dev::Window& window, Logger::Ca
 			}
 		}
 
+		TRACE_COUNTER("Coroutine frame memory", get_coro_frame_stats().slab_bytes);
+		if (steady_clock::now() >= next_memory_log) {
+			log_memory_usage(cat, last_logged_memory);
+			next_memory_log += MemoryLogInterval;
+		}
+
 		// Render a frame
 		renderer.frame([&](gfx::Renderer::Queue& queue) {
 			// Background
@@ -806,7 +990,26 @@ static void run_render(Broadcaster& broadcaster, dev::Window& window, Logger::Ca
 					state.import_status = nullopt;
 				}
 			}
+			if (show_memory_usage) render_memory_usage();
+#ifdef ENABLE_TRACING
+			render_tracing_controls();
+#endif
 		});
+
+		if (first_frame) {
+			INFO_AS(cat, "First frame presented {}ms after launch ({}ms in startup: audio {}ms, renderer {}ms, waiting on library {}ms)",
+				window.get_time() / 1ms, (window.get_time() - startup_begin) / 1ms, (renderer_begin - audio_begin) / 1ms,
+				(renderer_end - renderer_begin) / 1ms, library_wait / 1ms);
+			first_frame = false;
+			if (exit_after_first_frame) window.request_close();
+		}
+
+		// Only gameplay is expected to reach an allocation-free steady state; menus and loading
+		// allocate freely, so gameplay starts with a fresh warmup period
+		if (state.current == State::Gameplay)
+			ALLOC_AUDIT_FRAME("Gameplay");
+		else
+			ALLOC_AUDIT_RESET();
 	}
 }
 
@@ -814,7 +1017,7 @@ void render_thread(Broadcaster& broadcaster, Barriers<2>& barriers, dev::Window&
 try {
 	lib::os::name_current_thread("render");
 	broadcaster.register_as_endpoint();
-	broadcaster.subscribe<FileDrop>();
+	broadcaster.subscribe<FileDrop>(Broadcaster::DefaultChannelCapacity, Broadcaster::Overflow::Grow);
 	barriers.startup.arrive_and_wait();
 	auto render_log_level = globals::config->get_entry<string>("logging", "render");
 	auto cat = globals::logger->create_category("Render",
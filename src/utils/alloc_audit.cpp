@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/alloc_audit.hpp"
+
+#ifdef ENABLE_ALLOC_AUDIT
+
+#include <cstdlib>
+#include <new>
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+
+namespace playnote::alloc_audit {
+
+namespace {
+
+// Trivially constructible, so that operator new can use it at any point of the thread's lifetime.
+struct ThreadState {
+	ssize_t allocations = 0;
+	ssize_t frame_start = 0; // Value of allocations at the start of the current frame
+	ssize_t frames = 0; // Since the last reset
+	ssize_t flagged_frames = 0;
+	steady_clock::time_point last_report = {};
+};
+constinit thread_local auto thread_state = ThreadState{};
+
+}
+
+auto thread_allocation_count() noexcept -> ssize_t { return thread_state.allocations; }
+
+void end_frame(string_view name)
+{
+	auto& state = thread_state;
+	auto const allocations = state.allocations - state.frame_start;
+	state.frames += 1;
+	if (allocations > 0 && state.frames > WarmupFrames) {
+		state.flagged_frames += 1;
+		// One report per second is enough to find the culprit with a debugger
+		auto const now = steady_clock::now();
+		if (now - state.last_report >= 1s) {
+			WARN("{}: frame made {} heap allocations in steady state ({} such frames so far)",
+				name, allocations, state.flagged_frames);
+			state.last_report = now;
+		}
+	}
+	state.frame_start = state.allocations; // Don't count the report towards the next frame
+}
+
+void reset() noexcept
+{
+	thread_state.frames = 0;
+	thread_state.frame_start = thread_state.allocations;
+}
+
+}
+
+// Replacements of the global allocation functions. The array, nothrow and sized variants
+// forward to these by default.
+
+auto operator new(std::size_t size) -> void*
+{
+	playnote::alloc_audit::thread_state.allocations += 1;
+	if (auto* ptr = std::malloc(size? size : 1)) return ptr;
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+auto operator new(std::size_t size, std::align_val_t align) -> void*
+{
+	playnote::alloc_audit::thread_state.allocations += 1;
+	auto const alignment = static_cast<std::size_t>(align);
+#ifdef TARGET_WINDOWS
+	if (auto* ptr = _aligned_malloc(size? size : 1, alignment)) return ptr;
+#else
+	// aligned_alloc requires the size to be a multiple of the alignment
+	if (auto* ptr = std::aligned_alloc(alignment, (std::max(size, 1uz) + alignment - 1) / alignment * alignment)) return ptr;
+#endif
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#ifdef TARGET_WINDOWS
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+#endif
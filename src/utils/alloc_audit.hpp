@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+// Heap allocation auditing, for loops that are expected to stop allocating once they reach
+// a steady state. Enabled with the PLAYNOTE_ALLOC_AUDIT CMake option, which replaces the global
+// operator new with a counting version; otherwise all macros compile to nothing. Audit builds
+// don't link mimalloc, since it replaces operator new as well.
+//
+// Only allocations made through operator new are counted. Libraries that call malloc directly
+// are invisible to the auditor.
+
+#ifdef ENABLE_ALLOC_AUDIT
+
+// Mark the boundary between two frames of a loop running on the current thread. After a warmup
+// period, every frame that allocated is reported.
+#define ALLOC_AUDIT_FRAME(name) playnote::alloc_audit::end_frame(name)
+// Restart the warmup period of the current thread's loop, such as after a state change.
+#define ALLOC_AUDIT_RESET() playnote::alloc_audit::reset()
+
+namespace playnote::alloc_audit {
+
+// Number of frames after a reset that are allowed to allocate.
+constexpr auto WarmupFrames = 60z;
+
+// Number of heap allocations made by the current thread since it started.
+[[nodiscard]] auto thread_allocation_count() noexcept -> ssize_t;
+
+void end_frame(string_view name);
+void reset() noexcept;
+
+}
+
+#else
+
+#define ALLOC_AUDIT_FRAME(name) static_cast<void>(0)
+#define ALLOC_AUDIT_RESET() static_cast<void>(0)
+
+#endif
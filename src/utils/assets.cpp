@@ -10,25 +10,74 @@ or distributed except according to those terms.
 #include "utils/assets.hpp"
 
 #include "preamble.hpp"
-#include "lib/sqlite.hpp"
-#include "lib/zstd.hpp"
 #include "utils/logger.hpp"
+#include "utils/memory.hpp"
+#include "lib/zstd.hpp"
+#include "io/file.hpp"
 
 namespace playnote {
 
-Assets::Assets(fs::path const& db_path)
+Assets::Assets(fs::path const& pack_path)
 {
-	if (!fs::exists(db_path)) throw runtime_error_fmt("Asset database is missing at \"{}\"", db_path);
-	db = lib::sqlite::open(db_path);
-	select_asset = lib::sqlite::prepare<SelectAsset>(db);
-	INFO("Opened asset database at \"{}\"", db_path);
+	if (!fs::exists(pack_path)) throw runtime_error_fmt("Asset pack is missing at \"{}\"", pack_path);
+	file = io::read_file(pack_path);
+
+	// The mapping is page-aligned, and the tables are laid out to keep their members aligned,
+	// so the index is used in place
+	auto const contents = file.contents;
+	if (contents.size() < sizeof(Header)) throw runtime_error_fmt("Asset pack \"{}\" is truncated", pack_path);
+	auto const& header = *reinterpret_cast<Header const*>(contents.data());
+	if (header.magic != Magic) throw runtime_error_fmt("\"{}\" is not an asset pack", pack_path);
+	if (header.version != Version)
+		throw runtime_error_fmt("Asset pack \"{}\" is version {}, expected {}", pack_path, header.version, Version);
+	auto const tables_size = sizeof(Header) + header.entry_count * sizeof(Entry) + header.dictionary_count * sizeof(Dictionary);
+	if (contents.size() < tables_size) throw runtime_error_fmt("Asset pack \"{}\" is truncated", pack_path);
+	entries = {reinterpret_cast<Entry const*>(contents.data() + sizeof(Header)), header.entry_count};
+	dictionaries = {reinterpret_cast<Dictionary const*>(entries.data() + entries.size()), header.dictionary_count};
+
+	// Validate once, so that lookups can trust the index
+	for (auto const& dict: dictionaries) data_of(dict.offset, dict.size);
+	for (auto const& entry: entries) {
+		data_of(entry.offset, entry.size);
+		if (entry.compression == Compression::ZstdDictionary && entry.dictionary >= dictionaries.size())
+			throw runtime_error_fmt("Asset pack \"{}\" is malformed: asset {} uses a missing dictionary", pack_path, entry.id);
+	}
+	if (!std::ranges::is_sorted(entries, {}, &Entry::id)) throw runtime_error_fmt("Asset pack \"{}\" is malformed: index is not sorted", pack_path);
+	INFO("Opened asset pack at \"{}\" ({} assets, {} dictionaries)", pack_path, entries.size(), dictionaries.size());
+}
+
+Assets::~Assets() noexcept
+{ charge_memory(MemoryTag::Assets, -cache_bytes); }
+
+auto Assets::get(id asset_id) -> span<byte const>
+{
+	auto const entry = lower_bound(entries, +asset_id, {}, &Entry::id);
+	if (entry == entries.end() || entry->id != +asset_id) throw runtime_error_fmt("Asset ID {} not found", +asset_id);
+	auto const data = data_of(entry->offset, entry->size);
+	if (entry->compression == Compression::None) return data;
+
+	auto lock = lock_guard{cache_lock};
+	if (auto const cached = cache.find(entry->id); cached != cache.end()) return cached->second;
+	auto const start = steady_clock::now();
+	auto decompressed = entry->compression == Compression::ZstdDictionary?
+		lib::zstd::decompress(data, data_of(dictionaries[entry->dictionary].offset, dictionaries[entry->dictionary].size)) :
+		lib::zstd::decompress(data);
+	if (decompressed.size() != entry->raw_size)
+		throw runtime_error_fmt("Asset ID {} decompressed to {} bytes, expected {}", entry->id, decompressed.size(), entry->raw_size);
+	DEBUG("Decompressed asset ID {} ({} -> {} bytes) in {}us", entry->id, entry->size, entry->raw_size,
+		(steady_clock::now() - start) / 1us);
+	// Vectors keep their buffer when the map rehashes, so returned spans stay valid
+	auto const& result = cache.emplace(entry->id, move(decompressed)).first->second;
+	cache_bytes += ssize(result);
+	charge_memory(MemoryTag::Assets, ssize(result));
+	return result;
 }
 
-auto Assets::get(id asset_id) -> vector<byte>
+auto Assets::data_of(uint64_t offset, uint64_t size) const -> span<byte const>
 {
-	for (auto [compressed, data]: lib::sqlite::query(select_asset, +asset_id))
-		return compressed? lib::zstd::decompress(data) : vector<byte>{data.begin(), data.end()};
-	throw runtime_error_fmt("Asset ID {} not found", +asset_id);
+	if (offset > file.contents.size() || size > file.contents.size() - offset)
+		throw runtime_error_fmt("Asset pack \"{}\" is malformed: data out of bounds", file.path);
+	return file.contents.subspan(offset, size);
 }
 
 }
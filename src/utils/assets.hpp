@@ -9,28 +9,78 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
-#include "lib/sqlite.hpp"
 #include "utils/service.hpp"
+#include "io/file.hpp"
 
 namespace playnote {
 
+// Read-only store of game assets, backed by a memory-mapped asset pack.
 class Assets {
 public:
-	explicit Assets(fs::path const& db_path);
+	// Asset pack layout, as written by tools/pack_assets.cpp. The file starts with a header,
+	// followed by the entry table sorted by ID, the dictionary table, and finally the data of
+	// all dictionaries and assets. All offsets are from the start of the file.
 
-	auto get(id) -> vector<byte>;
+	static constexpr auto Magic = to_array({'P', 'N', 'A', 'P'});
+	static constexpr auto Version = 1u;
+	static constexpr auto DataAlignment = 16uz;
 
-private:
-	struct SelectAsset {
-		static constexpr auto Query = R"sql(
-			SELECT compressed, data FROM assets WHERE id = ?1
-		)sql";
-		using Params = tuple<uint>;
-		using Row = tuple<int, span<byte const>>;
+	enum class Compression: uint {
+		None,
+		Zstd,
+		ZstdDictionary, // Compressed with one of the pack's shared dictionaries
+	};
+
+	struct Header {
+		array<char, 4> magic;
+		uint version;
+		uint entry_count;
+		uint dictionary_count;
+	};
+
+	struct Entry {
+		uint id;
+		Compression compression;
+		uint dictionary; // Index into the dictionary table, if used
+		uint reserved;
+		uint64_t offset;
+		uint64_t size; // As stored
+		uint64_t raw_size; // After decompression
+	};
+
+	struct Dictionary {
+		uint64_t offset;
+		uint64_t size;
 	};
 
-	lib::sqlite::DB db;
-	lib::sqlite::Statement<SelectAsset> select_asset;
+	static_assert(sizeof(Header) == 16 && sizeof(Entry) == 40 && sizeof(Dictionary) == 16);
+
+	// Open the asset pack. Only the index is read; asset data is paged in as it's accessed.
+	// Throws runtime_error if the file is missing or malformed.
+	explicit Assets(fs::path const& pack_path);
+	~Assets() noexcept;
+
+	// Retrieve an asset's contents. Uncompressed assets are returned directly from the mapping,
+	// compressed ones are decompressed on first access and cached. The span is valid for
+	// the lifetime of the asset store. Thread-safe.
+	// Throws runtime_error if the asset doesn't exist or fails to decompress.
+	auto get(id) -> span<byte const>;
+
+	Assets(Assets const&) = delete;
+	auto operator=(Assets const&) -> Assets& = delete;
+	Assets(Assets&&) = delete;
+	auto operator=(Assets&&) -> Assets& = delete;
+
+private:
+	io::ReadFile file;
+	span<Entry const> entries;
+	span<Dictionary const> dictionaries;
+
+	mutex cache_lock;
+	unordered_map<uint, vector<byte>> cache;
+	ssize_t cache_bytes = 0;
+
+	[[nodiscard]] auto data_of(uint64_t offset, uint64_t size) const -> span<byte const>;
 };
 
 namespace globals {
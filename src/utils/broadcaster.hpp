@@ -20,77 +20,177 @@ struct Barriers {
 	latch shutdown{N}; // Threads wait on this before exiting
 };
 
-// A cross-thread message bus.
+// A cross-thread message bus. Every subscription owns a preallocated, bounded channel; delivery
+// doesn't allocate, and messages that don't fit are dropped and counted instead, unless
+// the subscription asked for its channel to grow.
+// All endpoints must register and subscribe before any messages are sent.
 class Broadcaster {
 public:
+	static constexpr auto DefaultChannelCapacity = 256z;
+
+	// What happens to a message that doesn't fit in a full channel.
+	enum class Overflow {
+		Drop, // Discard it and count it; for high-frequency streams where stale messages are useless
+		Grow, // Allocate more space; for rare control messages that must never be lost
+	};
+
 	Broadcaster() = default;
 
 	// Declare that the current thread will send and/or receive messages.
 	void register_as_endpoint();
 
-	// Declare that current thread is interested in messages of type T.
+	// Declare that current thread is interested in messages of type T. Up to capacity messages
+	// can be pending before the overflow policy kicks in.
 	template<typename T>
-	void subscribe();
+	void subscribe(ssize_t capacity = DefaultChannelCapacity, Overflow = Overflow::Drop);
 
-	// Send message to all other threads that declared interest in this type.
+	// Send message to all other threads that declared interest in this type. Messages are copied
+	// for each recipient, so they must be copyable.
 	template<typename T>
-	void shout(T&& message) { make_shout<T>(forward<T>(message)); }
+	void shout(T&& message) requires copy_constructible<remove_cvref_t<T>> { make_shout<T>(forward<T>(message)); }
 
 	// Send message to all other threads that declared interest in this type, constructing
 	// the message in-place.
 	template<typename T, typename... Args>
-	void make_shout(Args&&... args);
+	void make_shout(Args&&... args) requires copy_constructible<remove_cvref_t<T>>;
 
-	// Return all pending messages of type T. Must have previously subscribed to this type.
+	// Call the function with each pending message of type T, in order of arrival. Must have
+	// previously subscribed to this type.
+	template<typename T, callable<void(remove_cvref_t<T>&&)> Func>
+	void receive_all(Func&& func);
+
+	// Return the number of messages of type T that were dropped because the current thread's
+	// channel was full.
 	template<typename T>
-	auto receive_all() -> generator<T>;
+	[[nodiscard]] auto get_dropped_count() const -> ssize_t;
+
+	// Return the number of messages dropped across all channels.
+	[[nodiscard]] auto get_total_dropped_count() const -> ssize_t;
+
+	Broadcaster(Broadcaster const&) = delete;
+	auto operator=(Broadcaster const&) -> Broadcaster& = delete;
+	Broadcaster(Broadcaster&&) = delete;
+	auto operator=(Broadcaster&&) -> Broadcaster& = delete;
 
 private:
+	struct ChannelBase {
+		ssize_t endpoint;
+		Overflow overflow;
+		atomic<ssize_t> dropped = 0;
+
+		ChannelBase(ssize_t endpoint, Overflow overflow): endpoint{endpoint}, overflow{overflow} {}
+		virtual ~ChannelBase() = default;
+	};
+
+	template<typename T>
+	struct Channel: ChannelBase {
+		mpmc_queue<T> queue;
+
+		Channel(ssize_t endpoint, ssize_t capacity, Overflow overflow):
+			ChannelBase{endpoint, overflow}, queue{static_cast<size_t>(capacity)} {}
+	};
+
 	inline static thread_local auto endpoint_id = -1z;
+	inline static auto type_count = atomic<ssize_t>{0};
 	mutex register_lock;
-	vector<unordered_map<type_index, shared_ptr<void>>> queues;
+	vector<vector<unique_ptr<ChannelBase>>> channels; // Indexed by type slot; all subscriptions of that type
+	vector<vector<ChannelBase*>> inboxes; // Indexed by endpoint, then type slot
+
+	// Dense index of a message type, assigned on first use.
+	template<typename T>
+	[[nodiscard]] static auto type_slot() -> ssize_t
+	{
+		static auto const slot = type_count.fetch_add(1);
+		return slot;
+	}
+
+	template<typename T>
+	[[nodiscard]] auto get_inbox() const -> Channel<T>&;
 };
 
 inline void Broadcaster::register_as_endpoint()
 {
 	ASSUME(endpoint_id == -1z);
 	auto lock = lock_guard{register_lock};
-	endpoint_id = queues.size();
-	queues.emplace_back();
+	endpoint_id = inboxes.size();
+	inboxes.emplace_back();
 }
 
 template<typename T>
-void Broadcaster::subscribe()
+void Broadcaster::subscribe(ssize_t capacity, Overflow overflow)
 {
 	using Type = remove_cvref_t<T>;
 	ASSUME(endpoint_id != -1z);
+	auto const slot = type_slot<Type>();
 	auto lock = lock_guard{register_lock};
-	ASSUME(!queues[endpoint_id].contains(typeid(Type)));
-	queues[endpoint_id][typeid(Type)] = make_shared<mpmc_queue<Type>>();
+	if (static_cast<ssize_t>(channels.size()) <= slot) channels.resize(slot + 1);
+	auto& inbox = inboxes[endpoint_id];
+	if (static_cast<ssize_t>(inbox.size()) <= slot) inbox.resize(slot + 1, nullptr);
+	ASSUME(!inbox[slot]);
+	inbox[slot] = channels[slot].emplace_back(make_unique<Channel<Type>>(endpoint_id, capacity, overflow)).get();
 }
 
 template<typename T, typename... Args>
-void Broadcaster::make_shout(Args&&... args)
+void Broadcaster::make_shout(Args&&... args) requires copy_constructible<remove_cvref_t<T>>
 {
 	using Type = remove_cvref_t<T>;
 	ASSUME(endpoint_id != -1z);
-	for (auto [idx, in_channel]: queues | views::enumerate) {
-		if (endpoint_id == idx) continue;
-		if (!in_channel.contains(typeid(Type))) continue;
-		(*static_pointer_cast<mpmc_queue<Type>>(in_channel[typeid(Type)])).enqueue(T{forward<Args>(args)...});
+	auto const slot = type_slot<Type>();
+	if (static_cast<ssize_t>(channels.size()) <= slot) return;
+	auto const& recipients = channels[slot];
+	auto const last = find_last_if(recipients, [](auto const& channel) { return channel->endpoint != endpoint_id; }).begin();
+	if (last == recipients.end()) return;
+
+	// Every recipient but the last gets a copy; the last one gets the original
+	auto message = Type{forward<Args>(args)...};
+	auto const deliver = [](ChannelBase& channel, Type&& delivered) {
+		auto& typed_channel = static_cast<Channel<Type>&>(channel);
+		if (typed_channel.queue.try_enqueue(move(delivered))) return;
+		if (typed_channel.overflow == Overflow::Grow)
+			typed_channel.queue.enqueue(move(delivered));
+		else
+			typed_channel.dropped += 1;
+	};
+	for (auto it = recipients.begin(); it != last; ++it) {
+		if ((*it)->endpoint == endpoint_id) continue;
+		deliver(**it, Type{message});
 	}
+	deliver(**last, move(message));
 }
 
-template<typename T>
-auto Broadcaster::receive_all() -> generator<T>
+template<typename T, callable<void(remove_cvref_t<T>&&)> Func>
+void Broadcaster::receive_all(Func&& func)
 {
 	using Type = remove_cvref_t<T>;
-	ASSUME(endpoint_id != -1z);
-	ASSUME(queues[endpoint_id].contains(typeid(Type)));
-	auto& out_queue = *static_pointer_cast<mpmc_queue<Type>>(queues[endpoint_id][typeid(Type)]);
+	auto& channel = get_inbox<Type>();
 	auto message = Type{};
-	while (out_queue.try_dequeue(message))
-		co_yield move(message);
+	while (channel.queue.try_dequeue(message))
+		func(move(message));
+}
+
+template<typename T>
+auto Broadcaster::get_dropped_count() const -> ssize_t
+{
+	return get_inbox<remove_cvref_t<T>>().dropped.load();
+}
+
+inline auto Broadcaster::get_total_dropped_count() const -> ssize_t
+{
+	auto total = 0z;
+	for (auto const& type_channels: channels)
+		for (auto const& channel: type_channels)
+			total += channel->dropped.load();
+	return total;
+}
+
+template<typename T>
+auto Broadcaster::get_inbox() const -> Channel<T>&
+{
+	ASSUME(endpoint_id != -1z);
+	auto const slot = type_slot<T>();
+	auto const& inbox = inboxes[endpoint_id];
+	ASSUME(slot < static_cast<ssize_t>(inbox.size()) && inbox[slot]);
+	return static_cast<Channel<T>&>(*inbox[slot]);
 }
 
 }
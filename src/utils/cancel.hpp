@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+namespace playnote {
+
+// Thrown from a cancellation point once cancellation has been requested.
+class cancelled_error: public runtime_error {
+public:
+	using runtime_error::runtime_error;
+};
+
+// Shared flag for cooperatively cancelling long-running work. All copies of a token observe
+// the same state. Checking is cheap enough to do once per decoded frame or written chunk.
+class CancelToken {
+public:
+	// Create a token that is never cancelled.
+	CancelToken() = default;
+
+	// Create a token that can be cancelled.
+	[[nodiscard]] static auto make() -> CancelToken
+	{
+		auto token = CancelToken{};
+		token.state = make_shared<atomic<bool>>(false);
+		return token;
+	}
+
+	// Request cancellation of all work observing this token.
+	void cancel() const { if (state) state->store(true); }
+
+	// Check if cancellation has been requested.
+	[[nodiscard]] auto is_cancelled() const -> bool { return state && state->load(); }
+
+	// Throw cancelled_error if cancellation has been requested.
+	void check() const { if (is_cancelled()) throw cancelled_error{"Operation cancelled"}; }
+
+private:
+	shared_ptr<atomic<bool>> state;
+};
+
+}
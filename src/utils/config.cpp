@@ -25,6 +25,25 @@ try {
 	ERROR("Failed to flush config to file: {}", e.what());
 }
 
+void Config::Observer::reset() noexcept
+{
+	if (!config) return;
+	config->unregister_observer(observer_id);
+	config = nullptr;
+	observer_id = -1;
+}
+
+auto Config::Observer::operator=(Observer&& other) noexcept -> Observer&
+{
+	if (this == &other) return *this;
+	reset();
+	config = other.config;
+	observer_id = other.observer_id;
+	other.config = nullptr;
+	other.observer_id = -1;
+	return *this;
+}
+
 void Config::load_from_file()
 {
 	if (!fs::exists(ConfigPath)) return;
@@ -32,27 +51,35 @@ void Config::load_from_file()
 	auto const toml_data = toml::parse(
 		{reinterpret_cast<char const*>(file.contents.data()), file.contents.size()});
 
-	for (auto& entry: entries) {
+	auto changed = vector<ssize_t>{};
+	auto lock = std::unique_lock{entries_lock};
+	for (auto [idx, entry]: entries | views::enumerate) {
 		if (!toml_data.contains(entry.category)) continue;
 		auto const& category_table = *toml_data[entry.category].as_table();
 		if (!category_table.contains(entry.name)) continue;
 		visit([&](auto& v) {
 			auto const& toml_entry = category_table[entry.name].value<remove_cvref_t<decltype(v)>>();
-			if (!toml_entry) return;
+			if (!toml_entry || *toml_entry == v) return;
 			v = *toml_entry;
+			changed.emplace_back(idx);
 		}, entry.value);
 	}
+	for (auto idx: changed) publish(idx);
+	lock.unlock();
+	notify(changed);
 }
 
 void Config::save_to_file() const
 {
 	auto toml_data = toml::table{};
+	auto lock = std::unique_lock{entries_lock};
 	for (auto const& entry: entries) {
 		if (!toml_data.contains(entry.category))
 			toml_data.insert(entry.category, toml::table{});
 		auto& category_table = *toml_data[entry.category].as_table();
 		visit([&](auto const& v) { category_table.insert_or_assign(entry.name, v); }, entry.value);
 	}
+	lock.unlock();
 
 	auto file_content = std::stringstream{};
 	file_content << toml_data;
@@ -63,21 +90,73 @@ void Config::save_to_file() const
 
 void Config::set_entry(Entry&& entry)
 {
-	find_entry(entry.category, entry.name).value = move(entry.value);
+	auto const idx = find_entry(id{entry.category}, id{entry.name});
+	{
+		auto lock = lock_guard{entries_lock};
+		auto& value = entries[idx].value;
+		ASSERT(value.index() == entry.value.index());
+		if (value == entry.value) return;
+		value = move(entry.value);
+		publish(idx);
+	}
+	notify(span{&idx, 1});
 }
 
-auto Config::find_entry(string_view category, string_view name) -> Entry&
+auto Config::find_entry(id category, id name) const -> ssize_t
 {
-	auto iter = find_if(entries, [&](auto const& e) { return e.category == category && e.name == name; });
-	ASSERT(iter != entries.end());
-	return *iter;
+	auto iter = index.find(make_pair(category, name));
+	ASSERT(iter != index.end());
+	return iter->second;
 }
 
-auto Config::find_entry(string_view category, string_view name) const -> Entry const&
+void Config::publish(ssize_t entry_idx)
 {
-	auto iter = find_if(entries, [&](auto const& e) { return e.category == category && e.name == name; });
-	ASSERT(iter != entries.end());
-	return *iter;
+	visit(visitor{
+		[&](string const&) {},
+		[&](auto v) { scalars[entry_idx].store(to_scalar(v)); },
+	}, entries[entry_idx].value);
+}
+
+void Config::notify(span<ssize_t const> entry_idxs)
+{
+	if (entry_idxs.empty()) return;
+	// Copy the observers out, so that callbacks are free to register or unregister observers
+	auto pending = vector<shared_ptr<ObserverState>>{};
+	{
+		auto lock = lock_guard{observers_lock};
+		for (auto const& [observer_id, observer]: observers)
+			if (contains(entry_idxs, observer.entry_idx)) pending.emplace_back(observer.state);
+	}
+	for (auto const& state: pending) {
+		auto lock = lock_guard{state->call_lock};
+		if (state->active) state->func();
+	}
+}
+
+auto Config::register_observer(ssize_t entry_idx, function<void()>&& func) -> Observer
+{
+	auto state = make_shared<ObserverState>();
+	state->func = move(func);
+	auto lock = lock_guard{observers_lock};
+	auto const observer_id = next_observer_id;
+	next_observer_id += 1;
+	observers.emplace(observer_id, ObserverEntry{entry_idx, move(state)});
+	return Observer{*this, observer_id};
+}
+
+void Config::unregister_observer(ssize_t observer_id) noexcept
+{
+	auto state = shared_ptr<ObserverState>{};
+	{
+		auto lock = lock_guard{observers_lock};
+		auto it = observers.find(observer_id);
+		if (it == observers.end()) return;
+		state = move(it->second.state);
+		observers.erase(it);
+	}
+	// Waits for a notification that's already running the callback on another thread
+	auto lock = lock_guard{state->call_lock};
+	state->active = false;
 }
 
 // Consult this function for the list of registered config entries.
@@ -88,6 +167,21 @@ void Config::create_defaults()
 		.name = "attach_console",
 		.value = false,
 	});
+	entries.emplace_back(Entry{
+		.category = "system",
+		.name = "show_memory_usage",
+		.value = false,
+	});
+	entries.emplace_back(Entry{
+		.category = "system",
+		.name = "exit_after_first_frame",
+		.value = false,
+	});
+	entries.emplace_back(Entry{
+		.category = "system",
+		.name = "import_workers", // Worker processes for song imports; 0 imports in the game process
+		.value = 0,
+	});
 
 	entries.emplace_back(Entry{
 		.category = "logging",
@@ -643,6 +737,14 @@ void Config::create_defaults()
 		.name = "judgment_timeout",
 		.value = 400,
 	});
+
+	index.reserve(entries.size());
+	scalars = make_unique<atomic<uint64_t>[]>(entries.size());
+	for (auto [idx, entry]: entries | views::enumerate) {
+		auto const [it, inserted] = index.emplace(make_pair(id{entry.category}, id{entry.name}), idx);
+		ASSERT(inserted);
+		publish(idx);
+	}
 }
 
 }
@@ -10,6 +10,7 @@ or distributed except according to those terms.
 #pragma once
 #include "preamble.hpp"
 #include "utils/service.hpp"
+#include "utils/assert.hpp"
 
 namespace playnote {
 inline constexpr auto AppTitle = "Playnote";
@@ -40,9 +41,17 @@ inline constexpr auto LogfilePath = "playnote.log"sv;
 inline constexpr auto ConfigPath = "config.toml"sv;
 inline constexpr auto LibraryPath = "library"sv;
 inline constexpr auto LibraryDBPath = "library.db"sv;
-inline constexpr auto AssetDBPath = "assets.db"sv;
+inline constexpr auto AssetPackPath = "assets.pak"sv;
+inline constexpr auto PipelineCachePath = "pipeline_cache"sv;
+inline constexpr auto TracePath = "playnote-trace.json"sv;
+#ifdef TARGET_WINDOWS
+inline constexpr auto ImportWorkerFilename = "playnote-import-worker.exe"sv; // Next to the game executable
+#else
+inline constexpr auto ImportWorkerFilename = "playnote-import-worker"sv; // Next to the game executable
+#endif
 
-// Global runtime configuration, kept in sync with the config file.
+// Global runtime configuration, kept in sync with the config file. All methods are thread-safe;
+// reads return copies, so they're never torn by a concurrent change.
 class Config {
 public:
 	using Value = variant<int, double, bool, string>;
@@ -52,13 +61,64 @@ public:
 		Value value;
 	};
 
+	// Compile-time reference to an entry of a known type.
+	template<variant_alternative<Value> T>
+	struct Key {
+		id category;
+		id name;
+
+		consteval Key(string_view category, string_view name): category{category}, name{name} {}
+	};
+
+	// Resolved reference to a scalar entry. Reads are lock-free and always see the latest value.
+	// Valid for as long as the config object exists.
+	template<variant_alternative<Value> T> requires (!same_as<T, string>)
+	class Handle {
+	public:
+		Handle() = default;
+
+		[[nodiscard]] auto get() const -> T { return from_scalar<T>(slot->load()); }
+		[[nodiscard]] auto operator*() const -> T { return get(); }
+
+	private:
+		friend Config;
+		atomic<uint64_t> const* slot = nullptr;
+
+		explicit Handle(atomic<uint64_t> const& slot): slot{&slot} {}
+	};
+
+	// Registration of a change callback. Once this is destroyed or reset, the callback is no longer
+	// running on any other thread, and won't be called again. The callback is allowed to reset
+	// its own observer.
+	class Observer {
+	public:
+		Observer() = default;
+		~Observer() noexcept { reset(); }
+
+		// Unregister the callback early.
+		void reset() noexcept;
+
+		Observer(Observer const&) = delete;
+		auto operator=(Observer const&) -> Observer& = delete;
+		Observer(Observer&& other) noexcept { *this = move(other); }
+		auto operator=(Observer&&) noexcept -> Observer&;
+
+	private:
+		friend Config;
+		Config* config = nullptr;
+		ssize_t observer_id = -1;
+
+		Observer(Config& config, ssize_t observer_id): config{&config}, observer_id{observer_id} {}
+	};
+
 	// Create the config object, with entries at their default values.
 	Config() { create_defaults(); }
 
 	// Overwrite the config file with current entries.
 	~Config() noexcept;
 
-	// Update all entries with values from the config file.
+	// Update all entries with values from the config file. Can be called again to reload the file;
+	// observers of entries that changed will be notified.
 	void load_from_file();
 
 	// Flush the config to file, overwriting it.
@@ -66,22 +126,94 @@ public:
 
 	// Get the value of an entry.
 	template <variant_alternative<Value> T>
-	[[nodiscard]] auto get_entry(string_view category, string_view name) const -> T const&
-	{ return get<T>(find_entry(category, name).value); }
+	[[nodiscard]] auto get_entry(string_view category, string_view name) const -> T
+	{ return read_entry<T>(find_entry(id{category}, id{name})); }
+
+	// Get the value of an entry via its key.
+	template<variant_alternative<Value> T>
+	[[nodiscard]] auto get_entry(Key<T> key) const -> T
+	{ return read_entry<T>(find_entry(key.category, key.name)); }
+
+	// Resolve a key to a handle, for repeated reads of the entry in hot paths.
+	template<variant_alternative<Value> T> requires (!same_as<T, string>)
+	[[nodiscard]] auto get_handle(Key<T> key) const -> Handle<T>
+	{ return Handle<T>{scalars[resolve(key)]}; }
 
 	// Set an entry to a new value.
 	void set_entry(Entry&&);
 
+	// Register a callback to be called with the new value whenever the entry changes. The callback
+	// runs on the thread that performed the change.
+	template<variant_alternative<Value> T>
+	[[nodiscard]] auto observe(Key<T> key, function<void(T const&)> func) -> Observer
+	{
+		auto const idx = resolve(key);
+		return register_observer(idx, [this, idx, func = move(func)] { func(read_entry<T>(idx)); });
+	}
+
 	Config(Config const&) = delete;
 	auto operator=(Config const&) -> Config& = delete;
 	Config(Config&&) = delete;
 	auto operator=(Config&&) -> Config& = delete;
 
 private:
-	vector<Entry> entries;
+	// Shared with notifications in flight, so that unregistering can wait for them.
+	// The lock is recursive, so that a callback can unregister its own observer.
+	struct ObserverState {
+		recursive_mutex call_lock;
+		function<void()> func;
+		bool active = true;
+	};
+	struct ObserverEntry {
+		ssize_t entry_idx;
+		shared_ptr<ObserverState> state;
+	};
 
-	[[nodiscard]] auto find_entry(string_view category, string_view name) -> Entry&;
-	[[nodiscard]] auto find_entry(string_view category, string_view name) const -> Entry const&;
+	mutable mutex entries_lock; // Guards entry values; the set of entries never changes after construction
+	vector<Entry> entries;
+	unordered_map<pair<id, id>, ssize_t> index;
+	unique_ptr<atomic<uint64_t>[]> scalars;
+	mutex observers_lock;
+	unordered_map<ssize_t, ObserverEntry> observers;
+	ssize_t next_observer_id = 0;
+
+	template<typename T>
+	[[nodiscard]] static auto to_scalar(T value) -> uint64_t
+	{
+		if constexpr (same_as<T, double>) return bit_cast<uint64_t>(value);
+		else return static_cast<uint64_t>(static_cast<int64_t>(value));
+	}
+	template<typename T>
+	[[nodiscard]] static auto from_scalar(uint64_t value) -> T
+	{
+		if constexpr (same_as<T, double>) return bit_cast<double>(value);
+		else if constexpr (same_as<T, bool>) return value != 0;
+		else return static_cast<T>(static_cast<int64_t>(value));
+	}
+
+	template<variant_alternative<Value> T>
+	[[nodiscard]] auto read_entry(ssize_t entry_idx) const -> T
+	{
+		auto lock = lock_guard{entries_lock};
+		return get<T>(entries[entry_idx].value);
+	}
+
+	[[nodiscard]] auto find_entry(id category, id name) const -> ssize_t;
+
+	// Find the entry of a key, making sure the key's type matches the entry's.
+	template<variant_alternative<Value> T>
+	[[nodiscard]] auto resolve(Key<T> key) const -> ssize_t
+	{
+		auto const idx = find_entry(key.category, key.name);
+		auto lock = lock_guard{entries_lock};
+		ASSERT(holds_alternative<T>(entries[idx].value));
+		return idx;
+	}
+
+	void publish(ssize_t entry_idx);
+	void notify(span<ssize_t const> entry_idxs);
+	[[nodiscard]] auto register_observer(ssize_t entry_idx, function<void()>&&) -> Observer;
+	void unregister_observer(ssize_t observer_id) noexcept;
 	void create_defaults();
 };
 
@@ -0,0 +1,327 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/frame_pool.hpp"
+
+#include "preamble.hpp"
+#include "utils/assert.hpp"
+
+namespace playnote {
+
+namespace {
+
+constexpr auto SizeClasses = to_array<size_t>({128, 256, 512, 1024, 2048, 4096});
+constexpr auto SlabSize = size_t{64 * 1024}; // Slabs are aligned to their size
+// Once a size class has more fully free slabs than this, all but KeptEmptySlabs are released,
+// so that a burst of frames doesn't keep its memory reserved forever
+constexpr auto MaxEmptySlabs = 4z;
+constexpr auto KeptEmptySlabs = 1z;
+
+struct ThreadPools;
+
+// Placed at the start of every slab. Only accessed by the thread owning the slab's pools.
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) SlabHeader {
+	ssize_t total_blocks;
+	ssize_t free_blocks; // Blocks on the owner's local free list
+	// Used while trimming
+	enum class Fate { Undecided, Kept, Released } fate;
+	SlabHeader* next_released;
+};
+
+// Prepended to every pooled frame. Keeps the frame itself at the default new alignment.
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) BlockHeader {
+	ThreadPools* owner;
+	BlockHeader* next;
+};
+
+// Only ever written by the thread that owns them, so updates don't need read-modify-write
+// operations; atomic only so that get_coro_frame_stats() can read them from any thread.
+struct Counters {
+	atomic<ssize_t> pooled = 0;
+	atomic<ssize_t> fallback = 0;
+	atomic<ssize_t> unpooled = 0;
+	atomic<ssize_t> remote_frees = 0;
+	atomic<ssize_t> slab_allocations = 0;
+	atomic<ssize_t> slab_bytes = 0;
+};
+
+struct ThreadPools {
+	array<BlockHeader*, SizeClasses.size()> free_lists{};
+	array<atomic<BlockHeader*>, SizeClasses.size()> remote_frees{};
+	array<ssize_t, SizeClasses.size()> empty_slabs{}; // Slabs with all blocks on the free list
+	Counters counters;
+};
+
+void trim(ThreadPools&, ssize_t class_idx, ssize_t keep) noexcept;
+void drain_remote_frees(ThreadPools&, ssize_t class_idx) noexcept;
+
+// Pools of exited threads. They can't be freed, since their frames might still be alive
+// on other threads, so they are handed over to the next thread that starts up instead.
+// Their fully free slabs are released when they're handed over.
+struct Orphanage {
+	mutex lock;
+	vector<ThreadPools*> pools;
+	vector<ThreadPools*> all_pools; // Every set of pools ever created, for summing up the counters
+};
+
+// Counters of threads that are exiting and no longer have pools. Rare, so contention is fine.
+auto exiting_counters = Counters{};
+
+auto pooling_enabled = atomic<bool>{true};
+
+void bump(atomic<ssize_t>& counter, ssize_t amount = 1)
+{
+	counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Set once the current thread has handed its pools over to the orphanage. Trivially destructible,
+// so it stays readable while the rest of the thread's thread-locals, or statics, are destroyed.
+thread_local auto lease_released = false;
+
+auto orphanage() -> Orphanage&
+{
+	static auto instance = Orphanage{};
+	return instance;
+}
+
+// Ownership of a set of pools by the current thread.
+class PoolLease {
+public:
+	PoolLease()
+	{
+		auto& orphans = orphanage();
+		auto lock = lock_guard{orphans.lock};
+		if (orphans.pools.empty()) {
+			pools = new ThreadPools{};
+			orphans.all_pools.emplace_back(pools);
+		} else {
+			pools = orphans.pools.back();
+			orphans.pools.pop_back();
+		}
+	}
+
+	~PoolLease() noexcept
+	{
+		for (auto class_idx: views::iota(0z, ssize(SizeClasses))) {
+			drain_remote_frees(*pools, class_idx);
+			trim(*pools, class_idx, 0);
+		}
+		auto& orphans = orphanage();
+		auto lock = lock_guard{orphans.lock};
+		orphans.pools.emplace_back(pools);
+		lease_released = true;
+	}
+
+	[[nodiscard]] auto get() const -> ThreadPools& { return *pools; }
+
+	PoolLease(PoolLease const&) = delete;
+	auto operator=(PoolLease const&) -> PoolLease& = delete;
+	PoolLease(PoolLease&&) = delete;
+	auto operator=(PoolLease&&) -> PoolLease& = delete;
+
+private:
+	ThreadPools* pools;
+};
+
+// Return the current thread's pools, or nullptr if the thread is exiting and no longer has any.
+auto local_pools() -> ThreadPools*
+{
+	if (lease_released) return nullptr;
+	thread_local auto lease = PoolLease{};
+	return &lease.get();
+}
+
+// Return the index of the smallest size class that fits the frame, or -1 if none do.
+auto size_class(size_t frame_size) -> ssize_t
+{
+	auto const block_size = frame_size + sizeof(BlockHeader);
+	auto const it = lower_bound(SizeClasses, block_size);
+	if (it == SizeClasses.end()) return -1;
+	return distance(SizeClasses.begin(), it);
+}
+
+auto slab_of(BlockHeader* block) -> SlabHeader*
+{ return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(block) & ~(SlabSize - 1)); }
+
+// Carve up a new slab into blocks of the given size class.
+void refill(ThreadPools& pools, ssize_t class_idx)
+{
+	auto const block_size = SizeClasses[class_idx];
+	auto* slab = static_cast<byte*>(::operator new(SlabSize, std::align_val_t{SlabSize}));
+	bump(pools.counters.slab_allocations);
+	bump(pools.counters.slab_bytes, static_cast<ssize_t>(SlabSize));
+	auto* header = new(slab) SlabHeader{};
+	for (auto offset = sizeof(SlabHeader); offset + block_size <= SlabSize; offset += block_size) {
+		auto* block = new(slab + offset) BlockHeader{&pools, pools.free_lists[class_idx]};
+		pools.free_lists[class_idx] = block;
+		header->total_blocks += 1;
+	}
+	header->free_blocks = header->total_blocks;
+	pools.empty_slabs[class_idx] += 1;
+}
+
+// Take a block off the local free list, which must not be empty.
+auto pop_block(ThreadPools& pools, ssize_t class_idx) noexcept -> BlockHeader*
+{
+	auto* block = pools.free_lists[class_idx];
+	pools.free_lists[class_idx] = block->next;
+	auto* slab = slab_of(block);
+	if (slab->free_blocks == slab->total_blocks) pools.empty_slabs[class_idx] -= 1;
+	slab->free_blocks -= 1;
+	return block;
+}
+
+// Put a block owned by these pools back on the local free list.
+void push_block(ThreadPools& pools, ssize_t class_idx, BlockHeader* block) noexcept
+{
+	block->next = pools.free_lists[class_idx];
+	pools.free_lists[class_idx] = block;
+	auto* slab = slab_of(block);
+	slab->free_blocks += 1;
+	if (slab->free_blocks != slab->total_blocks) return;
+	pools.empty_slabs[class_idx] += 1;
+	if (pools.empty_slabs[class_idx] > MaxEmptySlabs) trim(pools, class_idx, KeptEmptySlabs);
+}
+
+// Move blocks freed by other threads onto the local free list.
+void drain_remote_frees(ThreadPools& pools, ssize_t class_idx) noexcept
+{
+	auto* block = pools.remote_frees[class_idx].exchange(nullptr);
+	while (block) {
+		auto* next = block->next;
+		push_block(pools, class_idx, block);
+		block = next;
+	}
+}
+
+// Release fully free slabs of a size class back to the global allocator, apart from the provided
+// number of them. Walks the whole free list, which is why it only runs once enough slabs pile up.
+void trim(ThreadPools& pools, ssize_t class_idx, ssize_t keep) noexcept
+{
+	if (pools.empty_slabs[class_idx] <= keep) return;
+
+	// Decide the fate of each empty slab the first time one of its blocks comes up
+	auto* released = static_cast<SlabHeader*>(nullptr);
+	auto kept = 0z;
+	for (auto* block = pools.free_lists[class_idx]; block; block = block->next) {
+		auto* slab = slab_of(block);
+		if (slab->free_blocks != slab->total_blocks || slab->fate != SlabHeader::Fate::Undecided) continue;
+		if (kept < keep) {
+			slab->fate = SlabHeader::Fate::Kept;
+			kept += 1;
+		} else {
+			slab->fate = SlabHeader::Fate::Released;
+			slab->next_released = released;
+			released = slab;
+		}
+	}
+
+	// Unlink the blocks of released slabs
+	auto** link = &pools.free_lists[class_idx];
+	while (*link) {
+		if (slab_of(*link)->fate != SlabHeader::Fate::Released) {
+			link = &(*link)->next;
+			continue;
+		}
+		*link = (*link)->next;
+	}
+	for (auto* block = pools.free_lists[class_idx]; block; block = block->next)
+		slab_of(block)->fate = SlabHeader::Fate::Undecided;
+
+	while (released) {
+		auto* next = released->next_released;
+		::operator delete(released, SlabSize, std::align_val_t{SlabSize});
+		bump(pools.counters.slab_bytes, -static_cast<ssize_t>(SlabSize));
+		pools.empty_slabs[class_idx] -= 1;
+		released = next;
+	}
+}
+
+}
+
+auto allocate_coro_frame(size_t size) -> void*
+{
+	auto const class_idx = size_class(size);
+	auto* pools = local_pools();
+	if (class_idx == -1) {
+		if (pools) bump(pools->counters.fallback);
+		else exiting_counters.fallback.fetch_add(1, memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	auto const pooling = pooling_enabled.load(memory_order_relaxed);
+	if (!pools || !pooling) {
+		// Exiting thread, or pooling disabled; the block has no owner and goes back
+		// to the global allocator when freed
+		if (!pools) exiting_counters.fallback.fetch_add(1, memory_order_relaxed);
+		else bump(pools->counters.unpooled);
+		auto* block = static_cast<BlockHeader*>(::operator new(SizeClasses[class_idx]));
+		block->owner = nullptr;
+		return block + 1;
+	}
+	// Remote frees are taken in eagerly, so that their slabs can be trimmed
+	if (pools->remote_frees[class_idx].load(memory_order_relaxed)) drain_remote_frees(*pools, class_idx);
+	if (!pools->free_lists[class_idx]) refill(*pools, class_idx);
+
+	auto* block = pop_block(*pools, class_idx);
+	bump(pools->counters.pooled);
+	return block + 1;
+}
+
+void free_coro_frame(void* ptr, size_t size) noexcept
+{
+	auto const class_idx = size_class(size);
+	if (class_idx == -1) {
+		::operator delete(ptr, size);
+		return;
+	}
+
+	auto* block = static_cast<BlockHeader*>(ptr) - 1;
+	if (!block->owner) {
+		::operator delete(block, SizeClasses[class_idx]);
+		return;
+	}
+	auto& owner = *block->owner;
+	auto* pools = local_pools();
+	if (&owner == pools) {
+		push_block(owner, class_idx, block);
+		return;
+	}
+
+	// Push onto the owner's remote stack; the owner takes the whole stack at once, so there's no ABA.
+	// An exiting thread frees its own frames this way too, since its pools are orphaned by now.
+	auto& remote = owner.remote_frees[class_idx];
+	block->next = remote.load();
+	while (!remote.compare_exchange_weak(block->next, block)) {}
+	if (pools) bump(pools->counters.remote_frees);
+	else exiting_counters.remote_frees.fetch_add(1, memory_order_relaxed);
+}
+
+auto get_coro_frame_stats() -> CoroFrameStats
+{
+	auto const sum = [](Counters const& counters, CoroFrameStats& stats) {
+		stats.pooled += counters.pooled.load(memory_order_relaxed);
+		stats.fallback += counters.fallback.load(memory_order_relaxed);
+		stats.unpooled += counters.unpooled.load(memory_order_relaxed);
+		stats.remote_frees += counters.remote_frees.load(memory_order_relaxed);
+		stats.slab_allocations += counters.slab_allocations.load(memory_order_relaxed);
+		stats.slab_bytes += counters.slab_bytes.load(memory_order_relaxed);
+	};
+	auto stats = CoroFrameStats{};
+	sum(exiting_counters, stats);
+	auto& orphans = orphanage();
+	auto lock = lock_guard{orphans.lock};
+	for (auto const* pools: orphans.all_pools) sum(pools->counters, stats);
+	return stats;
+}
+
+void set_coro_frame_pooling(bool enabled)
+{ pooling_enabled.store(enabled, memory_order_relaxed); }
+
+}
@@ -0,0 +1,39 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+namespace playnote {
+
+// Allocator serving coroutine frames of all task<T>s. Each thread owns a set of pools, one per
+// size class; frames freed on another thread are handed back to the owning thread's pool.
+// Frames larger than the biggest size class fall through to the global allocator. Pool memory
+// is carved from slabs; once a size class has several slabs with no live frames, most of them
+// are returned to the global allocator, and so are all of those of a thread that exits.
+
+// Allocation counters, for diagnostics.
+struct CoroFrameStats {
+	ssize_t pooled; // Frames served from a pool
+	ssize_t fallback; // Frames too large for any size class
+	ssize_t unpooled; // Frames served by the global allocator while pooling was disabled
+	ssize_t remote_frees; // Frames freed on a thread other than their owner
+	ssize_t slab_allocations; // Slabs ever allocated; together with fallback and unpooled frames,
+	                          // the global allocator calls made on behalf of coroutine frames
+	ssize_t slab_bytes; // Total memory reserved by all pools
+};
+
+// Retrieve the current values of the counters, summed over all threads.
+[[nodiscard]] auto get_coro_frame_stats() -> CoroFrameStats;
+
+// Serve new frames from the global allocator instead of the pools, or go back to pooling.
+// Meant for measuring what pooling saves; frames are freed correctly either way.
+void set_coro_frame_pooling(bool enabled);
+
+}
@@ -55,7 +55,7 @@ auto Logger::StringLogger::MemorySink::get_buffer() -> string
 	return out_buffer;
 }
 
-Logger::Logger(string_view log_file_path, Level global_log_level)
+Logger::Logger(string_view log_file_path, Level global_log_level, bool log_to_console)
 {
 	quill::Backend::start<quill::FrontendOptions>({
 		.thread_name = "Logging",
@@ -74,7 +74,7 @@ Logger::Logger(string_view log_file_path, Level global_log_level)
 	file_sink = static_pointer_cast<quill::FileSink>(
 		quill::Frontend::create_or_get_sink<quill::FileSink>(string{log_file_path}, file_cfg));
 
-	global = create_category("Global", global_log_level);
+	global = create_category("Global", global_log_level, log_to_console);
 }
 
 auto Logger::create_category(string_view name, Level level, bool log_to_console, bool log_to_file) -> Category
@@ -103,7 +103,7 @@ public:
 
 	// Initialize the logger. A global category will be created, immediately usable
 	// with the global logging macros.
-	Logger(string_view log_file_path, Level);
+	Logger(string_view log_file_path, Level, bool log_to_console = true);
 
 	// Create a new category. To be used with the *_AS macros.
 	// If the category already exists, the previously created instance is returned.
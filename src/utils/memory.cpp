@@ -0,0 +1,46 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/memory.hpp"
+
+#include "preamble.hpp"
+
+namespace playnote {
+
+namespace {
+
+// Each tag is updated from many threads; keep them from sharing a cache line.
+struct alignas(64) Counter {
+	atomic<ssize_t> current = 0;
+	atomic<ssize_t> peak = 0;
+};
+
+auto counters = array<Counter, enum_count<MemoryTag>()>{};
+
+}
+
+void charge_memory(MemoryTag tag, ssize_t bytes) noexcept
+{
+	auto& counter = counters[+tag];
+	auto const current = counter.current.fetch_add(bytes, memory_order_relaxed) + bytes;
+	if (bytes <= 0) return;
+	auto peak = counter.peak.load(memory_order_relaxed);
+	while (current > peak && !counter.peak.compare_exchange_weak(peak, current, memory_order_relaxed)) {}
+}
+
+auto get_memory_usage(MemoryTag tag) -> MemoryUsage
+{
+	auto const& counter = counters[+tag];
+	return MemoryUsage{
+		.current = counter.current.load(memory_order_relaxed),
+		.peak = counter.peak.load(memory_order_relaxed),
+	};
+}
+
+}
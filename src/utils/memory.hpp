@@ -0,0 +1,111 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+namespace playnote {
+
+// Subsystem that a block of memory is attributed to. Bytes are charged to the subsystem that
+// allocated them, and stay charged to it even if the container is later moved elsewhere.
+enum class MemoryTag {
+	Other,
+	ChartMedia, // Keysounds, previews and BGA images of loaded charts
+	AudioCache, // Decoded audio of songs being imported
+	ImportStaging, // Files being transcoded during import
+	TextAtlas, // Glyph atlas bitmaps
+	Assets, // Decompressed game assets
+	VideoFrames, // Video BGA frames decoded ahead of playback
+};
+
+// Memory currently attributed to a subsystem, in bytes.
+struct MemoryUsage {
+	ssize_t current;
+	ssize_t peak; // Highest value of current since startup
+};
+
+// Adjust the byte count of a subsystem. Negative values release memory.
+void charge_memory(MemoryTag, ssize_t bytes) noexcept;
+
+// Retrieve the current usage of a subsystem.
+[[nodiscard]] auto get_memory_usage(MemoryTag) -> MemoryUsage;
+
+// Standard allocator that charges every allocation to a subsystem.
+template<typename T>
+class TrackedAllocator {
+public:
+	using value_type = T;
+	// The tag travels with the memory it allocated
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	TrackedAllocator() noexcept = default;
+	explicit TrackedAllocator(MemoryTag tag) noexcept: tag{tag} {}
+	template<typename U>
+	TrackedAllocator(TrackedAllocator<U> const& other) noexcept: tag{other.get_tag()} {}
+
+	[[nodiscard]] auto allocate(size_t n) -> T*
+	{
+		auto* ptr = std::allocator<T>{}.allocate(n);
+		charge_memory(tag, static_cast<ssize_t>(n * sizeof(T)));
+		return ptr;
+	}
+
+	void deallocate(T* ptr, size_t n) noexcept
+	{
+		std::allocator<T>{}.deallocate(ptr, n);
+		charge_memory(tag, -static_cast<ssize_t>(n * sizeof(T)));
+	}
+
+	[[nodiscard]] auto get_tag() const noexcept -> MemoryTag { return tag; }
+
+	template<typename U>
+	auto operator==(TrackedAllocator<U> const& other) const noexcept -> bool { return tag == other.get_tag(); }
+
+private:
+	MemoryTag tag = MemoryTag::Other;
+};
+
+template<typename T>
+using tracked_vector = vector<T, TrackedAllocator<T>>;
+
+// Create an empty vector that charges its memory to the subsystem.
+template<typename T>
+[[nodiscard]] auto make_tracked_vector(MemoryTag tag) -> tracked_vector<T>
+{ return tracked_vector<T>{TrackedAllocator<T>{tag}}; }
+
+// Charge for memory that is owned by a library and can't use a TrackedAllocator.
+// The charge is released on destruction.
+class MemoryCharge {
+public:
+	explicit MemoryCharge(MemoryTag tag) noexcept: tag{tag} {}
+	~MemoryCharge() noexcept { charge_memory(tag, -bytes); }
+
+	// Update the number of bytes held.
+	void set(ssize_t new_bytes) noexcept { add(new_bytes - bytes); }
+
+	// Adjust the number of bytes held by a difference.
+	void add(ssize_t delta) noexcept
+	{
+		charge_memory(tag, delta);
+		bytes += delta;
+	}
+
+	MemoryCharge(MemoryCharge const&) = delete;
+	auto operator=(MemoryCharge const&) -> MemoryCharge& = delete;
+	MemoryCharge(MemoryCharge&&) = delete;
+	auto operator=(MemoryCharge&&) -> MemoryCharge& = delete;
+
+private:
+	MemoryTag tag;
+	ssize_t bytes = 0;
+};
+
+}
@@ -0,0 +1,260 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/scheduler.hpp"
+
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "utils/tracing.hpp"
+
+namespace playnote {
+
+namespace {
+
+// Minimal coroutine type that owns its own frame and destroys it upon completion.
+struct DetachedTask {
+	struct promise_type {
+		auto get_return_object() noexcept -> DetachedTask { return {}; }
+		auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+		auto final_suspend() noexcept -> std::suspend_never { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+auto run_detached(Scheduler& scheduler, Scheduler::Priority priority, task<> t) -> DetachedTask
+{
+	co_await scheduler.schedule(priority);
+	try {
+		co_await t;
+	} catch (exception const& e) {
+		ERROR("Uncaught exception in detached task: {}", e.what());
+	}
+}
+
+}
+
+Scheduler::Scheduler(ssize_t thread_count, function<void(ssize_t)> on_thread_start)
+{
+	add_group(Priority::Interactive, Priority::Maintenance, thread_count);
+	start_workers({{thread_count, move(on_thread_start)}});
+}
+
+Scheduler::Scheduler(WorkerSet foreground, WorkerSet background)
+{
+	add_group(Priority::Interactive, Priority::Load, foreground.thread_count);
+	add_group(Priority::Import, Priority::Maintenance, background.thread_count);
+	groups[1]->helper = groups[0].get();
+	groups[0]->helping = groups[1].get();
+	start_workers({move(foreground), move(background)});
+}
+
+Scheduler::~Scheduler() noexcept
+{
+	stopping.store(true);
+	wake_all();
+	for (auto& group: groups)
+		for (auto& worker: group->workers) worker->thread.join();
+}
+
+auto Scheduler::get_thread_count() const -> ssize_t
+{
+	auto count = 0z;
+	for (auto const& group: groups) count += ssize(group->workers);
+	return count;
+}
+
+void Scheduler::spawn(Priority priority, task<>&& t)
+{ run_detached(*this, priority, move(t)); }
+
+void Scheduler::add_group(Priority most_urgent, Priority least_urgent, ssize_t thread_count)
+{
+	auto& group = *groups.emplace_back(make_unique<WorkerGroup>());
+	group.most_urgent = most_urgent;
+	group.least_urgent = least_urgent;
+	group.workers.resize(thread_count);
+	for (auto& worker: group.workers) worker = make_unique<Worker>();
+}
+
+void Scheduler::start_workers(initializer_list<WorkerSet> sets)
+{
+	// Workers only start once they all exist, since they can steal from each other
+	// and hand work over to other groups
+	auto idx = 0z;
+	for (auto [group, set]: views::zip(groups, sets)) {
+		for (auto& worker: group->workers) {
+			worker->thread = jthread{[this, &group = *group, &worker = *worker, idx, on_thread_start = set.on_thread_start] {
+				run_worker(group, worker, idx, on_thread_start);
+			}};
+			idx += 1;
+		}
+	}
+}
+
+auto Scheduler::group_for(Priority priority) -> WorkerGroup&
+{
+	for (auto& group: groups)
+		if (+priority >= +group->most_urgent && +priority <= +group->least_urgent) return *group;
+	unreachable();
+}
+
+void Scheduler::wake_all()
+{
+	for (auto& group: groups) {
+		{
+			auto lock = lock_guard{group->sleep_lock};
+		}
+		group->wakeup.notify_all();
+	}
+}
+
+void Scheduler::enqueue(std::coroutine_handle<> handle, Priority priority)
+{
+	auto& group = group_for(priority);
+	// Work spawned by a worker stays local until stolen, to keep caches warm
+	auto& worker = current_scheduler == this && current_group == &group?
+		*current_worker :
+		*group.workers[group.next_worker.fetch_add(1) % ssize(group.workers)];
+	// Recorded before the push, since a worker could resume and finish the coroutine right after it
+	auto const flow_id = TRACE_NEW_FLOW_ID();
+	TRACE_FLOW_BEGIN("Resume", flow_id);
+	active.fetch_add(1);
+	{
+		auto lock = lock_guard{worker.lock};
+		worker.queues[+priority].emplace_back(QueuedTask{.handle = handle, .flow_id = flow_id});
+		worker.queued.fetch_add(1, memory_order_relaxed);
+	}
+	group.pending.fetch_add(1);
+	// A worker about to sleep either sees the new pending count, or is counted as sleeping here.
+	// The group's own workers are preferred; the helper only steps in if they're all busy
+	if (group.sleeping.load() > 0)
+		notify(group);
+	else if (group.helper && group.helper->sleeping.load() > 0)
+		notify(*group.helper);
+}
+
+void Scheduler::notify(WorkerGroup& group)
+{
+	// Taking the lock makes sure a worker is already waiting on the condition variable
+	// by the time we notify
+	{
+		auto lock = lock_guard{group.sleep_lock};
+	}
+	group.wakeup.notify_one();
+}
+
+auto Scheduler::try_claim(WorkerGroup& group) -> bool
+{
+	auto count = group.pending.load();
+	while (count > 0)
+		if (group.pending.compare_exchange_weak(count, count - 1)) return true;
+	return false;
+}
+
+auto Scheduler::has_work(WorkerGroup const& group) -> bool
+{ return group.pending.load() > 0 || (group.helping && group.helping->pending.load() > 0); }
+
+auto Scheduler::try_dequeue(WorkerGroup& group, Worker& self) -> optional<pair<QueuedTask, Priority>>
+{
+	for (auto priority_idx: views::iota(+group.most_urgent, +group.least_urgent + 1)) {
+		auto const priority = static_cast<Priority>(priority_idx);
+
+		// Own work is taken newest-first
+		if (self.queued.load(memory_order_relaxed) > 0) {
+			auto lock = lock_guard{self.lock};
+			auto& queue = self.queues[priority_idx];
+			if (!queue.empty()) {
+				auto queued = queue.back();
+				queue.pop_back();
+				self.queued.fetch_sub(1, memory_order_relaxed);
+				return make_pair(queued, priority);
+			}
+		}
+
+		// Other workers' work is stolen oldest-first
+		for (auto& victim: group.workers) {
+			if (victim.get() == &self) continue;
+			if (victim->queued.load(memory_order_relaxed) == 0) continue;
+			auto lock = lock_guard{victim->lock};
+			auto& queue = victim->queues[priority_idx];
+			if (queue.empty()) continue;
+			auto queued = queue.front();
+			queue.pop_front();
+			victim->queued.fetch_sub(1, memory_order_relaxed);
+			return make_pair(queued, priority);
+		}
+	}
+	return nullopt;
+}
+
+void Scheduler::run_worker(WorkerGroup& group, Worker& self, ssize_t idx, function<void(ssize_t)> const& on_thread_start)
+{
+	current_scheduler = this;
+	current_group = &group;
+	current_worker = &self;
+	if (on_thread_start) on_thread_start(idx);
+
+	while (true) {
+		auto* source = &group;
+		if (!try_claim(group)) {
+			if (group.helping && try_claim(*group.helping)) {
+				source = group.helping;
+			} else {
+				auto lock = std::unique_lock{group.sleep_lock};
+				group.sleeping.fetch_add(1);
+				// Workers only exit once no group has work left, since that work could still queue more here
+				group.wakeup.wait(lock, [&] { return has_work(group) || (stopping.load() && active.load() == 0); });
+				group.sleeping.fetch_sub(1);
+				if (!has_work(group) && stopping.load() && active.load() == 0) return;
+				continue;
+			}
+		}
+
+		// A claimed task is guaranteed to be queued somewhere, but the sweep can still miss it
+		// if other workers are taking tasks from under it at the same time
+		auto work = try_dequeue(*source, self);
+		while (!work) {
+			std::this_thread::yield();
+			work = try_dequeue(*source, self);
+		}
+		auto [queued, priority] = *work;
+		current_priority = priority;
+		TRACE_ZONE("Resume");
+		TRACE_FLOW_END("Resume", queued.flow_id);
+		queued.handle.resume();
+		if (active.fetch_sub(1) == 1 && stopping.load()) wake_all();
+	}
+}
+
+void TaskGroup::wait() const noexcept
+{
+	for (auto count = running->load(); count != 0; count = running->load())
+		running->wait(count);
+}
+
+void TaskGroup::start(task<>&& t)
+{
+	running->fetch_add(1);
+	// The counter is shared, since the group can be destroyed the moment it reaches zero
+	scheduler.spawn(priority, [](shared_ptr<atomic<ssize_t>> running, task<> t) -> task<> {
+		auto finish = [&] {
+			running->fetch_sub(1);
+			running->notify_all();
+		};
+		try {
+			co_await t;
+		} catch (...) {
+			finish();
+			throw;
+		}
+		finish();
+	}(running, move(t)));
+}
+
+}
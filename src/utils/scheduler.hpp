@@ -0,0 +1,174 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include "preamble.hpp"
+
+namespace playnote {
+
+// A work-stealing thread pool for coroutines. Every worker owns a deque per priority class;
+// idle workers always take the most urgent work available anywhere, stealing from other workers
+// if needed. Tasks give way to more urgent work whenever they're rescheduled. Workers can be split
+// into a foreground and a background group, each serving its own priority classes; idle foreground
+// workers also help with background work.
+class Scheduler {
+public:
+	// Urgency of a piece of work, from most to least urgent.
+	enum class Priority {
+		Interactive, // Needed for the next few frames
+		Load, // The user is waiting on it
+		Import, // Library import
+		Maintenance, // Can take as long as it needs
+	};
+
+	// Awaitable that resumes the awaiting coroutine on one of the workers.
+	class ScheduleOperation {
+	public:
+		[[nodiscard]] auto await_ready() const noexcept -> bool { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { scheduler.enqueue(handle, priority); }
+		void await_resume() const noexcept {}
+
+	private:
+		friend Scheduler;
+		Scheduler& scheduler;
+		Priority priority;
+
+		ScheduleOperation(Scheduler& scheduler, Priority priority): scheduler{scheduler}, priority{priority} {}
+	};
+
+	// A group of workers, each initialized with the provided function before running any tasks.
+	// Workers are numbered across all groups of a scheduler.
+	struct WorkerSet {
+		ssize_t thread_count;
+		function<void(ssize_t)> on_thread_start;
+	};
+
+	// Start a single group of workers, which runs work of every priority.
+	Scheduler(ssize_t thread_count, function<void(ssize_t)> on_thread_start = {});
+
+	// Start separate groups of workers for Interactive and Load work, and for Import and Maintenance
+	// work. This lets each group run at an OS priority that suits its work, without a big import
+	// holding up urgent work or urgent work being starved along with the import. Foreground workers
+	// take background work whenever they have none of their own; background workers never take
+	// foreground work, since their OS priority could starve it.
+	Scheduler(WorkerSet foreground, WorkerSet background);
+
+	// Finish all remaining work and stop the workers.
+	~Scheduler() noexcept;
+
+	// Move the awaiting coroutine onto a worker, queued at the given priority.
+	[[nodiscard]] auto schedule(Priority priority) -> ScheduleOperation { return ScheduleOperation{*this, priority}; }
+
+	// Run the task on a worker at the given priority once the returned task is awaited.
+	template<typename T>
+	auto schedule(Priority priority, task<T> t) -> task<T>
+	{
+		co_await schedule(priority);
+		co_return co_await t;
+	}
+
+	// Let any more urgent work run first. The coroutine keeps its current priority.
+	[[nodiscard]] auto yield() -> ScheduleOperation { return schedule(get_current_priority()); }
+
+	// Run the task on a worker at the given priority without waiting for its result.
+	// Exceptions escaping the task are logged.
+	void spawn(Priority, task<>&&);
+
+	// Priority of the work the current thread is running. Tasks scheduled without an explicit
+	// priority inherit it. Threads outside of any scheduler report Interactive.
+	[[nodiscard]] static auto get_current_priority() -> Priority { return current_priority; }
+
+	[[nodiscard]] auto get_thread_count() const -> ssize_t;
+
+	Scheduler(Scheduler const&) = delete;
+	auto operator=(Scheduler const&) -> Scheduler& = delete;
+	Scheduler(Scheduler&&) = delete;
+	auto operator=(Scheduler&&) -> Scheduler& = delete;
+
+private:
+	// A coroutine waiting to be resumed, along with the ID linking its enqueue and resume in traces.
+	struct QueuedTask {
+		std::coroutine_handle<> handle;
+		uint64_t flow_id;
+	};
+
+	struct Worker {
+		mutex lock;
+		array<deque<QueuedTask>, enum_count<Priority>()> queues;
+		atomic<ssize_t> queued = 0; // Across all priorities; lets thieves skip empty workers without locking
+		jthread thread;
+	};
+
+	// Workers serving a range of priorities. Work moves between workers of the same group, and to
+	// the helper group's workers once they run out of their own.
+	struct WorkerGroup {
+		Priority most_urgent;
+		Priority least_urgent;
+		WorkerGroup* helper = nullptr; // Group whose idle workers also take this group's work
+		WorkerGroup* helping = nullptr; // Inverse of the above
+		vector<unique_ptr<Worker>> workers;
+		atomic<ssize_t> next_worker = 0;
+		atomic<ssize_t> pending = 0; // Queued tasks that no worker has claimed yet
+		atomic<ssize_t> sleeping = 0; // Workers waiting on wakeup
+		mutex sleep_lock;
+		std::condition_variable wakeup;
+	};
+
+	inline static thread_local auto current_priority = Priority::Interactive;
+	inline static thread_local Scheduler* current_scheduler = nullptr;
+	inline static thread_local WorkerGroup* current_group = nullptr;
+	inline static thread_local Worker* current_worker = nullptr;
+
+	vector<unique_ptr<WorkerGroup>> groups;
+	atomic<ssize_t> active = 0; // Tasks queued or running in any group; any of them could queue more work
+	atomic<bool> stopping = false;
+
+	void add_group(Priority most_urgent, Priority least_urgent, ssize_t thread_count);
+	void start_workers(initializer_list<WorkerSet>);
+	[[nodiscard]] auto group_for(Priority) -> WorkerGroup&;
+	void wake_all();
+	void enqueue(std::coroutine_handle<>, Priority);
+	static void notify(WorkerGroup&);
+	[[nodiscard]] static auto try_claim(WorkerGroup&) -> bool;
+	[[nodiscard]] static auto has_work(WorkerGroup const&) -> bool;
+	[[nodiscard]] static auto try_dequeue(WorkerGroup&, Worker&) -> optional<pair<QueuedTask, Priority>>;
+	void run_worker(WorkerGroup&, Worker&, ssize_t idx, function<void(ssize_t)> const& on_thread_start);
+};
+
+// A set of fire-and-forget tasks that are tracked as a whole.
+class TaskGroup {
+public:
+	TaskGroup(Scheduler& scheduler, Scheduler::Priority priority): scheduler{scheduler}, priority{priority} {}
+
+	// Wait for all tasks in the group to finish.
+	~TaskGroup() noexcept { wait(); }
+
+	// Block until all tasks in the group have finished, including ones they start in the meantime.
+	void wait() const noexcept;
+
+	// Launch a task as part of the group.
+	void start(task<>&&);
+
+	// Check if all tasks in the group have finished.
+	[[nodiscard]] auto empty() const -> bool { return running->load() == 0; }
+
+	TaskGroup(TaskGroup const&) = delete;
+	auto operator=(TaskGroup const&) -> TaskGroup& = delete;
+	TaskGroup(TaskGroup&&) = delete;
+	auto operator=(TaskGroup&&) -> TaskGroup& = delete;
+
+private:
+	Scheduler& scheduler;
+	Scheduler::Priority priority;
+	shared_ptr<atomic<ssize_t>> running = make_shared<atomic<ssize_t>>(0);
+};
+
+}
@@ -9,32 +9,47 @@ or distributed except according to those terms.
 
 #pragma once
 #include "preamble.hpp"
+#include "utils/scheduler.hpp"
 #include "utils/service.hpp"
 
 namespace playnote::globals {
-inline auto fg_pool = Service<unique_ptr<thread_pool>>{};
-inline auto bg_pool = Service<unique_ptr<thread_pool>>{};
+inline auto scheduler = Service<Scheduler>{};
 }
 
 namespace playnote {
 
-// Launch a fire-and-forget task on a thread pool.
-inline void launch_task_on(unique_ptr<thread_pool>& pool, task<>&& t)
-{ pool->spawn(move(t)); }
+// All task frames created through these helpers are served by the pooled allocator
+// in utils/frame_pool.hpp.
 
-// Schedule a task on the thread pool. The task will execute once the returned task is awaited.
+using Priority = Scheduler::Priority;
+
+// Launch a fire-and-forget task on a scheduler.
+inline void launch_task_on(Scheduler& scheduler, Priority priority, task<>&& t)
+{ scheduler.spawn(priority, move(t)); }
+
+// Schedule a task on the scheduler. The task will execute once the returned task is awaited.
 template<typename T>
-auto schedule_task_on(unique_ptr<thread_pool>& pool, task<T>&& t) -> task<T>
-{ return pool->schedule(move(t)); }
+auto schedule_task_on(Scheduler& scheduler, Priority priority, task<T>&& t) -> task<T>
+{ return scheduler.schedule(priority, move(t)); }
 
-// Launch a task on the thread pool and return a future to its result, so that its result can be polled synchronously.
+// Schedule a task on the scheduler at the priority of the calling task.
 template<typename T>
-auto launch_pollable_on(unique_ptr<thread_pool>& pool, task<T>&& t) -> future<T> {
+auto schedule_task_on(Scheduler& scheduler, task<T>&& t) -> task<T>
+{ return scheduler.schedule(Scheduler::get_current_priority(), move(t)); }
+
+// Launch a task on the scheduler and return a future to its result, so that its result can be polled synchronously.
+template<typename T>
+auto launch_pollable_on(Scheduler& scheduler, Priority priority, task<T>&& t) -> future<T> {
 	auto result_promise = promise<T>{};
 	auto result_future = result_promise.get_future();
-	launch_task_on(pool, [](promise<T> p, task<T> t) -> task<> {
+	launch_task_on(scheduler, priority, [](promise<T> p, task<T> t) -> task<> {
 		try {
-			p.set_value(move(co_await t));
+			if constexpr (same_as<T, void>) {
+				co_await t;
+				p.set_value();
+			} else {
+				p.set_value(move(co_await t));
+			}
 		}
 		catch (...) {
 			p.set_exception(current_exception());
@@ -43,17 +58,14 @@ auto launch_pollable_on(unique_ptr<thread_pool>& pool, task<T>&& t) -> future<T>
 	return result_future;
 }
 
-// Shorthands for global pools
+// Shorthands for the global scheduler
 
-inline void launch_fg(task<>&& t) { launch_task_on(*globals::fg_pool, forward<task<>>(t)); }
-inline void launch_bg(task<>&& t) { launch_task_on(*globals::bg_pool, forward<task<>>(t)); }
-template<typename T>
-auto schedule_fg(task<T>&& t) -> task<T> { return schedule_task_on(*globals::fg_pool, forward<task<T>>(t)); }
+inline void launch_task(Priority priority, task<>&& t) { launch_task_on(*globals::scheduler, priority, forward<task<>>(t)); }
 template<typename T>
-auto schedule_bg(task<T>&& t) -> task<T> { return schedule_task_on(*globals::bg_pool, forward<task<T>>(t)); }
+auto schedule_task(Priority priority, task<T>&& t) -> task<T> { return schedule_task_on(*globals::scheduler, priority, forward<task<T>>(t)); }
 template<typename T>
-auto pollable_fg(task<T>&& t) -> future<T> { return launch_pollable_on(*globals::fg_pool, forward<task<T>>(t)); }
+auto schedule_task(task<T>&& t) -> task<T> { return schedule_task_on(*globals::scheduler, forward<task<T>>(t)); }
 template<typename T>
-auto pollable_bg(task<T>&& t) -> future<T> { return launch_pollable_on(*globals::bg_pool, forward<task<T>>(t)); }
+auto launch_pollable(Priority priority, task<T>&& t) -> future<T> { return launch_pollable_on(*globals::scheduler, priority, forward<task<T>>(t)); }
 
 }
@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/tracing.hpp"
+
+#ifdef ENABLE_TRACING
+
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "io/file.hpp"
+
+namespace playnote::tracing {
+
+namespace {
+
+// Events are stored in fixed-size chunks that never move, so that the exporter can read
+// published events while the owning thread keeps appending. The chunks form a ring; once all
+// of them are allocated, the oldest events are overwritten.
+constexpr auto ChunkSize = 4096z;
+constexpr auto MaxChunks = 256z; // 32MiB per thread
+constexpr auto Capacity = ChunkSize * MaxChunks;
+
+enum class EventType: uint8_t {
+	Zone,
+	Counter,
+	AsyncBegin,
+	AsyncEnd,
+	FlowBegin,
+	FlowEnd,
+};
+
+struct Event {
+	char const* name;
+	uint64_t timestamp;
+	uint64_t payload; // Zone end, counter value, or async/flow ID
+	EventType type;
+};
+
+struct ThreadBuffer {
+	ssize_t tid;
+	string name; // Written only by the owning thread, under the registry lock
+	array<atomic<Event*>, MaxChunks> chunks{};
+	atomic<ssize_t> size = 0; // Events ever recorded; the ring holds the last Capacity of them
+	atomic<ssize_t> dropped = 0;
+
+	explicit ThreadBuffer(ssize_t tid): tid{tid} {}
+	~ThreadBuffer() { for (auto& chunk: chunks) delete[] chunk.load(); }
+
+	ThreadBuffer(ThreadBuffer const&) = delete;
+	auto operator=(ThreadBuffer const&) -> ThreadBuffer& = delete;
+	ThreadBuffer(ThreadBuffer&&) = delete;
+	auto operator=(ThreadBuffer&&) -> ThreadBuffer& = delete;
+};
+
+// All buffers ever created. They outlive their threads, so that short-lived threads still
+// show up in the export.
+struct Registry {
+	mutex lock;
+	vector<unique_ptr<ThreadBuffer>> buffers;
+	// Exported timestamps are relative to this. The matching clock time calibrates the tick rate
+	uint64_t epoch = now();
+	steady_clock::time_point epoch_time = steady_clock::now();
+};
+
+auto registry() -> Registry&
+{
+	static auto instance = Registry{};
+	return instance;
+}
+
+thread_local auto current_buffer = static_cast<ThreadBuffer*>(nullptr); // Owned by the registry
+auto async_id_counter = atomic<uint64_t>{1};
+auto flow_id_counter = atomic<uint64_t>{1};
+
+// Return the current thread's buffer, creating it on first use. Returns nullptr if it couldn't
+// be created, in which case the thread's events are lost.
+auto get_buffer() noexcept -> ThreadBuffer*
+{
+	if (!current_buffer) [[unlikely]] {
+		try {
+			auto& reg = registry();
+			auto lock = lock_guard{reg.lock};
+			current_buffer = reg.buffers.emplace_back(make_unique<ThreadBuffer>(static_cast<ssize_t>(reg.buffers.size()) + 1)).get();
+		} catch (...) {
+			return nullptr;
+		}
+	}
+	return current_buffer;
+}
+
+// Next free slot in the current thread's chunk, and the end of that chunk. Most events only
+// need these, and skip looking up the chunk.
+thread_local auto next_slot = static_cast<Event*>(nullptr);
+thread_local auto chunk_end = static_cast<Event*>(nullptr);
+
+// Point the slot cursor at the chunk holding the thread's next event, allocating the chunk
+// on the ring's first lap. Returns false if memory is exhausted.
+auto advance_chunk(ThreadBuffer& buffer) noexcept -> bool
+{
+	auto const idx = buffer.size.load(memory_order_relaxed); // Only this thread writes
+	auto const chunk_idx = idx / ChunkSize % MaxChunks;
+	auto* chunk = buffer.chunks[chunk_idx].load(memory_order_relaxed);
+	if (!chunk) [[unlikely]] {
+		chunk = new(std::nothrow) Event[ChunkSize];
+		if (!chunk) return false;
+		buffer.chunks[chunk_idx].store(chunk, memory_order_release);
+	}
+	next_slot = chunk + idx % ChunkSize;
+	chunk_end = chunk + ChunkSize;
+	return true;
+}
+
+// Append an event to the current thread's buffer, overwriting the oldest one if it's full.
+// Events that arrive while memory is exhausted are dropped.
+void record(EventType type, char const* name, uint64_t timestamp, uint64_t payload) noexcept
+{
+	if (next_slot == chunk_end) [[unlikely]] {
+		auto* buffer = get_buffer();
+		if (!buffer) return;
+		if (!advance_chunk(*buffer)) {
+			buffer->dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+	}
+	*next_slot = Event{
+		.name = name,
+		.timestamp = timestamp,
+		.payload = payload,
+		.type = type,
+	};
+	next_slot += 1;
+	auto& size = current_buffer->size;
+	size.store(size.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void append_escaped(string& out, string_view str)
+{
+	for (auto c: str) {
+		switch (c) {
+		case '"': out.append("\\\""); break;
+		case '\\': out.append("\\\\"); break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				out.append(format("\\u{:04x}", c));
+			else
+				out.push_back(c);
+		}
+	}
+}
+
+// Conversion of timestamps into the microseconds of Chrome traces.
+struct Timebase {
+	uint64_t epoch;
+	double us_per_tick;
+
+	[[nodiscard]] auto to_us(uint64_t timestamp) const -> double
+	{ return static_cast<double>(static_cast<int64_t>(timestamp - epoch)) * us_per_tick; }
+};
+
+void append_event(string& out, Event const& ev, ssize_t tid, Timebase const& timebase)
+{
+	out.append(R"({"name":")");
+	append_escaped(out, ev.name);
+	out.append(format(R"(","pid":1,"tid":{},"ts":{:.3f},)", tid, timebase.to_us(ev.timestamp)));
+	switch (ev.type) {
+	case EventType::Zone:
+		out.append(format(R"("ph":"X","dur":{:.3f})", static_cast<double>(ev.payload - ev.timestamp) * timebase.us_per_tick));
+		break;
+	case EventType::Counter:
+		out.append(format(R"("ph":"C","args":{{"value":{}}})", bit_cast<double>(ev.payload)));
+		break;
+	case EventType::AsyncBegin:
+		out.append(format(R"("ph":"b","cat":"async","id":"{:#x}")", ev.payload));
+		break;
+	case EventType::AsyncEnd:
+		out.append(format(R"("ph":"e","cat":"async","id":"{:#x}")", ev.payload));
+		break;
+	case EventType::FlowBegin:
+		out.append(format(R"("ph":"s","cat":"flow","id":"{:#x}")", ev.payload));
+		break;
+	case EventType::FlowEnd:
+		out.append(format(R"("ph":"f","bp":"e","cat":"flow","id":"{:#x}")", ev.payload));
+		break;
+	}
+	out.append("},\n");
+}
+
+}
+
+void record_zone(Name name, uint64_t start, uint64_t end) noexcept
+{ record(EventType::Zone, name.str, start, end); }
+
+void record_counter(Name name, double value) noexcept
+{ record(EventType::Counter, name.str, now(), bit_cast<uint64_t>(value)); }
+
+void record_async(Name name, uint64_t id, bool begin) noexcept
+{ record(begin? EventType::AsyncBegin : EventType::AsyncEnd, name.str, now(), id); }
+
+void record_flow(Name name, uint64_t id, bool begin) noexcept
+{ record(begin? EventType::FlowBegin : EventType::FlowEnd, name.str, now(), id); }
+
+void set_thread_name(string_view name)
+{
+	auto* buffer = get_buffer();
+	if (!buffer) return;
+	if (buffer->name == name) return; // Cheap enough to call from a hot loop
+	auto lock = lock_guard{registry().lock};
+	buffer->name = name;
+}
+
+auto next_async_id() noexcept -> uint64_t
+{ return async_id_counter.fetch_add(1, memory_order_relaxed); }
+
+auto next_flow_id() noexcept -> uint64_t
+{ return flow_id_counter.fetch_add(1, memory_order_relaxed); }
+
+void export_chrome_trace(fs::path const& path)
+{
+	auto& reg = registry();
+	auto out = string{R"({"displayTimeUnit":"ns","traceEvents":[)" "\n"};
+	auto total_events = 0z;
+	auto total_dropped = 0z;
+	auto total_overwritten = 0z;
+	{
+		auto lock = lock_guard{reg.lock};
+		auto const elapsed_ticks = static_cast<double>(now() - reg.epoch);
+		auto const elapsed_us = duration_cast<duration<double, std::micro>>(steady_clock::now() - reg.epoch_time).count();
+		auto const timebase = Timebase{
+			.epoch = reg.epoch,
+			.us_per_tick = elapsed_ticks > 0.0? elapsed_us / elapsed_ticks : 0.0,
+		};
+		auto events = vector<Event>{};
+		for (auto const& buffer: reg.buffers) {
+			out.append(format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":")", buffer->tid));
+			append_escaped(out, buffer->name.empty()? format("thread{}", buffer->tid) : buffer->name);
+			out.append("\"}},\n");
+
+			// Copy the events out first, then drop the ones the thread overwrote in the meantime,
+			// like the reader of a seqlock
+			auto const size = buffer->size.load(memory_order_acquire);
+			auto const first = max(0z, size - Capacity);
+			events.clear();
+			for (auto idx: views::iota(first, size)) {
+				auto const* chunk = buffer->chunks[idx / ChunkSize % MaxChunks].load(memory_order_acquire);
+				events.emplace_back(chunk[idx % ChunkSize]);
+			}
+			std::atomic_thread_fence(memory_order_acquire);
+			// The thread could be writing over the slot of event size_now - Capacity right now
+			auto const size_now = buffer->size.load(memory_order_relaxed);
+			auto const valid_first = clamp(size_now - Capacity + 1, first, size);
+			for (auto const& ev: span{events}.subspan(valid_first - first))
+				append_event(out, ev, buffer->tid, timebase);
+			total_events += size - valid_first;
+			total_overwritten += valid_first;
+			total_dropped += buffer->dropped.load(memory_order_relaxed);
+		}
+	}
+	out.append(format(R"({{"name":"process_name","ph":"M","pid":1,"args":{{"name":"{}"}}}})" "\n]}}\n", AppTitle));
+
+	io::write_file(path, {reinterpret_cast<byte const*>(out.data()), out.size()});
+	INFO("Exported {} trace events to \"{}\"", total_events, path);
+	if (total_overwritten)
+		INFO("{} older trace events were overwritten by newer ones", total_overwritten);
+	if (total_dropped)
+		WARN("{} trace events were dropped due to exhausted memory", total_dropped);
+}
+
+}
+
+#endif
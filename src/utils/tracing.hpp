@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+// Profiling instrumentation. Events are recorded into per-thread ring buffers without locking,
+// and can be exported at any time as a Chrome trace, which Perfetto can open as well. Once
+// a thread's buffer is full, its oldest events are overwritten, so that an export always has
+// the most recent ones.
+// Enabled with the PLAYNOTE_TRACING CMake option; otherwise all macros compile to nothing
+// and their arguments are not evaluated.
+//
+// Zones are timed from construction to the end of the enclosing scope, and must not contain
+// a co_await, since the coroutine might resume on another thread. Use an async span instead.
+
+#ifdef ENABLE_TRACING
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#define TRACING_CONCAT_IMPL(a, b) a##b
+#define TRACING_CONCAT(a, b) TRACING_CONCAT_IMPL(a, b)
+
+// Time the rest of the enclosing scope.
+#define TRACE_ZONE(name) auto const TRACING_CONCAT(trace_zone_, __LINE__) = playnote::tracing::Zone{name}
+// Time the rest of the enclosing scope, which may be a coroutine suspending across threads.
+#define TRACE_ASYNC_SPAN(name) auto const TRACING_CONCAT(trace_span_, __LINE__) = playnote::tracing::AsyncSpan{name}
+// Record the current value of a named quantity.
+#define TRACE_COUNTER(name, value) playnote::tracing::record_counter(name, static_cast<double>(value))
+// Retrieve a unique ID for a flow. Evaluates to 0 when tracing is disabled.
+#define TRACE_NEW_FLOW_ID() playnote::tracing::next_flow_id()
+// Link the current point to a later TRACE_FLOW_END with the same ID, possibly on another thread.
+#define TRACE_FLOW_BEGIN(name, id) playnote::tracing::record_flow(name, id, true)
+#define TRACE_FLOW_END(name, id) playnote::tracing::record_flow(name, id, false)
+// Label the current thread in exported traces.
+#define TRACE_THREAD_NAME(name) playnote::tracing::set_thread_name(name)
+
+namespace playnote::tracing {
+
+// Event name. Only the pointer is stored, so it's required to be a string literal.
+struct Name {
+	char const* str;
+	consteval Name(char const* str): str{str} {}
+};
+
+// Current timestamp, in CPU timestamp counter ticks. Reading the counter directly costs a fraction
+// of a call into the OS clock; ticks are converted to nanoseconds on export.
+[[nodiscard]] inline auto now() noexcept -> uint64_t { return __rdtsc(); }
+
+void record_zone(Name, uint64_t start, uint64_t end) noexcept;
+void record_counter(Name, double value) noexcept;
+void record_async(Name, uint64_t id, bool begin) noexcept;
+void record_flow(Name, uint64_t id, bool begin) noexcept;
+void set_thread_name(string_view);
+
+// Retrieve a unique ID for an async span.
+[[nodiscard]] auto next_async_id() noexcept -> uint64_t;
+
+// Retrieve a unique ID for a flow.
+[[nodiscard]] auto next_flow_id() noexcept -> uint64_t;
+
+// Write the events still held in the buffers into a Chrome trace JSON file. Threads keep recording
+// while the export is running; events after the starting point are not included.
+void export_chrome_trace(fs::path const&);
+
+// RAII helper for TRACE_ZONE.
+class Zone {
+public:
+	explicit Zone(Name name) noexcept: name{name}, start{now()} {}
+	~Zone() noexcept { record_zone(name, start, now()); }
+
+	Zone(Zone const&) = delete;
+	auto operator=(Zone const&) -> Zone& = delete;
+	Zone(Zone&&) = delete;
+	auto operator=(Zone&&) -> Zone& = delete;
+
+private:
+	Name name;
+	uint64_t start;
+};
+
+// RAII helper for TRACE_ASYNC_SPAN.
+class AsyncSpan {
+public:
+	explicit AsyncSpan(Name name) noexcept: name{name}, id{next_async_id()} { record_async(name, id, true); }
+	~AsyncSpan() noexcept { record_async(name, id, false); }
+
+	AsyncSpan(AsyncSpan const&) = delete;
+	auto operator=(AsyncSpan const&) -> AsyncSpan& = delete;
+	AsyncSpan(AsyncSpan&&) = delete;
+	auto operator=(AsyncSpan&&) -> AsyncSpan& = delete;
+
+private:
+	Name name;
+	uint64_t id;
+};
+
+}
+
+#else
+
+#define TRACE_ZONE(name) static_cast<void>(0)
+#define TRACE_ASYNC_SPAN(name) static_cast<void>(0)
+#define TRACE_COUNTER(name, value) static_cast<void>(0)
+#define TRACE_NEW_FLOW_ID() uint64_t{0}
+#define TRACE_FLOW_BEGIN(name, id) static_cast<void>(0)
+#define TRACE_FLOW_END(name, id) static_cast<void>(0)
+#define TRACE_THREAD_NAME(name) static_cast<void>(0)
+
+#endif
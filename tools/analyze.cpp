@@ -0,0 +1,390 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <condition_variable>
+#include <cstdlib>
+#include <clocale>
+#include <cmath>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "lib/openssl.hpp"
+#include "lib/archive.hpp"
+#include "io/source.hpp"
+#include "io/song.hpp"
+#include "io/file.hpp"
+#include "bms/builder.hpp"
+#include "common.hpp"
+
+namespace playnote {
+
+enum class OutputFormat {
+	Json, // One object per line
+	Csv,
+};
+
+struct AnalyzeOptions {
+	vector<fs::path> paths;
+	OutputFormat format = OutputFormat::Json;
+	bool audio = true;
+	bool density = false;
+	int sampling_rate = 48000;
+	ssize_t threads = max(1u, jthread::hardware_concurrency());
+	ssize_t jobs = 4; // Songs in memory at once
+	fs::path scratch = fs::temp_directory_path() / "playnote-analyze";
+};
+
+// A song to analyze. If chart is set, only that chart of the song is analyzed.
+struct SongInput {
+	fs::path path;
+	optional<fs::path> chart;
+};
+
+// Statistics of one chart, or the reason it couldn't be built.
+struct ChartResult {
+	string song;
+	string chart;
+	optional<bms::MD5> md5;
+	optional<bms::Metadata> metadata;
+	nanoseconds build_time;
+	string error;
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <paths>...\n"
+		"Build charts from BMS files, song folders or archives, and print their statistics.\n"
+		"Folders that aren't a song are searched recursively.\n\n"
+		"Options:\n"
+		"  --format <json|csv>  Output format; JSON is one object per line (default: json)\n"
+		"  --no-audio           Skip audio loading and rendering; loudness and audio duration\n"
+		"                       are not reported\n"
+		"  --density            Include the density graphs (JSON only)\n"
+		"  --sampling-rate <n>  Sampling rate of the audio render (default: 48000)\n"
+		"  --threads <n>        Worker thread count (default: hardware concurrency)\n"
+		"  --jobs <n>           Songs processed at once, bounding memory use (default: 4).\n"
+		"                       Results are printed as songs finish, in no particular order\n"
+		"  --scratch <dir>      Directory for temporary songzips (default: {})\n",
+		name, fs::temp_directory_path() / "playnote-analyze");
+}
+
+static auto parse_args(span<char const* const> args) -> optional<AnalyzeOptions>
+{
+	auto options = AnalyzeOptions{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			options.paths.emplace_back(arg);
+			continue;
+		}
+		if (arg == "--no-audio") {
+			options.audio = false;
+			continue;
+		}
+		if (arg == "--density") {
+			options.density = true;
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--format") {
+			if (value == "json") options.format = OutputFormat::Json;
+			else if (value == "csv") options.format = OutputFormat::Csv;
+			else return nullopt;
+		}
+		else if (arg == "--sampling-rate") options.sampling_rate = lexical_cast<int>(value);
+		else if (arg == "--threads") options.threads = lexical_cast<ssize_t>(value);
+		else if (arg == "--jobs") options.jobs = lexical_cast<ssize_t>(value);
+		else if (arg == "--scratch") options.scratch = value;
+		else return nullopt;
+	}
+	if (options.paths.empty() || options.sampling_rate <= 0 || options.threads < 1 || options.jobs < 1) return nullopt;
+	return options;
+}
+
+// Find all songs at the path, the same way the library import does.
+static void collect_songs(fs::path const& path, vector<SongInput>& songs)
+{
+	if (fs::is_regular_file(path)) {
+		if (io::has_extension(path, io::BMSExtensions))
+			songs.emplace_back(SongInput{.path = path.parent_path(), .chart = path.filename()});
+		else
+			songs.emplace_back(SongInput{.path = path});
+	} else if (fs::is_directory(path)) {
+		auto contents = vector<fs::directory_entry>{};
+		copy(fs::directory_iterator{path}, back_inserter(contents));
+		if (any_of(contents, [&](auto const& entry) { return fs::is_regular_file(entry) && io::has_extension(entry, io::BMSExtensions); }))
+			songs.emplace_back(SongInput{.path = path});
+		else
+			for (auto const& entry: contents) collect_songs(entry, songs);
+	} else {
+		throw runtime_error_fmt("\"{}\" is not a file or directory", path);
+	}
+}
+
+// Convert the song into a temporary songzip. Without audio, only the chart files are copied,
+// so that no audio is transcoded.
+static auto open_song(fs::path const& path, fs::path const& zip_path, bool audio) -> task<io::Song>
+{
+	auto cat = globals::logger->global;
+	auto source = io::Source{path};
+	if (audio) co_return co_await io::Song::from_source(cat, *globals::scheduler, source, zip_path);
+	auto ar = lib::archive::open_write(zip_path);
+	for (auto&& ref: source.for_each_file()) {
+		if (!io::has_extension(ref.get_path(), io::BMSExtensions)) continue;
+		lib::archive::write_entry(ar, ref.get_path(), ref.read());
+	}
+	ar.reset(); // Finalize archive
+	co_return io::Song{cat, io::read_file(zip_path)};
+}
+
+// Build every chart of a song.
+static auto analyze_song(SongInput input, fs::path zip_path, AnalyzeOptions const& options) -> task<vector<ChartResult>>
+{
+	auto& scheduler = *globals::scheduler;
+	auto cat = globals::logger->global;
+	auto results = vector<ChartResult>{};
+	auto const song_name = input.path.generic_string();
+	try {
+		auto song = co_await open_song(input.path, zip_path, options.audio);
+		if (options.audio) co_await song.preload_audio_files(scheduler, options.sampling_rate);
+
+		auto builder = bms::Builder{cat, options.audio};
+		for (auto [chart_path, chart_file]: song.for_each_chart()) {
+			if (input.chart && fs::path{chart_path} != *input.chart) continue;
+			auto& result = results.emplace_back(ChartResult{.song = song_name, .chart = string{chart_path}});
+			try {
+				auto const start = steady_clock::now();
+				auto const chart = co_await builder.build(scheduler, chart_file, song, options.sampling_rate);
+				result.build_time = steady_clock::now() - start;
+				result.md5 = chart->md5;
+				result.metadata = chart->metadata;
+			} catch (exception const& e) {
+				result.error = e.what();
+			}
+		}
+	} catch (exception const& e) {
+		results.emplace_back(ChartResult{.song = song_name, .error = e.what()});
+	}
+	fs::remove(zip_path);
+	co_return results;
+}
+
+// Results of finished songs, waiting for the main thread to print them.
+struct Completions {
+	mutex lock;
+	std::condition_variable signal;
+	vector<vector<ChartResult>> songs;
+};
+
+// Analyze a song and hand its results over to the main thread.
+static auto analyze_song_into(Completions& completions, SongInput input, fs::path zip_path,
+	AnalyzeOptions const& options) -> task<>
+{
+	auto const song_name = input.path.generic_string();
+	auto results = vector<ChartResult>{};
+	try {
+		results = co_await analyze_song(move(input), move(zip_path), options);
+	} catch (exception const& e) {
+		results.emplace_back(ChartResult{.song = song_name, .error = e.what()});
+	}
+	{
+		auto lock = lock_guard{completions.lock};
+		completions.songs.emplace_back(move(results));
+	}
+	completions.signal.notify_one();
+}
+
+// Quote a CSV field if it contains any special characters.
+static auto csv_escape(string_view str) -> string
+{
+	if (str.find_first_of(",\"\n\r") == string_view::npos) return string{str};
+	auto result = string{"\""};
+	for (auto c: str) {
+		if (c == '"') result.push_back('"');
+		result.push_back(c);
+	}
+	result.push_back('"');
+	return result;
+}
+
+using FieldValue = variant<string, double, ssize_t, bool>;
+
+// Check the exponent bits directly; with -ffast-math, std::isfinite() is allowed to fold to true.
+static auto is_finite(double value) -> bool
+{
+	static constexpr auto ExponentMask = 0x7ff0'0000'0000'0000ull;
+	return (bit_cast<uint64_t>(value) & ExponentMask) != ExponentMask;
+}
+
+// Format a number as a JSON value. JSON has no infinities or NaNs, so those become null.
+static auto json_number(double value) -> string
+{ return is_finite(value)? format("{}", value) : string{"null"}; }
+
+static auto join_values(span<float const> values) -> string
+{
+	auto result = string{};
+	for (auto value: values) format_to(back_inserter(result), "{},", json_number(value));
+	if (!result.empty()) result.pop_back();
+	return result;
+}
+
+// Statistics of a successfully built chart, in output order. Audio statistics are omitted
+// if audio wasn't rendered.
+static auto chart_fields(ChartResult const& result, bool audio) -> vector<pair<string_view, FieldValue>>
+{
+	auto const& meta = *result.metadata;
+	auto playstyle = string{enum_name(meta.playstyle)};
+	if (playstyle.starts_with('_')) playstyle.erase(0, 1);
+	auto fields = vector<pair<string_view, FieldValue>>{
+		{"song", result.song},
+		{"chart", result.chart},
+		{"md5", lib::openssl::md5_to_hex(*result.md5)},
+		{"title", meta.title},
+		{"subtitle", meta.subtitle},
+		{"artist", meta.artist},
+		{"genre", meta.genre},
+		{"difficulty", string{enum_name(meta.difficulty)}},
+		{"playstyle", move(playstyle)},
+		{"note_count", static_cast<ssize_t>(meta.note_count)},
+		{"chart_duration", to_seconds(meta.chart_duration)},
+		{"has_ln", meta.features.has_ln},
+		{"has_soflan", meta.features.has_soflan},
+		{"nps_average", static_cast<double>(meta.nps.average)},
+		{"nps_peak", static_cast<double>(meta.nps.peak)},
+		{"bpm_initial", static_cast<double>(meta.bpm_range.initial)},
+		{"bpm_min", static_cast<double>(meta.bpm_range.min)},
+		{"bpm_max", static_cast<double>(meta.bpm_range.max)},
+		{"bpm_main", static_cast<double>(meta.bpm_range.main)},
+	};
+	if (audio) {
+		fields.emplace_back("audio_duration", to_seconds(meta.audio_duration));
+		fields.emplace_back("loudness", meta.loudness);
+	}
+	fields.emplace_back("build_seconds", to_seconds(result.build_time));
+	return fields;
+}
+
+static void print_json(ChartResult const& result, AnalyzeOptions const& options)
+{
+	if (!result.metadata) {
+		print(R"({{"song":"{}","chart":"{}","error":"{}"}})" "\n",
+			json_escape(result.song), json_escape(result.chart), json_escape(result.error));
+		return;
+	}
+	auto line = string{"{"};
+	for (auto const& [name, value]: chart_fields(result, options.audio)) {
+		format_to(back_inserter(line), R"("{}":)", name);
+		visit(visitor{
+			[&](string const& v) { format_to(back_inserter(line), R"("{}",)", json_escape(v)); },
+			[&](double v) { format_to(back_inserter(line), "{},", json_number(v)); },
+			[&](ssize_t v) { format_to(back_inserter(line), "{},", v); },
+			[&](bool v) { format_to(back_inserter(line), "{},", v); },
+		}, value);
+	}
+	if (options.density) {
+		auto const& density = result.metadata->density;
+		format_to(back_inserter(line), R"("density_resolution":{},"density_key":[{}],"density_scratch":[{}],"density_ln":[{}],)",
+			to_seconds(density.resolution), join_values(density.key), join_values(density.scratch), join_values(density.ln));
+	}
+	line.back() = '}';
+	print("{}\n", line);
+}
+
+static void print_csv_header(bool audio)
+{
+	auto const columns = audio?
+		"song,chart,md5,title,subtitle,artist,genre,difficulty,playstyle,note_count,chart_duration,has_ln,has_soflan,"
+		"nps_average,nps_peak,bpm_initial,bpm_min,bpm_max,bpm_main,audio_duration,loudness,build_seconds,error" :
+		"song,chart,md5,title,subtitle,artist,genre,difficulty,playstyle,note_count,chart_duration,has_ln,has_soflan,"
+		"nps_average,nps_peak,bpm_initial,bpm_min,bpm_max,bpm_main,build_seconds,error";
+	print("{}\n", columns);
+}
+
+static void print_csv(ChartResult const& result, AnalyzeOptions const& options)
+{
+	if (!result.metadata) {
+		// Every column between the chart and the error is empty
+		auto const empty_columns = options.audio? 20 : 18;
+		print("{},{},{}{}\n", csv_escape(result.song), csv_escape(result.chart),
+			string(empty_columns, ','), csv_escape(result.error));
+		return;
+	}
+	auto line = string{};
+	for (auto const& [name, value]: chart_fields(result, options.audio)) {
+		visit(visitor{
+			[&](string const& v) { line.append(csv_escape(v)); },
+			[&](double v) { if (is_finite(v)) format_to(back_inserter(line), "{}", v); }, // Empty if non-finite
+			[&](ssize_t v) { format_to(back_inserter(line), "{}", v); },
+			[&](bool v) { format_to(back_inserter(line), "{}", v); },
+		}, value);
+		line.push_back(',');
+	}
+	print("{}\n", line); // Empty error column
+}
+
+static auto analyze(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// stdout is reserved for results, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-analyze.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(options->threads);
+	auto songs = vector<SongInput>{};
+	for (auto const& path: options->paths) collect_songs(path, songs);
+	fs::create_directories(options->scratch);
+
+	if (options->format == OutputFormat::Csv) print_csv_header(options->audio);
+	auto failed = false;
+	// Up to jobs songs are in flight at once, so that memory use is bounded. A new song starts
+	// as soon as any one finishes, and results are printed in order of completion.
+	auto completions = Completions{};
+	auto next_song = 0z;
+	auto in_flight = 0z;
+	while (next_song < ssize(songs) || in_flight > 0) {
+		while (next_song < ssize(songs) && in_flight < options->jobs) {
+			auto zip_path = options->scratch / format("song_{}.zip", next_song);
+			launch_task_on(*globals::scheduler, Priority::Load,
+				analyze_song_into(completions, songs[next_song], move(zip_path), *options));
+			next_song += 1;
+			in_flight += 1;
+		}
+		auto finished = vector<vector<ChartResult>>{};
+		{
+			auto lock = std::unique_lock{completions.lock};
+			completions.signal.wait(lock, [&] { return !completions.songs.empty(); });
+			finished = move(completions.songs);
+			completions.songs.clear();
+		}
+		in_flight -= ssize(finished);
+		for (auto const& song_results: finished) {
+			for (auto const& result: song_results) {
+				if (!result.metadata) failed = true;
+				if (options->format == OutputFormat::Json) print_json(result, *options);
+				else print_csv(result, *options);
+			}
+		}
+		std::fflush(stdout);
+	}
+	return failed? EXIT_FAILURE : EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::analyze({argv, static_cast<std::size_t>(argc)}); }
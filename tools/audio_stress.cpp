@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "io/source.hpp"
+#include "io/song.hpp"
+#include "audio/mixer.hpp"
+#include "audio/player.hpp"
+#include "bms/builder.hpp"
+#include "bms/cursor.hpp"
+#include "bms/mapper.hpp"
+#include "corpus.hpp"
+
+namespace playnote {
+
+// Every keysound rings for this long, so a chart's polyphony is its note rate per second.
+static constexpr auto KeysoundLength = 1s;
+
+// Audio rendered before measurements start, for the polyphony to build up.
+static constexpr auto Warmup = KeysoundLength + 1s;
+
+static constexpr auto SamplingRate = 48000;
+
+struct StressOptions {
+	vector<ssize_t> voices = {32, 64, 128, 256, 512, 1024}; // Target polyphony, ramped in order
+	vector<ssize_t> cursors = {1, 2, 4};
+	vector<ssize_t> buffer_sizes = {64, 128, 256, 512, 1024};
+	milliseconds duration = 10s; // Of measured audio per configuration
+	double budget = 0.5; // Fraction of the buffer's real-time deadline that a callback may use
+	ssize_t min_voices = 0; // Fail if any configuration can't sustain this many
+	uint64_t seed = 1;
+	fs::path scratch = fs::temp_directory_path() / "playnote-audio-stress";
+};
+
+// Callback timings of one configuration.
+struct Measurement {
+	double mean_voices;
+	ssize_t peak_voices;
+	nanoseconds p99_callback;
+	nanoseconds max_callback;
+	nanoseconds deadline;
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options]\n"
+		"Render generated charts through the mixer into an offline audio sink, ramping the polyphony\n"
+		"until callbacks stop fitting into the real-time deadline. Results are written to stdout\n"
+		"as one JSON object per measurement, and one per configuration with its polyphony limit.\n\n"
+		"Options:\n"
+		"  --voices <n,...>        Target polyphony levels (default: 32,64,128,256,512,1024)\n"
+		"  --cursors <n,...>       Simultaneous cursor counts (default: 1,2,4)\n"
+		"  --buffer-sizes <n,...>  Buffer sizes in samples (default: 64,128,256,512,1024)\n"
+		"  --duration <ms>         Measured audio per configuration (default: 10000)\n"
+		"  --budget <0-1>          Share of the deadline a callback may use at the 99th percentile\n"
+		"                          (default: 0.5)\n"
+		"  --min-voices <n>        Exit with failure if any configuration sustains fewer voices\n"
+		"  --seed <n>              Seed of the generated charts (default: 1)\n"
+		"  --scratch <dir>         Directory for the generated songs (default: {})\n",
+		name, fs::temp_directory_path() / "playnote-audio-stress");
+}
+
+static auto parse_list(string_view value) -> vector<ssize_t>
+{
+	auto result = vector<ssize_t>{};
+	for (auto item: value | views::split(',') | views::to_sv)
+		result.emplace_back(lexical_cast<ssize_t>(item));
+	return result;
+}
+
+static auto parse_args(span<char const* const> args) -> optional<StressOptions>
+{
+	auto options = StressOptions{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--voices") options.voices = parse_list(value);
+		else if (arg == "--cursors") options.cursors = parse_list(value);
+		else if (arg == "--buffer-sizes") options.buffer_sizes = parse_list(value);
+		else if (arg == "--duration") options.duration = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--budget") options.budget = lexical_cast<double>(value);
+		else if (arg == "--min-voices") options.min_voices = lexical_cast<ssize_t>(value);
+		else if (arg == "--seed") options.seed = lexical_cast<uint64_t>(value);
+		else if (arg == "--scratch") options.scratch = value;
+		else return nullopt;
+	}
+	auto const positive = [](auto const& list) { return !list.empty() && all_of(list, [](auto v) { return v > 0; }); };
+	if (!positive(options.voices) || !positive(options.cursors) || !positive(options.buffer_sizes)) return nullopt;
+	if (options.duration <= 0ms || options.budget <= 0.0 || options.budget > 1.0) return nullopt;
+	sort(options.voices);
+	return options;
+}
+
+// Generated songs and their charts, shared by all configurations that need them.
+class ChartCache {
+public:
+	ChartCache(fs::path scratch, uint64_t seed, milliseconds duration):
+		scratch{move(scratch)}, seed{seed}, duration{duration} {}
+	~ChartCache() { songs.clear(); fs::remove_all(scratch); }
+
+	// Retrieve a chart with the given polyphony. Charts with different indices have different
+	// notes and MD5s, so that their sounds don't cut each other off when played together.
+	auto get(ssize_t voices, ssize_t index) -> shared_ptr<bms::Chart const>;
+
+private:
+	struct Entry {
+		io::Song song;
+		shared_ptr<bms::Chart const> chart;
+	};
+
+	fs::path scratch;
+	uint64_t seed;
+	milliseconds duration;
+	unordered_map<pair<ssize_t, ssize_t>, unique_ptr<Entry>> songs;
+};
+
+auto ChartCache::get(ssize_t voices, ssize_t index) -> shared_ptr<bms::Chart const>
+{
+	auto const key = pair{voices, index};
+	if (auto it = songs.find(key); it != songs.end()) return it->second->chart;
+
+	// At 150 BPM a measure lasts 1.6s. Each note rings for KeysoundLength, so the note rate
+	// is the polyphony; keysound slots are plentiful, so that few notes retrigger a ringing one.
+	constexpr auto MeasureLength = 1600ms;
+	constexpr auto Resolution = 192z;
+	auto const measures = clamp(static_cast<ssize_t>((duration + Warmup) / MeasureLength) + 1, 1z, 999z);
+	auto chart = corpus::ChartParams{
+		.measures = measures,
+		.resolution = Resolution,
+		.keysounds = clamp(voices * 2, 16z, corpus::MaxSlot),
+	};
+	chart.notes = min(static_cast<ssize_t>(voices * measures * MeasureLength / KeysoundLength), corpus::max_notes(chart));
+	auto const params = corpus::SongParams{.chart = chart, .keysound_length = KeysoundLength};
+
+	auto const name = format("song_{}_{}", voices, index);
+	auto const song_seed = corpus::mix_seed(corpus::mix_seed(seed, voices), index);
+	auto const dir = corpus::write_song(params, song_seed, scratch, name, corpus::Packaging::Dir);
+	auto& scheduler = *globals::scheduler;
+	auto cat = globals::logger->global;
+	auto entry = make_unique<Entry>(sync_wait(io::Song::from_source(cat, scheduler, io::Source{dir},
+		scratch / format("{}.zip", name))));
+	sync_wait(entry->song.preload_audio_files(scheduler, SamplingRate));
+	auto chart_file = vector<byte>{};
+	for (auto [path, data]: entry->song.for_each_chart())
+		chart_file.assign(data.begin(), data.end());
+	entry->chart = sync_wait(bms::Builder{cat}.build(scheduler, chart_file, entry->song, SamplingRate));
+	return songs.emplace(key, move(entry)).first->second->chart;
+}
+
+// Play the charts on autoplay through the offline sink, timing every buffer after the warmup.
+static auto measure(span<shared_ptr<bms::Chart const> const> charts, ssize_t buffer_size,
+	milliseconds duration) -> Measurement
+{
+	auto mixer_stub = globals::mixer.provide(globals::logger->global,
+		dev::Audio::OfflineSink{.sampling_rate = SamplingRate, .buffer_size = static_cast<int>(buffer_size)});
+	auto& audio = globals::mixer->get_audio();
+	auto player = audio::Player{};
+	for (auto const& chart: charts)
+		player.add_cursor(make_shared<bms::Cursor>(chart, true), bms::Mapper{});
+
+	auto buffer = vector<dev::Sample>(buffer_size);
+	auto const warmup_buffers = audio.ns_to_samples(Warmup) / buffer_size;
+	for (auto _: views::iota(0z, warmup_buffers)) audio.render(buffer);
+
+	auto const buffer_count = max(audio.ns_to_samples(duration) / buffer_size, 1z);
+	auto callbacks = vector<nanoseconds>{};
+	callbacks.reserve(buffer_count);
+	auto total_voices = 0z;
+	auto peak_voices = 0z;
+	for (auto _: views::iota(0z, buffer_count)) {
+		auto const start = steady_clock::now();
+		audio.render(buffer);
+		callbacks.emplace_back(steady_clock::now() - start);
+		auto const voices = player.get_active_sound_count();
+		total_voices += voices;
+		peak_voices = max(peak_voices, voices);
+	}
+
+	sort(callbacks);
+	return Measurement{
+		.mean_voices = static_cast<double>(total_voices) / buffer_count,
+		.peak_voices = peak_voices,
+		.p99_callback = callbacks[(ssize(callbacks) - 1) * 99 / 100],
+		.max_callback = callbacks.back(),
+		.deadline = audio.samples_to_ns(buffer_size),
+	};
+}
+
+static auto to_us(nanoseconds ns) -> double { return duration_cast<duration<double, std::micro>>(ns).count(); }
+
+static auto audio_stress(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Input mappers read their bindings from the config
+	auto config_stub = globals::config.provide();
+	globals::config->load_from_file();
+	// stdout is reserved for results, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-audio-stress.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(max(1u, jthread::hardware_concurrency()));
+	fs::remove_all(options->scratch);
+	fs::create_directories(options->scratch);
+	auto charts = ChartCache{options->scratch, options->seed, options->duration};
+
+	auto passed = true;
+	for (auto buffer_size: options->buffer_sizes) {
+		for (auto cursor_count: options->cursors) {
+			// Ramp the polyphony until a callback misses its budget
+			auto limit = 0.0;
+			auto saturated = true;
+			for (auto voices: options->voices) {
+				auto const per_cursor = (voices + cursor_count - 1) / cursor_count;
+				auto cursor_charts = vector<shared_ptr<bms::Chart const>>{};
+				for (auto idx: views::iota(0z, cursor_count))
+					cursor_charts.emplace_back(charts.get(per_cursor, idx));
+				auto const result = measure(cursor_charts, buffer_size, options->duration);
+				auto const load = to_us(result.p99_callback) / to_us(result.deadline);
+				auto const sustained = load <= options->budget;
+				print(R"({{"event":"measurement","buffer_size":{},"cursors":{},"target_voices":{},)"
+					R"("mean_voices":{:.1f},"peak_voices":{},"deadline_us":{:.1f},"p99_callback_us":{:.1f},)"
+					R"("max_callback_us":{:.1f},"load":{:.3f},"sustained":{}}})" "\n",
+					buffer_size, cursor_count, voices, result.mean_voices, result.peak_voices,
+					to_us(result.deadline), to_us(result.p99_callback), to_us(result.max_callback), load, sustained);
+				std::fflush(stdout);
+				if (!sustained) {
+					saturated = false;
+					break;
+				}
+				limit = result.mean_voices;
+			}
+			// A saturated limit means that even the highest target was sustained
+			print(R"({{"event":"limit","buffer_size":{},"cursors":{},"max_voices":{:.0f},"saturated":{}}})" "\n",
+				buffer_size, cursor_count, limit, saturated);
+			std::fflush(stdout);
+			if (limit < options->min_voices) passed = false;
+		}
+	}
+	return passed? EXIT_SUCCESS : EXIT_FAILURE;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::audio_stress({argv, static_cast<std::size_t>(argc)}); }
@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/alloc_audit.hpp"
+
+#ifdef ENABLE_ALLOC_AUDIT
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "dev/audio.hpp"
+#include "audio/mixer.hpp"
+#include "audio/player.hpp"
+#include "bms/cursor.hpp"
+#include "bms/mapper.hpp"
+#include "bms/score.hpp"
+#include "bench/fixtures.hpp"
+
+// Replays of gameplay frames, which fail if any frame past the warmup period allocates. The GPU
+// side of rendering and imgui aren't covered, since the benchmarks run without a window.
+// Only built with the PLAYNOTE_ALLOC_AUDIT CMake option. The argument is the chart's note count.
+
+namespace playnote::bench {
+
+// A full autoplayed playthrough, one 60Hz display frame at a time. Every frame advances the
+// cursor by a frame's worth of samples like the audio thread, and then collects judgments
+// and visible notes like the render thread. Items are frames.
+static void replay_frames_without_allocating(benchmark::State& state)
+{
+	static constexpr auto FrameSamples = SamplingRate / 60;
+	auto& fixture = chart_fixture(state.range(0));
+	auto frames = 0z;
+	for (auto _: state) {
+		auto cursor = bms::Cursor{fixture.chart, true};
+		auto frame_idx = 0z;
+		auto playing = true;
+		while (playing) {
+			auto const allocations_before = alloc_audit::thread_allocation_count();
+			auto sounds = 0z;
+			for (auto _: views::iota(0z, FrameSamples)) {
+				playing = cursor.advance_one_sample([&](auto) { sounds += 1; });
+				if (!playing) break;
+			}
+			auto judgments = 0z;
+			cursor.pending_judgment_events([&](auto) { judgments += 1; });
+			auto visible = 0z;
+			cursor.upcoming_notes([&](auto const&) { visible += 1; }, 1.0f);
+			benchmark::DoNotOptimize(sounds + judgments + visible);
+
+			auto const allocations = alloc_audit::thread_allocation_count() - allocations_before;
+			if (allocations > 0 && frame_idx >= alloc_audit::WarmupFrames) {
+				state.SkipWithError(format("Frame {} made {} heap allocations in steady state", frame_idx, allocations));
+				return;
+			}
+			frame_idx += 1;
+		}
+		frames += frame_idx;
+	}
+	state.SetItemsProcessed(frames);
+}
+BENCHMARK(replay_frames_without_allocating)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// A full autoplayed playthrough driven by the player, one 60Hz display frame at a time. Every
+// frame mixes one buffer through an offline sink, like the audio thread, and then does the CPU
+// side of the gameplay screen: fetching the audible cursor, scoring judgments and collecting
+// visible notes. Mixing runs on this thread, so both halves are counted. Items are frames.
+static void replay_player_without_allocating(benchmark::State& state)
+{
+	static constexpr auto FrameSamples = SamplingRate / 60;
+	auto& fixture = chart_fixture(state.range(0));
+	auto mixer_stub = globals::mixer.provide(globals::logger->global,
+		dev::Audio::OfflineSink{.sampling_rate = SamplingRate, .buffer_size = FrameSamples});
+	auto& audio = globals::mixer->get_audio();
+	auto player = audio::Player{};
+	auto buffer = vector<dev::Sample>(FrameSamples);
+	auto const chart_duration = fixture.chart->metadata.chart_duration;
+	auto frames = 0z;
+	for (auto _: state) {
+		// Starting a playthrough allocates, like restarting gameplay does
+		auto cursor = make_shared<bms::Cursor>(fixture.chart, true);
+		auto score = bms::Score{*fixture.chart};
+		player.add_cursor(cursor, bms::Mapper{});
+		auto frame_idx = 0z;
+		while (cursor->get_progress_ns() < chart_duration) {
+			auto const allocations_before = alloc_audit::thread_allocation_count();
+			audio.render(buffer);
+			auto const audible = player.get_audio_cursor(cursor);
+			cursor->pending_judgment_events([&](auto&& ev) { score.submit_judgment_event(ev); });
+			auto visible = 0z;
+			audible.upcoming_notes([&](auto const&) { visible += 1; }, 1.0f);
+			benchmark::DoNotOptimize(visible + score.get_score());
+
+			auto const allocations = alloc_audit::thread_allocation_count() - allocations_before;
+			if (allocations > 0 && frame_idx >= alloc_audit::WarmupFrames) {
+				state.SkipWithError(format("Frame {} made {} heap allocations in steady state", frame_idx, allocations));
+				player.remove_cursor(cursor);
+				return;
+			}
+			frame_idx += 1;
+		}
+		player.remove_cursor(cursor);
+		frames += frame_idx;
+	}
+	state.SetItemsProcessed(frames);
+}
+BENCHMARK(replay_player_without_allocating)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+}
+
+#endif
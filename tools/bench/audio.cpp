@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "lib/ffmpeg.hpp"
+#include "bench/fixtures.hpp"
+#include "corpus.hpp"
+
+// Benchmarks of audio file decoding, as done for every keysound of a loaded chart. The argument
+// is the file's duration in milliseconds.
+
+namespace playnote::bench {
+
+// The source rate differs from the playback rate, so that resampling isn't a no-op.
+static constexpr auto SourceRate = 44100;
+
+static void decode_wav(benchmark::State& state)
+{
+	auto const file = corpus::synthesize_tone(1, milliseconds{state.range(0)}, SourceRate);
+	for (auto _: state) {
+		auto samples = lib::ffmpeg::decode_and_resample_file_buffer(file, SamplingRate);
+		benchmark::DoNotOptimize(samples.data());
+	}
+	state.SetBytesProcessed(state.iterations() * ssize(file));
+}
+BENCHMARK(decode_wav)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+static void decode_ogg(benchmark::State& state)
+{
+	auto const wav = corpus::synthesize_tone(1, milliseconds{state.range(0)}, SourceRate);
+	auto const file = lib::ffmpeg::encode_as_ogg(lib::ffmpeg::decode_and_resample_file_buffer(wav, SourceRate), SourceRate);
+	for (auto _: state) {
+		auto samples = lib::ffmpeg::decode_and_resample_file_buffer(file, SamplingRate);
+		benchmark::DoNotOptimize(samples.data());
+	}
+	state.SetBytesProcessed(state.iterations() * ssize(file));
+}
+BENCHMARK(decode_ogg)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bench/baseline.hpp"
+
+#include <cmath>
+#include <nlohmann/json.hpp>
+#include "preamble.hpp"
+#include "io/file.hpp"
+#include "common.hpp"
+
+namespace playnote::bench {
+
+static auto unit_to_ns(string_view unit) -> double
+{
+	if (unit == "ns") return 1.0;
+	if (unit == "us") return 1e3;
+	if (unit == "ms") return 1e6;
+	if (unit == "s") return 1e9;
+	throw runtime_error_fmt("Unknown time unit \"{}\"", unit);
+}
+
+// Normal approximation of the two-sided Mann-Whitney U test, with tie and continuity correction.
+// Good enough from about 8 samples on each side.
+static auto mann_whitney_u(span<double const> a, span<double const> b) -> double
+{
+	auto combined = vector<pair<double, bool>>{}; // Value, whether it's from a
+	combined.reserve(a.size() + b.size());
+	for (auto value: a) combined.emplace_back(value, true);
+	for (auto value: b) combined.emplace_back(value, false);
+	sort(combined);
+
+	// Ties get the average of the ranks they span
+	auto const n = static_cast<double>(combined.size());
+	auto rank_sum_a = 0.0;
+	auto tie_term = 0.0;
+	for (auto begin = 0uz; begin < combined.size();) {
+		auto end = begin + 1;
+		while (end < combined.size() && combined[end].first == combined[begin].first) end += 1;
+		auto const rank = (static_cast<double>(begin + 1) + static_cast<double>(end)) / 2.0;
+		for (auto i = begin; i < end; i += 1)
+			if (combined[i].second) rank_sum_a += rank;
+		auto const ties = static_cast<double>(end - begin);
+		tie_term += ties * ties * ties - ties;
+		begin = end;
+	}
+
+	auto const n_a = static_cast<double>(a.size());
+	auto const n_b = static_cast<double>(b.size());
+	auto const u = rank_sum_a - n_a * (n_a + 1.0) / 2.0;
+	auto const mean = n_a * n_b / 2.0;
+	auto const variance = n_a * n_b / 12.0 * ((n + 1.0) - tie_term / (n * (n - 1.0)));
+	if (variance <= 0.0) return 1.0; // All values identical
+	auto const z = max(abs(u - mean) - 0.5, 0.0) / sqrt(variance);
+	return std::erfc(z / std::numbers::sqrt2);
+}
+
+auto load_baseline(fs::path const& path) -> Samples
+try {
+	auto const file = io::read_file(path);
+	auto const* begin = reinterpret_cast<char const*>(file.contents.data());
+	auto const json = nlohmann::json::parse(begin, begin + file.contents.size());
+
+	auto samples = Samples{};
+	for (auto const& entry: json.at("benchmarks")) {
+		if (entry.value("run_type", "iteration") != "iteration") continue; // Skip aggregates
+		if (entry.value("error_occurred", false)) continue;
+		auto const unit = entry.at("time_unit").get<string>();
+		auto const time = entry.at("real_time").get<double>() * unit_to_ns(unit);
+		samples[entry.at("name").get<string>()].emplace_back(time);
+	}
+	return samples;
+}
+catch (nlohmann::json::exception const& e) {
+	throw runtime_error_fmt("Failed to parse baseline {}: {}", path, e.what());
+}
+
+auto compare(Samples const& baseline, Samples const& current) -> vector<Comparison>
+{
+	auto results = vector<Comparison>{};
+	for (auto const& [name, current_times]: current) {
+		auto const it = baseline.find(name);
+		if (it == baseline.end()) continue;
+		auto const& baseline_times = it->second;
+		if (baseline_times.size() < 2 || current_times.size() < 2) continue;
+		results.emplace_back(Comparison{
+			.name = name,
+			.baseline_median = median(baseline_times),
+			.current_median = median(current_times),
+			.p_value = mann_whitney_u(baseline_times, current_times),
+		});
+	}
+	sort(results, {}, &Comparison::name);
+	return results;
+}
+
+}
@@ -0,0 +1,34 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+namespace playnote::bench {
+
+// Wall time of every repetition of each benchmark, in nanoseconds per iteration.
+using Samples = unordered_map<string, vector<double>, string_hash>;
+
+// Result of comparing one benchmark against its baseline.
+struct Comparison {
+	string name;
+	double baseline_median; // ns
+	double current_median; // ns
+	double p_value; // Two-sided Mann-Whitney U test; low values mean the difference is real
+};
+
+// Load the repetitions of a previous run from Google Benchmark's JSON output.
+// Throws runtime_error if the file can't be read or parsed.
+[[nodiscard]] auto load_baseline(fs::path const&) -> Samples;
+
+// Compare every benchmark that is present in both sets and has at least two repetitions
+// on each side. The results are sorted by name.
+[[nodiscard]] auto compare(Samples const& baseline, Samples const& current) -> vector<Comparison>;
+
+}
@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/memory.hpp"
+#include "lib/ffmpeg.hpp"
+#include "bms/chart.hpp"
+#include "bms/bga.hpp"
+#include "corpus.hpp"
+
+// Benchmarks of BGA decoding and playback.
+
+namespace playnote::bench {
+
+// Still image decoding, as done for every BGA image of a loaded chart. The argument is the image's
+// width and height.
+static void decode_image(benchmark::State& state)
+{
+	auto const size = static_cast<int>(state.range(0));
+	auto const file = corpus::synthesize_image(1, {size, size});
+	for (auto _: state) {
+		auto picture = lib::ffmpeg::decode_image(file);
+		benchmark::DoNotOptimize(picture.pixels.data());
+	}
+	state.SetBytesProcessed(state.iterations() * ssize(file));
+}
+BENCHMARK(decode_image)->Arg(256)->Arg(512)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+// Playback of a 640x480 video on the base layer, updated once per 60Hz display frame. The argument
+// is the playback speed; at higher speeds, the decoder has less time to stay ahead. Late frames
+// are the ones the decoder didn't deliver by the time they were due.
+static void bga_playback(benchmark::State& state)
+{
+	static constexpr auto VideoLength = 10s;
+	static constexpr auto VideoFPS = 30;
+	static constexpr auto DisplayInterval = duration_cast<nanoseconds>(1s) / 60;
+	auto const speed = state.range(0);
+
+	auto video = make_tracked_vector<byte>(MemoryTag::ChartMedia);
+	auto const video_file = corpus::synthesize_video({640, 480}, VideoLength / 1s * VideoFPS, VideoFPS);
+	video.assign(video_file.begin(), video_file.end());
+	auto chart = make_shared<bms::Chart>();
+	chart->media.bmp_slots.emplace_back(make_shared<bms::Media::BMPData const>(move(video)));
+	chart->timeline.bga[+bms::BGAEvent::Layer::Base].emplace_back(bms::BGAEvent{
+		.timestamp = 0ns,
+		.bmp_slot = 0,
+	});
+
+	auto stats = bms::BGAPlayer::Stats{};
+	for (auto _: state) {
+		auto player = bms::BGAPlayer{chart};
+		for (auto progress = 0ns; progress < VideoLength; progress += DisplayInterval) {
+			player.update(progress);
+			benchmark::DoNotOptimize(player.get_image().data());
+			sleep_for(DisplayInterval / speed);
+		}
+		auto const run = player.get_stats();
+		stats.frames_decoded += run.frames_decoded;
+		stats.frames_late += run.frames_late;
+		stats.composites += run.composites;
+		stats.decode_time += run.decode_time;
+	}
+	state.counters["frames_decoded"] = benchmark::Counter(stats.frames_decoded, benchmark::Counter::kAvgIterations);
+	state.counters["frames_late"] = benchmark::Counter(stats.frames_late, benchmark::Counter::kAvgIterations);
+	state.counters["composites"] = benchmark::Counter(stats.composites, benchmark::Counter::kAvgIterations);
+	state.counters["decode_fps"] = stats.decode_time > 0ns?
+		static_cast<double>(stats.frames_decoded) / duration_cast<duration<double>>(stats.decode_time).count() : 0.0;
+}
+BENCHMARK(bga_playback)->Arg(1)->Arg(4)->Arg(16)->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(1);
+
+}
@@ -0,0 +1,85 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <semaphore>
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/broadcaster.hpp"
+
+// Benchmarks of cross-thread message delivery. The arguments are the number of receiving threads
+// and the number of sending threads.
+
+namespace playnote::bench {
+
+// Roughly the size of an input event.
+struct BenchMessage {
+	ssize_t sequence;
+	array<float, 6> payload;
+};
+
+// Messages shouted per iteration by each sender. Channels are large enough to hold a whole batch
+// from every sender, so nothing should be dropped unless a receiver stalls.
+static constexpr auto BatchSize = 1000z;
+
+// Sender threads shout batches of messages at the same time, while the receivers drain their
+// channels as fast as they can. Broadcaster endpoints are tied to threads, so all endpoints are
+// threads of our own rather than benchmark threads.
+static void broadcaster_throughput(benchmark::State& state)
+{
+	auto const receiver_count = state.range(0);
+	auto const sender_count = state.range(1);
+	auto broadcaster = Broadcaster{};
+	auto subscribed = latch{receiver_count + sender_count};
+	auto batch_start = std::counting_semaphore{0};
+	auto batch_done = std::counting_semaphore{0};
+	auto running = atomic<bool>{true};
+	auto received = atomic<ssize_t>{0};
+
+	auto threads = vector<jthread>{};
+	for (auto _: views::iota(0z, receiver_count)) {
+		threads.emplace_back([&] {
+			broadcaster.register_as_endpoint();
+			broadcaster.subscribe<BenchMessage>(BatchSize * sender_count);
+			subscribed.count_down();
+			while (running.load()) {
+				broadcaster.receive_all<BenchMessage>([&](BenchMessage&&) { received.fetch_add(1, memory_order_relaxed); });
+				yield();
+			}
+		});
+	}
+	for (auto _: views::iota(0z, sender_count)) {
+		threads.emplace_back([&] {
+			broadcaster.register_as_endpoint();
+			subscribed.arrive_and_wait();
+			while (true) {
+				batch_start.acquire();
+				if (!running.load()) return;
+				for (auto idx: views::iota(0z, BatchSize))
+					broadcaster.make_shout<BenchMessage>(BenchMessage{.sequence = idx});
+				batch_done.release();
+			}
+		});
+	}
+
+	for (auto _: state) {
+		batch_start.release(sender_count);
+		for (auto _: views::iota(0z, sender_count)) batch_done.acquire();
+	}
+	running = false;
+	batch_start.release(sender_count);
+	threads.clear();
+
+	state.SetItemsProcessed(state.iterations() * BatchSize * sender_count * receiver_count);
+	state.counters["received"] = static_cast<double>(received.load());
+	state.counters["dropped"] = static_cast<double>(broadcaster.get_total_dropped_count());
+}
+BENCHMARK(broadcaster_throughput)->ArgsProduct({{1, 2, 4}, {1, 2, 4}})->ArgNames({"receivers", "senders"})
+	->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}
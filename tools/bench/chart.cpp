@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "bms/builder.hpp"
+#include "bms/cursor.hpp"
+#include "bms/score.hpp"
+#include "bms/ghost.hpp"
+#include "bms/density.hpp"
+#include "bench/fixtures.hpp"
+
+// Benchmarks of chart construction and gameplay logic. The argument is the chart's note count.
+
+namespace playnote::bench {
+
+// Parsing and chart generation, with keysounds served from the song's cache.
+static void build_chart(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto builder = bms::Builder{globals::logger->global};
+	for (auto _: state) {
+		auto chart = sync_wait(builder.build(*globals::scheduler, fixture.chart_file, fixture.song, SamplingRate));
+		benchmark::DoNotOptimize(chart);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(build_chart)->Arg(1000)->Arg(10000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// As above, but skipping the metadata calculation like a load of an imported chart.
+static void build_chart_cached(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto builder = bms::Builder{globals::logger->global};
+	auto cache = fixture.chart->metadata;
+	for (auto _: state) {
+		auto chart = sync_wait(builder.build(*globals::scheduler, fixture.chart_file, fixture.song, SamplingRate, cache));
+		benchmark::DoNotOptimize(chart);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(build_chart_cached)->Arg(1000)->Arg(10000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Rebuild after an edit to a single measure, as done by the watch mode on every save. The edit
+// repeats the file's last channel line, so only that measure is parsed again; every iteration
+// alternates between the original file and the edited one.
+static void rebuild_chart(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto edited = fixture.chart_file;
+	auto const text = string_view{reinterpret_cast<char const*>(edited.data()), edited.size()};
+	auto const is_channel = [&](std::size_t pos) { return pos + 3 < text.size() && text[pos + 3] >= '0' && text[pos + 3] <= '9'; };
+	auto line_start = text.rfind("\n#");
+	while (line_start != string_view::npos && line_start > 0 && !is_channel(line_start))
+		line_start = text.rfind("\n#", line_start - 1);
+	if (line_start == string_view::npos || !is_channel(line_start)) {
+		state.SkipWithError("Chart has no channel lines");
+		return;
+	}
+	auto const line = string{text.substr(line_start, text.find('\n', line_start + 1) - line_start)};
+	transform(line, back_inserter(edited), [](char c) { return static_cast<byte>(c); });
+	edited.emplace_back(byte{'\n'});
+
+	auto builder = bms::Builder{globals::logger->global};
+	sync_wait(builder.rebuild(*globals::scheduler, fixture.chart_file, fixture.song, SamplingRate));
+	auto parsed = 0z;
+	auto use_edited = true;
+	for (auto _: state) {
+		auto chart = sync_wait(builder.rebuild(*globals::scheduler,
+			use_edited? span<byte const>{edited} : span<byte const>{fixture.chart_file}, fixture.song, SamplingRate));
+		benchmark::DoNotOptimize(chart);
+		parsed += builder.get_rebuild_stats().measures_parsed;
+		use_edited = !use_edited;
+	}
+	state.counters["measures_parsed"] = benchmark::Counter(parsed, benchmark::Counter::kAvgIterations);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(rebuild_chart)->Arg(1000)->Arg(10000)->Arg(50000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Playthrough of the entire chart, one sample at a time. Items are samples.
+static void advance_cursor(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto const autoplay = state.range(1) != 0;
+	auto samples = 0z;
+	for (auto _: state) {
+		auto cursor = bms::Cursor{fixture.chart, autoplay};
+		auto sounds = 0z;
+		while (cursor.advance_one_sample([&](auto) { sounds += 1; })) {}
+		cursor.pending_judgment_events([](auto) {});
+		samples += cursor.get_progress();
+		benchmark::DoNotOptimize(sounds);
+	}
+	state.SetItemsProcessed(samples);
+}
+BENCHMARK(advance_cursor)->ArgsProduct({{1000, 10000, 50000}, {0, 1}})->ArgNames({"notes", "autoplay"})
+	->Unit(benchmark::kMillisecond);
+
+// Jumps all over the chart, forwards and backwards.
+static void seek_cursor(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto cursor = bms::Cursor{fixture.chart, true};
+	auto const length = lib::ns_to_samples(fixture.chart->metadata.chart_duration, SamplingRate);
+	auto const stride = static_cast<ssize_t>(static_cast<double>(length) * 0.618); // Never repeats
+	auto position = 0z;
+	for (auto _: state) {
+		position = (position + stride) % length;
+		cursor.seek(position);
+		cursor.pending_judgment_events([](auto) {});
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(seek_cursor)->Arg(1000)->Arg(10000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+
+// Ghost replays of a full playthrough, updated once per 60Hz display frame. The second argument
+// is the number of ghosts; the recorded play hits every note with timings spread over every
+// judgment window, and skips some. Items are ghost updates.
+static void replay_ghosts(benchmark::State& state)
+{
+	static constexpr auto DisplayInterval = duration_cast<nanoseconds>(1s) / 60;
+	auto& fixture = chart_fixture(state.range(0));
+	auto const ghost_count = state.range(1);
+	auto const& chart = *fixture.chart;
+
+	auto recording = make_shared<bms::Cursor::Recording>();
+	auto note_idx = 0z;
+	for (auto [idx, lane]: chart.timeline.lanes | views::enumerate) {
+		if (!lane.playable) continue;
+		for (auto const& note: lane.notes) {
+			auto const spread = note_idx++ % 25z - 12z; // -12..12
+			if (spread == 12) continue; // Missed
+			auto const press = note.timestamp + bms::Cursor::HitWindow * spread / 12;
+			auto const release = note.type_is<bms::Note::LN>()? note.timestamp + note.params<bms::Note::LN>().length : press + 1ms;
+			auto const lane_type = static_cast<bms::Lane::Type>(idx);
+			recording->emplace_back(bms::Cursor::RecordedInput{lib::ns_to_samples(press, SamplingRate), {lane_type, true}});
+			recording->emplace_back(bms::Cursor::RecordedInput{lib::ns_to_samples(release, SamplingRate), {lane_type, false}});
+		}
+	}
+	stable_sort(*recording, [](auto const& a, auto const& b) { return a.sample < b.sample; });
+
+	auto updates = 0z;
+	for (auto _: state) {
+		auto ghosts = vector<unique_ptr<bms::Ghost>>{};
+		for (auto _: views::iota(0z, ghost_count))
+			ghosts.emplace_back(make_unique<bms::Ghost>(fixture.chart, recording));
+		for (auto progress = 0ns; progress < chart.metadata.chart_duration + bms::Cursor::HitWindow; progress += DisplayInterval) {
+			for (auto& ghost: ghosts) ghost->update(progress);
+			updates += ghost_count;
+		}
+		benchmark::DoNotOptimize(ghosts.back()->get_score().get_score());
+	}
+	state.SetItemsProcessed(updates);
+}
+BENCHMARK(replay_ghosts)->ArgsProduct({{1000, 10000, 50000}, {1, 16, 64}})->ArgNames({"notes", "ghosts"})
+	->Unit(benchmark::kMillisecond);
+
+// Scoring of a full playthrough. The timings are spread over every judgment window, with some
+// misses mixed in.
+static void score_chart(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto events = vector<bms::Cursor::JudgmentEvent>{};
+	auto cursor = bms::Cursor{fixture.chart, true};
+	while (cursor.advance_one_sample([](auto) {})) {}
+	cursor.pending_judgment_events([&](auto event) {
+		auto const spread = static_cast<ssize_t>(events.size()) % 25z - 12z; // -12..12
+		if (event.timing) {
+			event.timing = spread == 12? nullopt : optional{bms::Cursor::HitWindow * spread / 12};
+			if (event.release_timing) event.release_timing = bms::Score::LNEarlyRelease * -spread / 12;
+		}
+		events.emplace_back(event);
+	});
+
+	for (auto _: state) {
+		auto score = bms::Score{*fixture.chart};
+		for (auto const& event: events) score.submit_judgment_event(event);
+		benchmark::DoNotOptimize(score.get_score());
+	}
+	state.SetItemsProcessed(state.iterations() * ssize(events));
+}
+BENCHMARK(score_chart)->Arg(1000)->Arg(10000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+
+// Decoding of a chart's stored density, as done for every chart shown in a chart list. The second
+// argument is the encoding; 0 is the downsampled thumbnail.
+static void decode_chart_density(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto const thumbnail = state.range(1) == 0;
+	auto const& full = fixture.chart->metadata.density;
+	auto const density = thumbnail? bms::downsample_density(full, bms::DensityThumbnailPoints) : full;
+	auto const encoding = thumbnail? bms::DensityEncoding::Q8 : static_cast<bms::DensityEncoding>(state.range(1));
+	auto const encoded = bms::encode_density(density.key, encoding);
+	for (auto _: state) {
+		auto decoded = bms::decode_density(encoded);
+		benchmark::DoNotOptimize(decoded);
+	}
+	state.SetItemsProcessed(state.iterations() * ssize(density.key));
+	state.counters["bytes"] = static_cast<double>(encoded.size());
+}
+BENCHMARK(decode_chart_density)->ArgsProduct({{1000}, {0, +bms::DensityEncoding::Q8, +bms::DensityEncoding::Q16,
+	+bms::DensityEncoding::Q16Delta}})->ArgNames({"notes", "encoding"})->Unit(benchmark::kMicrosecond);
+
+}
@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/config.hpp"
+
+// Benchmarks of config reads, as done every frame by the playfield and on every input by the mapper.
+
+namespace playnote::bench {
+
+static constexpr auto JudgmentTimeout = Config::Key<int>{"gameplay", "judgment_timeout"};
+
+// A lookup by category and name strings, as done before handles existed.
+static void config_read_by_name(benchmark::State& state)
+{
+	auto const& cfg = *globals::config;
+	for (auto _: state) {
+		auto value = cfg.get_entry<int>("gameplay", "judgment_timeout");
+		benchmark::DoNotOptimize(value);
+	}
+}
+BENCHMARK(config_read_by_name);
+
+static void config_read_by_key(benchmark::State& state)
+{
+	auto const& cfg = *globals::config;
+	for (auto _: state) {
+		auto value = cfg.get_entry(JudgmentTimeout);
+		benchmark::DoNotOptimize(value);
+	}
+}
+BENCHMARK(config_read_by_key);
+
+static void config_read_by_handle(benchmark::State& state)
+{
+	auto const handle = globals::config->get_handle(JudgmentTimeout);
+	for (auto _: state) {
+		auto value = handle.get();
+		benchmark::DoNotOptimize(value);
+	}
+}
+BENCHMARK(config_read_by_handle);
+
+// Handle reads while another thread keeps changing the entry.
+static void config_read_by_handle_contended(benchmark::State& state)
+{
+	auto const handle = globals::config->get_handle(JudgmentTimeout);
+	auto const original = handle.get();
+	if (state.thread_index() == 0) {
+		// Alternate between two values, so that every write is a real change
+		auto const values = to_array({original + 1, original});
+		auto flip = 0z;
+		for (auto _: state) {
+			globals::config->set_entry(Config::Entry{.category = "gameplay", .name = "judgment_timeout", .value = values[flip]});
+			flip ^= 1;
+			auto value = handle.get();
+			benchmark::DoNotOptimize(value);
+		}
+		// Restore the original, so that the saved config stays the same
+		globals::config->set_entry(Config::Entry{.category = "gameplay", .name = "judgment_timeout", .value = original});
+	} else {
+		for (auto _: state) {
+			auto value = handle.get();
+			benchmark::DoNotOptimize(value);
+		}
+	}
+}
+BENCHMARK(config_read_by_handle_contended)->Threads(2)->Threads(4);
+
+// Whether an observer gets called on every change of its entry.
+static void config_observe(benchmark::State& state)
+{
+	auto const original = globals::config->get_entry(JudgmentTimeout);
+	auto notified = 0z;
+	auto const observer = globals::config->observe(JudgmentTimeout, [&](int const&) { notified += 1; });
+	auto const values = to_array({original + 1, original});
+	auto flip = 0z;
+	for (auto _: state) {
+		globals::config->set_entry(Config::Entry{.category = "gameplay", .name = "judgment_timeout", .value = values[flip]});
+		flip ^= 1;
+	}
+	globals::config->set_entry(Config::Entry{.category = "gameplay", .name = "judgment_timeout", .value = original});
+	if (notified < static_cast<ssize_t>(state.iterations())) state.SkipWithError("Observer missed a change");
+}
+BENCHMARK(config_observe);
+
+}
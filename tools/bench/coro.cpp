@@ -0,0 +1,62 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+
+// Benchmarks of coroutine frame allocation. The argument is the frame size in bytes, spanning
+// the smallest size class, a typical chart-building frame, and the largest size class.
+
+namespace playnote::bench {
+
+static void coro_frame_pooled(benchmark::State& state)
+{
+	auto const size = static_cast<size_t>(state.range(0));
+	for (auto _: state) {
+		auto* frame = allocate_coro_frame(size);
+		benchmark::DoNotOptimize(frame);
+		free_coro_frame(frame, size);
+	}
+}
+BENCHMARK(coro_frame_pooled)->Arg(96)->Arg(400)->Arg(4064);
+
+// The global allocator, which served all frames before the pool existed.
+static void coro_frame_global(benchmark::State& state)
+{
+	auto const size = static_cast<size_t>(state.range(0));
+	for (auto _: state) {
+		auto* frame = ::operator new(size);
+		benchmark::DoNotOptimize(frame);
+		::operator delete(frame, size);
+	}
+}
+BENCHMARK(coro_frame_global)->Arg(96)->Arg(400)->Arg(4064);
+
+static auto leaf_task(ssize_t value) -> task<ssize_t> { co_return value + 1; }
+
+static auto chain_task(ssize_t length) -> task<ssize_t>
+{
+	auto sum = 0z;
+	for (auto idx: views::iota(0z, length))
+		sum += co_await leaf_task(idx);
+	co_return sum;
+}
+
+// A task awaiting a chain of short-lived subtasks, all on one thread. The argument is the chain length.
+static void coro_task_chain(benchmark::State& state)
+{
+	for (auto _: state) {
+		auto sum = sync_wait(chain_task(state.range(0)));
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(coro_task_chain)->Arg(1000);
+
+}
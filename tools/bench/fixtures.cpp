@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "bench/fixtures.hpp"
+
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "io/source.hpp"
+#include "bms/builder.hpp"
+#include "corpus.hpp"
+
+namespace playnote::bench {
+
+static auto fixtures = unordered_map<ssize_t, unique_ptr<ChartFixture>>{};
+
+static auto scratch_dir() -> fs::path { return fs::temp_directory_path() / "playnote-bench"; }
+
+auto chart_fixture(ssize_t notes) -> ChartFixture&
+{
+	if (auto it = fixtures.find(notes); it != fixtures.end()) return *it->second;
+
+	// Roughly 16 notes per measure, with a sprinkle of everything that makes charts expensive
+	auto const params = corpus::SongParams{
+		.chart = {
+			.notes = notes,
+			.measures = clamp(notes / 16, 16z, 999z),
+			.bpm_changes = 0.05f,
+			.ln_ratio = 0.1f,
+			.keysounds = 256,
+		},
+		.keysound_length = 100ms,
+	};
+	auto const dir = corpus::write_song(params, notes, scratch_dir(), format("song_{}", notes), corpus::Packaging::Dir);
+
+	auto& scheduler = *globals::scheduler;
+	auto cat = globals::logger->global;
+	auto song = sync_wait(io::Song::from_source(cat, scheduler, io::Source{dir}, scratch_dir() / format("song_{}.zip", notes)));
+	sync_wait(song.preload_audio_files(scheduler, SamplingRate));
+	auto chart_file = vector<byte>{};
+	for (auto [path, data]: song.for_each_chart())
+		chart_file.assign(data.begin(), data.end());
+	auto chart = sync_wait(bms::Builder{cat}.build(scheduler, chart_file, song, SamplingRate));
+
+	auto fixture = make_unique<ChartFixture>(move(song), move(chart_file), move(chart));
+	return *fixtures.emplace(notes, move(fixture)).first->second;
+}
+
+void remove_fixtures()
+{
+	fixtures.clear();
+	fs::remove_all(scratch_dir());
+}
+
+}
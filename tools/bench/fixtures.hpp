@@ -0,0 +1,35 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+#include "io/song.hpp"
+#include "bms/chart.hpp"
+
+namespace playnote::bench {
+
+// Sampling rate that all benchmarks decode and play back at.
+constexpr auto SamplingRate = 48000;
+
+// A generated song with a single chart, along with the chart built from it. The song's audio
+// is preloaded, so that building the chart again doesn't decode anything.
+struct ChartFixture {
+	io::Song song;
+	vector<byte> chart_file;
+	shared_ptr<bms::Chart const> chart;
+};
+
+// Retrieve a chart with the given number of notes, generating it on first use. Fixtures live
+// until remove_fixtures() is called.
+auto chart_fixture(ssize_t notes) -> ChartFixture&;
+
+// Destroy all fixtures and delete their files.
+void remove_fixtures();
+
+}
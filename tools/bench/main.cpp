@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "bench/fixtures.hpp"
+#include "bench/baseline.hpp"
+
+namespace playnote {
+
+struct BenchOptions {
+	optional<fs::path> baseline;
+	double alpha = 0.05; // Highest p-value that counts as a real difference
+	double threshold = 0.05; // Smallest relative slowdown that gets flagged
+};
+
+// Repetitions per benchmark when comparing, unless overridden. The U test needs a handful
+// of samples on each side to detect anything.
+static constexpr auto DefaultRepetitions = "--benchmark_repetitions=10"sv;
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] [benchmark options]\n"
+		"Run microbenchmarks of the chart and playback core. Fails if any benchmark's checks fail.\n"
+		"Save a baseline with --benchmark_out=<file> --benchmark_repetitions=10.\n\n"
+		"Options:\n"
+		"  --baseline=<file>    Compare against a saved JSON run, and fail on slowdowns\n"
+		"  --alpha=<p>          Significance level of the comparison (default: 0.05)\n"
+		"  --threshold=<ratio>  Smallest slowdown to fail on (default: 0.05)\n"
+		"Benchmark options follow.\n\n",
+		name);
+}
+
+// Take our own options out of the argument list, leaving the rest for Google Benchmark.
+static auto parse_args(vector<char*>& args) -> BenchOptions
+{
+	auto options = BenchOptions{};
+	auto has_repetitions = false;
+	auto remaining = vector<char*>{};
+	for (auto* arg_ptr: args) {
+		auto const arg = string_view{arg_ptr};
+		if (arg.starts_with("--baseline=")) options.baseline = arg.substr(arg.find('=') + 1);
+		else if (arg.starts_with("--alpha=")) options.alpha = lexical_cast<double>(arg.substr(arg.find('=') + 1));
+		else if (arg.starts_with("--threshold=")) options.threshold = lexical_cast<double>(arg.substr(arg.find('=') + 1));
+		else {
+			if (arg.starts_with("--benchmark_repetitions=")) has_repetitions = true;
+			remaining.emplace_back(arg_ptr);
+		}
+	}
+	if (options.baseline && !has_repetitions)
+		remaining.emplace_back(const_cast<char*>(DefaultRepetitions.data()));
+	args = move(remaining);
+	return options;
+}
+
+// Console output that also keeps the wall time of every repetition, and the names of benchmarks
+// whose checks failed.
+class RecordingReporter: public benchmark::ConsoleReporter {
+public:
+	void ReportRuns(std::vector<Run> const& runs) override
+	{
+		ConsoleReporter::ReportRuns(runs);
+		for (auto const& run: runs) {
+			if (run.skipped == benchmark::internal::SkippedWithError) {
+				if (!contains(errored, run.benchmark_name())) errored.emplace_back(run.benchmark_name());
+				continue;
+			}
+			if (run.run_type != Run::RT_Iteration || run.skipped) continue;
+			auto const ns = run.GetAdjustedRealTime() / benchmark::GetTimeUnitMultiplier(run.time_unit) * 1e9;
+			samples[run.benchmark_name()].emplace_back(ns);
+		}
+	}
+
+	[[nodiscard]] auto get_samples() const -> bench::Samples const& { return samples; }
+	[[nodiscard]] auto get_errored() const -> span<string const> { return errored; }
+
+private:
+	bench::Samples samples;
+	vector<string> errored;
+};
+
+static auto format_ns(double ns) -> string
+{
+	if (ns >= 1e9) return format("{:.3f}s", ns / 1e9);
+	if (ns >= 1e6) return format("{:.3f}ms", ns / 1e6);
+	if (ns >= 1e3) return format("{:.3f}us", ns / 1e3);
+	return format("{:.1f}ns", ns);
+}
+
+// Print the comparison table. Returns the number of flagged slowdowns.
+static auto report_comparison(BenchOptions const& options, bench::Samples const& current) -> ssize_t
+{
+	auto const baseline = bench::load_baseline(*options.baseline);
+	auto const results = bench::compare(baseline, current);
+	print("\nComparison against {} (Mann-Whitney U, alpha {}):\n", *options.baseline, options.alpha);
+	auto slowdowns = 0z;
+	for (auto const& result: results) {
+		auto const change = result.current_median / result.baseline_median - 1.0;
+		auto const significant = result.p_value < options.alpha;
+		auto const verdict =
+			significant && change > options.threshold? "SLOWER" :
+			significant && change < -options.threshold? "faster" :
+			"";
+		if (verdict == "SLOWER"sv) slowdowns += 1;
+		print("{:<40} {:>12} -> {:>12} {:>+8.1f}%  p={:.4f}  {}\n", result.name,
+			format_ns(result.baseline_median), format_ns(result.current_median),
+			change * 100.0, result.p_value, verdict);
+	}
+	if (results.empty()) print("No benchmarks in common with enough repetitions\n");
+	return slowdowns;
+}
+
+static auto run_benchmarks(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto bench_args = vector<char*>{};
+	for (auto* arg: args) bench_args.emplace_back(const_cast<char*>(arg));
+	auto const options = parse_args(bench_args);
+	if (contains(bench_args, "--help"sv, [](char const* arg) { return string_view{arg}; }))
+		print_usage(args[0]); // Google Benchmark prints the rest and exits
+	auto argc = static_cast<int>(bench_args.size());
+	benchmark::Initialize(&argc, bench_args.data());
+	if (benchmark::ReportUnrecognizedArguments(argc, bench_args.data())) return EXIT_FAILURE;
+
+	// Input mappers read their bindings from the config
+	auto config_stub = globals::config.provide();
+	globals::config->load_from_file();
+	auto logger_stub = globals::logger.provide("playnote-bench.log", Logger::Level::Warning, false);
+	auto scheduler_stub = globals::scheduler.provide(max(1u, jthread::hardware_concurrency()));
+
+	auto reporter = RecordingReporter{};
+	benchmark::RunSpecifiedBenchmarks(&reporter);
+	benchmark::Shutdown();
+	bench::remove_fixtures();
+
+	// Some benchmarks double as checks, and report failures by erroring out
+	auto const errored = reporter.get_errored();
+	if (!errored.empty()) {
+		print("\n{} benchmarks failed their checks:\n", errored.size());
+		for (auto const& name: errored) print("  {}\n", name);
+	}
+	auto slowdowns = 0z;
+	if (options.baseline) {
+		slowdowns = report_comparison(options, reporter.get_samples());
+		if (slowdowns > 0) print("{} significant slowdowns\n", slowdowns);
+	}
+	return errored.empty() && slowdowns == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::run_benchmarks({argv, static_cast<std::size_t>(argc)}); }
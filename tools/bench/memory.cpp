@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/memory.hpp"
+#include "bms/builder.hpp"
+#include "bench/fixtures.hpp"
+
+// Benchmarks of per-subsystem memory accounting. Each one also checks that the bytes end up
+// charged where they belong, and fails if they don't.
+
+namespace playnote::bench {
+
+// Filling and destroying a tracked vector. Items are bytes.
+static void tracked_vector_fill(benchmark::State& state)
+{
+	auto const size = state.range(0);
+	auto const before = get_memory_usage(MemoryTag::Other).current;
+	for (auto _: state) {
+		auto data = make_tracked_vector<byte>(MemoryTag::Other);
+		data.resize(size);
+		benchmark::DoNotOptimize(data.data());
+		if (get_memory_usage(MemoryTag::Other).current - before != size) {
+			state.SkipWithError("Tracked vector charged the wrong number of bytes");
+			return;
+		}
+	}
+	if (get_memory_usage(MemoryTag::Other).current != before)
+		state.SkipWithError("Tracked vector didn't release its bytes");
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(tracked_vector_fill)->Arg(4096)->Arg(1 << 20);
+
+// Moving a tracked vector around keeps its bytes charged to the subsystem that allocated them.
+static void tracked_vector_move(benchmark::State& state)
+{
+	auto const size = state.range(0);
+	auto const before = get_memory_usage(MemoryTag::ChartMedia).current;
+	auto const other_before = get_memory_usage(MemoryTag::Other).current;
+	for (auto _: state) {
+		auto source = make_tracked_vector<byte>(MemoryTag::ChartMedia);
+		source.resize(size);
+		auto destination = tracked_vector<byte>{};
+		destination = move(source);
+		benchmark::DoNotOptimize(destination.data());
+		if (get_memory_usage(MemoryTag::ChartMedia).current - before != size ||
+			get_memory_usage(MemoryTag::Other).current != other_before) {
+			state.SkipWithError("Moved tracked vector changed its subsystem");
+			return;
+		}
+	}
+	if (get_memory_usage(MemoryTag::ChartMedia).current != before)
+		state.SkipWithError("Moved tracked vector didn't release its bytes");
+}
+BENCHMARK(tracked_vector_move)->Arg(4096);
+
+// Building a chart charges its media to ChartMedia, and destroying it releases all of it.
+// The argument is the chart's note count.
+static void chart_media_attribution(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto builder = bms::Builder{globals::logger->global};
+	auto const before = get_memory_usage(MemoryTag::ChartMedia).current;
+	auto charged = 0z;
+	for (auto _: state) {
+		auto chart = sync_wait(builder.build(*globals::scheduler, fixture.chart_file, fixture.song, SamplingRate));
+		charged = get_memory_usage(MemoryTag::ChartMedia).current - before;
+		chart.reset();
+		if (charged <= 0) {
+			state.SkipWithError("Chart media wasn't charged to ChartMedia");
+			return;
+		}
+		if (get_memory_usage(MemoryTag::ChartMedia).current != before) {
+			state.SkipWithError("Destroyed chart didn't release its ChartMedia bytes");
+			return;
+		}
+	}
+	state.counters["chart_media_bytes"] = static_cast<double>(charged);
+}
+BENCHMARK(chart_media_attribution)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "dev/audio.hpp"
+#include "audio/mixer.hpp"
+#include "audio/player.hpp"
+#include "bms/cursor.hpp"
+#include "bms/mapper.hpp"
+#include "bench/fixtures.hpp"
+
+// Benchmarks of keysound mixing, rendered through an offline sink instead of an audio device.
+
+namespace playnote::bench {
+
+// A typical buffer size of a low-latency audio device.
+static constexpr auto BufferSize = 256;
+
+// Autoplay of a chart by a number of cursors at once, one audio buffer per iteration. Cursors
+// start over whenever the chart ends, so that there's always something to mix. The arguments
+// are the chart's note count and the number of cursors. Items are samples.
+static void mix_player(benchmark::State& state)
+{
+	auto& fixture = chart_fixture(state.range(0));
+	auto const cursor_count = state.range(1);
+	auto mixer_stub = globals::mixer.provide(globals::logger->global,
+		dev::Audio::OfflineSink{.sampling_rate = SamplingRate, .buffer_size = BufferSize});
+	auto& audio = globals::mixer->get_audio();
+	auto player = audio::Player{};
+	auto cursors = vector<shared_ptr<bms::Cursor>>{};
+	auto const start_cursors = [&] {
+		for (auto const& cursor: cursors) player.remove_cursor(cursor);
+		cursors.clear();
+		for (auto _: views::iota(0z, cursor_count)) {
+			cursors.emplace_back(make_shared<bms::Cursor>(fixture.chart, true));
+			player.add_cursor(cursors.back(), bms::Mapper{});
+		}
+	};
+	start_cursors();
+
+	auto const chart_samples = lib::ns_to_samples(fixture.chart->metadata.chart_duration, SamplingRate);
+	auto buffer = vector<dev::Sample>(BufferSize);
+	auto samples_since_start = 0z;
+	auto total_voices = 0z;
+	for (auto _: state) {
+		audio.render(buffer);
+		total_voices += player.get_active_sound_count();
+		samples_since_start += BufferSize;
+		if (samples_since_start >= chart_samples) [[unlikely]] {
+			state.PauseTiming();
+			start_cursors();
+			samples_since_start = 0;
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * BufferSize);
+	state.counters["mean_voices"] = benchmark::Counter(total_voices, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(mix_player)->ArgsProduct({{1000, 10000}, {1, 4}})->ArgNames({"notes", "cursors"})
+	->Unit(benchmark::kMicrosecond);
+
+}
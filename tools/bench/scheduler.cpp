@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+
+// Benchmarks of the task scheduler. Each benchmark runs its own scheduler, so that the global one
+// stays idle.
+
+namespace playnote::bench {
+
+static constexpr auto HopCount = 1000z;
+
+static auto hop_task(Scheduler& scheduler, ssize_t hops) -> task<>
+{
+	for (auto _: views::iota(0z, hops))
+		co_await scheduler.schedule(Priority::Load);
+}
+
+// A single task moving itself back onto the workers over and over. The argument is the number
+// of workers.
+static void scheduler_hop(benchmark::State& state)
+{
+	auto scheduler = Scheduler{state.range(0)};
+	for (auto _: state)
+		sync_wait(hop_task(scheduler, HopCount));
+	state.SetItemsProcessed(state.iterations() * HopCount);
+}
+BENCHMARK(scheduler_hop)->Arg(1)->Arg(4)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static auto small_task(Scheduler& scheduler, ssize_t work) -> task<ssize_t>
+{
+	co_await scheduler.schedule(Priority::Load);
+	auto sum = 0z;
+	for (auto idx: views::iota(0z, work)) {
+		sum += idx * idx;
+		benchmark::DoNotOptimize(sum);
+	}
+	co_return sum;
+}
+
+// Many small tasks awaited together, as done for the charts of a song or the keysounds of a chart.
+// The argument is the number of tasks.
+static void scheduler_fan_out(benchmark::State& state)
+{
+	auto scheduler = Scheduler{static_cast<ssize_t>(max(1u, jthread::hardware_concurrency()))};
+	for (auto _: state) {
+		auto tasks = vector<task<ssize_t>>{};
+		tasks.reserve(state.range(0));
+		for (auto _: views::iota(0z, state.range(0)))
+			tasks.emplace_back(small_task(scheduler, 1000));
+		auto results = sync_wait(when_all(move(tasks)));
+		benchmark::DoNotOptimize(results);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(scheduler_fan_out)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static auto import_spinner(Scheduler& scheduler, atomic<bool> const& stop) -> task<>
+{
+	while (!stop.load()) {
+		auto const until = steady_clock::now() + 50'000ns;
+		while (steady_clock::now() < until) {}
+		co_await scheduler.yield();
+	}
+}
+
+static auto empty_task() -> task<> { co_return; }
+
+// Round trip of interactive work while import work keeps every worker busy. Interactive work
+// should only ever wait for the import slices that are already running. The argument selects
+// a single group of workers (0), or separate foreground and background groups splitting the same
+// cores, as used by the game (1).
+static void scheduler_interactive_under_load(benchmark::State& state)
+{
+	auto const thread_count = static_cast<ssize_t>(max(1u, jthread::hardware_concurrency()));
+	auto scheduler_storage = optional<Scheduler>{};
+	if (state.range(0) == 0)
+		scheduler_storage.emplace(thread_count);
+	else
+		scheduler_storage.emplace(Scheduler::WorkerSet{max(1z, thread_count / 2)},
+			Scheduler::WorkerSet{max(1z, thread_count - thread_count / 2)});
+	auto& scheduler = *scheduler_storage;
+	auto stop = atomic<bool>{false};
+	{
+		auto imports = TaskGroup{scheduler, Priority::Import};
+		for (auto _: views::iota(0z, thread_count * 4))
+			imports.start(import_spinner(scheduler, stop));
+		for (auto _: state)
+			sync_wait(scheduler.schedule(Priority::Interactive, empty_task()));
+		stop.store(true);
+	}
+}
+BENCHMARK(scheduler_interactive_under_load)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+}
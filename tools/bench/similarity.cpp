@@ -0,0 +1,49 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+#include "bms/similarity.hpp"
+#include "corpus.hpp"
+
+// Benchmarks of the chart similarity index. The argument is the number of charts in the index.
+
+namespace playnote::bench {
+
+// An index filled with pseudorandom embeddings. Real embeddings cluster more, but a query scans
+// every chart either way.
+static void fill_index(bms::SimilarityIndex& index, ssize_t charts)
+{
+	for (auto chart_idx: views::iota(0z, charts)) {
+		auto md5 = bms::MD5{};
+		auto embedding = bms::ChartEmbedding{};
+		for (auto [idx, value]: md5 | views::enumerate)
+			value = static_cast<byte>(corpus::mix_seed(chart_idx, idx));
+		for (auto [idx, value]: embedding | views::enumerate)
+			value = static_cast<int8_t>(corpus::mix_seed(chart_idx, 1000 + idx) % 128);
+		index.add(md5, embedding);
+	}
+}
+
+// A top-10 query, as made by the "find similar charts" button.
+static void find_similar(benchmark::State& state)
+{
+	auto index = bms::SimilarityIndex{};
+	fill_index(index, state.range(0));
+	auto query = bms::ChartEmbedding{};
+	query.fill(64);
+	for (auto _: state) {
+		auto matches = index.find(query, 10);
+		benchmark::DoNotOptimize(matches);
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(find_similar)->Arg(10000)->Arg(100000)->Arg(500000)->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "utils/tracing.hpp"
+
+#ifdef ENABLE_TRACING
+
+#include <benchmark/benchmark.h>
+#include "preamble.hpp"
+
+// Benchmarks of the tracing instrumentation itself. Only built with the PLAYNOTE_TRACING CMake
+// option. Buffers are rings, so recording keeps its steady-state cost however long it runs.
+
+namespace playnote::bench {
+
+// An empty zone, which is the entire overhead TRACE_ZONE adds to the scope it times.
+// Items are zones.
+static void trace_zone(benchmark::State& state)
+{
+	for (auto _: state) {
+		TRACE_ZONE("Bench");
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(trace_zone)->ThreadRange(1, 8);
+
+// A counter sample. Items are samples.
+static void trace_counter(benchmark::State& state)
+{
+	auto value = 0z;
+	for (auto _: state) {
+		TRACE_COUNTER("Bench", value);
+		value += 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(trace_counter);
+
+}
+
+#endif
@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "lib/openssl.hpp"
+#include "lib/ffmpeg.hpp"
+#include "dev/audio.hpp"
+#include "audio/renderer.hpp"
+#include "bms/library.hpp"
+#include "common.hpp"
+
+namespace playnote {
+
+// Samples rendered between writes to the encoder.
+static constexpr auto ChunkSize = 65536z;
+
+struct BounceOptions {
+	string chart; // MD5 or part of the title
+	fs::path output;
+	optional<lib::ffmpeg::FileFormat> format;
+	fs::path db_path = LibraryDBPath;
+	fs::path songs_path = LibraryPath;
+	int sampling_rate = 48000;
+	bool normalize = false;
+	ssize_t threads = max(1u, jthread::hardware_concurrency());
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <chart>\n"
+		"Render the full audio of a library chart to a file, as heard on autoplay.\n"
+		"The chart is given by its MD5, or by a part of its title that matches only one chart.\n"
+		"A summary is written to stdout as a JSON object.\n\n"
+		"Options:\n"
+		"  --output <file>         Output file (default: <md5>.<format>)\n"
+		"  --format <wav|flac|opus>  Output format (default: from the output extension, or wav)\n"
+		"  --sampling-rate <n>     Sampling rate; Opus supports only 48000 (default: 48000)\n"
+		"  --normalize             Apply the loudness normalization used during gameplay\n"
+		"  --db <file>             Library database (default: {})\n"
+		"  --songs <dir>           Songzip directory (default: {})\n"
+		"  --threads <n>           Worker thread count for loading (default: hardware concurrency)\n",
+		name, LibraryDBPath, LibraryPath);
+}
+
+static auto format_from_extension(fs::path const& path) -> optional<lib::ffmpeg::FileFormat>
+{
+	auto ext = path.extension().string();
+	to_lower(ext);
+	if (ext == ".wav") return lib::ffmpeg::FileFormat::Wav;
+	if (ext == ".flac") return lib::ffmpeg::FileFormat::Flac;
+	if (ext == ".opus") return lib::ffmpeg::FileFormat::Opus;
+	return nullopt;
+}
+
+static auto parse_args(span<char const* const> args) -> optional<BounceOptions>
+{
+	auto options = BounceOptions{};
+	auto has_chart = false;
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			if (has_chart) return nullopt;
+			options.chart = arg;
+			has_chart = true;
+			continue;
+		}
+		if (arg == "--normalize") {
+			options.normalize = true;
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--output") options.output = value;
+		else if (arg == "--format") {
+			options.format = format_from_extension(format(".{}", value));
+			if (!options.format) return nullopt;
+		}
+		else if (arg == "--sampling-rate") options.sampling_rate = lexical_cast<int>(value);
+		else if (arg == "--db") options.db_path = value;
+		else if (arg == "--songs") options.songs_path = value;
+		else if (arg == "--threads") options.threads = lexical_cast<ssize_t>(value);
+		else return nullopt;
+	}
+	if (!has_chart || options.sampling_rate <= 0 || options.threads < 1) return nullopt;
+	if (!options.format) options.format = format_from_extension(options.output).value_or(lib::ffmpeg::FileFormat::Wav);
+	if (options.format == lib::ffmpeg::FileFormat::Opus && options.sampling_rate != 48000) return nullopt;
+	return options;
+}
+
+// Find the chart the user meant. Throws runtime_error if there is no single match.
+static auto find_chart(bms::Library& library, string_view query) -> bms::MD5
+{
+	if (auto const md5 = lib::openssl::md5_from_hex(query)) return *md5;
+	auto needle = string{query};
+	to_lower(needle);
+	auto matches = vector<bms::Library::ChartEntry>{};
+	for (auto& entry: sync_wait(library.list_charts())) {
+		auto title = entry.title;
+		to_lower(title);
+		if (title.contains(needle)) matches.emplace_back(move(entry));
+	}
+	if (matches.empty()) throw runtime_error_fmt("No chart matches \"{}\"", query);
+	if (matches.size() > 1) {
+		for (auto const& match: matches)
+			print(stderr, "{}  {}\n", lib::openssl::md5_to_hex(match.md5), match.title);
+		throw runtime_error_fmt("{} charts match \"{}\"; pick one by MD5", matches.size(), query);
+	}
+	return matches.front().md5;
+}
+
+static auto bounce(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// stdout is reserved for the summary, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-bounce.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(options->threads);
+	auto library_cat = globals::logger->create_category("Library", Logger::Level::Info, false);
+	auto library = bms::Library{library_cat, *globals::scheduler, options->db_path, options->songs_path};
+
+	auto const load_start = steady_clock::now();
+	auto const md5 = find_chart(library, options->chart);
+	auto const chart = sync_wait(library.load_chart(*globals::scheduler, md5, options->sampling_rate));
+	auto const load_time = steady_clock::now() - load_start;
+	if (options->output.empty()) {
+		auto ext = string{enum_name(*options->format)};
+		to_lower(ext);
+		options->output = format("{}.{}", lib::openssl::md5_to_hex(md5), ext);
+	}
+
+	auto const render_start = steady_clock::now();
+	auto const gain = options->normalize? dev::lufs_to_gain(chart->metadata.loudness) : 1.0f;
+	auto encoder = lib::ffmpeg::open_file_encoder(options->output, *options->format, options->sampling_rate);
+	auto renderer = audio::Renderer{chart};
+	auto chunk = vector<dev::Sample>{};
+	chunk.reserve(ChunkSize);
+	auto samples = 0z;
+	auto ended = false;
+	while (!ended) {
+		chunk.clear();
+		while (ssize(chunk) < ChunkSize) {
+			auto const sample = renderer.advance_one_sample();
+			if (!sample) {
+				ended = true;
+				break;
+			}
+			chunk.emplace_back(dev::Sample{sample->left * gain, sample->right * gain});
+		}
+		lib::ffmpeg::encode_chunk(encoder, chunk);
+		samples += ssize(chunk);
+	}
+	lib::ffmpeg::finish_file_encoder(move(encoder));
+	auto const render_time = steady_clock::now() - render_start;
+
+	auto const audio_seconds = static_cast<double>(samples) / options->sampling_rate;
+	print(R"({{"event":"complete","md5":"{}","title":"{}","output":"{}","audio_seconds":{:.3f},)"
+		R"("load_seconds":{:.3f},"render_seconds":{:.3f},"realtime_factor":{:.1f},"bytes":{}}})" "\n",
+		lib::openssl::md5_to_hex(md5), json_escape(chart->metadata.title), json_escape(options->output.generic_string()), audio_seconds,
+		to_seconds(load_time), to_seconds(render_time), audio_seconds / max(to_seconds(render_time), 0.001),
+		fs::file_size(options->output));
+	return EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::bounce({argv, static_cast<std::size_t>(argc)}); }
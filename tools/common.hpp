@@ -0,0 +1,40 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+// Helpers shared by the command-line tools and their reports.
+
+namespace playnote {
+
+// Escape a string for use inside a JSON string literal.
+inline auto json_escape(string_view str) -> string
+{
+	auto result = string{};
+	result.reserve(str.size());
+	for (auto c: str) {
+		if (c == '"' || c == '\\') result.push_back('\\');
+		if (static_cast<unsigned char>(c) < 0x20) format_to(back_inserter(result), "\\u{:04x}", static_cast<int>(c));
+		else result.push_back(c);
+	}
+	return result;
+}
+
+inline auto to_seconds(nanoseconds ns) -> double { return duration_cast<duration<double>>(ns).count(); }
+
+// Median of a set of samples. The set must not be empty.
+inline auto median(vector<double> values) -> double
+{
+	sort(values);
+	auto const mid = values.size() / 2;
+	return values.size() % 2? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+}
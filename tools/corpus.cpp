@@ -0,0 +1,334 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include "corpus.hpp"
+
+#include <random>
+#include "preamble.hpp"
+#include "utils/assert.hpp"
+#include "lib/archive.hpp"
+#include "lib/icu.hpp"
+#include "io/file.hpp"
+
+namespace playnote::corpus {
+
+// Lanes of a 7-key chart, with the scratch last.
+static constexpr auto LaneChannels = to_array({"11"sv, "12"sv, "13"sv, "14"sv, "15"sv, "18"sv, "19"sv, "16"sv});
+static_assert(ssize(LaneChannels) == LaneCount);
+
+// Source of randomness that produces the same sequence on every platform. The standard
+// distributions are implementation-defined, so they're avoided.
+class Random {
+public:
+	explicit Random(uint64_t seed): engine{seed} {}
+
+	// Uniform integer in [0, bound).
+	[[nodiscard]] auto below(ssize_t bound) -> ssize_t { return static_cast<ssize_t>(engine() % bound); }
+
+	// Uniform float in [0, 1).
+	[[nodiscard]] auto unit() -> float { return static_cast<float>(engine() >> 40) / static_cast<float>(1 << 24); }
+
+	[[nodiscard]] auto chance(float probability) -> bool { return unit() < probability; }
+
+private:
+	std::mt19937_64 engine;
+};
+
+// SplitMix64 finalizer.
+auto mix_seed(uint64_t seed, uint64_t stream) -> uint64_t
+{
+	auto z = seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+// Format a slot number as two base-36 digits.
+static auto slot_name(ssize_t slot) -> string
+{
+	static constexpr auto Digits = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"sv;
+	ASSUME(slot >= 0 && slot <= MaxSlot);
+	return string{Digits[slot / 36], Digits[slot % 36]};
+}
+
+// Build a title out of random words. The words are outside of ASCII, so that the encoding
+// of the file matters.
+static auto random_title(Random& random) -> string
+{
+	static constexpr auto Words = to_array({
+		"桜"sv, "夜明け"sv, "流星"sv, "幻想"sv, "残響"sv, "ノイズ"sv, "スペクトル"sv, "境界線"sv,
+		"蒼"sv, "未来"sv, "エコー"sv, "迷宮"sv, "光"sv, "シグナル"sv, "結晶"sv, "螺旋"sv,
+	});
+	auto title = string{};
+	auto const words = 1 + random.below(3);
+	for (auto i: views::iota(0z, words)) {
+		if (i != 0) title.append(" ");
+		title.append(Words[random.below(ssize(Words))]);
+	}
+	return title;
+}
+
+// Sine of a phase given in 1/2^32 of a turn, as a Q15 value. Samples and pixels are generated
+// with integer arithmetic only, since libm and fast-math floats differ between toolchains.
+static auto sine_q15(uint32_t phase) -> int32_t
+{
+	static constexpr auto TableBits = 12;
+	// Fifth-order polynomial over a quarter wave, folded to cover the rest
+	static constexpr auto Table = [] {
+		auto table = array<int16_t, 1z << TableBits>{};
+		for (auto i: views::iota(0z, ssize(table))) {
+			auto const q = i << (17 - TableBits); // Position within the turn, in 1/2^17 steps
+			auto const z = q < 32768? q : q < 98304? 65536 - q : q - 131072; // Q15, within [-1, 1]
+			auto const z2 = z * z >> 15;
+			auto const value = z * (51472 - (z2 * (21023 - (z2 * 2320 >> 15)) >> 15)) >> 15;
+			table[i] = static_cast<int16_t>(clamp(value, -32767z, 32767z));
+		}
+		return table;
+	}();
+	return Table[phase >> (32 - TableBits)];
+}
+
+// A linear fade-out avoids clicks at the end.
+auto synthesize_tone(ssize_t slot, milliseconds length, int sampling_rate, ssize_t detune) -> vector<byte>
+{
+	// Twelve-tone equal temperament ratios, in Q16
+	static constexpr auto Semitones = to_array<int64_t>({
+		65536, 69433, 73562, 77936, 82570, 87480, 92682, 98193, 104032, 110218, 116772, 123715,
+	});
+	auto const pitch = slot % 48;
+	auto frequency = (220ll << (pitch / 12)) * Semitones[pitch % 12]; // Hz in Q16
+	frequency = frequency * (1'000'000 + detune * 578) / 1'000'000; // A cent is a ratio of ~1.000578
+	auto const phase_step = static_cast<uint32_t>((frequency << 16) / sampling_rate);
+	auto const samples = static_cast<ssize_t>(sampling_rate * length.count() / 1000);
+	auto const data_size = static_cast<uint32_t>(samples * 2);
+
+	auto output = vector<byte>{};
+	output.reserve(44 + data_size);
+	auto append_str = [&](string_view str) {
+		for (auto ch: str) output.emplace_back(static_cast<byte>(ch));
+	};
+	auto append_u16 = [&](uint16_t value) {
+		output.emplace_back(static_cast<byte>(value & 0xFF));
+		output.emplace_back(static_cast<byte>(value >> 8));
+	};
+	auto append_u32 = [&](uint32_t value) {
+		append_u16(static_cast<uint16_t>(value & 0xFFFF));
+		append_u16(static_cast<uint16_t>(value >> 16));
+	};
+
+	append_str("RIFF");
+	append_u32(36 + data_size);
+	append_str("WAVE");
+	append_str("fmt ");
+	append_u32(16); // Chunk size
+	append_u16(1); // PCM
+	append_u16(1); // Channels
+	append_u32(sampling_rate);
+	append_u32(sampling_rate * 2); // Byte rate
+	append_u16(2); // Block align
+	append_u16(16); // Bits per sample
+	append_str("data");
+	append_u32(data_size);
+	auto phase = 0u;
+	for (auto i: views::iota(0z, samples)) {
+		auto const sample = sine_q15(phase) * (samples - i) / samples / 2; // Half amplitude, faded out
+		append_u16(static_cast<uint16_t>(static_cast<int16_t>(sample)));
+		phase += phase_step; // Wraps around every turn
+	}
+	return output;
+}
+
+auto synthesize_image(ssize_t slot, int2 size) -> vector<byte>
+{
+	auto const row_size = (size.x() * 3 + 3) / 4 * 4; // Rows are padded to 4 bytes
+	auto const data_size = static_cast<uint32_t>(row_size * size.y());
+	static constexpr auto QuarterTurn = 1u << 30;
+	static constexpr auto ThirdTurn = 0x5555'5555u;
+	auto const hue = static_cast<uint32_t>((slot % 36) * (1ll << 32) / 36); // Phase of red
+
+	auto output = vector<byte>{};
+	output.reserve(54 + data_size);
+	auto append_u16 = [&](uint16_t value) {
+		output.emplace_back(static_cast<byte>(value & 0xFF));
+		output.emplace_back(static_cast<byte>(value >> 8));
+	};
+	auto append_u32 = [&](uint32_t value) {
+		append_u16(static_cast<uint16_t>(value & 0xFFFF));
+		append_u16(static_cast<uint16_t>(value >> 16));
+	};
+
+	output.emplace_back(static_cast<byte>('B'));
+	output.emplace_back(static_cast<byte>('M'));
+	append_u32(54 + data_size);
+	append_u32(0); // Reserved
+	append_u32(54); // Pixel data offset
+	append_u32(40); // Header size
+	append_u32(size.x());
+	append_u32(size.y()); // Positive height means rows are stored bottom to top
+	append_u16(1); // Planes
+	append_u16(24); // Bits per pixel
+	append_u32(0); // No compression
+	append_u32(data_size);
+	append_u32(2835); // 72 DPI
+	append_u32(2835); // ^
+	append_u32(0); // Palette size
+	append_u32(0); // Important colors
+	for (auto y: views::iota(0, size.y())) {
+		for (auto x: views::iota(0, size.x())) {
+			// Cosine of the channel's phase, scaled to [0, 255] and darkened towards the corner
+			auto channel = [&](uint32_t phase) {
+				auto const level = 32768ll + sine_q15(hue + phase + QuarterTurn);
+				return static_cast<byte>(level * (x + y) * 255 / (65536ll * (size.x() + size.y())));
+			};
+			output.emplace_back(channel(2 * ThirdTurn)); // Blue
+			output.emplace_back(channel(ThirdTurn)); // Green
+			output.emplace_back(channel(0)); // Red
+		}
+		output.resize(output.size() + row_size - size.x() * 3, byte{0});
+	}
+	return output;
+}
+
+auto synthesize_video(int2 size, ssize_t frames, int fps) -> vector<byte>
+{
+	auto const header = format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg\n", size.x(), size.y(), fps);
+	auto const chroma_size = int2{(size.x() + 1) / 2, (size.y() + 1) / 2};
+	auto const frame_size = 6 + size.x() * size.y() + chroma_size.x() * chroma_size.y() * 2;
+
+	auto output = vector<byte>{};
+	output.reserve(header.size() + frames * frame_size);
+	auto append_str = [&](string_view str) {
+		for (auto ch: str) output.emplace_back(static_cast<byte>(ch));
+	};
+
+	append_str(header);
+	for (auto frame: views::iota(0z, frames)) {
+		append_str("FRAME\n");
+		for (auto y: views::iota(0, size.y()))
+			for (auto x: views::iota(0, size.x()))
+				output.emplace_back(static_cast<byte>((x + y + frame * 4) % 256));
+		for (auto plane: views::iota(0, 2))
+			for (auto _: views::iota(0, chroma_size.x() * chroma_size.y()))
+				output.emplace_back(static_cast<byte>(plane? 96 : 160));
+	}
+	return output;
+}
+
+auto generate_chart(ChartParams const& params, uint64_t seed, string_view title, ssize_t difficulty) -> string
+{
+	ASSERT(params.notes <= max_notes(params));
+	auto random = Random{seed};
+	auto bms = string{};
+	format_to(back_inserter(bms), "#PLAYER 1\n#GENRE Synthetic\n#TITLE {}\n#ARTIST playnote-corpus\n"
+		"#BPM {:.2f}\n#DIFFICULTY {}\n\n", title, params.bpm, difficulty);
+	for (auto slot: views::iota(1z, params.keysounds + 1))
+		format_to(back_inserter(bms), "#WAV{} k{}.wav\n", slot_name(slot), slot_name(slot));
+	bms.append("\n");
+
+	// BPM changes, each getting its own slot (there are fewer measures than slots)
+	auto bpm_changes = vector<pair<ssize_t, ssize_t>>{}; // Measure, slot
+	for (auto measure: views::iota(0z, params.measures)) {
+		if (!random.chance(params.bpm_changes)) continue;
+		auto const slot = ssize(bpm_changes) + 1;
+		// In hundredths, to keep the value exact
+		auto const bpm = static_cast<ssize_t>(params.bpm * 100.0f) * (50 + random.below(151)) / 100;
+		format_to(back_inserter(bms), "#BPM{} {}.{:02}\n", slot_name(slot), bpm / 100, bpm % 100);
+		bpm_changes.emplace_back(measure, slot);
+	}
+	bms.append("\n");
+
+	// Pick distinct cells of the lane/measure/position grid for the notes
+	auto const cells_per_lane = params.measures * params.resolution;
+	auto const cell_count = LaneCount * cells_per_lane;
+	auto const note_count = params.notes;
+	auto cells = vector<ssize_t>(cell_count);
+	for (auto i: views::iota(0z, cell_count)) cells[i] = i;
+	for (auto i: views::iota(0z, note_count)) // Partial Fisher-Yates shuffle
+		std::swap(cells[i], cells[i + random.below(cell_count - i)]);
+	cells.resize(note_count);
+	sort(cells); // Lane-major, then in time order
+
+	// Value in each cell, and whether it belongs to a long note
+	auto grid = vector<pair<ssize_t, bool>>(cell_count, {0, false});
+	for (auto i = 0z; i < note_count; i += 1) {
+		auto const cell = cells[i];
+		grid[cell].first = 1 + random.below(params.keysounds);
+		auto const next_on_lane = i + 1 < note_count && cells[i + 1] / cells_per_lane == cell / cells_per_lane;
+		if (next_on_lane && random.chance(params.ln_ratio)) {
+			grid[cell].second = true;
+			grid[cells[i + 1]] = {grid[cell].first, true}; // The end is silent, but must share the start's slot to pair up
+			i += 1;
+		}
+	}
+
+	for (auto measure: views::iota(0z, params.measures)) {
+		for (auto const& [change_measure, slot]: bpm_changes) {
+			if (change_measure == measure)
+				format_to(back_inserter(bms), "#{:03}08:{}\n", measure, slot_name(slot));
+		}
+		for (auto lane: views::iota(0z, LaneCount)) {
+			auto const base = lane * cells_per_lane + measure * params.resolution;
+			auto const row = span{grid}.subspan(base, params.resolution);
+			for (auto ln: {false, true}) {
+				if (!any_of(row, [&](auto const& cell) { return cell.first != 0 && cell.second == ln; })) continue;
+				auto channel = string{LaneChannels[lane]};
+				if (ln) channel[0] = '5';
+				format_to(back_inserter(bms), "#{:03}{}:", measure, channel);
+				for (auto const& [value, is_ln]: row)
+					bms.append(value != 0 && is_ln == ln? slot_name(value) : "00");
+				bms.append("\n");
+			}
+		}
+	}
+	return bms;
+}
+
+auto generate_song(SongParams const& params, uint64_t seed) -> vector<pair<fs::path, vector<byte>>>
+{
+	auto random = Random{seed};
+	auto const title = random_title(random);
+
+	auto files = vector<pair<fs::path, vector<byte>>>{};
+	for (auto chart_idx: views::iota(0z, params.charts)) {
+		auto const difficulty = min(chart_idx + 1, 5z);
+		auto const text = generate_chart(params.chart, mix_seed(seed, chart_idx), title, difficulty);
+		auto encoded = params.encoding == "UTF-8"?
+			vector<byte>{reinterpret_cast<byte const*>(text.data()), reinterpret_cast<byte const*>(text.data() + text.size())} :
+			lib::icu::from_utf8(text, params.encoding);
+		files.emplace_back(format("chart_{}.bme", chart_idx), move(encoded));
+	}
+	// The first slots are shared with every other song; the rest are detuned by a different amount in each
+	auto const shared = static_cast<ssize_t>(params.chart.keysounds * params.shared_keysounds);
+	for (auto slot: views::iota(1z, params.chart.keysounds + 1)) {
+		auto const detune = slot <= shared? 0z : 1 + random.below(50);
+		files.emplace_back(format("k{}.wav", slot_name(slot)), synthesize_tone(slot, params.keysound_length, 44100, detune));
+	}
+	return files;
+}
+
+auto write_song(SongParams const& params, uint64_t seed, fs::path const& dir, string_view name,
+	Packaging packaging) -> fs::path
+{
+	auto const files = generate_song(params, seed);
+	if (packaging == Packaging::Dir) {
+		auto const song_dir = dir / name;
+		fs::create_directories(song_dir);
+		for (auto const& [path, data]: files) io::write_file(song_dir / path, data);
+		return song_dir;
+	}
+	auto const archive_format = packaging == Packaging::Zip?
+		lib::archive::ArchiveFormat::Zip : lib::archive::ArchiveFormat::SevenZip;
+	auto const extension = packaging == Packaging::Zip? ".zip"sv : ".7z"sv;
+	auto const archive_path = dir / (string{name} + string{extension});
+	auto archive = lib::archive::open_write(archive_path, archive_format);
+	for (auto const& [path, data]: files) lib::archive::write_entry(archive, path, data);
+	return archive_path;
+}
+
+}
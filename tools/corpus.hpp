@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#pragma once
+#include "preamble.hpp"
+
+// Deterministic generation of synthetic BMS songs. The same parameters and seed produce
+// the same files on every platform.
+
+namespace playnote::corpus {
+
+// Largest slot number that fits in two base-36 digits.
+constexpr auto MaxSlot = 36z * 36z - 1;
+
+// Number of lanes of a generated chart; 7 keys and a scratch.
+constexpr auto LaneCount = 8z;
+
+// How the files of each song are stored.
+enum class Packaging {
+	Dir,
+	Zip,
+	SevenZip,
+};
+
+// Shape of a generated chart.
+struct ChartParams {
+	ssize_t notes = 1000; // A long note uses up two
+	ssize_t measures = 64; // Up to 999
+	ssize_t resolution = 16; // Note positions per measure
+	float bpm = 150.0f;
+	float bpm_changes = 0.0f; // Chance of a BPM change at the start of each measure
+	float ln_ratio = 0.0f; // Chance of a note starting a long note
+	ssize_t keysounds = 64; // Up to MaxSlot
+};
+
+// Shape of a generated song.
+struct SongParams {
+	ChartParams chart;
+	ssize_t charts = 1; // Charts of a song share its keysounds
+	milliseconds keysound_length = 250ms;
+	float shared_keysounds = 1.0f; // Fraction of keysounds that are identical in every song; the rest are unique
+	string encoding = "Shift_JIS"; // Of the BMS files
+};
+
+// Number of notes that fit into a chart of the given shape.
+[[nodiscard]] inline auto max_notes(ChartParams const& params) -> ssize_t
+{ return LaneCount * params.measures * params.resolution; }
+
+// Mix two values into a seed, so that every item gets an independent stream of randomness
+// regardless of how many others are generated.
+[[nodiscard]] auto mix_seed(uint64_t seed, uint64_t stream) -> uint64_t;
+
+// Generate the text of a chart, in UTF-8. The note count must fit the chart's shape.
+[[nodiscard]] auto generate_chart(ChartParams const&, uint64_t seed, string_view title,
+	ssize_t difficulty) -> string;
+
+// Render a sine tone as a mono 16-bit WAV file. Every slot gets a different pitch, and the detune
+// (in cents) shifts it further.
+[[nodiscard]] auto synthesize_tone(ssize_t slot, milliseconds length, int sampling_rate = 44100,
+	ssize_t detune = 0) -> vector<byte>;
+
+// Render a gradient picture as a 24-bit BMP file. Every slot gets a different hue.
+[[nodiscard]] auto synthesize_image(ssize_t slot, int2 size = {256, 256}) -> vector<byte>;
+
+// Render a moving gradient as an uncompressed YUV4MPEG2 video. Decoding it costs next to nothing,
+// so that timing the playback of it measures only the player's own overhead.
+[[nodiscard]] auto synthesize_video(int2 size, ssize_t frames, int fps = 30) -> vector<byte>;
+
+// Generate all files of a song, with paths relative to the song's root.
+[[nodiscard]] auto generate_song(SongParams const&, uint64_t seed) -> vector<pair<fs::path, vector<byte>>>;
+
+// Generate a song and write it into the directory, as a subdirectory or an archive with the given
+// name (without extension). Returns the path of the written song.
+auto write_song(SongParams const&, uint64_t seed, fs::path const& dir, string_view name, Packaging) -> fs::path;
+
+}
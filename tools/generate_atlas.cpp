@@ -9,25 +9,63 @@ or distributed except according to those terms.
 
 #include "preamble.hpp"
 #include "utils/logger.hpp"
+#include "lib/msdf.hpp"
 #include "io/file.hpp"
 #include "gfx/prewarm.hpp"
 #include "gfx/text.hpp"
+#include "common.hpp"
 
 namespace playnote {
 
+struct FontFile {
+	id font_id;
+	io::ReadFile file;
+};
+
+// Rasterize all prewarm glyphs into a fresh atlas, and return its serialized form.
+static auto build_atlas(span<FontFile const> fonts, lib::msdf::GlyphCache* cache,
+	optional<fs::path> const& debug_filename) -> vector<byte>
+{
+	auto shaper = gfx::TextShaper{globals::logger->global, 4096};
+	if (cache) shaper.set_glyph_cache(*cache);
+	auto font_ids = vector<id>{};
+	font_ids.reserve(fonts.size());
+	for (auto const& font: fonts) {
+		shaper.load_font(font.font_id, font.file.contents, 500);
+		font_ids.emplace_back(font.font_id);
+	}
+	shaper.define_style("Sans-Regular"_id, font_ids);
+
+	for (auto chars: gfx::AtlasPrewarmChars)
+		shaper.shape("Sans-Regular"_id, chars);
+
+	if (debug_filename) shaper.dump_atlas(*debug_filename);
+	return shaper.serialize();
+}
+
 auto generate_atlas(span<char const* const> args)
 try {
-	if (args.size() < 3) {
-		print(stderr, "Usage: {} <output> <fonts>...\n", args[0]);
+	auto cache_filename = optional<fs::path>{};
+	auto verify = false;
+	auto positional = vector<char const*>{};
+	for (auto idx = 1z; idx < ssize(args); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (arg == "--verify") verify = true;
+		else if (arg == "--cache" && idx + 1 < ssize(args)) cache_filename = args[++idx];
+		else positional.emplace_back(args[idx]);
+	}
+	if (positional.size() < 2) {
+		print(stderr, "Usage: {} [--cache <file>] [--verify] <output> <fonts>...\n"
+			"  --cache <file>  Reuse glyphs rasterized by previous runs, and save the new ones\n"
+			"  --verify        Also build the atlas from scratch, and fail if the results differ\n", args[0]);
 		return EXIT_FAILURE;
 	}
-	auto* output_filename = args[1];
-	auto font_filenames = args.subspan(2);
+	auto* output_filename = positional[0];
+	auto font_filenames = span{positional}.subspan(1);
 
 	auto logger_stub = globals::logger.provide("generate_atlas.log", Logger::Level::Debug);
-	auto shaper = gfx::TextShaper{globals::logger->global, 4096};
-	auto font_ids = vector<id>{};
-	font_ids.reserve(font_filenames.size());
+	auto fonts = vector<FontFile>{};
+	fonts.reserve(font_filenames.size());
 	for (auto font_path_sv: font_filenames) {
 		static constexpr auto WeightSuffixes = to_array({
 			"-Regular"sv,
@@ -37,19 +75,41 @@ try {
 		auto font_name = font_path.filename().replace_extension().string();
 		for (auto suffix: WeightSuffixes)
 			if (font_name.ends_with(suffix)) font_name.resize(font_name.size() - suffix.size());
-		auto font_id = id{font_name};
-		auto font_file = io::read_file(font_path);
-		shaper.load_font(font_id, {font_file.contents.begin(), font_file.contents.end()}, 500);
-		font_ids.emplace_back(font_id);
+		fonts.emplace_back(FontFile{id{font_name}, io::read_file(font_path)});
 	}
-	shaper.define_style("Sans-Regular"_id, font_ids);
 
-	for (auto chars: gfx::AtlasPrewarmChars)
-		shaper.shape("Sans-Regular"_id, chars);
+	auto cache = lib::msdf::GlyphCache{};
+	if (cache_filename && fs::exists(*cache_filename)) {
+		try {
+			cache = lib::msdf::deserialize_glyph_cache(io::read_file(*cache_filename).contents);
+		} catch (exception const& e) {
+			WARN("Discarding glyph cache \"{}\": {}", *cache_filename, e.what());
+		}
+	}
+
+	auto const debug_filename = fs::path{output_filename}.replace_extension(".png");
+	auto const start = steady_clock::now();
+	auto const output = build_atlas(fonts, cache_filename? &cache : nullptr, debug_filename);
+	auto const elapsed = steady_clock::now() - start;
+	if (cache_filename) {
+		print("Rasterized {} glyphs, reused {} from the cache, in {:.2f}s\n", cache.misses, cache.hits, to_seconds(elapsed));
+		io::write_file(*cache_filename, lib::msdf::serialize_glyph_cache(cache));
+	} else {
+		print("Rasterized the atlas in {:.2f}s\n", to_seconds(elapsed));
+	}
+
+	if (verify) {
+		auto const clean_start = steady_clock::now();
+		auto const clean_output = build_atlas(fonts, nullptr, nullopt);
+		auto const clean_elapsed = steady_clock::now() - clean_start;
+		print("Clean build took {:.2f}s ({:.1f}x)\n", to_seconds(clean_elapsed),
+			to_seconds(clean_elapsed) / max(to_seconds(elapsed), 0.001));
+		if (!std::ranges::equal(output, clean_output)) {
+			print(stderr, "The atlas differs from a clean build\n");
+			return EXIT_FAILURE;
+		}
+	}
 
-	auto debug_filename = fs::path{output_filename}.replace_extension(".png");
-	shaper.dump_atlas(debug_filename);
-	auto output = shaper.serialize();
 	io::write_file(output_filename, output);
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/logger.hpp"
+#include "corpus.hpp"
+
+namespace playnote {
+
+struct CorpusOptions {
+	fs::path output;
+	uint64_t seed = 1;
+	ssize_t songs = 10;
+	corpus::SongParams song;
+	corpus::Packaging packaging = corpus::Packaging::Dir;
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <output dir>\n"
+		"Generate a reproducible corpus of synthetic BMS songs.\n\n"
+		"Options:\n"
+		"  --seed <n>              Seed of the generator (default: 1)\n"
+		"  --songs <n>             Number of songs (default: 10)\n"
+		"  --charts <n>            Charts per song (default: 1)\n"
+		"  --notes <n>             Notes per chart, long notes counting twice (default: 1000)\n"
+		"  --measures <n>          Measures per chart, up to 999 (default: 64)\n"
+		"  --resolution <n>        Note positions per measure (default: 16)\n"
+		"  --bpm <n>               Initial BPM (default: 150)\n"
+		"  --bpm-changes <0-1>     Chance of a BPM change per measure (default: 0)\n"
+		"  --ln-ratio <0-1>        Chance of a note starting a long note (default: 0)\n"
+		"  --keysounds <n>         Keysounds per song, up to {} (default: 64)\n"
+		"  --keysound-length <ms>  Length of each keysound (default: 250)\n"
+		"  --shared-keysounds <0-1> Fraction of keysounds identical in every song (default: 1)\n"
+		"  --encoding <sjis|utf8>  Encoding of the BMS files (default: sjis)\n"
+		"  --package <dir|zip|7z>  Packaging of each song (default: dir)\n",
+		name, corpus::MaxSlot);
+}
+
+static auto parse_args(span<char const* const> args) -> optional<CorpusOptions>
+{
+	auto options = CorpusOptions{};
+	auto has_output = false;
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			if (has_output) return nullopt;
+			options.output = arg;
+			has_output = true;
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--seed") options.seed = lexical_cast<uint64_t>(value);
+		else if (arg == "--songs") options.songs = lexical_cast<ssize_t>(value);
+		else if (arg == "--charts") options.song.charts = lexical_cast<ssize_t>(value);
+		else if (arg == "--notes") options.song.chart.notes = lexical_cast<ssize_t>(value);
+		else if (arg == "--measures") options.song.chart.measures = lexical_cast<ssize_t>(value);
+		else if (arg == "--resolution") options.song.chart.resolution = lexical_cast<ssize_t>(value);
+		else if (arg == "--bpm") options.song.chart.bpm = lexical_cast<float>(value);
+		else if (arg == "--bpm-changes") options.song.chart.bpm_changes = lexical_cast<float>(value);
+		else if (arg == "--ln-ratio") options.song.chart.ln_ratio = lexical_cast<float>(value);
+		else if (arg == "--keysounds") options.song.chart.keysounds = lexical_cast<ssize_t>(value);
+		else if (arg == "--keysound-length") options.song.keysound_length = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--shared-keysounds") options.song.shared_keysounds = lexical_cast<float>(value);
+		else if (arg == "--encoding") {
+			if (value == "sjis") options.song.encoding = "Shift_JIS";
+			else if (value == "utf8") options.song.encoding = "UTF-8";
+			else return nullopt;
+		}
+		else if (arg == "--package") {
+			if (value == "dir") options.packaging = corpus::Packaging::Dir;
+			else if (value == "zip") options.packaging = corpus::Packaging::Zip;
+			else if (value == "7z") options.packaging = corpus::Packaging::SevenZip;
+			else return nullopt;
+		}
+		else return nullopt;
+	}
+	if (!has_output) return nullopt;
+	auto const& chart = options.song.chart;
+	if (options.songs < 1 || options.song.charts < 1 || chart.notes < 0) return nullopt;
+	if (chart.measures < 1 || chart.measures > 999 || chart.resolution < 1) return nullopt;
+	if (chart.bpm <= 0.0f || chart.keysounds < 1 || chart.keysounds > corpus::MaxSlot) return nullopt;
+	if (chart.bpm_changes < 0.0f || chart.bpm_changes > 1.0f) return nullopt;
+	if (chart.ln_ratio < 0.0f || chart.ln_ratio > 1.0f) return nullopt;
+	if (options.song.keysound_length <= 0ms) return nullopt;
+	if (options.song.shared_keysounds < 0.0f || options.song.shared_keysounds > 1.0f) return nullopt;
+	return options;
+}
+
+static auto generate_corpus(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	auto logger_stub = globals::logger.provide("generate_corpus.log", Logger::Level::Info);
+	auto& chart = options->song.chart;
+	auto const max_notes = corpus::max_notes(chart);
+	if (chart.notes > max_notes) {
+		WARN("Only {} notes fit into {} measures at resolution {}", max_notes, chart.measures, chart.resolution);
+		chart.notes = max_notes;
+	}
+	fs::create_directories(options->output);
+	for (auto song_idx: views::iota(0z, options->songs)) {
+		auto const seed = corpus::mix_seed(options->seed, song_idx);
+		corpus::write_song(options->song, seed, options->output, format("song_{:04}", song_idx), options->packaging);
+	}
+	print("Generated {} songs with {} charts each in {}\n", options->songs, options->song.charts, options->output);
+	return EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::generate_corpus({argv, static_cast<std::size_t>(argc)}); }
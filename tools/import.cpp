@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "lib/os.hpp"
+#include "bms/library.hpp"
+#include "common.hpp"
+
+namespace playnote {
+
+struct ImportOptions {
+	vector<fs::path> paths;
+	fs::path db_path = LibraryDBPath;
+	fs::path songs_path = LibraryPath;
+	ssize_t threads = max(1u, jthread::hardware_concurrency());
+	ssize_t workers = 0; // Import worker processes; 0 imports in this process
+	milliseconds interval = 1s; // Between progress reports
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <paths>...\n"
+		"Import songs into the library without starting the game.\n"
+		"Progress is written to stdout as one JSON object per line.\n\n"
+		"Options:\n"
+		"  --db <file>        Library database (default: {})\n"
+		"  --songs <dir>      Songzip directory (default: {})\n"
+		"  --threads <n>      Worker thread count (default: hardware concurrency)\n"
+		"  --workers <n>      Import in this many worker processes, so that a song that crashes\n"
+		"                     a decoder is quarantined instead (default: 0, import in this process)\n"
+		"  --interval <ms>    Time between progress reports (default: 1000)\n",
+		name, LibraryDBPath, LibraryPath);
+}
+
+static auto parse_args(span<char const* const> args) -> optional<ImportOptions>
+{
+	auto options = ImportOptions{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			options.paths.emplace_back(arg);
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--db") options.db_path = value;
+		else if (arg == "--songs") options.songs_path = value;
+		else if (arg == "--threads") options.threads = lexical_cast<ssize_t>(value);
+		else if (arg == "--workers") options.workers = lexical_cast<ssize_t>(value);
+		else if (arg == "--interval") options.interval = milliseconds{lexical_cast<int>(value)};
+		else return nullopt;
+	}
+	if (options.paths.empty() || options.threads < 1 || options.workers < 0) return nullopt;
+	return options;
+}
+
+// Write a line of import statistics. Rates are averages since the start of the import.
+static void print_progress(bms::Library const& library, string_view event, nanoseconds elapsed)
+{
+	auto const charts = library.get_import_charts_added() + library.get_import_charts_skipped() +
+		library.get_import_charts_failed();
+	auto const bytes = library.get_import_bytes_processed();
+	auto const seconds = max(to_seconds(elapsed), 0.001);
+	auto line = format(R"({{"event":"{}","elapsed":{:.3f},"songs_total":{},"songs_processed":{},)"
+		R"("songs_failed":{},"songs_quarantined":{},"charts_added":{},"charts_skipped":{},"charts_failed":{},)"
+		R"("bytes_processed":{},"charts_per_second":{:.2f},"bytes_per_second":{:.0f},"stage_seconds":{{)",
+		event, to_seconds(elapsed), library.get_import_songs_total(), library.get_import_songs_processed(),
+		library.get_import_songs_failed(), library.get_import_songs_quarantined(), library.get_import_charts_added(), library.get_import_charts_skipped(),
+		library.get_import_charts_failed(), bytes, charts / seconds, bytes / seconds);
+	for (auto stage: enum_values<bms::Library::ImportStage>()) {
+		auto name = string{enum_name(stage)};
+		to_lower(name);
+		line.append(format(R"("{}":{:.3f},)", name, to_seconds(library.get_import_stage_time(stage))));
+	}
+	line.back() = '}';
+	print("{}}}\n", line);
+	std::fflush(stdout);
+}
+
+static auto import_songs(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// stdout is reserved for progress reports, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-import.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(options->threads);
+	auto library_cat = globals::logger->create_category("Library", Logger::Level::Info, false);
+	auto library = bms::Library{library_cat, *globals::scheduler, options->db_path, options->songs_path};
+	if (options->workers > 0)
+		library.use_import_workers(lib::os::get_executable_path().parent_path() / ImportWorkerFilename, options->workers);
+
+	auto const start = steady_clock::now();
+	for (auto const& path: options->paths) library.import(path);
+	auto next_report = start + options->interval;
+	while (library.is_importing()) {
+		sleep_for(10ms);
+		auto const now = steady_clock::now();
+		if (now < next_report) continue;
+		print_progress(library, "progress", now - start);
+		next_report += options->interval;
+	}
+	print_progress(library, "complete", steady_clock::now() - start);
+	return EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::import_songs({argv, static_cast<std::size_t>(argc)}); }
@@ -0,0 +1,385 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/frame_pool.hpp"
+#include "utils/config.hpp"
+#include "lib/os.hpp"
+#include "bms/library.hpp"
+#include "corpus.hpp"
+#include "common.hpp"
+
+namespace playnote {
+
+// Whether coroutine frames are pooled during imports.
+enum class FramePool {
+	On,
+	Off,
+	Compare, // Every run is done twice, with and without pooling
+};
+
+struct ImportBenchOptions {
+	fs::path scratch = fs::temp_directory_path() / "playnote-import-bench";
+	uint64_t seed = 1;
+	ssize_t songs = 20;
+	corpus::SongParams song = {.charts = 2};
+	corpus::Packaging packaging = corpus::Packaging::Zip;
+	ssize_t threads = max(1u, jthread::hardware_concurrency());
+	ssize_t workers = 0; // Import worker processes; 0 imports in this process
+	ssize_t runs = 1;
+	ssize_t page = 50; // Charts per page of density thumbnails
+	FramePool frame_pool = FramePool::On;
+	optional<milliseconds> cancel_after; // Cancel each import this long after it starts
+	milliseconds cancel_limit = 1000ms; // Longest acceptable time from cancellation to idle
+	bool keep = false; // Keep the scratch directory afterwards
+};
+
+// Measurements of a single import of the whole corpus.
+struct RunResult {
+	nanoseconds elapsed;
+	nanoseconds cpu_time;
+	ssize_t peak_rss; // Largest resident set size sampled during this run's import
+	ssize_t lifetime_peak_rss; // High-water mark of the process, including earlier runs
+	ssize_t worker_peak_rss; // Largest of any worker process; workers only live for one run
+	ssize_t charts_added;
+	ssize_t charts_failed;
+	ssize_t songs_failed;
+	ssize_t songs_quarantined;
+	ssize_t bytes_processed;
+	array<nanoseconds, enum_count<bms::Library::ImportStage>()> stage_times; // Summed over all songs
+	ssize_t db_bytes;
+	ssize_t songs_bytes; // Including the audio store
+	ssize_t store_bytes;
+	ssize_t audio_reused;
+	ssize_t audio_transcoded;
+	nanoseconds thumbnail_page_median; // Time to fetch the density thumbnails of one page of charts
+	nanoseconds thumbnail_page_max;
+	bool frame_pool;
+	ssize_t frames; // Coroutine frames allocated by this process during the import
+	ssize_t frame_heap_allocations; // Global allocator calls made for those frames
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options]\n"
+		"Import a generated corpus into a scratch library and report throughput.\n"
+		"Results are written to stdout as one JSON object per run, followed by a summary.\n\n"
+		"Options:\n"
+		"  --scratch <dir>         Working directory, emptied first (default: {})\n"
+		"  --seed <n>              Seed of the corpus (default: 1)\n"
+		"  --songs <n>             Number of songs (default: 20)\n"
+		"  --charts <n>            Charts per song (default: 2)\n"
+		"  --notes <n>             Notes per chart (default: 1000)\n"
+		"  --keysounds <n>         Keysounds per song (default: 64)\n"
+		"  --keysound-length <ms>  Length of each keysound (default: 250)\n"
+		"  --shared-keysounds <0-1> Fraction of keysounds identical in every song (default: 1)\n"
+		"  --package <dir|zip|7z>  Packaging of each song (default: zip)\n"
+		"  --threads <n>           Worker thread count (default: hardware concurrency)\n"
+		"  --workers <n>           Import in this many worker processes; CPU time then only\n"
+		"                          counts this process (default: 0, import in this process)\n"
+		"  --runs <n>              Number of imports, each into an empty library (default: 1)\n"
+		"  --page <n>              Charts per page when fetching density thumbnails (default: 50)\n"
+		"  --frame-pool <on|off|compare> Pool coroutine frames, or serve them from the global\n"
+		"                          allocator; compare does every run both ways (default: on).\n"
+		"                          Frames are only counted in this process, not in workers\n"
+		"  --cancel-after <ms>     Cancel each import this long after starting it, and measure\n"
+		"                          how long it takes to stop instead of import throughput\n"
+		"  --cancel-limit <ms>     Fail if stopping takes longer than this (default: 1000)\n"
+		"  --keep                  Don't delete the scratch directory afterwards\n\n"
+		"peak_rss_bytes is sampled every 10ms during each import, so short spikes can be missed;\n"
+		"lifetime_peak_rss_bytes is the exact high-water mark, but it includes earlier runs.\n"
+		"stage_task_seconds is the wall time song imports spent in each stage, summed over songs.\n"
+		"Songs are imported concurrently, so the sums can exceed the elapsed time; they show where\n"
+		"imports wait, not where CPU time goes.\n"
+		"To measure coroutine frame pooling on a 10k-keysound import, use for example\n"
+		"  --songs 10 --keysounds 1000 --shared-keysounds 0 --frame-pool compare --runs 5\n",
+		name, fs::temp_directory_path() / "playnote-import-bench");
+}
+
+static auto parse_args(span<char const* const> args) -> optional<ImportBenchOptions>
+{
+	auto options = ImportBenchOptions{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (arg == "--keep") {
+			options.keep = true;
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--scratch") options.scratch = value;
+		else if (arg == "--seed") options.seed = lexical_cast<uint64_t>(value);
+		else if (arg == "--songs") options.songs = lexical_cast<ssize_t>(value);
+		else if (arg == "--charts") options.song.charts = lexical_cast<ssize_t>(value);
+		else if (arg == "--notes") options.song.chart.notes = lexical_cast<ssize_t>(value);
+		else if (arg == "--keysounds") options.song.chart.keysounds = lexical_cast<ssize_t>(value);
+		else if (arg == "--keysound-length") options.song.keysound_length = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--shared-keysounds") options.song.shared_keysounds = lexical_cast<float>(value);
+		else if (arg == "--package") {
+			if (value == "dir") options.packaging = corpus::Packaging::Dir;
+			else if (value == "zip") options.packaging = corpus::Packaging::Zip;
+			else if (value == "7z") options.packaging = corpus::Packaging::SevenZip;
+			else return nullopt;
+		}
+		else if (arg == "--threads") options.threads = lexical_cast<ssize_t>(value);
+		else if (arg == "--workers") options.workers = lexical_cast<ssize_t>(value);
+		else if (arg == "--runs") options.runs = lexical_cast<ssize_t>(value);
+		else if (arg == "--page") options.page = lexical_cast<ssize_t>(value);
+		else if (arg == "--frame-pool") {
+			if (value == "on") options.frame_pool = FramePool::On;
+			else if (value == "off") options.frame_pool = FramePool::Off;
+			else if (value == "compare") options.frame_pool = FramePool::Compare;
+			else return nullopt;
+		}
+		else if (arg == "--cancel-after") options.cancel_after = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--cancel-limit") options.cancel_limit = milliseconds{lexical_cast<int>(value)};
+		else return nullopt;
+	}
+	auto& chart = options.song.chart;
+	if (options.songs < 1 || options.song.charts < 1 || options.threads < 1 || options.workers < 0 || options.runs < 1 || options.page < 1) return nullopt;
+	if (chart.keysounds < 1 || chart.keysounds > corpus::MaxSlot || options.song.keysound_length <= 0ms) return nullopt;
+	if (chart.notes < 0) return nullopt;
+	if ((options.cancel_after && *options.cancel_after < 0ms) || options.cancel_limit <= 0ms) return nullopt;
+	if (options.song.shared_keysounds < 0.0f || options.song.shared_keysounds > 1.0f) return nullopt;
+	// Keep the default density of 16 notes per measure
+	chart.measures = clamp(chart.notes / 16, 16z, 999z);
+	if (chart.notes > corpus::max_notes(chart)) return nullopt;
+	return options;
+}
+
+static auto directory_size(fs::path const& path) -> ssize_t
+{
+	auto total = 0z;
+	for (auto const& entry: fs::recursive_directory_iterator{path})
+		if (entry.is_regular_file()) total += entry.file_size();
+	return total;
+}
+
+static auto file_size_or_zero(fs::path const& path) -> ssize_t
+{ return fs::exists(path)? fs::file_size(path) : 0; }
+
+// Fetch the density thumbnails of all charts, a page at a time, like a chart list being scrolled.
+// Returns the median and the longest page fetch.
+static auto fetch_thumbnail_pages(bms::Library& library, ssize_t page) -> pair<nanoseconds, nanoseconds>
+{
+	auto const charts = sync_wait(library.list_charts());
+	auto md5s = vector<bms::MD5>{};
+	md5s.reserve(charts.size());
+	for (auto const& chart: charts) md5s.emplace_back(chart.md5);
+	auto times = vector<double>{};
+	auto longest = 0ns;
+	for (auto chunk: md5s | views::chunk(page)) {
+		auto const start = steady_clock::now();
+		auto const thumbnails = sync_wait(library.load_density_thumbnails(span{chunk}));
+		auto const elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+		if (ssize(thumbnails) != ssize(chunk)) throw runtime_error_fmt("Expected {} density thumbnails, got {}", ssize(chunk), ssize(thumbnails));
+		times.emplace_back(elapsed.count());
+		longest = max(longest, elapsed);
+	}
+	if (times.empty()) return {0ns, 0ns};
+	return {nanoseconds{static_cast<int64_t>(median(move(times)))}, longest};
+}
+
+static auto run_import(fs::path const& corpus_dir, fs::path const& library_dir, ssize_t page, ssize_t workers,
+	bool frame_pool) -> RunResult
+{
+	auto const db_path = library_dir / "library.db";
+	auto const songs_path = library_dir / "songs";
+	auto result = RunResult{.frame_pool = frame_pool};
+	set_coro_frame_pooling(frame_pool);
+	{
+		auto library_cat = globals::logger->create_category("Library", Logger::Level::Info, false);
+		auto library = bms::Library{library_cat, *globals::scheduler, db_path, songs_path};
+		if (workers > 0)
+			library.use_import_workers(lib::os::get_executable_path().parent_path() / ImportWorkerFilename, workers);
+		auto const usage_before = lib::os::get_process_usage();
+		auto const frames_before = get_coro_frame_stats();
+		auto const start = steady_clock::now();
+		library.import(corpus_dir);
+		result.peak_rss = usage_before.rss;
+		while (library.is_importing()) {
+			sleep_for(10ms);
+			result.peak_rss = max(result.peak_rss, lib::os::get_process_usage().rss);
+		}
+		result.elapsed = steady_clock::now() - start;
+		auto const usage_after = lib::os::get_process_usage();
+		auto const frames_after = get_coro_frame_stats();
+		result.frames = (frames_after.pooled + frames_after.fallback + frames_after.unpooled) -
+			(frames_before.pooled + frames_before.fallback + frames_before.unpooled);
+		result.frame_heap_allocations = (frames_after.fallback + frames_after.unpooled + frames_after.slab_allocations) -
+			(frames_before.fallback + frames_before.unpooled + frames_before.slab_allocations);
+
+		result.cpu_time = usage_after.cpu_time - usage_before.cpu_time;
+		result.lifetime_peak_rss = usage_after.peak_rss;
+		result.worker_peak_rss = library.get_import_worker_peak_rss();
+		result.charts_added = library.get_import_charts_added();
+		result.charts_failed = library.get_import_charts_failed();
+		result.songs_failed = library.get_import_songs_failed();
+		result.songs_quarantined = library.get_import_songs_quarantined();
+		result.bytes_processed = library.get_import_bytes_processed();
+		result.audio_reused = library.get_import_audio_reused();
+		result.audio_transcoded = library.get_import_audio_transcoded();
+		for (auto stage: enum_values<bms::Library::ImportStage>())
+			result.stage_times[+stage] = library.get_import_stage_time(stage);
+		auto const [page_median, page_max] = fetch_thumbnail_pages(library, page);
+		result.thumbnail_page_median = page_median;
+		result.thumbnail_page_max = page_max;
+	} // Close the database, so that its size is final
+	auto db_wal = db_path;
+	db_wal.concat("-wal");
+	result.db_bytes = file_size_or_zero(db_path) + file_size_or_zero(db_wal);
+	result.songs_bytes = directory_size(songs_path);
+	result.store_bytes = directory_size(songs_path / "audio");
+	set_coro_frame_pooling(true);
+	return result;
+}
+
+// Start importing the corpus, cancel the import after a delay, and return how long it took for
+// the library to wind down. The library cancels its imports on destruction, and waits for them.
+// The library is then opened again, which throws if the cancelled import left it inconsistent.
+static auto run_cancelled_import(fs::path const& corpus_dir, fs::path const& library_dir, ssize_t workers,
+	milliseconds cancel_after) -> nanoseconds
+{
+	auto library_cat = globals::logger->create_category("Library", Logger::Level::Info, false);
+	auto library = optional<bms::Library>{};
+	library.emplace(library_cat, *globals::scheduler, library_dir / "library.db", library_dir / "songs");
+	if (workers > 0)
+		library->use_import_workers(lib::os::get_executable_path().parent_path() / ImportWorkerFilename, workers);
+	library->import(corpus_dir);
+	sleep_for(cancel_after);
+	auto const start = steady_clock::now();
+	library.reset();
+	auto const cancel_to_idle = steady_clock::now() - start;
+
+	library.emplace(library_cat, *globals::scheduler, library_dir / "library.db", library_dir / "songs");
+	sync_wait(library->list_charts());
+	return cancel_to_idle;
+}
+
+// Write the results of one run as a JSON line.
+static void print_run(ssize_t run_idx, ssize_t threads, ssize_t workers, RunResult const& result)
+{
+	auto const seconds = max(to_seconds(result.elapsed), 0.001);
+	auto const cpu_seconds = to_seconds(result.cpu_time);
+	auto line = format(R"({{"event":"run","run":{},"threads":{},"workers":{},"elapsed":{:.3f},"charts_added":{},)"
+		R"("charts_failed":{},"songs_failed":{},"songs_quarantined":{},"bytes_processed":{},"charts_per_second":{:.2f},)"
+		R"("megabytes_per_second":{:.2f},"cpu_seconds":{:.3f},"cpu_utilization":{:.3f},"peak_rss_bytes":{},)"
+		R"("lifetime_peak_rss_bytes":{},"worker_peak_rss_bytes":{},"db_bytes":{},"songs_bytes":{},"store_bytes":{},"audio_reused":{},"audio_transcoded":{},)"
+		R"("thumbnail_page_ms":{:.3f},"thumbnail_page_max_ms":{:.3f},"frame_pool":{},"frames":{},"frame_heap_allocations":{},)"
+		R"("stage_task_seconds":{{)",
+		run_idx, threads, workers, seconds, result.charts_added, result.charts_failed, result.songs_failed,
+		result.songs_quarantined, result.bytes_processed, result.charts_added / seconds, result.bytes_processed / seconds / 1e6,
+		cpu_seconds, cpu_seconds / (seconds * threads), result.peak_rss, result.lifetime_peak_rss, result.worker_peak_rss, result.db_bytes, result.songs_bytes,
+		result.store_bytes, result.audio_reused, result.audio_transcoded,
+		to_seconds(result.thumbnail_page_median) * 1000.0, to_seconds(result.thumbnail_page_max) * 1000.0,
+		result.frame_pool, result.frames, result.frame_heap_allocations);
+	for (auto stage: enum_values<bms::Library::ImportStage>()) {
+		auto name = string{enum_name(stage)};
+		to_lower(name);
+		format_to(back_inserter(line), R"("{}":{:.3f},)", name, to_seconds(result.stage_times[+stage]));
+	}
+	line.back() = '}';
+	print("{}}}\n", line);
+	std::fflush(stdout);
+}
+
+static void print_summary(span<RunResult const> results)
+{
+	auto collect = [&](auto func) {
+		auto values = vector<double>{};
+		for (auto const& result: results) values.emplace_back(func(result));
+		return median(move(values));
+	};
+	auto const elapsed = collect([](auto const& r) { return to_seconds(r.elapsed); });
+	auto const charts_per_second = collect([](auto const& r) { return r.charts_added / max(to_seconds(r.elapsed), 0.001); });
+	auto const mb_per_second = collect([](auto const& r) { return r.bytes_processed / max(to_seconds(r.elapsed), 0.001) / 1e6; });
+	auto const peak_rss = fold_left(results, 0z, [](auto acc, auto const& r) { return max(acc, r.peak_rss); });
+	auto const worker_peak_rss = fold_left(results, 0z, [](auto acc, auto const& r) { return max(acc, r.worker_peak_rss); });
+	auto const frame_heap_allocations = collect([](auto const& r) { return static_cast<double>(r.frame_heap_allocations); });
+	print(R"({{"event":"summary","runs":{},"frame_pool":{},"median_elapsed":{:.3f},"median_charts_per_second":{:.2f},)"
+		R"("median_megabytes_per_second":{:.2f},"peak_rss_bytes":{},"worker_peak_rss_bytes":{},"median_frame_heap_allocations":{:.0f}}})" "\n",
+		results.size(), results.front().frame_pool, elapsed, charts_per_second, mb_per_second, peak_rss, worker_peak_rss,
+		frame_heap_allocations);
+}
+
+static auto import_bench(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// stdout is reserved for results, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-import-bench.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(options->threads);
+
+	fs::remove_all(options->scratch);
+	auto const corpus_dir = options->scratch / "corpus";
+	fs::create_directories(corpus_dir);
+	for (auto song_idx: views::iota(0z, options->songs)) {
+		auto const seed = corpus::mix_seed(options->seed, song_idx);
+		corpus::write_song(options->song, seed, corpus_dir, format("song_{:04}", song_idx), options->packaging);
+	}
+
+	if (options->cancel_after) {
+		auto slowest = 0ns;
+		for (auto run_idx: views::iota(0z, options->runs)) {
+			auto const library_dir = options->scratch / format("run_{}", run_idx);
+			fs::create_directories(library_dir);
+			auto const cancel_to_idle = run_cancelled_import(corpus_dir, library_dir, options->workers, *options->cancel_after);
+			slowest = max(slowest, cancel_to_idle);
+			print(R"({{"event":"cancel","run":{},"workers":{},"cancel_after_ms":{},"cancel_to_idle_ms":{:.3f}}})" "\n",
+				run_idx, options->workers, options->cancel_after->count(), to_seconds(cancel_to_idle) * 1000.0);
+			std::fflush(stdout);
+			if (!options->keep) fs::remove_all(library_dir);
+		}
+		if (!options->keep) fs::remove_all(options->scratch);
+		if (slowest > options->cancel_limit) {
+			print(stderr, "Cancelled import took {:.3f}ms to stop, over the limit of {}ms\n",
+				to_seconds(slowest) * 1000.0, options->cancel_limit.count());
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// When comparing, pooled and unpooled runs alternate, so that they share any drift in conditions
+	auto modes = vector<bool>{};
+	if (options->frame_pool != FramePool::Off) modes.emplace_back(true);
+	if (options->frame_pool != FramePool::On) modes.emplace_back(false);
+	auto results = vector<vector<RunResult>>(modes.size());
+	for (auto run_idx: views::iota(0z, options->runs)) {
+		for (auto mode_idx: views::iota(0z, ssize(modes))) {
+			auto const frame_pool = modes[mode_idx];
+			auto const library_dir = options->scratch / format("run_{}{}", run_idx, frame_pool? "" : "_unpooled");
+			fs::create_directories(library_dir);
+			results[mode_idx].emplace_back(run_import(corpus_dir, library_dir, options->page, options->workers, frame_pool));
+			print_run(run_idx, options->threads, options->workers, results[mode_idx].back());
+			if (!options->keep) fs::remove_all(library_dir);
+		}
+	}
+	for (auto const& mode_results: results) print_summary(mode_results);
+
+	if (!options->keep) fs::remove_all(options->scratch);
+	return EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::import_bench({argv, static_cast<std::size_t>(argc)}); }
@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "lib/os.hpp"
+#include "io/audio_store.hpp"
+#include "bms/import_workers.hpp"
+
+namespace playnote {
+
+struct ImportWorkerOptions {
+	ssize_t index; // Distinguishes the logs and temporary files of concurrent workers
+	fs::path store_path;
+	ssize_t threads = max(1u, jthread::hardware_concurrency());
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <index>\n"
+		"Import worker process, started by the game or by playnote-import. Receives import jobs\n"
+		"on stdin and replies on stdout; not meant to be run by hand.\n\n"
+		"Options:\n"
+		"  --store <dir>      Audio store shared with the other workers (required)\n"
+		"  --threads <n>      Worker thread count (default: hardware concurrency)\n",
+		name);
+}
+
+static auto parse_args(span<char const* const> args) -> optional<ImportWorkerOptions>
+{
+	auto options = ImportWorkerOptions{};
+	auto index = optional<ssize_t>{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			if (index) return nullopt;
+			index = lexical_cast<ssize_t>(arg);
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--store") options.store_path = value;
+		else if (arg == "--threads") options.threads = lexical_cast<ssize_t>(value);
+		else return nullopt;
+	}
+	if (!index || options.store_path.empty() || options.threads < 1) return nullopt;
+	options.index = *index;
+	return options;
+}
+
+static auto run_worker(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// stdout carries replies to the parent, so logs only go to the file
+	auto logger_stub = globals::logger.provide(format("playnote-import-worker-{}.log", options->index),
+		Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(options->threads, [](auto worker_idx) {
+		lib::os::name_current_thread(format("worker{}", worker_idx));
+		lib::os::lower_current_thread_priority();
+	});
+	auto library_cat = globals::logger->create_category("Library", Logger::Level::Info, false);
+	auto audio_store = io::AudioStore{options->store_path, format("w{}.", options->index)};
+	INFO_AS(library_cat, "Import worker {} ready", options->index);
+	bms::serve_import_jobs(library_cat, *globals::scheduler, audio_store);
+	INFO_AS(library_cat, "Import worker {} exiting", options->index);
+	return EXIT_SUCCESS;
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::run_worker({argv, static_cast<std::size_t>(argc)}); }
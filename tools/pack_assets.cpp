@@ -8,55 +8,143 @@ or distributed except according to those terms.
 */
 
 #include "preamble.hpp"
+#include "utils/assets.hpp"
 #include "io/file.hpp"
-#include "lib/sqlite.hpp"
 #include "lib/zstd.hpp"
 
 namespace playnote {
 
-static constexpr auto AssetsSchema = R"sql(
-	CREATE TABLE assets(
-		id INTEGER PRIMARY KEY,
-		compressed INTEGER NOT NULL,
-		data BLOB NOT NULL
-	)
-)sql";
-
-struct InsertAsset {
-	static constexpr auto Query = R"sql(
-		INSERT INTO assets(id, compressed, data) VALUES(?1, ?2, ?3)
-	)sql";
-	using Params = tuple<uint, int, span<byte const>>;
+// Compression is only kept if it saves at least this fraction of the size; otherwise the asset
+// is already compressed, and decompressing it at runtime would be wasted work.
+static constexpr auto MinCompressionGain = 0.05;
+static constexpr auto MaxDictionarySize = 64z * 1024;
+
+struct InputAsset {
+	uint id;
+	Assets::Compression compression;
+	io::ReadFile file;
+	vector<byte> stored; // Compressed data, empty if stored raw
 };
 
+// Append bytes of a trivially copyable object to the output.
+template<typename T>
+static void append(vector<byte>& out, T const& value)
+{
+	auto const bytes = std::as_bytes(span{&value, 1});
+	copy(bytes, back_inserter(out));
+}
+
+static void align(vector<byte>& out)
+{ out.resize((out.size() + Assets::DataAlignment - 1) / Assets::DataAlignment * Assets::DataAlignment); }
+
 auto pack_assets(span<char const* const> args)
 try {
 	if (args.size() < 3) {
-		print(stderr, "Usage: {} <output database> <input assets>...\nInput asset: <path>[:z]", args[0]);
+		print(stderr, "Usage: {} <output pack> <input assets>...\nInput asset: <path>[:z|:d]\n"
+			":z compresses the asset, :d compresses it with a dictionary shared by all :d assets", args[0]);
 		return EXIT_FAILURE;
 	}
 	auto* out_filename = args[1];
 	auto in_filenames = args.subspan(2);
 
-	if (fs::exists(out_filename)) fs::remove(out_filename);
-	auto db = lib::sqlite::open(out_filename);
-	lib::sqlite::execute(db, AssetsSchema);
-
-	auto stmt = lib::sqlite::prepare<InsertAsset>(db);
+	auto assets = vector<InputAsset>{};
 	for (auto path_cstr: in_filenames) {
 		auto path_sv = string_view{path_cstr};
-		auto compress = false;
+		auto compression = Assets::Compression::None;
 		if (path_sv.ends_with(":z")) {
-			compress = true;
+			compression = Assets::Compression::Zstd;
+			path_sv.remove_suffix(2);
+		} else if (path_sv.ends_with(":d")) {
+			compression = Assets::Compression::ZstdDictionary;
 			path_sv.remove_suffix(2);
 		}
 		auto path = fs::path{path_sv};
 		auto filename = path.filename().string();
-		auto filename_id = id{filename};
-		auto file = io::read_file(path);
-		lib::sqlite::execute(stmt, +filename_id, compress,
-			compress? lib::zstd::compress(file.contents, lib::zstd::CompressionLevel::Ultra) : file.contents);
+		assets.emplace_back(InputAsset{
+			.id = +id{filename},
+			.compression = compression,
+			.file = io::read_file(path),
+		});
 	}
+	sort(assets, {}, &InputAsset::id);
+	if (auto const dup = std::ranges::adjacent_find(assets, {}, &InputAsset::id); dup != assets.end())
+		throw runtime_error_fmt("Two assets share the ID {}", dup->id);
+
+	// Train the shared dictionary
+	auto dictionary = vector<byte>{};
+	auto samples = vector<span<byte const>>{};
+	for (auto const& asset: assets)
+		if (asset.compression == Assets::Compression::ZstdDictionary) samples.emplace_back(asset.file.contents);
+	if (!samples.empty()) {
+		try {
+			dictionary = lib::zstd::train_dictionary(samples, MaxDictionarySize);
+		} catch (exception const& e) {
+			print(stderr, "{}; compressing without a dictionary\n", e.what());
+			for (auto& asset: assets)
+				if (asset.compression == Assets::Compression::ZstdDictionary) asset.compression = Assets::Compression::Zstd;
+		}
+	}
+
+	// Compress, and keep the result only where it pays off
+	for (auto& asset: assets) {
+		if (asset.compression == Assets::Compression::None) continue;
+		asset.stored = asset.compression == Assets::Compression::ZstdDictionary?
+			lib::zstd::compress(asset.file.contents, dictionary, lib::zstd::CompressionLevel::Ultra) :
+			lib::zstd::compress(asset.file.contents, lib::zstd::CompressionLevel::Ultra);
+		if (static_cast<double>(asset.stored.size()) > static_cast<double>(asset.file.contents.size()) * (1.0 - MinCompressionGain)) {
+			asset.compression = Assets::Compression::None;
+			asset.stored.clear();
+		}
+	}
+	auto const uses_dictionary = any_of(assets, [](auto const& asset) { return asset.compression == Assets::Compression::ZstdDictionary; });
+	auto const dictionary_count = uses_dictionary? 1u : 0u;
+
+	// Lay out the data after the tables
+	auto out = vector<byte>{};
+	auto offset = sizeof(Assets::Header) + assets.size() * sizeof(Assets::Entry) + dictionary_count * sizeof(Assets::Dictionary);
+	auto align_offset = [&] { offset = (offset + Assets::DataAlignment - 1) / Assets::DataAlignment * Assets::DataAlignment; };
+	align_offset();
+	auto const dictionary_entry = Assets::Dictionary{.offset = offset, .size = dictionary.size()};
+	if (uses_dictionary) {
+		offset += dictionary.size();
+		align_offset();
+	}
+	auto entries = vector<Assets::Entry>{};
+	for (auto const& asset: assets) {
+		auto const data = asset.compression == Assets::Compression::None? asset.file.contents : span<byte const>{asset.stored};
+		entries.emplace_back(Assets::Entry{
+			.id = asset.id,
+			.compression = asset.compression,
+			.dictionary = 0,
+			.reserved = 0,
+			.offset = offset,
+			.size = data.size(),
+			.raw_size = asset.file.contents.size(),
+		});
+		offset += data.size();
+		align_offset();
+	}
+
+	append(out, Assets::Header{
+		.magic = Assets::Magic,
+		.version = Assets::Version,
+		.entry_count = static_cast<uint>(entries.size()),
+		.dictionary_count = dictionary_count,
+	});
+	for (auto const& entry: entries) append(out, entry);
+	if (uses_dictionary) append(out, dictionary_entry);
+	align(out);
+	if (uses_dictionary) {
+		copy(dictionary, back_inserter(out));
+		align(out);
+	}
+	for (auto const& asset: assets) {
+		copy(asset.compression == Assets::Compression::None? asset.file.contents : span<byte const>{asset.stored}, back_inserter(out));
+		align(out);
+	}
+
+	if (fs::exists(out_filename)) fs::remove(out_filename);
+	io::write_file(out_filename, out);
 	return EXIT_SUCCESS;
 }
 catch (exception const& e) {
@@ -0,0 +1,166 @@
+/*
+Copyright (c) 2026 Tearnote (Hubert Maraszek)
+
+Licensed under the Mozilla Public License Version 2.0 <LICENSE-MPL-2.0.txt
+or https://www.mozilla.org/en-US/MPL/2.0/> or the Boost Software License <LICENSE-BSL-1.0.txt
+or https://www.boost.org/LICENSE_1_0.txt>, at your option. This file may not be copied, modified,
+or distributed except according to those terms.
+*/
+
+#include <cstdlib>
+#include <clocale>
+#include "preamble.hpp"
+#include "utils/task_pool.hpp"
+#include "utils/logger.hpp"
+#include "utils/config.hpp"
+#include "io/source.hpp"
+#include "io/song.hpp"
+#include "io/file.hpp"
+#include "audio/mixer.hpp"
+#include "audio/player.hpp"
+#include "bms/builder.hpp"
+#include "bms/cursor.hpp"
+#include "bms/mapper.hpp"
+#include "common.hpp"
+
+namespace playnote {
+
+struct WatchOptions {
+	fs::path chart;
+	milliseconds interval = 100ms; // How often the chart file is checked for changes
+	milliseconds budget = 250ms; // Reloads that take longer are reported as slow
+	milliseconds start = 0ms; // Initial playback position
+};
+
+static void print_usage(char const* name)
+{
+	print(stderr, "Usage: {} [options] <chart>\n"
+		"Play a BMS chart on autoplay, and reload it whenever the file is saved. Playback continues\n"
+		"from the same position in the new version of the chart. Only measures that changed\n"
+		"are parsed again, and keysounds are never decoded twice. Every reload is written\n"
+		"to stdout as a JSON object.\n\n"
+		"Options:\n"
+		"  --interval <ms>  How often to check the chart for changes (default: 100)\n"
+		"  --budget <ms>    Report reloads that take longer than this as slow (default: 250)\n"
+		"  --start <ms>     Start playback from this position (default: 0)\n",
+		name);
+}
+
+static auto parse_args(span<char const* const> args) -> optional<WatchOptions>
+{
+	auto options = WatchOptions{};
+	auto chart = optional<fs::path>{};
+	for (auto idx = 1z; idx < static_cast<ssize_t>(args.size()); idx += 1) {
+		auto const arg = string_view{args[idx]};
+		if (!arg.starts_with("--")) {
+			if (chart) return nullopt;
+			chart = arg;
+			continue;
+		}
+		if (idx + 1 >= static_cast<ssize_t>(args.size())) return nullopt;
+		auto const value = string_view{args[++idx]};
+		if (arg == "--interval") options.interval = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--budget") options.budget = milliseconds{lexical_cast<int>(value)};
+		else if (arg == "--start") options.start = milliseconds{lexical_cast<int>(value)};
+		else return nullopt;
+	}
+	if (!chart || options.interval <= 0ms || options.budget <= 0ms || options.start < 0ms) return nullopt;
+	options.chart = move(*chart);
+	return options;
+}
+
+// Read the whole chart file. The file is copied out of the mapping right away, since an editor
+// might be rewriting it.
+static auto read_chart(fs::path const& path) -> vector<byte>
+{
+	auto const file = io::read_file(path);
+	return vector<byte>{file.contents.begin(), file.contents.end()};
+}
+
+static auto to_ms(nanoseconds ns) -> double { return duration_cast<duration<double, std::milli>>(ns).count(); }
+
+static auto watch(span<char const* const> args) -> int
+try {
+	std::setlocale(LC_ALL, "en_US.UTF-8"); //TODO remove after forking libarchive
+	auto const options = parse_args(args);
+	if (!options) {
+		print_usage(args[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Input mappers read their bindings from the config
+	auto config_stub = globals::config.provide();
+	globals::config->load_from_file();
+	// stdout is reserved for results, so logs only go to the file
+	auto logger_stub = globals::logger.provide("playnote-watch.log", Logger::Level::Info, false);
+	auto scheduler_stub = globals::scheduler.provide(max(1u, jthread::hardware_concurrency()));
+	auto mixer_stub = globals::mixer.provide(globals::logger->global);
+	auto& scheduler = *globals::scheduler;
+	auto cat = globals::logger->global;
+	auto const sampling_rate = globals::mixer->get_audio().get_sampling_rate();
+
+	// The chart's folder is imported once, for its keysounds. The chart itself is always read
+	// from disk
+	auto const scratch = fs::temp_directory_path() / "playnote-watch";
+	fs::remove_all(scratch);
+	fs::create_directories(scratch);
+	auto song = sync_wait(io::Song::from_source(cat, scheduler, io::Source{fs::absolute(options->chart).parent_path()},
+		scratch / "song.zip"));
+	sync_wait(song.preload_audio_files(scheduler, sampling_rate));
+
+	auto builder = bms::Builder{cat};
+	auto last_write = fs::last_write_time(options->chart);
+	auto chart = sync_wait(builder.rebuild(scheduler, read_chart(options->chart), song, sampling_rate));
+	auto player = audio::Player{};
+	auto cursor = make_shared<bms::Cursor>(chart, true);
+	cursor->seek_ns(options->start);
+	player.add_cursor(cursor, bms::Mapper{});
+	print(R"({{"event":"loaded","notes":{},"measures":{}}})" "\n",
+		chart->metadata.note_count, builder.get_rebuild_stats().measures_total);
+	std::fflush(stdout);
+
+	while (true) {
+		sleep_for(options->interval);
+		auto error = std::error_code{};
+		auto const write = fs::last_write_time(options->chart, error);
+		if (error || write == last_write) continue; // Editors can briefly remove the file while saving
+		last_write = write;
+
+		auto const start = steady_clock::now();
+		try {
+			chart = sync_wait(builder.rebuild(scheduler, read_chart(options->chart), song, sampling_rate));
+		} catch (exception const& e) {
+			WARN("Failed to reload the chart: {}", e.what());
+			print(R"({{"event":"error","message":"{}"}})" "\n", json_escape(e.what()));
+			std::fflush(stdout);
+			continue;
+		}
+
+		// Continue from the position that's audible right now, rather than the end of the last buffer
+		auto const progress = player.get_audio_cursor(cursor).get_progress();
+		auto new_cursor = make_shared<bms::Cursor>(chart, true);
+		new_cursor->seek(progress);
+		player.remove_cursor(cursor);
+		player.add_cursor(new_cursor, bms::Mapper{});
+		cursor = move(new_cursor);
+		auto const latency = steady_clock::now() - start;
+
+		auto const stats = builder.get_rebuild_stats();
+		if (latency > options->budget)
+			WARN("Reload took {:.1f}ms, over the budget of {}ms", to_ms(latency), options->budget / 1ms);
+		print(R"({{"event":"reload","latency_ms":{:.2f},"slow":{},"full":{},"measures_parsed":{},)"
+			R"("measures_total":{},"position_ms":{:.0f},"notes":{}}})" "\n",
+			to_ms(latency), latency > options->budget, stats.full, stats.measures_parsed,
+			stats.measures_total, to_ms(cursor->get_progress_ns()), chart->metadata.note_count);
+		std::fflush(stdout);
+	}
+}
+catch (exception const& e) {
+	print(stderr, "Uncaught exception: {}\n", e.what());
+	return EXIT_FAILURE;
+}
+
+}
+
+auto main(int argc, char** argv) -> int
+{ return playnote::watch({argv, static_cast<std::size_t>(argc)}); }